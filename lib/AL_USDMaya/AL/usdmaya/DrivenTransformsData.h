@@ -60,7 +60,8 @@ public:
   AL_USDMAYA_PUBLIC
   static const MString kName;
 
-  /// the structure of driven transform
+  /// the structure of driven transform. Nodes that output this data can write their matrices directly into
+  /// m_drivenTransforms.drivenMatrixBuffer(), and then dirty them with m_drivenTransforms.dirtyMatrices(first, count).
   nodes::proxy::DrivenTransforms m_drivenTransforms;
 
 private:
@@ -149,6 +149,8 @@ static void postFileRead(void*)
   {
     std::vector<MObjectHandle>& unloadedProxies = nodes::ProxyShape::GetUnloadedProxyShapes();
     unsigned int numUnloadedProxies = unloadedProxies.size();
+    std::vector<nodes::ProxyShape*> proxies;
+    proxies.reserve(numUnloadedProxies);
     for(unsigned int i = 0; i < numUnloadedProxies; ++i)
     {
       if(!(unloadedProxies[i].isValid() && unloadedProxies[i].isAlive()))
@@ -161,18 +163,19 @@ static void postFileRead(void*)
         TF_CODING_ERROR("ProxyShape::m_unloadedProxyShapes had a non-Proxy-Shape mobject");
         continue;
       }
+      proxies.push_back((nodes::ProxyShape*)fn.userNode());
+    }
+    unloadedProxies.clear();
+
+    // open the stages of all of the proxy shapes concurrently, to ensure that each one has a valid USD stage!
+    nodes::ProxyShape::loadStages(proxies);
 
-      // execute a pull on each proxy shape to ensure that each one has a valid USD stage!
-      nodes::ProxyShape* proxy = (nodes::ProxyShape*)fn.userNode();
-      proxy->loadStage();
-      auto stage = proxy->getUsdStage();
-      proxy->deserialiseTranslatorContext();
-      proxy->findTaggedPrims();
-      proxy->deserialiseTransformRefs();
-      proxy->constructGLImagingEngine();
+    // (if a proxy is loading asynchronously, the deserialisation is deferred until the stage is available)
+    for(nodes::ProxyShape* proxy : proxies)
+    {
+      proxy->deserialiseAfterFileRead();
       proxy->addAttributeChangedCallback();
     }
-    unloadedProxies.clear();
   }
   {
     MItDependencyNodes iter(MFn::kPluginTransformNode);
@@ -200,6 +203,8 @@ static void _preFileSave()
   // those AL::usdmaya::nodes::Transform nodes that are created because they are required, or have been requested).
   MGlobal::clearSelectionList();
 
+  // make sure the layers are saved with any transform edits that are still waiting to be written
+  nodes::TransformationMatrix::flushPendingPushes();
   nodes::ProxyShape::serializeAll();
 }
 
@@ -248,6 +253,7 @@ static void postFileSave(void*)
 //----------------------------------------------------------------------------------------------------------------------
 static void preFileExport(void* p)
 {
+  nodes::TransformationMatrix::flushPendingPushes();
   nodes::ProxyShape::serializeAll();
 }
 
@@ -292,6 +298,7 @@ void Global::onPluginUnload()
   manager.unregisterCallback(m_preExport);
   manager.unregisterCallback(m_postExport);
   StageCache::removeCallbacks();
+  nodes::TransformationMatrix::freePushQueue();
 
   AL::maya::event::MayaEventManager::freeInstance();
   AL::event::EventScheduler::freeScheduler();
@@ -0,0 +1,295 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "AL/usdmaya/MetadataIndex.h"
+#include "AL/usdmaya/DebugCodes.h"
+#include "AL/usdmaya/Metadata.h"
+
+#include "pxr/usd/sdf/changeList.h"
+#include "pxr/usd/sdf/schema.h"
+
+#include <algorithm>
+
+namespace AL {
+namespace usdmaya {
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::build(const UsdStageRefPtr& stage)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("MetadataIndex::build\n");
+  clear();
+  if(!stage)
+    return;
+
+  m_stage = stage;
+  refreshLayers();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::clear()
+{
+  m_layers.clear();
+  m_stage = UsdStageWeakPtr();
+  m_layersDirty = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::refreshLayers()
+{
+  m_layersDirty = false;
+  if(!m_stage)
+    return;
+
+  const SdfLayerHandleVector rootLayerStack = m_stage->GetLayerStack(true);
+  const SdfLayerHandleVector usedLayers = m_stage->GetUsedLayers(true);
+
+  // drop any layers the stage no longer uses
+  for(auto it = m_layers.begin(); it != m_layers.end(); )
+  {
+    if(!it->first || std::find(usedLayers.begin(), usedLayers.end(), it->first) == usedLayers.end())
+    {
+      it = m_layers.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  // and scan any that have not been seen before
+  for(const SdfLayerHandle& layer : usedLayers)
+  {
+    auto inserted = m_layers.insert(std::make_pair(layer, LayerEntry()));
+    LayerEntry& entry = inserted.first->second;
+    entry.inRootLayerStack = std::find(rootLayerStack.begin(), rootLayerStack.end(), layer) != rootLayerStack.end();
+    if(inserted.second)
+    {
+      scanLayer(layer, entry);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::scanLayer(const SdfLayerHandle& layer, LayerEntry& entry)
+{
+  entry.specs.clear();
+  layer->Traverse(SdfPath::AbsoluteRootPath(), [this, &layer, &entry](const SdfPath& path)
+  {
+    scanSpec(layer, path, entry);
+  });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::scanSpec(const SdfLayerHandle& layer, const SdfPath& specPath, LayerEntry& entry)
+{
+  if(!specPath.IsPrimOrPrimVariantSelectionPath())
+    return;
+
+  uint32_t tags = 0;
+  if(layer->HasField(specPath, Metadata::selectability))
+    tags |= kSelectability;
+  if(layer->HasField(specPath, Metadata::locked))
+    tags |= kLocked;
+  if(layer->HasField(specPath, Metadata::excludeFromProxyShape))
+    tags |= kExcludeFromProxyShape;
+  if(layer->HasField(specPath, Metadata::importAsNative))
+    tags |= kImportAsNative;
+
+  if(tags)
+  {
+    entry.specs[specPath] = tags;
+  }
+  else
+  {
+    entry.specs.erase(specPath);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::rescanSubtree(const SdfLayerHandle& layer, const SdfPath& path, LayerEntry& entry)
+{
+  // specs within variants do not necessarily sort next to their parent prim, so check all of the tagged specs
+  for(auto it = entry.specs.lower_bound(path); it != entry.specs.end(); )
+  {
+    if(it->first.HasPrefix(path))
+    {
+      it = entry.specs.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  layer->Traverse(path, [this, &layer, &entry](const SdfPath& specPath)
+  {
+    scanSpec(layer, specPath, entry);
+  });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::layersDidChange(const SdfNotice::LayersDidChange& notice)
+{
+  if(!m_stage)
+    return;
+
+  for(const auto& layerChanges : notice.GetChangeListMap())
+  {
+    auto found = m_layers.find(layerChanges.first);
+    if(found == m_layers.end())
+    {
+      continue;
+    }
+
+    const SdfLayerHandle& layer = found->first;
+    LayerEntry& entry = found->second;
+    for(const auto& change : layerChanges.second.GetEntryList())
+    {
+      const SdfPath& path = change.first;
+      const SdfChangeList::Entry& changeEntry = change.second;
+
+      // any change to the layers composed into the stage requires the set of used layers to be refreshed
+      if(!changeEntry.subLayerChanges.empty() ||
+         changeEntry.flags.didChangePrimReferences ||
+         changeEntry.flags.didChangePrimInheritPaths ||
+         changeEntry.flags.didChangePrimSpecializes ||
+         changeEntry.flags.didChangePrimVariantSets)
+      {
+        m_layersDirty = true;
+      }
+
+      if(changeEntry.flags.didReplaceContent || changeEntry.flags.didReloadContent)
+      {
+        scanLayer(layer, entry);
+        m_layersDirty = true;
+        continue;
+      }
+
+      if(path == SdfPath::AbsoluteRootPath() || !path.IsPrimOrPrimVariantSelectionPath())
+      {
+        continue;
+      }
+
+      // prims that have been added, removed or renamed need their entire subtree rescanned
+      if(changeEntry.flags.didAddInertPrim || changeEntry.flags.didAddNonInertPrim ||
+         changeEntry.flags.didRemoveInertPrim || changeEntry.flags.didRemoveNonInertPrim ||
+         changeEntry.flags.didRename || !changeEntry.oldPath.IsEmpty())
+      {
+        if(!changeEntry.oldPath.IsEmpty())
+        {
+          rescanSubtree(layer, changeEntry.oldPath, entry);
+        }
+        rescanSubtree(layer, path, entry);
+        continue;
+      }
+
+      for(const auto& info : changeEntry.infoChanged)
+      {
+        if(info.first == Metadata::selectability || info.first == Metadata::locked ||
+           info.first == Metadata::excludeFromProxyShape || info.first == Metadata::importAsNative ||
+           info.first == SdfFieldKeys->Payload || info.first == SdfFieldKeys->VariantSelection)
+        {
+          // a different variant may bring in a different set of layers
+          if(info.first == SdfFieldKeys->Payload || info.first == SdfFieldKeys->VariantSelection)
+          {
+            m_layersDirty = true;
+          }
+          else
+          {
+            scanSpec(layer, path, entry);
+          }
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::objectsChanged(const UsdNotice::ObjectsChanged& notice)
+{
+  if(m_stage && notice.GetStage() == m_stage && !notice.GetResyncedPaths().empty())
+  {
+    m_layersDirty = true;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MetadataIndex::isComplete()
+{
+  if(!m_stage)
+    return false;
+
+  if(m_layersDirty)
+  {
+    refreshLayers();
+  }
+
+  for(const auto& layer : m_layers)
+  {
+    if(!layer.second.inRootLayerStack && !layer.second.specs.empty())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MetadataIndex::taggedPaths(uint32_t tags, SdfPathVector& paths)
+{
+  paths.clear();
+  if(m_layersDirty)
+  {
+    refreshLayers();
+  }
+
+  for(const auto& layer : m_layers)
+  {
+    if(!layer.second.inRootLayerStack)
+      continue;
+
+    for(const auto& spec : layer.second.specs)
+    {
+      if(spec.second & tags)
+      {
+        // opinions authored within a variant apply to the prim the variant set is on
+        paths.push_back(spec.first.ContainsPrimVariantSelection() ? spec.first.StripAllVariantSelections() : spec.first);
+      }
+    }
+  }
+
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t MetadataIndex::numTaggedSpecs()
+{
+  if(m_layersDirty)
+  {
+    refreshLayers();
+  }
+
+  size_t count = 0;
+  for(const auto& layer : m_layers)
+  {
+    count += layer.second.specs.size();
+  }
+  return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
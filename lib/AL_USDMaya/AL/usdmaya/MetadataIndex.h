@@ -0,0 +1,135 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#pragma once
+
+#include "./Api.h"
+
+#include "pxr/pxr.h"
+#include "pxr/usd/sdf/layer.h"
+#include "pxr/usd/sdf/notice.h"
+#include "pxr/usd/sdf/path.h"
+#include "pxr/usd/usd/notice.h"
+#include "pxr/usd/usd/stage.h"
+
+#include <map>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace AL {
+namespace usdmaya {
+
+///---------------------------------------------------------------------------------------------------------------------
+/// \brief  An index of the prim specs within the layers of a stage that carry any of the AL metadata keys
+///         (selectability, lock, excludeFromProxyShape and importAsNative). The index is built by scanning the layer
+///         specs once, and is then kept up to date from the SdfNotice::LayersDidChange notifications.
+///
+///         Spec paths within the root layer stack of the stage are also the paths of the composed prims, so if every
+///         tagged spec is found in the root layer stack, the index can be used in place of a traversal of the
+///         composed stage. If tags are found in layers brought in through references or payloads, isComplete() will
+///         return false, and a full traversal is still required.
+///---------------------------------------------------------------------------------------------------------------------
+class MetadataIndex
+{
+public:
+
+  /// the metadata keys tracked by the index
+  enum Tag
+  {
+    kSelectability = 1 << 0,          ///< Metadata::selectability
+    kLocked = 1 << 1,                 ///< Metadata::locked
+    kExcludeFromProxyShape = 1 << 2,  ///< Metadata::excludeFromProxyShape
+    kImportAsNative = 1 << 3,         ///< Metadata::importAsNative
+    kAllTags = 0xF
+  };
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  scans all of the layers used by the stage, and records the prim specs that carry AL metadata
+  /// \param  stage the stage to index
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  void build(const UsdStageRefPtr& stage);
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  discards the index
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  void clear();
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  returns true if the index has been built for a stage
+  ///-------------------------------------------------------------------------------------------------------------------
+  bool isValid() const
+    { return bool(m_stage); }
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  updates the index for the specs modified within the layers. Changes to layers that are not used by the
+  ///         indexed stage are ignored.
+  /// \param  notice the layer change notification
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  void layersDidChange(const SdfNotice::LayersDidChange& notice);
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  flags the set of used layers to be refreshed if any prims of the stage have been resynced. Loading or
+  ///         unloading a payload changes the layers used by the stage without modifying any layer, so is only
+  ///         reported through the stage notice.
+  /// \param  notice the stage change notification
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  void objectsChanged(const UsdNotice::ObjectsChanged& notice);
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  returns true if all of the tagged specs are within the root layer stack of the stage (in which case the
+  ///         paths returned from taggedPaths are the paths of all the tagged prims)
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  bool isComplete();
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  returns the paths of the prim specs in the root layer stack carrying any of the requested tags
+  /// \param  tags a bitmask of MetadataIndex::Tag values
+  /// \param  paths the returned (sorted) paths
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  void taggedPaths(uint32_t tags, SdfPathVector& paths);
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  returns the total number of tagged specs found across all of the layers of the stage
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  size_t numTaggedSpecs();
+
+private:
+  struct LayerEntry
+  {
+    std::map<SdfPath, uint32_t> specs;
+    bool inRootLayerStack = false;
+  };
+  void refreshLayers();
+  void scanLayer(const SdfLayerHandle& layer, LayerEntry& entry);
+  void scanSpec(const SdfLayerHandle& layer, const SdfPath& specPath, LayerEntry& entry);
+  void rescanSubtree(const SdfLayerHandle& layer, const SdfPath& path, LayerEntry& entry);
+
+private:
+  std::map<SdfLayerHandle, LayerEntry> m_layers;
+  UsdStageWeakPtr m_stage;
+  bool m_layersDirty = false;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
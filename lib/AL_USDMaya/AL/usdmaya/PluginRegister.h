@@ -72,6 +72,16 @@ MStatus registerPlugin(AFnPlugin& plugin)
     MGlobal::setOptionVarValue("AL_usdmaya_selectResolution", 10);
   }
 
+  if(!MGlobal::optionVarExists("AL_usdmaya_pickMode"))
+  {
+    MGlobal::setOptionVarValue("AL_usdmaya_pickMode", 0);
+  }
+
+  if(!MGlobal::optionVarExists("AL_usdmaya_deferPushToPrim"))
+  {
+    MGlobal::setOptionVarValue("AL_usdmaya_deferPushToPrim", 1);
+  }
+
   MStatus status;
 
   // gpuCachePluginMain used as an example.
@@ -3,82 +3,143 @@
 namespace AL {
 namespace usdmaya {
 
-bool SelectabilityDB::isPathUnselectable(const SdfPath& path) const
+SdfPath SelectabilityDB::findUnselectableAncestor(const SdfPath& path) const
 {
-  for(SdfPath unselectablePath : m_unselectablePaths)
+  if(m_pathTree.empty() || !path.IsAbsolutePath())
+  {
+    return SdfPath();
+  }
+
+  // only the ancestors of the path need to be checked, so this is proportional to the depth of the path
+  for(SdfPath ancestor = path; !ancestor.IsEmpty(); ancestor = ancestor.GetParentPath())
   {
-    if(path.HasPrefix(unselectablePath))
+    auto it = m_pathTree.find(ancestor);
+    if(it != m_pathTree.end() && it->second.unselectable)
     {
-      return true;
+      return ancestor;
     }
   }
 
-  return false;
+  return SdfPath();
 }
 
-void SelectabilityDB::removePathsAsUnselectable(const SdfPathVector& paths)
+bool SelectabilityDB::isPathUnselectable(const SdfPath& path) const
 {
-  bool needsSort = false;
-  for(SdfPath path : paths)
-  {
-    needsSort |= removeUnselectablePath(path);
-  }
+  return !findUnselectableAncestor(path).IsEmpty();
+}
+
+bool SelectabilityDB::isPathExplicitlyUnselectable(const SdfPath& path) const
+{
+  auto it = m_pathTree.find(path);
+  return it != m_pathTree.end() && it->second.unselectable;
+}
+
+bool SelectabilityDB::hasUnselectableDescendants(const SdfPath& path) const
+{
+  auto it = m_pathTree.find(path);
+  return it != m_pathTree.end() && it->second.unselectableDescendants != 0;
+}
 
-  if(needsSort)
+void SelectabilityDB::removePathsAsUnselectable(const SdfPathVector& paths)
+{
+  for(const SdfPath& path : paths)
   {
-    sort();
+    m_unselectablePathsDirty |= removeUnselectablePath(path);
   }
 }
 
 void SelectabilityDB::removePathAsUnselectable(const SdfPath& path)
 {
-  if(removeUnselectablePath(path))
-  {
-    sort();
-  }
+  m_unselectablePathsDirty |= removeUnselectablePath(path);
 }
 
 void SelectabilityDB::addPathsAsUnselectable(const SdfPathVector& paths)
 {
-  bool needsSort = false;
-  for(SdfPath path : paths)
-  {
-    needsSort |= addUnselectablePath(path);
-  }
-
-  if(needsSort)
+  for(const SdfPath& path : paths)
   {
-    sort();
+    m_unselectablePathsDirty |= addUnselectablePath(path);
   }
 }
 
 void SelectabilityDB::addPathAsUnselectable(const SdfPath& path)
 {
-  if(addUnselectablePath(path))
+  m_unselectablePathsDirty |= addUnselectablePath(path);
+}
+
+const SdfPathVector& SelectabilityDB::getUnselectablePaths() const
+{
+  if(m_unselectablePathsDirty)
   {
-    sort();
+    m_unselectablePaths.clear();
+    for(const auto& it : m_pathTree)
+    {
+      if(it.second.unselectable)
+      {
+        m_unselectablePaths.push_back(it.first);
+      }
+    }
+    std::sort(m_unselectablePaths.begin(), m_unselectablePaths.end());
+    m_unselectablePathsDirty = false;
   }
+  return m_unselectablePaths;
+}
+
+void SelectabilityDB::clear()
+{
+  m_pathTree.clear();
+  m_unselectablePaths.clear();
+  m_unselectablePathsDirty = false;
 }
 
 bool SelectabilityDB::removeUnselectablePath(const SdfPath& path)
 {
-  auto foundPathEntry = std::find(m_unselectablePaths.begin(), m_unselectablePaths.end(), path);
-  if(foundPathEntry != m_unselectablePaths.end())
+  auto foundPathEntry = m_pathTree.find(path);
+  if(foundPathEntry == m_pathTree.end() || !foundPathEntry->second.unselectable)
+  {
+    return false;
+  }
+  foundPathEntry->second.unselectable = false;
+
+  for(SdfPath parent = path.GetParentPath(); !parent.IsEmpty(); parent = parent.GetParentPath())
   {
-    m_unselectablePaths.erase(foundPathEntry);
-    return true;
+    --m_pathTree.find(parent)->second.unselectableDescendants;
   }
-  return false;
+
+  // prune the branches of the tree that no longer lead to an unselectable path
+  SdfPath prunePath = path;
+  while(!prunePath.IsEmpty())
+  {
+    auto it = m_pathTree.find(prunePath);
+    if(it->second.unselectable || it->second.unselectableDescendants)
+    {
+      break;
+    }
+    m_pathTree.erase(it);
+    prunePath = prunePath.GetParentPath();
+  }
+  return true;
 }
 
 bool SelectabilityDB::addUnselectablePath(const SdfPath& path)
 {
-  if(!std::binary_search(m_unselectablePaths.begin(), m_unselectablePaths.end(), path))
+  if(!path.IsAbsolutePath())
+  {
+    return false;
+  }
+
+  // inserting the path also inserts all of its ancestors
+  auto inserted = m_pathTree.insert(std::make_pair(path, PathNode()));
+  if(inserted.first->second.unselectable)
+  {
+    return false;
+  }
+  inserted.first->second.unselectable = true;
+
+  for(SdfPath parent = path.GetParentPath(); !parent.IsEmpty(); parent = parent.GetParentPath())
   {
-    m_unselectablePaths.push_back(path);
-    return true;
+    ++m_pathTree.find(parent)->second.unselectableDescendants;
   }
-  return false;
+  return true;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -5,6 +5,7 @@
 #include "pxr/pxr.h"
 #include "pxr/usd/usd/prim.h"
 #include "pxr/usd/sdf/path.h"
+#include "pxr/usd/sdf/pathTable.h"
 #include <algorithm>
 
 PXR_NAMESPACE_USING_DIRECTIVE
@@ -13,7 +14,11 @@ namespace AL {
 namespace usdmaya {
 
 ///---------------------------------------------------------------------------------------------------------------------
-/// \brief  Logic that stores a sorted list of paths which represent Selectable points in the USD hierarchy
+/// \brief  Logic that stores the paths which represent Selectable points in the USD hierarchy.
+///         The paths are stored in a path tree (an SdfPathTable, in which each path is linked to its parent and
+///         children), so adding or removing a path, and the queries, only need to look at the ancestors of the path,
+///         regardless of how many paths have been marked as unselectable. The sorted list of paths is only built from
+///         the tree when it is requested.
 ///---------------------------------------------------------------------------------------------------------------------
 class SelectabilityDB {
 public:
@@ -25,9 +30,32 @@ public:
   AL_USDMAYA_PUBLIC
   bool isPathUnselectable(const SdfPath& path) const;
 
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  Determines whether the path itself has been added as unselectable (rather than inheriting it)
+  /// \param  path the path to test
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  bool isPathExplicitlyUnselectable(const SdfPath& path) const;
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  Finds the path the unselectable state is inherited from
+  /// \param  path the path to test
+  /// \return the path itself if it has been added as unselectable, otherwise its nearest ancestor that has been. If the
+  ///         path is selectable, an empty path is returned.
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  SdfPath findUnselectableAncestor(const SdfPath& path) const;
+
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  Determines whether any of the paths beneath this path have been added as unselectable
+  /// \param  path the path to test
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  bool hasUnselectableDescendants(const SdfPath& path) const;
+
   ///-------------------------------------------------------------------------------------------------------------------
   /// \brief  Adds a list of paths to the selectable list
-  /// \param  paths which will be added as selectable. All children paths will be also unselectable
+  /// \param  paths which will be added as selectable. All children paths will be also unselectable.
   ///-------------------------------------------------------------------------------------------------------------------
   AL_USDMAYA_PUBLIC
   void addPathsAsUnselectable(const SdfPathVector& paths);
@@ -40,9 +68,12 @@ public:
   void addPathAsUnselectable(const SdfPath& path);
 
   ///-------------------------------------------------------------------------------------------------------------------
-  /// \brief  Gets the currently explictly tracked unseletable paths
+  /// \brief  Gets the currently explictly tracked unseletable paths. The sorted list is rebuilt from the path tree if
+  ///         any paths have been added or removed since it was last requested, so the returned list is only valid
+  ///         until the paths are next modified.
   ///-------------------------------------------------------------------------------------------------------------------
-  inline const SdfPathVector& getUnselectablePaths() const { return m_unselectablePaths; }
+  AL_USDMAYA_PUBLIC
+  const SdfPathVector& getUnselectablePaths() const;
 
   ///-------------------------------------------------------------------------------------------------------------------
   /// \brief  Removes a list of paths from the selectable list if the exist.
@@ -58,13 +89,25 @@ public:
   AL_USDMAYA_PUBLIC
   void removePathAsUnselectable(const SdfPath& path);
 
+  ///-------------------------------------------------------------------------------------------------------------------
+  /// \brief  Removes all of the paths from the selectable list
+  ///-------------------------------------------------------------------------------------------------------------------
+  AL_USDMAYA_PUBLIC
+  void clear();
+
 private:
-  inline void sort(){std::sort(m_unselectablePaths.begin(), m_unselectablePaths.end());}
   bool addUnselectablePath(const SdfPath& path);
   bool removeUnselectablePath(const SdfPath& path);
 
 private:
-  SdfPathVector m_unselectablePaths;
+  struct PathNode
+  {
+    bool unselectable = false;                ///< true if the path has been added as unselectable
+    uint32_t unselectableDescendants = 0;     ///< the number of unselectable paths beneath this one
+  };
+  SdfPathTable<PathNode> m_pathTree;
+  mutable SdfPathVector m_unselectablePaths;    ///< the sorted unselectable paths, built on demand
+  mutable bool m_unselectablePathsDirty = false;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
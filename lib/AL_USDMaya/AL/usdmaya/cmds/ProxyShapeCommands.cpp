@@ -31,6 +31,7 @@
 #include "maya/MDagPath.h"
 #include "maya/MArgList.h"
 
+#include <map>
 #include <sstream>
 #include <algorithm>
 #include "AL/usdmaya/utils/Utils.h"
@@ -201,6 +202,7 @@ MSyntax ProxyShapeImport::createSyntax()
   syntax.addFlag("-epp", "-excludePrimPath", MSyntax::kString);
   syntax.addFlag("-ctt", "-connectToTime", MSyntax::kBoolean);
   syntax.addFlag("-ul",    "-unloaded", MSyntax::kBoolean);
+  syntax.addFlag("-as", "-async", MSyntax::kBoolean);
   syntax.addFlag("-fp", "-fullpaths", MSyntax::kBoolean);
   syntax.makeFlagMultiUse("-arp");
 
@@ -402,6 +404,12 @@ MStatus ProxyShapeImport::doIt(const MArgList& args)
     database.getFlagArgument("-ul", 0, unloaded);
     m_modifier.newPlugValueBool(MPlug(m_shape, nodes::ProxyShape::unloaded()), unloaded);
   }
+  if(database.isFlagSet("-as"))
+  {
+    bool asyncLoad;
+    database.getFlagArgument("-as", 0, asyncLoad);
+    m_modifier.newPlugValueBool(MPlug(m_shape, nodes::ProxyShape::asyncLoad()), asyncLoad);
+  }
 
 
   if(hasStagePopulationMaskInclude) m_modifier.newPlugValueString(MPlug(m_shape, nodes::ProxyShape::populationMaskIncludePaths()), populationMaskIncludePath);
@@ -1009,7 +1017,10 @@ MSyntax ProxyShapeSelect::createSyntax()
   syntax.addFlag("-r", "-replace", MSyntax::kNoArg);
   syntax.addFlag("-d", "-deselect", MSyntax::kNoArg);
   syntax.addFlag("-i", "-internal", MSyntax::kNoArg);
+  syntax.addFlag("-dp", "-deselectPath", MSyntax::kString);
+  syntax.addFlag("-pnd", "-pending", MSyntax::kLong);
   syntax.makeFlagMultiUse("-pp");
+  syntax.makeFlagMultiUse("-dp");
   return syntax;
 }
 
@@ -1019,6 +1030,104 @@ bool ProxyShapeSelect::isUndoable() const
   return true;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+namespace {
+/// a selection made through the C++ API, waiting to be consumed by the AL_usdmaya_ProxyShapeSelect command
+struct PendingSelection
+{
+  SdfPathVector selectPaths;
+  SdfPathVector deselectPaths;
+  MGlobal::ListAdjustment mode;
+};
+std::map<int32_t, PendingSelection> g_pendingSelections;
+int32_t g_nextPendingSelection = 0;
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+MStatus ProxyShapeSelect::executePending(nodes::ProxyShape* proxy, SdfPathVector selectPaths, SdfPathVector deselectPaths,
+                                         MGlobal::ListAdjustment mode, bool internal, Execution execution)
+{
+  if(!proxy)
+  {
+    return MS::kFailure;
+  }
+
+  // The command has to be run through MGlobal in order for it to be added to the undo queue. Rather than converting
+  // the paths to strings (only for the command to parse them again), they are handed over to the command directly,
+  // and the command is only told which of the pending selections to make.
+  const int32_t id = g_nextPendingSelection++;
+  PendingSelection& pending = g_pendingSelections[id];
+  pending.selectPaths.swap(selectPaths);
+  pending.deselectPaths.swap(deselectPaths);
+  pending.mode = mode;
+
+  MString command = internal ? "AL_usdmaya_ProxyShapeSelect -i -pnd " : "AL_usdmaya_ProxyShapeSelect -pnd ";
+  command += id;
+  command += " \"";
+  command += MFnDagNode(proxy->thisMObject()).fullPathName();
+  command += "\"";
+
+  MStatus status;
+  if(execution == kExecuteOnIdle)
+  {
+    status = MGlobal::executeCommandOnIdle(command, false);
+  }
+  else
+  {
+    status = MGlobal::executeCommand(command, false, execution == kExecuteNow);
+
+    // the command will have consumed the selection, unless it failed before reaching it
+    g_pendingSelections.erase(id);
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MStatus ProxyShapeSelect::select(nodes::ProxyShape* proxy, const SdfPathVector& paths, MGlobal::ListAdjustment mode,
+                                 bool internal, Execution execution)
+{
+  return executePending(proxy, paths, SdfPathVector(), mode, internal, execution);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MStatus ProxyShapeSelect::modifySelection(nodes::ProxyShape* proxy, const SdfPathVector& selectPaths,
+                                          const SdfPathVector& deselectPaths, bool internal, Execution execution)
+{
+  if(selectPaths.empty())
+  {
+    return deselectPaths.empty() ? MStatus(MS::kSuccess) :
+           executePending(proxy, deselectPaths, SdfPathVector(), MGlobal::kRemoveFromList, internal, execution);
+  }
+  return executePending(proxy, selectPaths, deselectPaths, MGlobal::kAddToList, internal, execution);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+nodes::SelectionUndoHelper* ProxyShapeSelect::selectPaths(nodes::ProxyShape* proxy, const SdfPathVector& paths,
+                                                          MGlobal::ListAdjustment mode, bool isInternal)
+{
+  SdfPathVector orderedPaths;
+  nodes::SelectionUndoHelper::SdfPathHashSet unorderedPaths;
+  orderedPaths.reserve(paths.size());
+  for(const SdfPath& path : paths)
+  {
+    if(!proxy->selectabilityDB().isPathUnselectable(path) && path.IsAbsolutePath())
+    {
+      auto insertResult = unorderedPaths.insert(path);
+      if (insertResult.second) {
+        orderedPaths.push_back(path);
+      }
+    }
+  }
+
+  nodes::SelectionUndoHelper* helper = new nodes::SelectionUndoHelper(proxy, unorderedPaths, mode, isInternal);
+  if(!proxy->doSelect(*helper, orderedPaths))
+  {
+    delete helper;
+    return 0;
+  }
+  return helper;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 MStatus ProxyShapeSelect::doIt(const MArgList& args)
 {
@@ -1027,67 +1136,90 @@ MStatus ProxyShapeSelect::doIt(const MArgList& args)
   {
     MArgDatabase db = makeDatabase(args);
     AL_MAYA_COMMAND_HELP(db, g_helpText);
+
+    SdfPathVector paths;
+    SdfPathVector deselectPaths;
+    MGlobal::ListAdjustment mode = MGlobal::kAddToList;
+
+    // a selection made through the C++ API is consumed even if the proxy can no longer be found
+    const bool isPending = db.isFlagSet("-pnd");
+    if(isPending)
+    {
+      int32_t id = -1;
+      db.getFlagArgument("-pnd", 0, id);
+      auto pending = g_pendingSelections.find(id);
+      if(pending == g_pendingSelections.end())
+      {
+        MGlobal::displayError("AL_usdmaya_ProxyShapeSelect: the pending selection has already been made");
+        throw MS::kFailure;
+      }
+      paths.swap(pending->second.selectPaths);
+      deselectPaths.swap(pending->second.deselectPaths);
+      mode = pending->second.mode;
+      g_pendingSelections.erase(pending);
+    }
+
     nodes::ProxyShape* proxy = getShapeNode(db);
     if(!proxy)
     {
       throw MS::kFailure;
     }
-    SdfPathVector orderedPaths;
-    nodes::SelectionUndoHelper::SdfPathHashSet unorderedPaths;
 
-    MGlobal::ListAdjustment mode = MGlobal::kAddToList;
-    if(db.isFlagSet("-cl"))
-    {
-      mode = MGlobal::kReplaceList;
-    }
-    else
+    if(!isPending)
     {
-      for(uint32_t i = 0, n = db.numberOfFlagUses("-pp"); i < n; ++i)
-      {
-        MArgList args;
-        db.getFlagArgumentList("-pp", i, args);
-        MString pathString = args.asString(0);
-
-        SdfPath path(AL::maya::utils::convert(pathString));
-
-        if(!proxy->selectabilityDB().isPathUnselectable(path) && path.IsAbsolutePath())
-        {
-          auto insertResult = unorderedPaths.insert(path);
-          if (insertResult.second) {
-            orderedPaths.push_back(path);
-          }
-        }
-      }
-
-      if(db.isFlagSet("-tgl"))
-      {
-        mode = MGlobal::kXORWithList;
-      }
-      else
-      if(db.isFlagSet("-a"))
-      {
-        mode = MGlobal::kAddToList;
-      }
-      else
-      if(db.isFlagSet("-r"))
+      if(db.isFlagSet("-cl"))
       {
         mode = MGlobal::kReplaceList;
       }
       else
-      if(db.isFlagSet("-d"))
       {
-        mode = MGlobal::kRemoveFromList;
+        for(uint32_t i = 0, n = db.numberOfFlagUses("-pp"); i < n; ++i)
+        {
+          MArgList args;
+          db.getFlagArgumentList("-pp", i, args);
+          MString pathString = args.asString(0);
+          paths.push_back(SdfPath(AL::maya::utils::convert(pathString)));
+        }
+
+        if(db.isFlagSet("-tgl"))
+        {
+          mode = MGlobal::kXORWithList;
+        }
+        else
+        if(db.isFlagSet("-a"))
+        {
+          mode = MGlobal::kAddToList;
+        }
+        else
+        if(db.isFlagSet("-r"))
+        {
+          mode = MGlobal::kReplaceList;
+        }
+        else
+        if(db.isFlagSet("-d"))
+        {
+          mode = MGlobal::kRemoveFromList;
+        }
+
+        for(uint32_t i = 0, n = db.numberOfFlagUses("-dp"); i < n; ++i)
+        {
+          MArgList args;
+          db.getFlagArgumentList("-dp", i, args);
+          deselectPaths.push_back(SdfPath(AL::maya::utils::convert(args.asString(0))));
+        }
       }
     }
     const bool isInternal = db.isFlagSet("-i");
+    m_helper = selectPaths(proxy, paths, mode, isInternal);
+    if(m_helper) m_helper->doIt();
 
-    m_helper = new nodes::SelectionUndoHelper(proxy, unorderedPaths, mode, isInternal);
-    if(!proxy->doSelect(*m_helper, orderedPaths))
+    // the -dp paths are removed once the -pp paths have been selected, so that both can be done with one command
+    if(!deselectPaths.empty())
     {
-      delete m_helper;
-      m_helper = 0;
+      m_deselectHelper = selectPaths(proxy, deselectPaths, MGlobal::kRemoveFromList, isInternal);
+      if(m_deselectHelper) m_deselectHelper->doIt();
     }
-    return _redoIt(isInternal);
+    return refresh(isInternal);
   }
   catch(const MStatus& status)
   {
@@ -1105,6 +1237,7 @@ MStatus ProxyShapeSelect::doIt(const MArgList& args)
 MStatus ProxyShapeSelect::undoIt()
 {
   TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("ProxyShapeSelect::undoIt\n");
+  if(m_deselectHelper) m_deselectHelper->undoIt();
   if(m_helper) m_helper->undoIt();
   if(MGlobal::kInteractive == MGlobal::mayaState())
     MGlobal::executeCommand("refresh", false, false);
@@ -1114,14 +1247,15 @@ MStatus ProxyShapeSelect::undoIt()
 //----------------------------------------------------------------------------------------------------------------------
 MStatus ProxyShapeSelect::redoIt()
 {
-  return _redoIt(false);
+  TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("ProxyShapeSelect::redoIt\n");
+  if(m_helper) m_helper->doIt();
+  if(m_deselectHelper) m_deselectHelper->doIt();
+  return refresh(false);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-MStatus ProxyShapeSelect::_redoIt(bool isInternal)
+MStatus ProxyShapeSelect::refresh(bool isInternal)
 {
-  TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("ProxyShapeSelect::redoIt\n");
-  if(m_helper) m_helper->doIt();
   if(MGlobal::kInteractive == MGlobal::mayaState() && !isInternal)
     MGlobal::executeCommandOnIdle("refresh", false);
 
@@ -1146,8 +1280,7 @@ MStatus ProxyShapePostSelect::redoIt()
   m_proxy->setChangedSelectionState(false);
   MSelectionList sl;
   MGlobal::getActiveSelectionList(sl);
-  MString command;
-  MFnDependencyNode depNode(m_proxy->thisMObject());
+  SdfPathVector deselected;
   for (const auto& path : m_proxy->selectedPaths()) {
     auto obj = m_proxy->findRequiredPath(path);
     if (obj != MObject::kNullObj) {
@@ -1155,16 +1288,12 @@ MStatus ProxyShapePostSelect::redoIt()
       MDagPath dg;
       dagNode.getPath(dg);
       if (!sl.hasItem(dg)) {
-        command += "AL_usdmaya_ProxyShapeSelect -i -d -pp \"";
-        command += path.GetText();
-        command += "\" \"";
-        command += depNode.name();
-        command += "\";";
+        deselected.push_back(path);
       }
     }
   }
-  if (command.length() > 0) {
-    MGlobal::executeCommand(command, false, false);
+  if (!deselected.empty()) {
+    ProxyShapeSelect::select(m_proxy, deselected, MGlobal::kRemoveFromList, true, ProxyShapeSelect::kExecuteNowWithoutUndo);
   }
   return MS::kSuccess;
 }
@@ -1391,6 +1520,7 @@ void constructProxyShapeCommandGuis()
     commandGui.addStringOption("name", "Proxy Shape Node Name", "", false, AL::maya::utils::CommandGuiHelper::kStringOptional);
     commandGui.addBoolOption("connectToTime", "Connect to Time", true, true);
     commandGui.addBoolOption("unloaded", "Opens the layer with payloads unloaded.", false, true);
+    commandGui.addBoolOption("async", "Opens the stage in the background.", false, true);
   }
 
   {
@@ -1513,6 +1643,13 @@ AL_usdmaya_ProxyShapeImport Overview:
        -unloaded true   //< don't load any loadable prims
        -unloaded false  //< load all loadable prims
 
+   Large stages can be opened in the background by specifying the -as/-async flag _(the default is false)_. The command
+   will return immediately, and the proxy shape will display placeholder bounds until the stage has been opened. The
+   progress of the load can be queried from the loadState and loadProgress attributes on the proxy shape. This flag
+   is ignored when maya is not running interactively.
+
+       -async true
+
     The command will return a string array containing the names of all instances of the created node. (There will be
     more than one instance if more than one transform was selected or passed into the command.)  By default, the will
     be the shortest-unique names; if -fp/-fullpaths is given, then they will be full path names.
@@ -1648,6 +1785,14 @@ AL_usdmaya_ProxyShapeSelect Overview:
    internally within the USD Maya plugin, when the proxy shape is listening to state changes caused by the
    MEL command select, or via the API call MGlobal::setActiveSelectionList. The behaviour of this flag
    is driven by internal requirements, so no guarantee will be given about its behaviour in future]
+
+  The -dp/-deselectPath flag specifies a prim path to remove from the selection once the -pp paths have been
+  selected, so that prims can be selected and deselected with a single command (and a single undo), e.g.
+
+    AL_usdmaya_ProxyShapeSelect -a -pp "/root/hips/thigh_left" -dp "/root/hips/thigh_right" "AL_usdmaya_ProxyShape1";
+
+  The -pnd/-pending flag is used by the C++ API to make a selection whose paths have been handed to the command
+  directly. It cannot be used from MEL or python.
 )";
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -221,16 +221,56 @@ class ProxyShapeSelect
   : public ProxyShapeCommandBase
 {
   nodes::SelectionUndoHelper* m_helper;
+  nodes::SelectionUndoHelper* m_deselectHelper;
 public:
-  ProxyShapeSelect () : m_helper(0) {}
-  ~ProxyShapeSelect() { delete m_helper; }
+  ProxyShapeSelect () : m_helper(0), m_deselectHelper(0) {}
+  ~ProxyShapeSelect() { delete m_helper; delete m_deselectHelper; }
   AL_MAYA_DECLARE_COMMAND();
+
+  /// \brief  how a selection made through the C++ API is executed
+  enum Execution
+  {
+    kExecuteNow,              ///< the selection is made immediately, and is added to the undo queue
+    kExecuteNowWithoutUndo,   ///< the selection is made immediately, but is not added to the undo queue
+    kExecuteOnIdle            ///< the selection is made the next time maya is idle
+  };
+
+  /// \brief  Modifies the selection of prims on the proxy shape, by running the AL_usdmaya_ProxyShapeSelect command
+  ///         (so that the selection is added to the undo queue). The paths are handed to the command directly, rather
+  ///         than being passed as arguments of the command.
+  /// \param  proxy the proxy shape on which to select the prims
+  /// \param  paths the prim paths to select / deselect / toggle. Passing no paths with kReplaceList clears the selection.
+  /// \param  mode the selection mode (kAddToList, kRemoveFromList, kXORWithList or kReplaceList)
+  /// \param  internal if true, maya's selection list will not be modified (see the -i flag of the command)
+  /// \param  execution when the selection should be made
+  /// \return MS::kSuccess if the selection was performed (or queued)
+  AL_USDMAYA_PUBLIC
+  static MStatus select(nodes::ProxyShape* proxy, const SdfPathVector& paths, MGlobal::ListAdjustment mode,
+                        bool internal = false, Execution execution = kExecuteNow);
+
+  /// \brief  Adds some prims to the selection on the proxy shape, and removes others from it, with a single
+  ///         AL_usdmaya_ProxyShapeSelect command (and so a single entry in the undo queue).
+  /// \param  proxy the proxy shape on which to select the prims
+  /// \param  selectPaths the prim paths to add to the selection
+  /// \param  deselectPaths the prim paths to remove from the selection
+  /// \param  internal if true, maya's selection list will not be modified (see the -i flag of the command)
+  /// \param  execution when the selection should be made
+  /// \return MS::kSuccess if the selection was performed (or queued)
+  AL_USDMAYA_PUBLIC
+  static MStatus modifySelection(nodes::ProxyShape* proxy, const SdfPathVector& selectPaths,
+                                 const SdfPathVector& deselectPaths, bool internal = false,
+                                 Execution execution = kExecuteNow);
+
 private:
+  static MStatus executePending(nodes::ProxyShape* proxy, SdfPathVector selectPaths, SdfPathVector deselectPaths,
+                                MGlobal::ListAdjustment mode, bool internal, Execution execution);
+  static nodes::SelectionUndoHelper* selectPaths(nodes::ProxyShape* proxy, const SdfPathVector& paths,
+                                                 MGlobal::ListAdjustment mode, bool internal);
   bool isUndoable() const override;
   MStatus doIt(const MArgList& args) override;
   MStatus undoIt() override;
   MStatus redoIt() override;
-  MStatus _redoIt(bool isInternal);
+  MStatus refresh(bool isInternal);
 };
 
 //----------------------------------------------------------------------------------------------------------------------
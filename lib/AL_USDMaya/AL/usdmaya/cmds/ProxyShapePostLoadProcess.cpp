@@ -136,50 +136,39 @@ struct ImportCallback
 
 //----------------------------------------------------------------------------------------------------------------------
 void huntForNativeNodes(
-    const MDagPath& proxyTransformPath,
+    const UsdPrim& prim,
+    fileio::SchemaPrimsUtils& utils,
     std::vector<UsdPrim>& schemaPrims,
-    std::vector<ImportCallback>& postCallBacks,
-    nodes::ProxyShape& proxy)
+    std::vector<ImportCallback>& postCallBacks)
 {
+  TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("huntForNativeNodes: PrimName %s\n", prim.GetName().GetText());
 
-  UsdStageRefPtr stage = proxy.getUsdStage();
-  fileio::translators::TranslatorManufacture& manufacture = proxy.translatorManufacture();
-
-  fileio::SchemaPrimsUtils utils(manufacture);
-  TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("huntForNativeNodes::huntForNativeNodes\n");
-  fileio::TransformIterator it(stage, proxyTransformPath);
-  for(; !it.done(); it.next())
+  // If the prim isn't importable by default then don't add it to the list
+  fileio::translators::TranslatorRefPtr t = utils.isSchemaPrim(prim);
+  if(t && t->importableByDefault())
   {
-    UsdPrim prim = it.prim();
-    TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("huntForNativeNodes: PrimName %s\n", prim.GetName().GetText());
+    TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShapePostLoadProcess::huntForNativeNodes found matching schema %s\n", prim.GetPath().GetText());
+    schemaPrims.push_back(prim);
+  }
 
-    // If the prim isn't importable by default then don't add it to the list
-    fileio::translators::TranslatorRefPtr t = utils.isSchemaPrim(prim);
-    if(t && t->importableByDefault())
-    {
-      TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShapePostLoadProcess::huntForNativeNodes found matching schema %s\n", prim.GetPath().GetText());
-      schemaPrims.push_back(prim);
-    }
+  VtDictionary customData = prim.GetCustomData();
+  VtDictionary::const_iterator postCallBacksEntry = customData.find("callbacks");
+  if(postCallBacksEntry != customData.end())
+  {
+    //Get the list of post callbacks
+    VtDictionary melCallbacks = postCallBacksEntry->second.Get<VtDictionary>();
 
-    VtDictionary customData = prim.GetCustomData();
-    VtDictionary::const_iterator postCallBacksEntry = customData.find("callbacks");
-    if(postCallBacksEntry != customData.end())
+    for(VtDictionary::const_iterator melCommand = melCallbacks.begin(), end = melCallbacks.end();
+        melCommand != end;
+        ++melCommand)
     {
-      //Get the list of post callbacks
-      VtDictionary melCallbacks = postCallBacksEntry->second.Get<VtDictionary>();
+      ImportCallback importCallback;
+      importCallback.name = melCommand->first;
+      importCallback.type = ImportCallback::kMel;
+      importCallback.params = melCommand->second.Get<VtDictionary>();
 
-      for(VtDictionary::const_iterator melCommand = melCallbacks.begin(), end = melCallbacks.end();
-          melCommand != end;
-          ++melCommand)
-      {
-        ImportCallback importCallback;
-        importCallback.name = melCommand->first;
-        importCallback.type = ImportCallback::kMel;
-        importCallback.params = melCommand->second.Get<VtDictionary>();
-
-        TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShapePostLoadProcess::huntForNativeNodes adding post callback from %s\n", prim.GetPath().GetText());
-        postCallBacks.push_back(importCallback);
-      }
+      TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShapePostLoadProcess::huntForNativeNodes adding post callback from %s\n", prim.GetPath().GetText());
+      postCallBacks.push_back(importCallback);
     }
   }
 }
@@ -428,34 +417,46 @@ MStatus ProxyShapePostLoadProcess::initialise(nodes::ProxyShape* ptrNode)
     }
   }
 
-  AL_BEGIN_PROFILE_SECTION(HuntForNativePrims);
   proxyTransformPath.pop();
 
-  // iterate over the stage and find all custom schema nodes that have registered translator plugins
-  std::vector<UsdPrim> schemaPrims;
-  std::vector<ImportCallback> callBacks;
   UsdStageRefPtr stage = ptrNode->usdStage();
-  if(stage)
+  if(!stage)
   {
-    huntForNativeNodes(proxyTransformPath, schemaPrims, callBacks, *ptrNode/* stage, ptrNode->translatorManufacture()*/);
-  }
-  else
-  {
-    AL_END_PROFILE_SECTION();
     return MS::kFailure;
   }
 
-  AL_END_PROFILE_SECTION();
+  // iterate over the stage and find all custom schema nodes that have registered translator plugins
+  std::vector<UsdPrim> schemaPrims;
+  std::vector<ImportCallback> callBacks;
+  fileio::SchemaPrimsUtils utils(ptrNode->translatorManufacture());
+  TF_DEBUG(ALUSDMAYA_COMMANDS).Msg("huntForNativeNodes::huntForNativeNodes\n");
 
-  // generate the transform chains
-  MObjectToPrim objsToCreate;
-  createTranformChainsForSchemaPrims(ptrNode, schemaPrims, proxyTransformPath, objsToCreate);
+  nodes::HierarchyIterationLogic findNativeNodes;
+  findNativeNodes.iteration = [&utils, &schemaPrims, &callBacks](const fileio::TransformIterator&, const UsdPrim& prim)
+  {
+    huntForNativeNodes(prim, utils, schemaPrims, callBacks);
+  };
+  findNativeNodes.postIteration = [ptrNode, &schemaPrims, &proxyTransformPath]()
+  {
+    // generate the transform chains
+    MObjectToPrim objsToCreate;
+    createTranformChainsForSchemaPrims(ptrNode, schemaPrims, proxyTransformPath, objsToCreate);
 
-  // create prims that need to be imported
-  createSchemaPrims(ptrNode, schemaPrims);
+    // create prims that need to be imported
+    createSchemaPrims(ptrNode, schemaPrims);
 
-  // now perform any post-creation fix up
-  connectSchemaPrims(ptrNode, schemaPrims);
+    // now perform any post-creation fix up
+    connectSchemaPrims(ptrNode, schemaPrims);
+  };
+
+  // The search for native nodes shares a single traversal of the stage with the search for tagged prims. Since the
+  // native nodes are listed first, the schema prims will have been created before the excluded geometry, selectability
+  // and locks are processed.
+  AL_BEGIN_PROFILE_SECTION(PostLoadTraversal);
+  const nodes::HierarchyIterationPipeline logics{ &findNativeNodes };
+  ptrNode->findTaggedPrims(logics);
+  AL_END_PROFILE_SECTION();
+  TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShapePostLoadProcess::initialise visited %zu prims\n", ptrNode->primsVisited());
 
   return MS::kSuccess;
 }
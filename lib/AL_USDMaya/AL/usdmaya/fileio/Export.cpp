@@ -40,10 +40,13 @@
 #include "maya/MSelectionList.h"
 #include "maya/MUuid.h"
 
+#include "pxr/usd/kind/registry.h"
 #include "pxr/usd/usd/modelAPI.h"
 #include "pxr/usd/usd/timeCode.h"
 #include "pxr/usd/usd/variantSets.h"
 #include "pxr/usd/usd/primRange.h"
+#include "pxr/usd/usdGeom/bboxCache.h"
+#include "pxr/usd/usdGeom/modelAPI.h"
 #include "pxr/usd/usdGeom/xform.h"
 #include "pxr/usd/usdGeom/xformCommonAPI.h"
 #include "pxr/usd/usdGeom/mesh.h"
@@ -294,6 +297,75 @@ struct Export::Impl
     }
   }
 
+  void authorExtentsHints(const ExporterParams& params)
+  {
+    // the hints are authored on each model. If the exported data does not specify any models, the root prims are made
+    // components, since the hint is only used as the bounds of a model.
+    std::vector<UsdGeomModelAPI> models;
+    for(auto prim : m_stage->Traverse())
+    {
+      if(prim.IsModel())
+      {
+        models.emplace_back(prim);
+      }
+    }
+    if(models.empty())
+    {
+      for(auto prim : m_stage->GetPseudoRoot().GetChildren())
+      {
+        if(prim.IsA<UsdGeomImageable>())
+        {
+          UsdModelAPI(prim).SetKind(KindTokens->component);
+          models.emplace_back(prim);
+        }
+      }
+    }
+    if(models.empty())
+    {
+      return;
+    }
+
+    UsdGeomBBoxCache bboxCache(params.m_timeCode, UsdGeomImageable::GetOrderedPurposeTokens());
+    if(!params.m_animTranslator)
+    {
+      for(auto& model : models)
+      {
+        model.SetExtentsHint(model.ComputeExtentsHint(bboxCache), params.m_timeCode);
+      }
+      return;
+    }
+
+    // a sample is authored for each frame, unless the hint of a model does not change over the frame range
+    std::vector<std::vector<VtVec3fArray> > hints(models.size());
+    for(double frame = params.m_minFrame; frame <= params.m_maxFrame; frame += 1.0)
+    {
+      bboxCache.SetTime(UsdTimeCode(frame));
+      for(size_t i = 0, n = models.size(); i < n; ++i)
+      {
+        hints[i].push_back(models[i].ComputeExtentsHint(bboxCache));
+      }
+    }
+    for(size_t i = 0, n = models.size(); i < n; ++i)
+    {
+      const std::vector<VtVec3fArray>& samples = hints[i];
+      if(samples.empty())
+      {
+        continue;
+      }
+      if(std::all_of(samples.begin(), samples.end(), [&samples](const VtVec3fArray& hint) { return hint == samples.front(); }))
+      {
+        models[i].SetExtentsHint(samples.front(), params.m_timeCode);
+        continue;
+      }
+      double frame = params.m_minFrame;
+      for(const VtVec3fArray& hint : samples)
+      {
+        models[i].SetExtentsHint(hint, UsdTimeCode(frame));
+        frame += 1.0;
+      }
+    }
+  }
+
   void doExport(const char* const filename, bool toFilter = false, SdfPath defaultPrim = SdfPath())
   {
     setDefaultPrimIfOnlyOneRoot(defaultPrim);
@@ -955,6 +1027,10 @@ void Export::doExport()
   }
 
   m_impl->processInstances();
+  if(m_params.m_extentsHints)
+  {
+    m_impl->authorExtentsHints(m_params);
+  }
   m_impl->doExport(m_params.m_fileName.asChar(), m_params.m_filterSample, defaultPrim);
 }
 
@@ -1038,6 +1114,10 @@ MStatus ExportCommand::doIt(const MArgList& args)
   {
     AL_MAYA_CHECK_ERROR(argData.getFlagArgument("eac", 0, m_params.m_extensiveAnimationCheck), "ALUSDExport: Unable to fetch \"extensive animation check\" argument");
   }
+  if(argData.isFlagSet("eh", &status))
+  {
+    AL_MAYA_CHECK_ERROR(argData.getFlagArgument("eh", 0, m_params.m_extentsHints), "ALUSDExport: Unable to fetch \"extents hints\" argument");
+  }
 
   if(m_params.m_animation)
   {
@@ -1124,6 +1204,8 @@ MSyntax ExportCommand::createSyntax()
   AL_MAYA_CHECK_ERROR2(status, errorString);
   status = syntax.addFlag("-eac", "-extensiveAnimationCheck", MSyntax::kBoolean);
   AL_MAYA_CHECK_ERROR2(status, errorString);
+  status = syntax.addFlag("-eh", "-extentsHints", MSyntax::kBoolean);
+  AL_MAYA_CHECK_ERROR2(status, errorString);
   syntax.enableQuery(false);
   syntax.enableEdit(false);
 
@@ -1153,6 +1235,11 @@ ExportCommand Overview:
   
   The exporter can remove samples that contain the same data for adjacent samples
     1. AL_usdmaya_ExportCommand -f "<path/to/out/file.usd>" -fs
+
+  The extentsHint of each model can be authored, so that the bounds of the exported data can be found without
+  traversing all of the geometry (e.g. by the proxy shape). If there are no models, each root prim is exported as a
+  component model with a hint.
+    1. AL_usdmaya_ExportCommand -f "<path/to/out/file.usd>" -eh 1
 )";
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -95,6 +95,7 @@ MStatus ExportTranslator::writer(const MFileObject& file, const AL::maya::utils:
     params.m_animTranslator = new AnimationTranslator;
   }
   params.m_filterSample = options.getBool(kFilterSample);
+  params.m_extentsHints = options.getBool(kExtentsHints);
   if(params.m_selected)
   {
     MGlobal::getActiveSelectionList(params.m_nodes);
@@ -60,6 +60,7 @@ AL_MAYA_TRANSLATOR_BEGIN(ExportTranslator, "AL usdmaya export", false, true, "us
   static constexpr const char* const kFrameMin = "Frame Min"; ///< specify min time frame option name
   static constexpr const char* const kFrameMax = "Frame Max"; ///< specify max time frame option name
   static constexpr const char* const kFilterSample = "Filter Sample"; ///< export filter sample option name
+  static constexpr const char* const kExtentsHints = "Extents Hints"; ///< export extents hints option name
   static constexpr const char* const kExportAtWhichTime = "Export At Which Time";
 
   AL_USDMAYA_PUBLIC
@@ -94,6 +95,7 @@ AL_MAYA_TRANSLATOR_BEGIN(ExportTranslator, "AL usdmaya export", false, true, "us
     if(!options.addFloat(kFrameMin, defaultValues.m_minFrame)) return MS::kFailure;
     if(!options.addFloat(kFrameMax, defaultValues.m_maxFrame)) return MS::kFailure;
     if(!options.addBool(kFilterSample, defaultValues.m_filterSample)) return MS::kFailure;
+    if(!options.addBool(kExtentsHints, defaultValues.m_extentsHints)) return MS::kFailure;
     if(!options.addEnum(kExportAtWhichTime, timelineLevel, defaultValues.m_exportAtWhichTime)) return MS::kFailure;
     
     return MS::kSuccess;
@@ -59,7 +59,10 @@ typedef boost::filesystem::path path;
 #include "AL/usd/utils/ForwardDeclares.h"
 
 #include "maya/MFileIO.h"
+#include "maya/MFnIntArrayData.h"
+#include "maya/MIntArray.h"
 #include "maya/MFnPluginData.h"
+#include "maya/MFnStringArrayData.h"
 #include "maya/MFnReference.h"
 #include "maya/MHWGeometryUtilities.h"
 #include "maya/MItDependencyNodes.h"
@@ -67,17 +70,25 @@ typedef boost::filesystem::path path;
 #include "maya/MNodeClass.h"
 #include "maya/MFileIO.h"
 #include "maya/MCommandResult.h"
+#include "maya/MUuid.h"
 
 #include "pxr/base/arch/systemInfo.h"
 #include "pxr/base/tf/fileUtils.h"
+#include "pxr/base/work/dispatcher.h"
+#include "pxr/base/work/loops.h"
 #include "pxr/usd/ar/resolver.h"
+#include "pxr/usd/usd/primRange.h"
 #include "pxr/usd/usd/stageCacheContext.h"
+#include "pxr/usd/usdGeom/xformable.h"
 #include "pxr/usdImaging/usdImaging/primAdapter.h"
 #include "pxr/usdImaging/usdImaging/meshAdapter.h"
 #include "pxr/usd/usdUtils/stageCache.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iterator>
+#include <thread>
 
 namespace AL {
 namespace usdmaya {
@@ -217,12 +228,20 @@ MObject ProxyShape::m_serializedArCtx = MObject::kNullObj;
 MObject ProxyShape::m_serializedTrCtx = MObject::kNullObj;
 MObject ProxyShape::m_unloaded = MObject::kNullObj;
 MObject ProxyShape::m_inDrivenTransformsData = MObject::kNullObj;
+MObject ProxyShape::m_bulkWriteDrivenTransforms = MObject::kNullObj;
 MObject ProxyShape::m_ambient = MObject::kNullObj;
 MObject ProxyShape::m_diffuse = MObject::kNullObj;
 MObject ProxyShape::m_specular = MObject::kNullObj;
 MObject ProxyShape::m_emission = MObject::kNullObj;
 MObject ProxyShape::m_shininess = MObject::kNullObj;
 MObject ProxyShape::m_serializedRefCounts = MObject::kNullObj;
+MObject ProxyShape::m_serializedRefData = MObject::kNullObj;
+MObject ProxyShape::m_serializedRefPaths = MObject::kNullObj;
+MObject ProxyShape::m_transformPoolSize = MObject::kNullObj;
+MObject ProxyShape::m_disconnectStaticTransforms = MObject::kNullObj;
+MObject ProxyShape::m_deferObjectsChanged = MObject::kNullObj;
+MObject ProxyShape::m_useExtentsHint = MObject::kNullObj;
+MObject ProxyShape::m_parallelBounds = MObject::kNullObj;
 MObject ProxyShape::m_version = MObject::kNullObj;
 MObject ProxyShape::m_transformTranslate = MObject::kNullObj;
 MObject ProxyShape::m_transformRotate = MObject::kNullObj;
@@ -230,6 +249,9 @@ MObject ProxyShape::m_transformScale = MObject::kNullObj;
 MObject ProxyShape::m_stageDataDirty = MObject::kNullObj;
 MObject ProxyShape::m_stageCacheId = MObject::kNullObj;
 MObject ProxyShape::m_assetResolverConfig = MObject::kNullObj;
+MObject ProxyShape::m_asyncLoad = MObject::kNullObj;
+MObject ProxyShape::m_loadState = MObject::kNullObj;
+MObject ProxyShape::m_loadProgress = MObject::kNullObj;
 
 //----------------------------------------------------------------------------------------------------------------------
 std::vector<MObjectHandle> ProxyShape::m_unloadedProxyShapes;
@@ -469,6 +491,37 @@ MStatus ProxyShape::setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray
   return MPxSurfaceShape::setDependentsDirty(plugBeingDirtied, plugs);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+MStatus ProxyShape::connectionMade(const MPlug& plug, const MPlug& otherPlug, bool asSrc)
+{
+  // the set of transforms driven by the outTime has changed
+  if(asSrc && plug == m_outTime)
+  {
+    m_animatedSamples->invalidate();
+    MFnDependencyNode fn(otherPlug.node());
+    if(fn.typeId() == Transform::kTypeId)
+    {
+      ((Transform*)fn.userNode())->setAnimatedSamples(m_animatedSamples);
+    }
+  }
+  return MPxSurfaceShape::connectionMade(plug, otherPlug, asSrc);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MStatus ProxyShape::connectionBroken(const MPlug& plug, const MPlug& otherPlug, bool asSrc)
+{
+  if(asSrc && plug == m_outTime)
+  {
+    m_animatedSamples->invalidate();
+    MFnDependencyNode fn(otherPlug.node());
+    if(fn.typeId() == Transform::kTypeId)
+    {
+      ((Transform*)fn.userNode())->setAnimatedSamples(nullptr);
+    }
+  }
+  return MPxSurfaceShape::connectionBroken(plug, otherPlug, asSrc);
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 MStatus ProxyShape::preEvaluation(const MDGContext & context, const MEvaluationNode& evaluationNode)
 {
@@ -568,37 +621,68 @@ ProxyShape::ProxyShape()
 
   registerEvents();
 
+  // The tagged prim searches are all thread safe. Each one records its findings in per-thread accumulators during the
+  // traversal, which are merged (and any changes to the stage or maya scene made) in postIteration.
+  m_findExcludedPrims.threadSafe = true;
   m_findExcludedPrims.preIteration = [this]() {
     m_excludedTaggedGeometry.clear();
   };
-  m_findExcludedPrims.iteration = [this]( const fileio::TransformIterator& transformIterator,
-                                          const UsdPrim& prim) {
+  m_findExcludedPrims.concurrentIteration = [this](const UsdPrim& prim) {
 
     bool excludeGeo = false;
     if(prim.GetMetadata(Metadata::excludeFromProxyShape, &excludeGeo))
     {
       if (excludeGeo)
       {
-        m_excludedTaggedGeometry.push_back(prim.GetPrimPath());
+        m_findExcludedPrims.accumulators.local().push_back(prim.GetPrimPath());
+      }
+    }
+  };
+  m_findExcludedPrims.postIteration = [this]() {
+    for(auto& excluded : m_findExcludedPrims.accumulators)
+    {
+      m_excludedTaggedGeometry.insert(m_excludedTaggedGeometry.end(), excluded.begin(), excluded.end());
+    }
+    m_findExcludedPrims.accumulators.clear();
+
+    // a prim within an instance master may have been visited once per instance
+    std::sort(m_excludedTaggedGeometry.begin(), m_excludedTaggedGeometry.end());
+    m_excludedTaggedGeometry.erase(std::unique(m_excludedTaggedGeometry.begin(), m_excludedTaggedGeometry.end()),
+                                   m_excludedTaggedGeometry.end());
+
+    // If prim has exclusion tag or is a descendent of a prim with it, create as Maya geo. Since the paths are sorted,
+    // nested excluded prims will immediately follow the excluded prim they are a descendant of.
+    // (authoring the custom data will trigger change notifications, so work from a copy of the excluded roots)
+    SdfPathVector excludedRoots;
+    for(const SdfPath& excludedPath : m_excludedTaggedGeometry)
+    {
+      if(excludedRoots.empty() || !excludedPath.HasPrefix(excludedRoots.back()))
+      {
+        excludedRoots.push_back(excludedPath);
       }
     }
 
-    // If prim has exclusion tag or is a descendent of a prim with it, create as Maya geo
-    if (excludeGeo || primHasExcludedParent(prim))
+    VtValue schemaName(fileio::ALExcludedPrimSchema.GetString());
+    for(const SdfPath& excludedRoot : excludedRoots)
     {
-      VtValue schemaName(fileio::ALExcludedPrimSchema.GetString());
-      prim.SetCustomDataByKey(fileio::ALSchemaType, schemaName);
+      UsdPrim excludedPrim = m_stage->GetPrimAtPath(excludedRoot);
+      if(!excludedPrim)
+        continue;
+
+      for(UsdPrim prim : UsdPrimRange(excludedPrim))
+      {
+        prim.SetCustomDataByKey(fileio::ALSchemaType, schemaName);
+      }
     }
-  };
-  m_findExcludedPrims.postIteration = [this]() {
+
     constructExcludedPrims();
   };
 
+  m_findUnselectablePrims.threadSafe = true;
   m_findUnselectablePrims.preIteration = [this]() {
 
   };
-  m_findUnselectablePrims.iteration = [this]
-                                    (const fileio::TransformIterator& transformIterator, const UsdPrim& prim) {
+  m_findUnselectablePrims.concurrentIteration = [this](const UsdPrim& prim) {
 
     TfToken selectabilityPropertyToken;
     if(prim.GetMetadata<TfToken>(Metadata::selectability, &selectabilityPropertyToken))
@@ -607,15 +691,24 @@ ProxyShape::ProxyShape()
       //Check if this prim is unselectable
       if(selectabilityPropertyToken == Metadata::unselectable)
       {
-        m_findUnselectablePrims.newUnselectables.push_back(prim.GetPath());
+        m_findUnselectablePrims.accumulators.local().newUnselectables.push_back(prim.GetPath());
       }
       else if(m_selectabilityDB.isPathUnselectable(prim.GetPath()) && selectabilityPropertyToken != Metadata::unselectable)
       {
-        m_findUnselectablePrims.removeUnselectables.push_back(prim.GetPath());
+        m_findUnselectablePrims.accumulators.local().removeUnselectables.push_back(prim.GetPath());
       }
     }
   };
   m_findUnselectablePrims.postIteration = [this]() {
+    for(auto& accumulator : m_findUnselectablePrims.accumulators)
+    {
+      m_findUnselectablePrims.newUnselectables.insert(m_findUnselectablePrims.newUnselectables.end(),
+          accumulator.newUnselectables.begin(), accumulator.newUnselectables.end());
+      m_findUnselectablePrims.removeUnselectables.insert(m_findUnselectablePrims.removeUnselectables.end(),
+          accumulator.removeUnselectables.begin(), accumulator.removeUnselectables.end());
+    }
+    m_findUnselectablePrims.accumulators.clear();
+
     if(m_findUnselectablePrims.removeUnselectables.size() > 0)
     {
       m_selectabilityDB.removePathsAsUnselectable(m_findUnselectablePrims.removeUnselectables);
@@ -630,32 +723,39 @@ ProxyShape::ProxyShape()
     m_findUnselectablePrims.removeUnselectables.clear();
   };
 
+  m_findLockedPrims.threadSafe = true;
   m_findLockedPrims.preIteration = [this]() {
     this->m_lockTransformPrims.clear();
     this->m_lockInheritedPrims.clear();
   };
-  m_findLockedPrims.iteration = [this] ( const fileio::TransformIterator& transformIterator,
-                                         const UsdPrim& prim)
+  m_findLockedPrims.concurrentIteration = [this](const UsdPrim& prim)
   {
+    FindLockedPrimsLogic::Accumulator& accumulator = m_findLockedPrims.accumulators.local();
     TfToken lockPropertyToken;
     if (prim.GetMetadata<TfToken>(Metadata::locked, & lockPropertyToken))
     {
       if (lockPropertyToken == Metadata::lockTransform)
       {
-        this->m_lockTransformPrims.insert(prim.GetPath());
+        accumulator.lockTransformPrims.push_back(prim.GetPath());
       }
       else if (lockPropertyToken == Metadata::lockInherited)
       {
-        this->m_lockInheritedPrims.insert(prim.GetPath());
+        accumulator.lockInheritedPrims.push_back(prim.GetPath());
       }
     }
     else
     {
-      this->m_lockInheritedPrims.insert(prim.GetPath());
+      accumulator.lockInheritedPrims.push_back(prim.GetPath());
     }
 
   };
   m_findLockedPrims.postIteration = [this]() {
+    for(auto& accumulator : m_findLockedPrims.accumulators)
+    {
+      this->m_lockTransformPrims.insert(accumulator.lockTransformPrims.begin(), accumulator.lockTransformPrims.end());
+      this->m_lockInheritedPrims.insert(accumulator.lockInheritedPrims.begin(), accumulator.lockInheritedPrims.end());
+    }
+    m_findLockedPrims.accumulators.clear();
     constructLockPrims();
   };
 
@@ -669,7 +769,17 @@ ProxyShape::~ProxyShape()
 {
   TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::~ProxyShape\n");
   MNodeMessage::removeCallback(m_attributeChanged);
+  MNodeMessage::removeCallback(m_aboutToDelete);
   MEventMessage::removeCallback(m_onSelectionChanged);
+  m_transformPool.clear();
+  if(m_asyncLoadIdle)
+  {
+    MEventMessage::removeCallback(m_asyncLoadIdle);
+  }
+
+  // waits for any stage that is still being opened, so that the worker never outlives the proxy
+  m_asyncStageLoad.reset();
+  removeChangedObjectsCallbacks();
   removeAttributeChangedCallback();
   TfNotice::Revoke(m_variantChangedNoticeKey);
   TfNotice::Revoke(m_objectsChangedNoticeKey);
@@ -706,6 +816,26 @@ static const int16_t rotate_order_values[] =
   -1
 };
 
+//----------------------------------------------------------------------------------------------------------------------
+static const char* const stage_load_state_strings[] =
+{
+  "unloaded",
+  "loading",
+  "loaded",
+  "failed",
+  0
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+static const int16_t stage_load_state_values[] =
+{
+  ProxyShape::kStageUnloaded,
+  ProxyShape::kStageLoading,
+  ProxyShape::kStageLoaded,
+  ProxyShape::kStageLoadFailed,
+  -1
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 MStatus ProxyShape::initialise()
 {
@@ -744,6 +874,7 @@ MStatus ProxyShape::initialise()
 
     addFrame("USD Driven Transforms");
     m_inDrivenTransformsData = addDataAttr("inDrivenTransformsData", "idrvtd", DrivenTransformsData::kTypeId, kWritable | kArray | kConnectable);
+    m_bulkWriteDrivenTransforms = addBoolAttr("bulkWriteDrivenTransforms", "bwdt", false, kReadable | kWritable | kStorable);
 
     addFrame("OpenGL Display");
     m_ambient = addColourAttr("ambientColour", "amc", MColor(0.1f, 0.1f, 0.1f), kReadable | kWritable | kConnectable | kStorable | kAffectsAppearance);
@@ -753,6 +884,13 @@ MStatus ProxyShape::initialise()
     m_shininess = addFloatAttr("shininess", "shi", 5.0f, kReadable | kWritable | kConnectable | kStorable | kAffectsAppearance);
 
     m_serializedRefCounts = addStringAttr("serializedRefCounts", "strcs", kReadable | kWritable | kStorable | kHidden);
+    m_serializedRefData = addDataAttr("serializedRefData", "srfd", MFnData::kIntArray, kReadable | kWritable | kStorable | kHidden);
+    m_serializedRefPaths = addDataAttr("serializedRefPaths", "srfp", MFnData::kStringArray, kReadable | kWritable | kStorable | kHidden);
+    m_transformPoolSize = addInt32Attr("transformPoolSize", "tpsz", 0, kReadable | kWritable | kStorable);
+    m_disconnectStaticTransforms = addBoolAttr("disconnectStaticTransforms", "dstr", false, kReadable | kWritable | kStorable);
+    m_deferObjectsChanged = addBoolAttr("deferObjectsChanged", "dfoc", false, kReadable | kWritable | kStorable);
+    m_useExtentsHint = addBoolAttr("useExtentsHint", "ueh", true, kReadable | kWritable | kStorable);
+    m_parallelBounds = addBoolAttr("parallelBounds", "pbnd", false, kReadable | kWritable | kStorable);
 
     m_version = addStringAttr(
         "version", "vrs", getVersion().c_str(),
@@ -770,6 +908,11 @@ MStatus ProxyShape::initialise()
 
     m_assetResolverConfig = addStringAttr("assetResolverConfig", "arc", kReadable | kWritable | kConnectable | kStorable | kAffectsAppearance);
 
+    addFrame("USD Stage Loading");
+    m_asyncLoad = addBoolAttr("asyncLoad", "asyl", false, kReadable | kWritable | kStorable);
+    m_loadState = addEnumAttr("loadState", "stls", kReadable, stage_load_state_strings, stage_load_state_values);
+    m_loadProgress = addFloatAttr("loadProgress", "stlp", 0.0f, kReadable);
+
     AL_MAYA_CHECK_ERROR(attributeAffects(m_time, m_outTime), errorString);
     AL_MAYA_CHECK_ERROR(attributeAffects(m_timeOffset, m_outTime), errorString);
     AL_MAYA_CHECK_ERROR(attributeAffects(m_timeScalar, m_outTime), errorString);
@@ -884,7 +1027,7 @@ void ProxyShape::onPrimResync(SdfPath primPath, SdfPathVector& previousPrims)
 void ProxyShape::resync(const SdfPath& primPath)
 {
   // FIMXE: This method was needed to call update() on all translators in the maya scene. Since then some new
-  // locking and selectability functionality has been added to onObjectsChanged(). I would want to call the logic in
+  // locking and selectability functionality has been added to processChangedObjects(). I would want to call the logic in
   // that method to handle this resyncing but it would need to be refactored.
 
   SdfPathVector existingSchemaPrims;
@@ -977,9 +1120,27 @@ void ProxyShape::serializeAll()
   }
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+/// returns true if a change to the field of a prim may change whether the prim is selectable or locked (either directly,
+/// or by changing the composition of the prim)
+static bool affectsSelectabilityOrLock(const TfToken& field)
+{
+  return field == Metadata::selectability ||
+         field == Metadata::locked ||
+         field == SdfFieldKeys->References ||
+         field == SdfFieldKeys->Payload ||
+         field == SdfFieldKeys->InheritPaths ||
+         field == SdfFieldKeys->Specializes ||
+         field == SdfFieldKeys->VariantSelection ||
+         field == SdfFieldKeys->VariantSetNames;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void ProxyShape::onObjectsChanged(UsdNotice::ObjectsChanged const& notice, UsdStageWeakPtr const& sender)
 {
+  // payloads loaded whilst a file is being read still change the layers used by the stage
+  m_metadataIndex.objectsChanged(notice);
+
   if(MFileIO::isReadingFile())
     return;
 
@@ -1004,6 +1165,197 @@ void ProxyShape::onObjectsChanged(UsdNotice::ObjectsChanged const& notice, UsdSt
     AL::usdmaya::Profiler::printReport(strstr);
   }
 
+  const UsdNotice::ObjectsChanged::PathRange resyncedPaths = notice.GetResyncedPaths();
+  const UsdNotice::ObjectsChanged::PathRange changedInfoOnlyPaths = notice.GetChangedInfoOnlyPaths();
+  bool timeSamplesChanged = false;
+  for(auto it = changedInfoOnlyPaths.begin(), end = changedInfoOnlyPaths.end(); it != end; ++it)
+  {
+    const TfTokenVector changedFields = notice.GetChangedFields(*it);
+    if(!timeSamplesChanged)
+    {
+      timeSamplesChanged = std::find(changedFields.begin(), changedFields.end(), SdfFieldKeys->TimeSamples) != changedFields.end();
+    }
+
+    // the selectability and lock state of a prim only need to be checked again if the relevant metadata (or the
+    // composition of the prim) has changed, so that ordinary edits to the attribute values skip that work entirely
+    if(it->IsPrimPath() && std::any_of(changedFields.begin(), changedFields.end(), affectsSelectabilityOrLock))
+    {
+      m_changedSelectabilityPaths.insert(*it);
+    }
+  }
+  for(const SdfPath& path : resyncedPaths)
+  {
+    if(path.IsPrimPath() || path.IsAbsoluteRootPath())
+    {
+      m_changedSelectabilityPaths.insert(path);
+    }
+  }
+
+  // the prims cached by the driven transforms are invalidated the next time they are updated. If there are a lot of
+  // changes before then, it is cheaper to simply resolve all of the prims again.
+  if(!resyncedPaths.empty())
+  {
+    const size_t maxResyncedPaths = 256;
+    if(m_drivenResyncedPaths.size() + resyncedPaths.size() > maxResyncedPaths)
+    {
+      m_drivenResyncedPaths.assign(1, SdfPath::AbsoluteRootPath());
+    }
+    else
+    if(m_drivenResyncedPaths.empty() || m_drivenResyncedPaths[0] != SdfPath::AbsoluteRootPath())
+    {
+      m_drivenResyncedPaths.insert(m_drivenResyncedPaths.end(), resyncedPaths.begin(), resyncedPaths.end());
+    }
+  }
+
+  // the cached queries on the xform ops of the transforms may no longer resolve to the strongest opinions (or may be
+  // missing new time samples), so they are rebuilt when next read. Any static transforms that have been disconnected
+  // from the proxy time, but which have now gained time samples, are queued to be re-connected.
+  if(!m_requiredPaths.empty())
+  {
+    const bool disconnectStatic = disconnectStaticTransformsPlug().asBool() && !m_staticTransformPaths.empty();
+    std::vector<TransformReferenceMap::iterator> references;
+    auto invalidateXformOpQueries = [this, &references, disconnectStatic](const SdfPath& path, bool subtree)
+    {
+      if(subtree)
+      {
+        m_requiredPaths.findSubtree(path.GetPrimPath(), references);
+      }
+      else
+      {
+        references.clear();
+        auto it = m_requiredPaths.find(path.GetPrimPath());
+        if(it != m_requiredPaths.end())
+        {
+          references.push_back(it);
+        }
+      }
+
+      for(auto it : references)
+      {
+        Transform* transform = it->second.m_transform;
+        if(transform && transform->transform())
+        {
+          transform->transform()->invalidateXformOpQueries();
+
+          if(disconnectStatic && m_staticTransformPaths.count(it->first) &&
+             std::find(m_rearmedTransformPaths.begin(), m_rearmedTransformPaths.end(), it->first) == m_rearmedTransformPaths.end())
+          {
+            UsdGeomXformable xformable(m_stage->GetPrimAtPath(it->first));
+            if(xformable && xformable.TransformMightBeTimeVarying())
+            {
+              // only the animation flags are refreshed, so that any tweaks to the transform are kept
+              transform->transform()->updateAnimationFlags();
+              m_rearmedTransformPaths.push_back(it->first);
+            }
+          }
+        }
+      }
+    };
+
+    for(const SdfPath& path : resyncedPaths)
+    {
+      invalidateXformOpQueries(path, !path.IsPropertyPath());
+    }
+    for(const SdfPath& path : changedInfoOnlyPaths)
+    {
+      invalidateXformOpQueries(path, false);
+    }
+  }
+
+  // the picking hierarchy must be rebuilt if prims have been added or removed, whereas changes to the attributes only
+  // require the bounds to be refitted
+  if(!resyncedPaths.empty())
+  {
+    m_primPicker.clear();
+  }
+  else
+  if(!changedInfoOnlyPaths.empty())
+  {
+    m_primPicker.invalidateBounds();
+  }
+
+  // only the cached bounds of the modified prims (and their ancestors) are discarded. A static stage needs to be
+  // checked again if any time samples have been authored.
+  {
+    std::lock_guard<std::mutex> lock(m_boundsCacheMutex);
+    m_boundsCache.invalidate(SdfPathVector(resyncedPaths.begin(), resyncedPaths.end()),
+                             SdfPathVector(changedInfoOnlyPaths.begin(), changedInfoOnlyPaths.end()));
+    if(!resyncedPaths.empty() || timeSamplesChanged)
+    {
+      m_boundsCache.invalidateTimeVarying();
+    }
+  }
+
+  // A script that edits many prims generates a notice for each edit, so when deferObjectsChanged is enabled the prims
+  // whose selectability or lock state may have changed are merged, and checked together once maya is idle (or the time
+  // changes). Everything else above has to be kept in sync with the stage as each notice is received. The DG is never
+  // modified from within the notice, so transforms to be re-connected to the proxy time are always deferred.
+  if(hasChangedObjects())
+  {
+    if(deferObjectsChangedPlug().asBool() || !m_rearmedTransformPaths.empty())
+    {
+      if(!m_changedObjectsIdle)
+      {
+        m_changedObjectsIdle = MEventMessage::addEventCallback("idle", onChangedObjectsIdle, this);
+        m_changedObjectsTimeChange = MDGMessage::addTimeChangeCallback(onChangedObjectsTimeChange, this);
+      }
+    }
+    else
+    {
+      processChangedObjects();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::onChangedObjectsIdle(void* ptr)
+{
+  ((ProxyShape*)ptr)->processChangedObjects();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::onChangedObjectsTimeChange(MTime&, void* ptr)
+{
+  ((ProxyShape*)ptr)->processChangedObjects();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::removeChangedObjectsCallbacks()
+{
+  if(m_changedObjectsIdle)
+  {
+    MEventMessage::removeCallback(m_changedObjectsIdle);
+    m_changedObjectsIdle = 0;
+  }
+  if(m_changedObjectsTimeChange)
+  {
+    MMessage::removeCallback(m_changedObjectsTimeChange);
+    m_changedObjectsTimeChange = 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::processChangedObjects()
+{
+  removeChangedObjectsCallbacks();
+  if(!hasChangedObjects())
+  {
+    return;
+  }
+
+  if(!m_rearmedTransformPaths.empty())
+  {
+    reconnectRearmedTransforms();
+  }
+
+  SdfPathSet changedPaths;
+  changedPaths.swap(m_changedSelectabilityPaths);
+  if(!m_stage || changedPaths.empty())
+  {
+    return;
+  }
+  TF_DEBUG(ALUSDMAYA_EVENTS).Msg("ProxyShape::processChangedObjects %zu prims\n", changedPaths.size());
+
   SdfPathVector newUnselectables;
   SdfPathVector removeUnselectables;
   auto recordSelectablePrims = [&newUnselectables, &removeUnselectables, this](const UsdPrim& prim){
@@ -1057,26 +1409,9 @@ void ProxyShape::onObjectsChanged(UsdNotice::ObjectsChanged const& notice, UsdSt
     }
   };
 
-  const UsdNotice::ObjectsChanged::PathRange resyncedPaths = notice.GetResyncedPaths();
-  for(const SdfPath& path : resyncedPaths)
-  {
-    UsdPrim newPrim = m_stage->GetPrimAtPath(path);
-    recordSelectablePrims(newPrim);
-    recordPrimsLockStatus(newPrim);
-  }
-
-  const UsdNotice::ObjectsChanged::PathRange changedInfoOnlyPaths = notice.GetChangedInfoOnlyPaths();
-  for(const SdfPath& path : changedInfoOnlyPaths)
+  for(const SdfPath& path : changedPaths)
   {
-    UsdPrim changedPrim;
-    if(path.IsPropertyPath())
-    {
-      changedPrim = m_stage->GetPrimAtPath(path.GetParentPath());
-    }
-    else
-    {
-      changedPrim = m_stage->GetPrimAtPath(path);
-    }
+    UsdPrim changedPrim = m_stage->GetPrimAtPath(path);
     recordSelectablePrims(changedPrim);
     recordPrimsLockStatus(changedPrim);
   }
@@ -1148,19 +1483,23 @@ std::vector<UsdPrim> ProxyShape::huntForNativeNodesUnderPrim(
   std::vector<UsdPrim> prims;
   fileio::SchemaPrimsUtils utils(manufacture);
 
-  fileio::TransformIterator it(m_stage->GetPrimAtPath(startPath), proxyTransformPath);
-  for(; !it.done(); it.next())
+  // only the prims beneath the start path need to be searched for native nodes
+  UsdPrim startPrim = m_stage->GetPrimAtPath(startPath);
+  if(startPrim)
   {
-    UsdPrim prim = it.prim();
-    if(!prim.IsValid())
+    for(fileio::TransformIterator it(startPrim, proxyTransformPath); !it.done(); it.next())
     {
-      continue;
-    }
+      const UsdPrim& prim = it.prim();
+      if(!prim.IsValid())
+      {
+        continue;
+      }
 
-    fileio::translators::TranslatorRefPtr trans = utils.isSchemaPrim(prim);
-    if(trans && trans->importableByDefault())
-    {
-      prims.push_back(prim);
+      fileio::translators::TranslatorRefPtr trans = utils.isSchemaPrim(prim);
+      if(trans && trans->importableByDefault())
+      {
+        prims.push_back(prim);
+      }
     }
   }
   findExcludedGeometry();
@@ -1181,6 +1520,9 @@ void ProxyShape::variantSelectionListener(SdfNotice::LayersDidChange const& noti
 // selection change happened.  If so, we trigger a ProxyShapePostLoadProcess() which will regenerate the alTransform
 // nodes based on the contents of the new variant selection.
 {
+  // keep the metadata index in sync with the layers, regardless of whether the change is a variant switch
+  m_metadataIndex.layersDidChange(notice);
+
   if(MFileIO::isReadingFile())
   {
     return;
@@ -1221,23 +1563,82 @@ void ProxyShape::variantSelectionListener(SdfNotice::LayersDidChange const& noti
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void ProxyShape::loadStage()
+UsdStageRefPtr ProxyShape::openStage(const StageLoadRequest& request, bool useStageCache, std::atomic<float>* progress)
 {
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::loadStage\n");
+  // NOTE: this may be called from a worker thread, so must not touch any maya state, nor the profiler.
+  SdfLayerRefPtr rootLayer = SdfLayer::FindOrOpen(request.fileString);
+  if(progress)
+  {
+    progress->store(0.5f);
+  }
+  if(!rootLayer)
+  {
+    return UsdStageRefPtr();
+  }
 
-  AL_BEGIN_PROFILE_SECTION(LoadStage);
-  MDataBlock dataBlock = forceCache();
+  auto open = [&request, &rootLayer]()
+  {
+    if(request.sessionLayer)
+    {
+      TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage is called with extra session layer.\n");
+      return UsdStage::OpenMasked(rootLayer, request.sessionLayer, request.mask, request.loadOperation);
+    }
+    TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage is called without any session layer.\n");
+    return UsdStage::OpenMasked(rootLayer, request.mask, request.loadOperation);
+  };
+
+  UsdStageRefPtr stage;
+  if(useStageCache)
+  {
+    UsdStageCacheContext ctx(StageCache::Get());
+    stage = open();
+  }
+  else
+  {
+    stage = open();
+  }
+
+  if(stage)
+  {
+    // Expand the mask, since we do not really want to mask the possible relation targets.
+    stage->ExpandPopulationMask();
+  }
+
+  if(progress)
+  {
+    progress->store(0.9f);
+  }
+  return stage;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::prepareStageLoad(MDataBlock& dataBlock, StageLoadRequest& request, MString& file)
+{
   // in case there was already a stage in m_stage, check to see if it's edit target has been altered
   trackEditTargetLayer();
   m_stage = UsdStageRefPtr();
+  m_metadataIndex.clear();
+  m_primPicker.clear();
+  {
+    std::lock_guard<std::mutex> lock(m_boundsCacheMutex);
+    m_boundsCache.clear();
+  }
+
+  // any changes that are still queued refer to the previous stage
+  removeChangedObjectsCallbacks();
+  m_changedSelectabilityPaths.clear();
+  m_rearmedTransformPaths.clear();
+
+  // any stage still being opened in the background has been superseded by this request
+  cancelAsyncLoad();
 
   // Get input attr values
-  const MString file = inputStringValue(dataBlock, m_filePath);
+  file = inputStringValue(dataBlock, m_filePath);
   const MString sessionLayerName = inputStringValue(dataBlock, m_sessionLayerName);
   const MString serializedArCtx = inputStringValue(dataBlock, m_serializedArCtx);
 
   const MString populationMaskIncludePaths = inputStringValue(dataBlock, m_populationMaskIncludePaths);
-  UsdStagePopulationMask mask = constructStagePopulationMask(populationMaskIncludePaths);
+  request.mask = constructStagePopulationMask(populationMaskIncludePaths);
 
   // TODO initialise the context using the serialised attribute
 
@@ -1265,6 +1666,7 @@ void ProxyShape::loadStage()
   }
 
   TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage called for the usd file: %s\n", fileString.c_str());
+  request.fileString = fileString;
 
   // Check path validity
   // Don't try to create a stage for a non-existent file. Some processes
@@ -1275,119 +1677,269 @@ void ProxyShape::loadStage()
   bool isValidPath = (TfStringStartsWith(fileString, "//") ||
                       TfIsFile(fileString, true /*resolveSymlinks*/));
 
-  if (isValidPath)
+  if(!isValidPath)
   {
-    MStatus status;
-    SdfLayerRefPtr sessionLayer;
-
-    AL_BEGIN_PROFILE_SECTION(OpeningUsdStage);
-      AL_BEGIN_PROFILE_SECTION(OpeningSessionLayer);
-        {
-          // Grab the session layer from the layer manager
-          if(sessionLayerName.length() > 0)
-          {
-            auto layerManager = LayerManager::findManager();
-            if(layerManager)
-            {
-              sessionLayer = layerManager->findLayer(AL::maya::utils::convert(sessionLayerName));
-              if(!sessionLayer)
-              {
-                MGlobal::displayError(MString("ProxyShape \"") + name() + "\" had a serialized session layer"
-                    " named \"" + sessionLayerName + "\", but no matching layer could be found in the layerManager");
-              }
-            }
-            else
-            {
-              MGlobal::displayError(MString("ProxyShape \"") + name() + "\" had a serialized session layer,"
-                  " but no layerManager node was found");
-            }
-          }
-
-          // If we still have no sessionLayer, but there's data in serializedSessionLayer, then
-          // assume we're reading an "old" file, and read it for backwards compatibility.
-          if(!sessionLayer)
-          {
-            const MString serializedSessionLayer = inputStringValue(dataBlock, m_serializedSessionLayer);
-            if(serializedSessionLayer.length() != 0)
-            {
-              sessionLayer = SdfLayer::CreateAnonymous();
-              sessionLayer->ImportFromString(AL::maya::utils::convert(serializedSessionLayer));
-            }
-          }
-        }
-      AL_END_PROFILE_SECTION();
-
-      AL_BEGIN_PROFILE_SECTION(OpenRootLayer);
-
-      const MString assetResolverConfig = inputStringValue(dataBlock, m_assetResolverConfig);
+    if(!fileString.empty())
+    {
+      TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("The usd file is not valid: %s.\n", file.asChar());
+      MGlobal::displayWarning(MString("usd file path not valid \"") + file + "\"");
+    }
+    return false;
+  }
 
-      if (assetResolverConfig.length()==0)
-      {
-        // Initialise the asset resolver with the filepath
-        PXR_NS::ArGetResolver().ConfigureResolverForAsset(fileString);
-      }
-      else
-      {
-        // Initialise the asset resolver with the resolverConfig string
-        PXR_NS::ArGetResolver().ConfigureResolverForAsset(assetResolverConfig.asChar());
-      }
+  request.loadOperation = inputBoolValue(dataBlock, m_unloaded) ? UsdStage::LoadNone : UsdStage::LoadAll;
+  request.resolverConfig = inputStringValue(dataBlock, m_assetResolverConfig).asChar();
 
-      SdfLayerRefPtr rootLayer = SdfLayer::FindOrOpen(fileString);
-      AL_END_PROFILE_SECTION();
+  AL_BEGIN_PROFILE_SECTION(OpeningSessionLayer);
+    {
+      SdfLayerRefPtr& sessionLayer = request.sessionLayer;
 
-      if(rootLayer)
+      // Grab the session layer from the layer manager
+      if(sessionLayerName.length() > 0)
       {
-        AL_BEGIN_PROFILE_SECTION(UsdStageOpen);
-        UsdStageCacheContext ctx(StageCache::Get());
-
-        bool unloadedFlag = inputBoolValue(dataBlock, m_unloaded);
-        UsdStage::InitialLoadSet loadOperation = unloadedFlag ? UsdStage::LoadNone : UsdStage::LoadAll;
-
-        if (sessionLayer)
+        auto layerManager = LayerManager::findManager();
+        if(layerManager)
         {
-          TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage is called with extra session layer.\n");
-          m_stage = UsdStage::OpenMasked(rootLayer, sessionLayer, mask, loadOperation);
+          sessionLayer = layerManager->findLayer(AL::maya::utils::convert(sessionLayerName));
+          if(!sessionLayer)
+          {
+            MGlobal::displayError(MString("ProxyShape \"") + name() + "\" had a serialized session layer"
+                " named \"" + sessionLayerName + "\", but no matching layer could be found in the layerManager");
+          }
         }
         else
         {
-          TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage is called without any session layer.\n");
-          m_stage = UsdStage::OpenMasked(rootLayer, mask, loadOperation);
+          MGlobal::displayError(MString("ProxyShape \"") + name() + "\" had a serialized session layer,"
+              " but no layerManager node was found");
         }
-
-        // Expand the mask, since we do not really want to mask the possible relation targets.
-        m_stage->ExpandPopulationMask();
-
-        UsdStageCache::Id stageId = StageCache::Get().Insert(m_stage);
-        outputInt32Value(dataBlock, m_stageCacheId, stageId.ToLongInt());
-
-        // Save the initial edit target
-        trackEditTargetLayer();
-
-        AL_END_PROFILE_SECTION();
       }
-      else
+
+      // If we still have no sessionLayer, but there's data in serializedSessionLayer, then
+      // assume we're reading an "old" file, and read it for backwards compatibility.
+      if(!sessionLayer)
       {
-        // file path not valid
-        if(file.length())
+        const MString serializedSessionLayer = inputStringValue(dataBlock, m_serializedSessionLayer);
+        if(serializedSessionLayer.length() != 0)
         {
-          TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage failed to open the usd file: %s.\n", file.asChar());
-          MGlobal::displayWarning(MString("Failed to open usd file \"") + file + "\"");
+          sessionLayer = SdfLayer::CreateAnonymous();
+          sessionLayer->ImportFromString(AL::maya::utils::convert(serializedSessionLayer));
         }
       }
-    AL_END_PROFILE_SECTION();
+    }
+  AL_END_PROFILE_SECTION();
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const std::string& ProxyShape::resolverAsset(const StageLoadRequest& request)
+{
+  // the resolver is configured with the resolverConfig string if there is one, otherwise with the filepath
+  return request.resolverConfig.empty() ? request.fileString : request.resolverConfig;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::configureResolver(const StageLoadRequest& request)
+{
+  PXR_NS::ArGetResolver().ConfigureResolverForAsset(resolverAsset(request));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::loadStage()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::loadStage\n");
+
+  AL_BEGIN_PROFILE_SECTION(LoadStage);
+  MDataBlock dataBlock = forceCache();
+
+  StageLoadRequest request;
+  MString file;
+  const bool isValidPath = prepareStageLoad(dataBlock, request, file);
+
+  const bool asyncLoad = isValidPath &&
+                         inputBoolValue(dataBlock, m_asyncLoad) &&
+                         asyncLoadAvailable();
+
+  if (isValidPath)
+  {
+    AL_BEGIN_PROFILE_SECTION(OpeningUsdStage);
+      // The resolver context is global state, so it is always configured from the main thread
+      AL_BEGIN_PROFILE_SECTION(ConfigureAssetResolver);
+      configureResolver(request);
+      AL_END_PROFILE_SECTION();
+
+      if(asyncLoad)
+      {
+        beginAsyncLoad(request, file);
+      }
+      else
+      {
+        AL_BEGIN_PROFILE_SECTION(UsdStageOpen);
+        m_stage = openStage(request, true, nullptr);
+        AL_END_PROFILE_SECTION();
+        onStageOpened(dataBlock, file);
+      }
+    AL_END_PROFILE_SECTION();
   }
-  else
-  if(!fileString.empty())
+
+  if(!asyncLoad)
+  {
+    postLoadStage(dataBlock, !MFileIO::isReadingFile());
+  }
+
+  AL_END_PROFILE_SECTION();
+
+  if(!asyncLoad)
+  {
+    if(MGlobal::kInteractive == MGlobal::mayaState())
+    {
+      std::stringstream strstr;
+      strstr << "Breakdown for file: " << file << std::endl;
+      AL::usdmaya::Profiler::printReport(strstr);
+      MGlobal::displayInfo(AL::maya::utils::convert(strstr.str()));
+    }
+    setStageLoadState(m_stage ? kStageLoaded : (request.fileString.empty() ? kStageUnloaded : kStageLoadFailed));
+  }
+
+  stageDataDirtyPlug().setValue(true);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::loadStages(const std::vector<ProxyShape*>& proxies)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::loadStages %zu\n", proxies.size());
+
+  struct PendingLoad
+  {
+    ProxyShape* proxy;
+    StageLoadRequest request;
+    MString file;
+    UsdStageRefPtr stage;
+    bool isValidPath;
+    bool asyncLoad;
+  };
+
+  AL_BEGIN_PROFILE_SECTION(LoadStages);
+
+  // gather the inputs of every proxy on the main thread, grouping the valid ones by the asset the resolver is
+  // configured for
+  std::vector<PendingLoad> loads(proxies.size());
+  std::map<std::string, std::vector<size_t>> resolverGroups;
+  AL_BEGIN_PROFILE_SECTION(GatherStageInputs);
+  for(size_t i = 0; i < proxies.size(); ++i)
+  {
+    PendingLoad& load = loads[i];
+    load.proxy = proxies[i];
+    MDataBlock dataBlock = load.proxy->forceCache();
+    load.isValidPath = load.proxy->prepareStageLoad(dataBlock, load.request, load.file);
+    load.asyncLoad = load.isValidPath &&
+                     load.proxy->inputBoolValue(dataBlock, m_asyncLoad) &&
+                     asyncLoadAvailable();
+    if(load.isValidPath)
+    {
+      resolverGroups[resolverAsset(load.request)].push_back(i);
+    }
+  }
+  AL_END_PROFILE_SECTION();
+
+  // The resolver configuration is global state, so only the stages that configure the resolver identically are opened
+  // concurrently, one group at a time. As with loadStage, proxies that have no explicit config configure the resolver
+  // for their own file, so they only share a group with the proxies that load the same file.
+  AL_BEGIN_PROFILE_SECTION(OpenUsdStages);
+  for(auto& group : resolverGroups)
+  {
+    std::vector<size_t>& indices = group.second;
+    configureResolver(loads[indices.front()].request);
+
+    // proxies that have requested an async load are completed from the idle loop instead
+    auto isAsync = [&loads](size_t index) { return loads[index].asyncLoad; };
+    for(size_t index : indices)
+    {
+      if(isAsync(index))
+      {
+        loads[index].proxy->beginAsyncLoad(loads[index].request, loads[index].file);
+      }
+    }
+    indices.erase(std::remove_if(indices.begin(), indices.end(), isAsync), indices.end());
+
+    // UsdStageCacheContext is not thread safe, so the stages are inserted into the cache afterwards
+    WorkParallelForN(indices.size(), [&loads, &indices](size_t begin, size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+      {
+        PendingLoad& load = loads[indices[i]];
+        load.stage = openStage(load.request, false, nullptr);
+      }
+    });
+  }
+  AL_END_PROFILE_SECTION();
+
+  // finally complete the maya side of each load in turn
+  AL_BEGIN_PROFILE_SECTION(PostLoadProcess);
+  for(PendingLoad& load : loads)
+  {
+    if(load.asyncLoad)
+    {
+      continue;
+    }
+
+    ProxyShape* proxy = load.proxy;
+    MDataBlock dataBlock = proxy->forceCache();
+    proxy->m_stage = load.stage;
+    if(load.isValidPath)
+    {
+      proxy->onStageOpened(dataBlock, load.file);
+    }
+    proxy->postLoadStage(dataBlock, !MFileIO::isReadingFile());
+    proxy->setStageLoadState(proxy->m_stage ? kStageLoaded :
+                             (load.request.fileString.empty() ? kStageUnloaded : kStageLoadFailed));
+    proxy->stageDataDirtyPlug().setValue(true);
+  }
+  AL_END_PROFILE_SECTION();
+
+  AL_END_PROFILE_SECTION();
+
+  if(MGlobal::kInteractive == MGlobal::mayaState() && !proxies.empty())
+  {
+    std::stringstream strstr;
+    strstr << "Breakdown for " << proxies.size() << " proxy shapes" << std::endl;
+    AL::usdmaya::Profiler::printReport(strstr);
+    MGlobal::displayInfo(AL::maya::utils::convert(strstr.str()));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::onStageOpened(MDataBlock& dataBlock, const MString& file)
+{
+  if(!m_stage)
   {
-    TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("The usd file is not valid: %s.\n", file.asChar());
-    MGlobal::displayWarning(MString("usd file path not valid \"") + file + "\"");
+    // file path not valid
+    if(file.length())
+    {
+      TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::loadStage failed to open the usd file: %s.\n", file.asChar());
+      MGlobal::displayWarning(MString("Failed to open usd file \"") + file + "\"");
+    }
+    return;
   }
 
+  UsdStageCache::Id stageId = StageCache::Get().Insert(m_stage);
+  outputInt32Value(dataBlock, m_stageCacheId, stageId.ToLongInt());
+
+  AL_BEGIN_PROFILE_SECTION(BuildMetadataIndex);
+  m_metadataIndex.build(m_stage);
+  AL_END_PROFILE_SECTION();
+
+  // Save the initial edit target
+  trackEditTargetLayer();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::postLoadStage(MDataBlock& dataBlock, bool runPostLoadProcess)
+{
   // Get the prim
   // If no primPath string specified, then use the pseudo-root.
   const SdfPath rootPath(std::string("/"));
   MString primPathStr = inputStringValue(dataBlock, m_primPath);
-  if (primPathStr.length())
+  if (primPathStr.length() && m_stage)
   {
     m_path = SdfPath(AL::maya::utils::convert(primPathStr));
     UsdPrim prim = m_stage->GetPrimAtPath(m_path);
@@ -1401,26 +1953,185 @@ void ProxyShape::loadStage()
     m_path = rootPath;
   }
 
-  if(m_stage && !MFileIO::isReadingFile())
+  if(m_stage && runPostLoadProcess)
   {
     AL_BEGIN_PROFILE_SECTION(PostLoadProcess);
       // execute the post load process to import any custom prims
+      // (this also searches for the tagged prims, within the same traversal of the stage)
       cmds::ProxyShapePostLoadProcess::initialise(this);
-      findTaggedPrims();
     AL_END_PROFILE_SECTION();
   }
+}
 
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::asyncLoadAvailable()
+{
+  // Only interactive sessions have an idle loop to complete the load from. Batch and library sessions load
+  // synchronously, since scripts expect the stage to be available once the command returns, unless they have opted
+  // in with the AL_usdmaya_asyncLoadInBatch optionVar (in which case they must call waitForStage).
+  return MGlobal::kInteractive == MGlobal::mayaState() ||
+         (MGlobal::optionVarExists("AL_usdmaya_asyncLoadInBatch") && MGlobal::optionVarIntValue("AL_usdmaya_asyncLoadInBatch"));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::beginAsyncLoad(const StageLoadRequest& request, const MString& file)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::beginAsyncLoad %s\n", request.fileString.c_str());
+
+  // The worker only opens the layers and composes the stage. Inserting into the stage cache, creating the
+  // transform chains and schema nodes all require the main thread, and are performed by completeAsyncLoad.
+  m_asyncStageLoad.reset(new AsyncStageLoad);
+  AsyncStageLoad* load = m_asyncStageLoad.get();
+  load->thread = std::thread([request, load]()
+  {
+    load->stage = openStage(request, false, &load->progress);
+    load->done = true;
+  });
+  m_asyncLoadFile = file;
+  m_asyncLoadFromFileRead = MFileIO::isReadingFile();
+
+  setStageLoadState(kStageLoading);
+
+  if(!m_asyncLoadIdle)
+  {
+    m_asyncLoadIdle = MEventMessage::addEventCallback("idle", onAsyncLoadIdle, this);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::onAsyncLoadIdle(void* ptr)
+{
+  ProxyShape* proxy = (ProxyShape*)ptr;
+  if(proxy->m_asyncStageLoad && !proxy->m_asyncStageLoad->done)
+  {
+    // still loading, refresh the progress so that UI watching the attribute is updated
+    proxy->setStageLoadProgress(proxy->stageLoadProgress());
+    return;
+  }
+  proxy->completeAsyncLoad();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::cancelAsyncLoad()
+{
+  if(m_asyncLoadIdle)
+  {
+    MEventMessage::removeCallback(m_asyncLoadIdle);
+    m_asyncLoadIdle = 0;
+  }
+
+  // The open cannot be interrupted, so this waits for the worker to finish before discarding the stage it opened
+  m_asyncStageLoad.reset();
+  m_deserialiseOnAsyncLoad = false;
+  if(m_currentLoadState == kStageLoading)
+  {
+    setStageLoadState(kStageUnloaded);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::completeAsyncLoad()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::completeAsyncLoad\n");
+
+  if(m_asyncLoadIdle)
+  {
+    MEventMessage::removeCallback(m_asyncLoadIdle);
+    m_asyncLoadIdle = 0;
+  }
+
+  if(!m_asyncStageLoad)
+  {
+    return;
+  }
+
+  AL_BEGIN_PROFILE_SECTION(LoadStage);
+  MDataBlock dataBlock = forceCache();
+  m_asyncStageLoad->thread.join();
+  m_stage = m_asyncStageLoad->stage;
+  m_asyncStageLoad.reset();
+
+  onStageOpened(dataBlock, m_asyncLoadFile);
+
+  // if the load was started whilst reading a maya file, the scene nodes for the custom prims already exist,
+  // and will be re-attached by deserialiseAfterFileRead instead.
+  postLoadStage(dataBlock, !m_asyncLoadFromFileRead);
   AL_END_PROFILE_SECTION();
 
   if(MGlobal::kInteractive == MGlobal::mayaState())
   {
     std::stringstream strstr;
-    strstr << "Breakdown for file: " << file << std::endl;
+    strstr << "Breakdown for file: " << m_asyncLoadFile << std::endl;
     AL::usdmaya::Profiler::printReport(strstr);
     MGlobal::displayInfo(AL::maya::utils::convert(strstr.str()));
   }
 
+  setStageLoadState(m_stage ? kStageLoaded : kStageLoadFailed);
   stageDataDirtyPlug().setValue(true);
+
+  if(m_deserialiseOnAsyncLoad)
+  {
+    deserialiseAfterFileRead();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::waitForStage()
+{
+  if(isStageLoading())
+  {
+    completeAsyncLoad();
+  }
+  return bool(m_stage);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::setStageLoadState(StageLoadState state)
+{
+  if(m_currentLoadState != state)
+  {
+    m_currentLoadState = state;
+    MDataBlock dataBlock = forceCache();
+    outputInt16Value(dataBlock, m_loadState, int16_t(state));
+  }
+  setStageLoadProgress(stageLoadProgress());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::setStageLoadProgress(float progress)
+{
+  MDataBlock dataBlock = forceCache();
+  if(inputFloatValue(dataBlock, m_loadProgress) != progress)
+  {
+    outputFloatValue(dataBlock, m_loadProgress, progress);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::deserialiseAfterFileRead()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::deserialiseAfterFileRead\n");
+
+  // the stage is still being opened, so defer until it is available
+  if(isStageLoading())
+  {
+    m_deserialiseOnAsyncLoad = true;
+    return;
+  }
+  m_deserialiseOnAsyncLoad = false;
+
+  if(!getUsdStage())
+  {
+    return;
+  }
+
+  deserialiseTranslatorContext();
+  findTaggedPrims();
+  deserialiseTransformRefs();
+
+  // transforms read from file may have been pointed at prims before the stage was available
+  validateTransforms();
+  constructGLImagingEngine();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -1620,6 +2331,37 @@ void ProxyShape::onAttributeChanged(MNodeMessage::AttributeMessage msg, MPlug& p
         proxy->constructExcludedPrims();
       }
     }
+    else
+    if(plug == m_disconnectStaticTransforms)
+    {
+      proxy->updateStaticTransformConnections();
+    }
+    else
+    if(plug == m_transformPoolSize)
+    {
+      proxy->m_transformPool.setCapacity(std::max(0, plug.asInt()));
+      if(proxy->m_transformPool.size() > proxy->m_transformPool.capacity())
+      {
+        MDGModifier modifier;
+        proxy->m_transformPool.trim(modifier);
+        modifier.doIt();
+      }
+    }
+    else
+    if(plug == m_useExtentsHint)
+    {
+      {
+        std::lock_guard<std::mutex> lock(proxy->m_boundsCacheMutex);
+        proxy->m_boundsCache.setUseExtentsHint(plug.asBool());
+      }
+      MHWRender::MRenderer::setGeometryDrawDirty(proxy->thisMObject(), true);
+    }
+    else
+    if(plug == m_parallelBounds)
+    {
+      std::lock_guard<std::mutex> lock(proxy->m_boundsCacheMutex);
+      proxy->m_boundsCache.setParallel(plug.asBool());
+    }
   }
 }
 
@@ -1651,6 +2393,16 @@ void ProxyShape::postConstructor()
   TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::postConstructor\n");
   setRenderable(true);
   addAttributeChangedCallback();
+  MObject obj = thisMObject();
+  m_aboutToDelete = MNodeMessage::addNodeAboutToDeleteCallback(obj, onAboutToDelete, (void*)this);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::onAboutToDelete(MObject&, MDGModifier& modifier, void* clientData)
+{
+  // the pooled transforms are parented under a transform of their own, so they would otherwise be left behind
+  ProxyShape* proxy = (ProxyShape*)clientData;
+  proxy->m_transformPool.clear(&modifier);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -1673,84 +2425,289 @@ bool ProxyShape::primHasExcludedParent(UsdPrim prim)
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-
 void ProxyShape::findTaggedPrims()
 {
-  findTaggedPrims(m_hierarchyIterationLogics);
+  findTaggedPrims(HierarchyIterationPipeline());
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void ProxyShape::findTaggedPrims(const HierarchyIterationLogics& iterationLogics)
 {
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::iteratePrimHierarchy\n");
-  if(!m_stage)
+  iteratePrimHierarchy(HierarchyIterationPipeline(std::begin(iterationLogics), std::end(iterationLogics)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::findTaggedPrims(const HierarchyIterationPipeline& additionalLogics)
+{
+  // the additional logics may need to see every prim, however the tagged prim searches alone can be driven by the index
+  if(additionalLogics.empty() && findTaggedPrimsFromIndex())
+  {
     return;
+  }
+
+  HierarchyIterationPipeline logics(additionalLogics);
+  logics.insert(logics.end(), std::begin(m_hierarchyIterationLogics), std::end(m_hierarchyIterationLogics));
+  iteratePrimHierarchy(logics);
+}
 
-  for(auto hl : iterationLogics)
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::findTaggedPrimsFromIndex()
+{
+  // Prims within instances are reached through their masters, which are composed from other layers, so the paths found
+  // in the index would not match those found by a traversal.
+  if(!m_stage || !m_metadataIndex.isValid() || !m_stage->GetMasters().empty() || !m_metadataIndex.isComplete())
   {
-    hl->preIteration();
+    return false;
   }
 
-  MDagPath m_parentPath;
-  for(fileio::TransformIterator it(m_stage, m_parentPath); !it.done(); it.next())
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::findTaggedPrimsFromIndex\n");
+  AL_BEGIN_PROFILE_SECTION(IndexedPrimSearch);
+
+  SdfPathVector taggedPaths;
+  m_metadataIndex.taggedPaths(MetadataIndex::kSelectability | MetadataIndex::kLocked | MetadataIndex::kExcludeFromProxyShape,
+                              taggedPaths);
+
+  // Only the prims that would be reached by a traversal of the stage should be visited. The descendants of a prim with
+  // a transform lock are also visited, since they may inherit the lock from it.
+  std::vector<UsdPrim> candidates;
+  candidates.reserve(taggedPaths.size());
+  for(const SdfPath& path : taggedPaths)
   {
-    const UsdPrim& prim = it.prim();
-    if(!prim.IsValid())
+    UsdPrim prim = m_stage->GetPrimAtPath(path);
+    if(!prim || !prim.IsActive() || !prim.IsLoaded() || !prim.IsDefined() || prim.IsAbstract())
       continue;
 
-    for(auto hl : iterationLogics)
+    TfToken lockPropertyToken;
+    if(prim.GetMetadata<TfToken>(Metadata::locked, &lockPropertyToken) && lockPropertyToken == Metadata::lockTransform)
+    {
+      for(const UsdPrim& child : UsdPrimRange(prim))
+      {
+        candidates.push_back(child);
+      }
+    }
+    else
+    {
+      candidates.push_back(prim);
+    }
+  }
+
+  // nested transform locks will have added some prims twice
+  std::sort(candidates.begin(), candidates.end(), [](const UsdPrim& a, const UsdPrim& b) { return a.GetPath() < b.GetPath(); });
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  for(auto hl : m_hierarchyIterationLogics)
+  {
+    if(hl->preIteration)
     {
-      hl->iteration(it, prim);
+      hl->preIteration();
     }
   }
 
-  for(auto hl : iterationLogics)
+  WorkParallelForN(candidates.size(), [this, &candidates](size_t begin, size_t end)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      for(auto hl : m_hierarchyIterationLogics)
+      {
+        hl->concurrentIteration(candidates[i]);
+      }
+    }
+  });
+
+  for(auto hl : m_hierarchyIterationLogics)
   {
-    hl->postIteration();
+    if(hl->postIteration)
+    {
+      hl->postIteration();
+    }
   }
+
+  m_primsVisited = candidates.size();
+  AL_END_PROFILE_SECTION();
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::findTaggedPrimsFromIndex visited %zu of the %zu tagged specs\n",
+      candidates.size(), m_metadataIndex.numTaggedSpecs());
+  return true;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void ProxyShape::findExcludedGeometry()
+namespace {
+/// visits the prims of a stage in parallel. Each child subtree is handed to the dispatcher as a separate task, so that
+/// idle worker threads can steal the remaining subtrees from busy ones. Instances are followed into their masters, in
+/// the same way as the fileio::TransformIterator.
+struct ConcurrentPrimVisitor
 {
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::findExcludedGeometry\n");
-  if(!m_stage)
-    return;
-
-  m_findExcludedPrims.preIteration();
-  MDagPath m_parentPath;
+  ConcurrentPrimVisitor(WorkDispatcher& dispatcher, const HierarchyIterationPipeline& logics)
+    : m_dispatcher(dispatcher), m_logics(logics) {}
 
-  for(fileio::TransformIterator it(m_stage, m_parentPath); !it.done(); it.next())
+  void visit(UsdPrim prim)
   {
-    const UsdPrim& prim = it.prim();
-    if(!prim.IsValid())
-      continue;
-    m_findExcludedPrims.iteration(it, prim);
+    // the last child is visited on this thread, the rest are left for other threads to pick up
+    while(prim)
+    {
+      ++m_primsVisited.local();
+      for(auto hl : m_logics)
+      {
+        hl->concurrentIteration(prim);
+      }
+
+      const UsdPrim parent = prim.IsInstance() ? prim.GetMaster() : prim;
+      UsdPrim next;
+      for(const UsdPrim& child : parent.GetChildren())
+      {
+        if(next)
+        {
+          m_dispatcher.Run([this, next]() { visit(next); });
+        }
+        next = child;
+      }
+      prim = next;
+    }
   }
 
-  m_findExcludedPrims.postIteration();
-}
+  size_t primsVisited() const
+    { return m_primsVisited.combine(std::plus<size_t>()); }
+
+  WorkDispatcher& m_dispatcher;
+  const HierarchyIterationPipeline& m_logics;
+  tbb::enumerable_thread_specific<size_t> m_primsVisited;
+};
+} // anon
 
 //----------------------------------------------------------------------------------------------------------------------
-void ProxyShape::findSelectablePrims()
+size_t ProxyShape::iteratePrimHierarchy(const HierarchyIterationPipeline& logics, bool allowParallel)
 {
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::findSelectablePrims\n");
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::iteratePrimHierarchy\n");
+  m_primsVisited = 0;
   if(!m_stage)
-    return;
+    return 0;
+
+  // only the logics that provide a visitor need to be called for each prim
+  HierarchyIterationPipeline concurrentVisitors;
+  HierarchyIterationPipeline serialVisitors;
+  for(auto hl : logics)
+  {
+    if(hl->preIteration)
+    {
+      hl->preIteration();
+    }
+    if(allowParallel && hl->threadSafe && hl->concurrentIteration)
+    {
+      concurrentVisitors.push_back(hl);
+    }
+    else
+    if(hl->iteration || hl->concurrentIteration)
+    {
+      serialVisitors.push_back(hl);
+    }
+  }
+
+  // Logics that need the transform iterator have to walk the stage on this thread. The thread safe logics are then run
+  // within that same walk, with the prims it finds being handed over to the worker threads in batches.
+  size_t primsVisited = 0;
+  if(!serialVisitors.empty())
+  {
+    AL_BEGIN_PROFILE_SECTION(SerialPrimTraversal);
+    WorkDispatcher dispatcher;
+    const size_t batchSize = 256;
+    std::shared_ptr<std::vector<UsdPrim>> batch;
+    auto dispatchBatch = [&dispatcher, &concurrentVisitors, &batch]()
+    {
+      std::shared_ptr<std::vector<UsdPrim>> prims;
+      prims.swap(batch);
+      dispatcher.Run([&concurrentVisitors, prims]()
+      {
+        for(const UsdPrim& prim : *prims)
+        {
+          for(auto hl : concurrentVisitors)
+          {
+            hl->concurrentIteration(prim);
+          }
+        }
+      });
+    };
 
-  m_findUnselectablePrims.preIteration();
+    MDagPath m_parentPath;
+    for(fileio::TransformIterator it(m_stage, m_parentPath); !it.done(); it.next())
+    {
+      const UsdPrim& prim = it.prim();
+      if(!prim.IsValid())
+        continue;
+
+      ++primsVisited;
+      for(auto hl : serialVisitors)
+      {
+        if(hl->iteration)
+        {
+          hl->iteration(it, prim);
+        }
+        else
+        {
+          hl->concurrentIteration(prim);
+        }
+      }
 
-  MDagPath m_parentPath;
-  for(fileio::TransformIterator it(m_stage, m_parentPath); !it.done(); it.next())
+      if(!concurrentVisitors.empty())
+      {
+        if(!batch)
+        {
+          batch = std::make_shared<std::vector<UsdPrim>>();
+          batch->reserve(batchSize);
+        }
+        batch->push_back(prim);
+        if(batch->size() == batchSize)
+        {
+          dispatchBatch();
+        }
+      }
+    }
+    if(batch)
+    {
+      dispatchBatch();
+    }
+    dispatcher.Wait();
+    AL_END_PROFILE_SECTION();
+  }
+  else
+  if(!concurrentVisitors.empty())
   {
-    const UsdPrim& prim = it.prim();
-    if(!prim.IsValid())
-      continue;
+    AL_BEGIN_PROFILE_SECTION(ConcurrentPrimTraversal);
+    WorkDispatcher dispatcher;
+    ConcurrentPrimVisitor visitor(dispatcher, concurrentVisitors);
+    for(const UsdPrim& prim : m_stage->GetPseudoRoot().GetChildren())
+    {
+      dispatcher.Run([&visitor, prim]() { visitor.visit(prim); });
+    }
+    dispatcher.Wait();
+    primsVisited = visitor.primsVisited();
+    AL_END_PROFILE_SECTION();
+  }
 
-    m_findUnselectablePrims.iteration(it, prim);
+  for(auto hl : logics)
+  {
+    if(hl->postIteration)
+    {
+      hl->postIteration();
+    }
   }
 
-  m_findUnselectablePrims.postIteration();
+  m_primsVisited = primsVisited;
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::iteratePrimHierarchy visited %zu prims with %zu concurrent and %zu serial logics\n",
+      primsVisited, concurrentVisitors.size(), serialVisitors.size());
+  return primsVisited;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::findExcludedGeometry()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::findExcludedGeometry\n");
+  iteratePrimHierarchy(HierarchyIterationPipeline{ &m_findExcludedPrims });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::findSelectablePrims()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::findSelectablePrims\n");
+  iteratePrimHierarchy(HierarchyIterationPipeline{ &m_findUnselectablePrims });
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -1817,6 +2774,30 @@ MStatus ProxyShape::computeOutputTime(const MPlug& plug, MDataBlock& dataBlock,
   return outputTimeValue(dataBlock, m_outTime, currentTime);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+size_t ProxyShape::evaluateAnimatedTransforms(const MTime& currentTime)
+{
+  // Only the transforms connected to our outTime are guaranteed to be computed after this node, so only they can use
+  // the samples. Those that offset or scale the time will be computed at a different time, so they are left to read
+  // their own values. Both are only checked when the set of transforms is rebuilt.
+  if(m_animatedTransformsVersion != m_requiredPaths.version() || !m_animatedSamples->valid())
+  {
+    std::vector<const TransformationMatrix*> matrices;
+    for(const auto& it : m_requiredPaths)
+    {
+      if(it.second.m_transform && isTimeDriven(it.second.node()) && !hasTimeRemapping(it.second.node()))
+      {
+        matrices.push_back(it.second.m_transform->transform());
+      }
+    }
+    m_animatedSamples->reset(matrices);
+    m_animatedTransformsVersion = m_requiredPaths.version();
+  }
+
+  // this matches the time each transform computes when it has no time offset or scale
+  return m_animatedSamples->update(UsdTimeCode(currentTime.as(MTime::uiUnit())));
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 MStatus ProxyShape::compute(const MPlug& plug, MDataBlock& dataBlock)
 {
@@ -1824,7 +2805,12 @@ MStatus ProxyShape::compute(const MPlug& plug, MDataBlock& dataBlock)
   MTime currentTime;
   if(plug == m_outTime)
   {
-    return computeOutputTime(plug, dataBlock, currentTime);
+    MStatus status = computeOutputTime(plug, dataBlock, currentTime);
+    if(status)
+    {
+      evaluateAnimatedTransforms(currentTime);
+    }
+    return status;
   }
   else
   if(plug == m_outStageData)
@@ -1850,6 +2836,13 @@ MBoundingBox ProxyShape::boundingBox() const
 {
   MStatus status;
 
+  // While the stage is being opened on a worker thread, return a unit sized placeholder (which is not cached),
+  // so that the shape remains selectable and framable until the real bounds are known.
+  if(isStageLoading())
+  {
+    return MBoundingBox(MPoint(-1.0, -1.0, -1.0), MPoint(1.0, 1.0, 1.0));
+  }
+
   // Make sure outStage is up to date
   MDataBlock dataBlock = const_cast<ProxyShape*>(this)->forceCache();
 
@@ -1858,71 +2851,31 @@ MBoundingBox ProxyShape::boundingBox() const
   (void)outDataHandle;
   CHECK_MSTATUS_AND_RETURN(status, MBoundingBox() );
 
-  // XXX:aluk
-  // If we could cheaply determine whether a stage only has static geometry,
-  // we could make this value a constant one for that case, avoiding the
-  // memory overhead of a cache entry per frame
-  UsdTimeCode currTime = UsdTimeCode(inputDoubleValue(dataBlock, m_outTime));
-
-  // RB: There must be a nicer way of doing this that avoids the map?
-  // The time codes are likely to be ranged, so an ordered array + binary search would surely work?
-  std::map<UsdTimeCode, MBoundingBox>::const_iterator cacheLookup = m_boundingBoxCache.find(currTime);
-  if (cacheLookup != m_boundingBoxCache.end())
+  UsdPrim prim = getUsdPrim(dataBlock);
+  if (!prim)
   {
-    return cacheLookup->second;
+    return MBoundingBox();
   }
 
-  GfBBox3d allBox;
-  UsdPrim prim = getUsdPrim(dataBlock);
-  if (prim)
+  uint32_t purposes = 0;
+  if (inputBoolValue(dataBlock, m_displayGuides))
   {
-    UsdGeomImageable imageablePrim(prim);
-    bool showGuides = inputBoolValue(dataBlock, m_displayGuides);
-    bool showRenderGuides = inputBoolValue(dataBlock, m_displayRenderGuides);
-    if (showGuides && showRenderGuides)
-    {
-      allBox = imageablePrim.ComputeUntransformedBound(
-            currTime,
-            UsdGeomTokens->default_,
-            UsdGeomTokens->proxy,
-            UsdGeomTokens->guide,
-            UsdGeomTokens->render);
-    }
-    else
-    if (showGuides && !showRenderGuides)
-    {
-      allBox = imageablePrim.ComputeUntransformedBound(
-            currTime,
-            UsdGeomTokens->default_,
-            UsdGeomTokens->proxy,
-            UsdGeomTokens->guide);
-    }
-    else if (!showGuides && showRenderGuides)
-    {
-      allBox = imageablePrim.ComputeUntransformedBound(
-            currTime,
-            UsdGeomTokens->default_,
-            UsdGeomTokens->proxy,
-            UsdGeomTokens->render);
-    }
-    else
-    {
-      allBox = imageablePrim.ComputeUntransformedBound(
-            currTime,
-            UsdGeomTokens->default_,
-            UsdGeomTokens->proxy);
-    }
+    purposes |= proxy::BoundsCache::kGuidePurpose;
   }
-  else
+  if (inputBoolValue(dataBlock, m_displayRenderGuides))
   {
-    return MBoundingBox();
+    purposes |= proxy::BoundsCache::kRenderPurpose;
   }
 
-  // insert new cache entry
-  MBoundingBox& retval = m_boundingBoxCache[currTime];
+  const UsdTimeCode currTime = UsdTimeCode(inputDoubleValue(dataBlock, m_outTime));
+  GfRange3d boxRange;
+  {
+    std::lock_guard<std::mutex> lock(m_boundsCacheMutex);
+    boxRange = m_boundsCache.bounds(prim, currTime, purposes);
+  }
 
   // Convert to GfRange3d to MBoundingBox
-  GfRange3d boxRange = allBox.ComputeAlignedBox();
+  MBoundingBox retval;
   if (!boxRange.IsEmpty())
   {
     retval = MBoundingBox(MPoint(boxRange.GetMin()[0],
@@ -1940,6 +2893,41 @@ MBoundingBox ProxyShape::boundingBox() const
   return retval;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+proxy::PrimPicker& ProxyShape::primPicker()
+{
+  if(!m_stage || isStageLoading())
+  {
+    m_primPicker.clear();
+    return m_primPicker;
+  }
+
+  MDataBlock dataBlock = forceCache();
+  const UsdTimeCode currTime = UsdTimeCode(inputDoubleValue(dataBlock, m_outTime));
+
+  TfTokenVector purposes = { UsdGeomTokens->default_, UsdGeomTokens->proxy };
+  if(inputBoolValue(dataBlock, m_displayGuides))
+  {
+    purposes.push_back(UsdGeomTokens->guide);
+  }
+  if(inputBoolValue(dataBlock, m_displayRenderGuides))
+  {
+    purposes.push_back(UsdGeomTokens->render);
+  }
+
+  if(!m_primPicker.isValid() || m_primPicker.purposes() != purposes)
+  {
+    AL_BEGIN_PROFILE_SECTION(BuildPrimPicker);
+    m_primPicker.build(m_stage->GetPseudoRoot(), currTime, purposes);
+    AL_END_PROFILE_SECTION();
+  }
+  else
+  {
+    m_primPicker.setTime(currTime);
+  }
+  return m_primPicker;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void ProxyShape::unloadMayaReferences()
 {
@@ -1981,6 +2969,9 @@ MStatus ProxyShape::computeDrivenAttributes(const MPlug& plug, MDataBlock& dataB
   TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::computeDrivenAttributes\n");
   m_drivenTransformsDirty = false;
 
+  const uint32_t bulkWriteFlags = dataBlock.inputValue(m_bulkWriteDrivenTransforms).asBool() ?
+                                  (proxy::DrivenTransforms::kBulkWrite | proxy::DrivenTransforms::kParallelFill) : 0;
+
   MArrayDataHandle drvTransArray = dataBlock.inputArrayValue(m_inDrivenTransformsData);
   uint32_t elemCnt = drvTransArray.elementCount();
   for (uint32_t elemIdx = 0; elemIdx < elemCnt; ++elemIdx)
@@ -1995,34 +2986,101 @@ MStatus ProxyShape::computeDrivenAttributes(const MPlug& plug, MDataBlock& dataB
 
     if (!drivenTransforms.drivenPrimPaths().empty())
     {
-      if(!drivenTransforms.update(m_stage, currentTime))
+      if (!m_drivenResyncedPaths.empty())
+      {
+        drivenTransforms.invalidateCache(m_drivenResyncedPaths);
+      }
+      // the flags set by the node that outputs the data are left as they were once the samples are written
+      const uint32_t updateFlags = drivenTransforms.updateFlags();
+      drivenTransforms.setUpdateFlags(updateFlags | bulkWriteFlags);
+      const bool updated = drivenTransforms.update(m_stage, currentTime);
+      drivenTransforms.setUpdateFlags(updateFlags);
+      if(!updated)
       {
         MString command("failed to update driven prims on block: ");
         MGlobal::displayError(command + elemIdx);
       }
     }
   }
+  m_drivenResyncedPaths.clear();
   return dataBlock.setClean(plug);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+namespace {
+// the layout of the serialised transform references. Each reference is stored as the UUID of the maya node (as 4 ints),
+// followed by the required, selected, and ref counts. The prim path and the full path name of the maya node of each
+// reference are stored separately in the same order.
+const int32_t kTransformRefsVersion = 1;
+const uint32_t kTransformRefStride = 7;
+
+// returns the first node in the selection list that lives beneath the transform of the proxy shape
+bool findTransformRefNode(const MSelectionList& sl, const MString& proxyTransformName, MObject& node)
+{
+  const MString prefix = proxyTransformName + "|";
+  for(uint32_t i = 0, n = sl.length(); i < n; ++i)
+  {
+    MDagPath path;
+    if(sl.getDagPath(i, path))
+    {
+      const MString name = path.fullPathName();
+      if(name.length() > prefix.length() && name.substring(0, prefix.length() - 1) == prefix)
+      {
+        node = path.node();
+        return true;
+      }
+    }
+  }
+  return false;
+}
+} // anon
+
 //----------------------------------------------------------------------------------------------------------------------
 void ProxyShape::serialiseTransformRefs()
 {
   triggerEvent("PreSerialiseTransformRefs");
 
-  std::ostringstream oss;
-  for(auto iter : m_requiredPaths)
+  MIntArray refData;
+  MStringArray refPaths;
+  refData.setLength(1 + m_requiredPaths.size() * kTransformRefStride);
+  refPaths.setLength(m_requiredPaths.size() * 2);
+  refData[0] = kTransformRefsVersion;
+
+  uint32_t count = 0;
+  for(const auto& iter : m_requiredPaths)
   {
-    MFnDagNode fn(iter.second.node());
-    MDagPath path;
-    fn.getPath(path);
-    oss << path.fullPathName() << " "
-        << iter.first.GetText() << " "
-        << uint32_t(iter.second.required()) << " "
-        << uint32_t(iter.second.selected()) << " "
-        << uint32_t(iter.second.refCount()) << ";";
-  }
-  serializedRefCountsPlug().setString(oss.str().c_str());
+    MStatus status;
+    MFnDagNode fn(iter.second.node(), &status);
+    if(!status)
+      continue;
+
+    AL::maya::utils::guid uuid;
+    fn.uuid().get(uuid.uuid);
+    int32_t words[4];
+    std::memcpy(words, uuid.uuid, sizeof(words));
+
+    const uint32_t offset = 1 + count * kTransformRefStride;
+    refData[offset + 0] = words[0];
+    refData[offset + 1] = words[1];
+    refData[offset + 2] = words[2];
+    refData[offset + 3] = words[3];
+    refData[offset + 4] = iter.second.required();
+    refData[offset + 5] = iter.second.selected();
+    refData[offset + 6] = iter.second.refCount();
+    refPaths[count * 2] = iter.first.GetText();
+    refPaths[count * 2 + 1] = fn.fullPathName();
+    ++count;
+  }
+  refData.setLength(1 + count * kTransformRefStride);
+  refPaths.setLength(count * 2);
+
+  MFnIntArrayData fnData;
+  MFnStringArrayData fnPaths;
+  serializedRefDataPlug().setValue(fnData.create(refData));
+  serializedRefPathsPlug().setValue(fnPaths.create(refPaths));
+
+  // the reference counts used to be stored as text, make sure any old data isn't read back in.
+  serializedRefCountsPlug().setString("");
 
   triggerEvent("PostSerialiseTransformRefs");
 }
@@ -2033,47 +3091,106 @@ void ProxyShape::deserialiseTransformRefs()
   triggerEvent("PreDeserialiseTransformRefs");
 
   MString str = serializedRefCountsPlug().asString();
-  MStringArray strs;
-  str.split(';', strs);
-
-  for(uint32_t i = 0, n = strs.length(); i < n; ++i)
+  if(str.length())
   {
-    if(strs[i].length())
-    {
-      MStringArray tstrs;
-      strs[i].split(' ', tstrs);
-      MString nodeName = tstrs[0];
+    // scenes saved prior to the binary format store the full path names of the nodes as text
+    MStringArray strs;
+    str.split(';', strs);
 
-      MSelectionList sl;
-      if(sl.add(nodeName))
+    for(uint32_t i = 0, n = strs.length(); i < n; ++i)
+    {
+      if(strs[i].length())
       {
-        MObject node;
-        if(sl.getDependNode(0, node))
+        MStringArray tstrs;
+        strs[i].split(' ', tstrs);
+        MString nodeName = tstrs[0];
+
+        MSelectionList sl;
+        if(sl.add(nodeName))
         {
-          MFnDependencyNode fn(node);
-          if(fn.typeId() == AL_USDMAYA_TRANSFORM)
+          MObject node;
+          if(sl.getDependNode(0, node))
           {
-            Transform* ptr = (Transform*)fn.userNode();
+            MFnDependencyNode fn(node);
+            Transform* ptr = fn.typeId() == AL_USDMAYA_TRANSFORM ? (Transform*)fn.userNode() : 0;
             const uint32_t required = tstrs[2].asUnsigned();
             const uint32_t selected = tstrs[3].asUnsigned();
             const uint32_t refCounts = tstrs[4].asUnsigned();
             SdfPath path(tstrs[1].asChar());
             m_requiredPaths.emplace(path, TransformReference(node, ptr, required, selected, refCounts));
           }
-          else
+        }
+      }
+    }
+  }
+  else
+  {
+    MObject dataObj, pathsObj;
+    serializedRefDataPlug().getValue(dataObj);
+    serializedRefPathsPlug().getValue(pathsObj);
+    if(!dataObj.isNull() && !pathsObj.isNull())
+    {
+      MIntArray refData = MFnIntArrayData(dataObj).array();
+      MStringArray refPaths = MFnStringArrayData(pathsObj).array();
+
+      const uint32_t count = refData.length() ? (refData.length() - 1) / kTransformRefStride : 0;
+      if(count && refData[0] == kTransformRefsVersion && count * 2 == refPaths.length())
+      {
+        const MString proxyTransformName = parentTransform().fullPathName();
+        for(uint32_t i = 0; i < count; ++i)
+        {
+          const uint32_t offset = 1 + i * kTransformRefStride;
+          int32_t words[4] = { refData[offset + 0], refData[offset + 1], refData[offset + 2], refData[offset + 3] };
+          AL::maya::utils::guid uuid;
+          std::memcpy(uuid.uuid, words, sizeof(words));
+
+          // The node is found by its UUID, so the lookup survives renames and reparenting of the node. UUIDs are not
+          // unique across the scene (e.g. the same file may be referenced twice), so only a node beneath this proxy
+          // is accepted, otherwise the node is found by the path it had when the scene was saved.
+          MSelectionList sl;
+          MObject node;
+          bool found = sl.add(MUuid(uuid.uuid)) && findTransformRefNode(sl, proxyTransformName, node);
+          if(!found)
           {
-            const uint32_t required = tstrs[2].asUnsigned();
-            const uint32_t selected = tstrs[3].asUnsigned();
-            const uint32_t refCounts = tstrs[4].asUnsigned();
-            SdfPath path(tstrs[1].asChar());
-            m_requiredPaths.emplace(path, TransformReference(node, 0, required, selected, refCounts));
+            sl.clear();
+            found = sl.add(refPaths[i * 2 + 1]) && findTransformRefNode(sl, proxyTransformName, node);
+          }
+          if(found)
+          {
+            MFnDependencyNode fn(node);
+            Transform* ptr = fn.typeId() == AL_USDMAYA_TRANSFORM ? (Transform*)fn.userNode() : 0;
+            m_requiredPaths.emplace(
+                SdfPath(refPaths[i * 2].asChar()),
+                TransformReference(node, ptr, refData[offset + 4], refData[offset + 5], refData[offset + 6]));
           }
         }
       }
+      else if(count)
+      {
+        MGlobal::displayError(MString("ProxyShape: unable to read the transform references of ") + name());
+      }
+    }
+  }
+
+  // the connections removed by disconnectStaticTransforms are not saved, so any transform of a static prim that is
+  // not connected to the proxy time is assumed to have been disconnected by it
+  if(m_stage && disconnectStaticTransformsPlug().asBool())
+  {
+    for(const auto& it : m_requiredPaths)
+    {
+      UsdPrim prim = m_stage->GetPrimAtPath(it.first);
+      if(prim && it.second.m_transform && !it.second.m_transform->timePlug().isConnected() && isStaticTransform(prim))
+      {
+        m_staticTransformPaths.insert(it.first);
+      }
     }
   }
 
   serializedRefCountsPlug().setString("");
+  MFnIntArrayData fnData;
+  MFnStringArrayData fnPaths;
+  serializedRefDataPlug().setValue(fnData.create());
+  serializedRefPathsPlug().setValue(fnPaths.create());
 
   triggerEvent("PostDeserialiseTransformRefs");
 }
@@ -2094,7 +3211,7 @@ void ProxyShape::cleanupTransformRefs()
   {
     if(!it->second.selected() && !it->second.required() && !it->second.refCount())
     {
-      m_requiredPaths.erase(it++);
+      it = m_requiredPaths.erase(it);
     }
     else
     {
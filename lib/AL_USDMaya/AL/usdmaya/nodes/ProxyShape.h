@@ -20,32 +20,47 @@
 #include <AL/usdmaya/ForwardDeclares.h>
 #include "AL/maya/utils/Api.h"
 #include "AL/maya/utils/MayaHelperMacros.h"
+#include "AL/maya/utils/MObjectMap.h"
 #include "AL/maya/utils/NodeHelper.h"
 #include "AL/event/EventHandler.h"
 #include "AL/maya/event/MayaEventManager.h"
 #include <AL/usdmaya/SelectabilityDB.h>
+#include "AL/usdmaya/MetadataIndex.h"
 #include "AL/usdmaya/DrivenTransformsData.h"
 #include "AL/usdmaya/fileio/translators/TranslatorBase.h"
 #include "AL/usdmaya/fileio/translators/TranslatorContext.h"
 #include "AL/usdmaya/fileio/translators/TransformTranslator.h"
+#include "AL/usdmaya/nodes/proxy/BoundsCache.h"
 #include "AL/usdmaya/nodes/proxy/PrimFilter.h"
+#include "AL/usdmaya/nodes/proxy/PrimPicker.h"
+#include "AL/usdmaya/nodes/proxy/TransformPool.h"
+#include "AL/usdmaya/nodes/proxy/AnimatedSamples.h"
 #include "maya/MPxSurfaceShape.h"
+#include "maya/MDGMessage.h"
 #include "maya/MEventMessage.h"
 #include "maya/MNodeMessage.h"
 #include "maya/MPxDrawOverride.h"
 #include "maya/MEvaluationNode.h"
 #include "maya/MDagModifier.h"
 #include "maya/MObjectArray.h"
+#include "maya/MObjectHandle.h"
+#include "maya/MStringArray.h"
 #include "maya/MSelectionList.h"
 #include "pxr/pxr.h"
 #include "pxr/usd/usd/prim.h"
+#include "pxr/usd/usd/stage.h"
 #include "pxr/usd/usd/timeCode.h"
 #include "pxr/usd/sdf/path.h"
 #include "pxr/base/tf/weakBase.h"
 #include "pxr/usd/usd/notice.h"
 #include "pxr/usd/sdf/notice.h"
+#include "tbb/enumerable_thread_specific.h"
+#include <atomic>
 #include <stack>
 #include <functional>
+#include <thread>
+#include <memory>
+#include <mutex>
 #include "AL/usd/utils/ForwardDeclares.h"
 
 PXR_NAMESPACE_USING_DIRECTIVE
@@ -114,6 +129,8 @@ private:
   MSelectionList m_newSelection;
   std::vector<std::pair<SdfPath, MObject>> m_insertedRefs;
   std::vector<std::pair<SdfPath, MObject>> m_removedRefs;
+  proxy::TransformPool::NodeArray m_acquiredNodes;
+  proxy::TransformPool::NodeArray m_releasedNodes;
   bool m_internal;
 };
 
@@ -198,7 +215,9 @@ struct  HierarchyIterationLogic
   HierarchyIterationLogic():
       preIteration(nullptr),
       iteration(nullptr),
-      postIteration(nullptr)
+      concurrentIteration(nullptr),
+      postIteration(nullptr),
+      threadSafe(false)
   {}
 
   /// \brief  provide a method to be called prior to iteration of the UsdStage hierarchy
@@ -207,8 +226,18 @@ struct  HierarchyIterationLogic
   /// \brief  a visitor method that is called on each of the UsdPrims in the stage hierarchy
   std::function<void(const fileio::TransformIterator& transformIterator,const UsdPrim& prim)> iteration;
 
+  /// \brief  a visitor method that is called on each of the UsdPrims in the stage hierarchy, that may be called from
+  ///         multiple threads at once (in no particular order). Only used if threadSafe is true. If no iteration method
+  ///         has been provided, this will also be used when the hierarchy is traversed serially.
+  std::function<void(const UsdPrim& prim)> concurrentIteration;
+
   /// \brief  provide a method to be called after iteration of the UsdStage hierarchy
   std::function<void()> postIteration;
+
+  /// \brief  set to true if concurrentIteration can be safely called in parallel. Results should be written into
+  ///         per-thread accumulators, which can then be merged in postIteration (which is always called on the main
+  ///         thread). The UsdStage must not be modified until postIteration.
+  bool threadSafe;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -220,6 +249,14 @@ struct FindUnselectablePrimsLogic
 {
   SdfPathVector newUnselectables; ///< items that need to be made unselectable
   SdfPathVector removeUnselectables; ///< items that are unselectable, but need to be made selectable
+
+  /// the per-thread results of the traversal, merged into newUnselectables and removeUnselectables after iteration
+  struct Accumulator
+  {
+    SdfPathVector newUnselectables;
+    SdfPathVector removeUnselectables;
+  };
+  tbb::enumerable_thread_specific<Accumulator> accumulators;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -228,10 +265,31 @@ struct FindUnselectablePrimsLogic
 struct FindLockedPrimsLogic
   : public HierarchyIterationLogic
 {
+  /// the per-thread results of the traversal, merged into the locked prim sets of the proxy after iteration
+  struct Accumulator
+  {
+    SdfPathVector lockTransformPrims;
+    SdfPathVector lockInheritedPrims;
+  };
+  tbb::enumerable_thread_specific<Accumulator> accumulators;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  implements the logic required when searching for prims that have been excluded from the proxy shape
+//----------------------------------------------------------------------------------------------------------------------
+struct FindExcludedPrimsLogic
+  : public HierarchyIterationLogic
+{
+  /// the per-thread lists of prims that have been tagged as excluded
+  tbb::enumerable_thread_specific<SdfPathVector> accumulators;
 };
 
 typedef const HierarchyIterationLogic*  HierarchyIterationLogics[3];
 
+/// \brief  an ordered list of hierarchy iteration logics that will be run together within a single traversal of the
+///         UsdStage hierarchy. The pre/post iteration methods are called in the order the logics are listed.
+typedef std::vector<const HierarchyIterationLogic*> HierarchyIterationPipeline;
+
 extern AL::event::EventId kPreClearStageCache;
 extern AL::event::EventId kPostClearStageCache;
 //----------------------------------------------------------------------------------------------------------------------
@@ -335,6 +393,11 @@ public:
   /// an array of MPxData for the driven transforms
   AL_DECL_ATTRIBUTE(inDrivenTransformsData);
 
+  /// When enabled, the samples of each inDrivenTransformsData are written directly to the layer of the stage's edit
+  /// target within a single SdfChangeBlock (and prepared in parallel), in addition to any update flags already set on
+  /// the data
+  AL_DECL_ATTRIBUTE(bulkWriteDrivenTransforms);
+
   /// ambient display colour
   AL_DECL_ATTRIBUTE(ambient);
 
@@ -350,9 +413,37 @@ public:
   /// material shininess
   AL_DECL_ATTRIBUTE(shininess);
 
-  /// Serialised reference counts to rebuild the transform reference information
+  /// Serialised reference counts to rebuild the transform reference information (only read from older scenes)
   AL_DECL_ATTRIBUTE(serializedRefCounts);
 
+  /// Serialised reference counts, stored as the UUID of each node followed by its counts
+  AL_DECL_ATTRIBUTE(serializedRefData);
+
+  /// The prim paths for each of the entries in serializedRefData
+  AL_DECL_ATTRIBUTE(serializedRefPaths);
+
+  /// The maximum number of AL_usdmaya_Transform nodes kept for reuse when the selection changes (0 disables the pool)
+  AL_DECL_ATTRIBUTE(transformPoolSize);
+
+  /// When enabled, the AL_usdmaya_Transform nodes created for prims whose transforms are not animated are not connected
+  /// to outTime, so that they take no part in the evaluation of each frame. They are connected again (once maya is idle,
+  /// or the time changes) if time samples are later authored on the prim. Only the connections removed by this option
+  /// are ever restored.
+  AL_DECL_ATTRIBUTE(disconnectStaticTransforms);
+
+  /// When enabled, the selectability and lock state of the prims modified by each UsdNotice::ObjectsChanged notice are
+  /// merged together, and updated once maya is idle (or the time changes), rather than as each notice is received. The
+  /// translated prims, transforms and bounds are always updated immediately. Sessions without an idle loop (e.g. batch
+  /// sessions) that enable this need to call processChangedObjects().
+  AL_DECL_ATTRIBUTE(deferObjectsChanged);
+
+  /// When enabled (the default), the extentsHint authored on a model is used as its bounds, rather than the bounds of
+  /// its descendants
+  AL_DECL_ATTRIBUTE(useExtentsHint);
+
+  /// When enabled, the modified subtrees of the stage are traversed in parallel when the bounds are recomputed
+  AL_DECL_ATTRIBUTE(parallelBounds);
+
   /// The path list joined by ",", that will be used as a mask when doing UsdStage::OpenMask()
   AL_DECL_ATTRIBUTE(populationMaskIncludePaths);
 
@@ -371,6 +462,10 @@ public:
   /// A place to put a custom assetResolver Config string that's passed to the Resolver Context when stage is opened
   AL_DECL_ATTRIBUTE(assetResolverConfig);
 
+  /// If true, the stage will be opened on a worker thread (interactive sessions only, unless the optionVar
+  /// AL_usdmaya_asyncLoadInBatch is set to 1, in which case scripts need to call waitForStage)
+  AL_DECL_ATTRIBUTE(asyncLoad);
+
   //--------------------------------------------------------------------------------------------------------------------
   /// \name   Output Attributes
   //--------------------------------------------------------------------------------------------------------------------
@@ -381,6 +476,12 @@ public:
   /// inStageData  --->  inStageDataCached  --->  outStageData
   AL_DECL_ATTRIBUTE(outStageData);
 
+  /// The current ProxyShape::StageLoadState of the stage (read-only)
+  AL_DECL_ATTRIBUTE(loadState);
+
+  /// A value between 0 and 1 that indicates how far through loading the stage is (read-only)
+  AL_DECL_ATTRIBUTE(loadProgress);
+
 
   //--------------------------------------------------------------------------------------------------------------------
   /// \name   Public Utils
@@ -445,6 +546,19 @@ public:
       return MObject::kNullObj;
     }
 
+  /// \brief  reads the animated xform ops of every AL_usdmaya_Transform whose time is driven by this proxy shape at the
+  ///         specified time, all of them in parallel. This is called whenever the output time changes. The values
+  ///         are stored in the animatedSamples, from which each transform node takes its values when it is computed
+  ///         (rather than each node resolving its own xform ops in turn). Transforms that remap the time are skipped.
+  /// \param  currentTime the output time of this proxy shape
+  /// \return the number of transforms that were sampled
+  AL_USDMAYA_PUBLIC
+  size_t evaluateAnimatedTransforms(const MTime& currentTime);
+
+  /// \brief  returns the samples read by evaluateAnimatedTransforms
+  inline const proxy::AnimatedSamples& animatedSamples() const
+    { return *m_animatedSamples; }
+
   /// \brief  traverses the UsdStage looking for the prims that are going to be handled by custom transformer
   ///         plug-ins.
   /// \param  proxyTransformPath the DAG path of the proxy shape
@@ -476,6 +590,24 @@ public:
       MDGModifier* modifier2 = 0,
       uint32_t* createCount = 0);
 
+  /// \brief  The batched equivalent of makeUsdTransformChain, for when transform chains are needed for a large number of
+  ///         prims (e.g. a marquee selection). The ancestors shared between the prims are only resolved once, and all of
+  ///         the missing AL_usdmaya_Transform nodes are created in hierarchy order within the modifier.
+  /// \param  usdPrims the leaf prims in each of the chains to create
+  /// \param  modifier will store the changes as the paths are constructed.
+  /// \param  reason  the reason why these paths are being generated.
+  /// \param  modifier2 if specified, the modifier will end up containing a set of commands to switch the pushToPrim
+  ///         flags to true.
+  /// \param  createCount the returned number of transforms that were created.
+  /// \return the transform nodes for each of the prims, in the same order as usdPrims
+  AL_USDMAYA_PUBLIC
+  MObjectArray makeUsdTransformChains(
+      const std::vector<UsdPrim>& usdPrims,
+      MDagModifier& modifier,
+      TransformReason reason,
+      MDGModifier* modifier2 = 0,
+      uint32_t* createCount = 0);
+
   /// \brief  Will construct AL_usdmaya_Transform nodes for all of the prims from the specified usdPrim and down.
   /// \param  usdPrim the root for the transforms to be created
   /// \param  modifier the modifier that will store the creation steps for the transforms
@@ -579,17 +711,11 @@ public:
   AL_USDMAYA_PUBLIC
   bool isSelectedMObject(MObject obj, SdfPath& path)
   {
-    for(auto it : m_requiredPaths)
+    const SdfPath* found = m_requiredPaths.findPath(obj);
+    if(found)
     {
-      if(obj == it.second.node())
-      {
-        path = it.first;
-        if(m_selectedPaths.count(it.first) > 0)
-        {
-          return true;
-        }
-        break;
-      }
+      path = *found;
+      return m_selectedPaths.count(path) > 0;
     }
     return false;
   }
@@ -613,6 +739,13 @@ public:
   AL_USDMAYA_PUBLIC
   void findTaggedPrims(const HierarchyIterationLogics& iterationLogics);
 
+  /// \brief aggregates logic that needs to iterate through the hierarchy looking for properties/metdata on prims,
+  ///        and runs some additional logics within the same traversal. The additional logics are run before the tagged
+  ///        prim logics, both for each prim, and in the post iteration step.
+  /// \param additionalLogics the logics to run alongside the tagged prim searches
+  AL_USDMAYA_PUBLIC
+  void findTaggedPrims(const HierarchyIterationPipeline& additionalLogics);
+
   /// \brief  searches for the excluded geometry
   AL_USDMAYA_PUBLIC
   void findExcludedGeometry();
@@ -621,9 +754,28 @@ public:
   AL_USDMAYA_PUBLIC
   void findSelectablePrims();
 
-  //// \brief iterates the prim hierarchy calling pre/iterate/post like functions that are stored in the passed in objects
+  /// \brief iterates the prim hierarchy a single time, calling the pre/iterate/post like functions that are stored in
+  ///        the passed in objects. If allowParallel is true, the logics that are thread safe are run on the worker
+  ///        threads. When every logic is thread safe, the subtrees of the stage are distributed across the worker
+  ///        threads, otherwise the stage is walked on this thread, and the prims it finds are handed over to the thread
+  ///        safe logics in batches.
+  /// \param logics the logics to run within the traversal
+  /// \param allowParallel if false, all logics will be run within a single serial traversal
+  /// \return the number of prims visited
   AL_USDMAYA_PUBLIC
-  void iteratePrimHierarchy();
+  size_t iteratePrimHierarchy(const HierarchyIterationPipeline& logics, bool allowParallel = true);
+
+  /// \brief returns the number of prims visited by the last traversal of the prim hierarchy
+  /// \return the number of prims visited
+  size_t primsVisited() const
+    { return m_primsVisited; }
+
+  /// \brief returns the index of the prim specs carrying AL metadata within the layers of the stage. When all of the
+  ///        tagged specs are within the root layer stack, findTaggedPrims only visits the prims found in the index,
+  ///        rather than traversing the whole stage.
+  /// \return the metadata index
+  MetadataIndex& metadataIndex()
+    { return m_metadataIndex; }
 
   /// \brief  returns the plugin translator registry assigned to this shape
   /// \return the translator registry
@@ -775,6 +927,22 @@ public:
   inline void setChangedSelectionState(bool v)
     { m_hasChangedSelection = v; }
 
+  /// \brief  returns the CPU prim picker for the stage, which is built on first use (or whenever the displayed
+  ///         purposes change), and refitted to the current time of the proxy shape.
+  /// \return the prim picker
+  AL_USDMAYA_PUBLIC
+  proxy::PrimPicker& primPicker();
+
+  /// \brief  updates the selectability and lock state of the prims whose changes have been queued by the
+  ///         deferObjectsChanged attribute, and reconnects any static transforms that have gained time samples
+  AL_USDMAYA_PUBLIC
+  void processChangedObjects();
+
+  /// \brief  returns true if there are queued changes to the stage that have not yet been processed
+  /// \return true if processChangedObjects has work to do
+  bool hasChangedObjects() const
+    { return !m_changedSelectabilityPaths.empty() || !m_rearmedTransformPaths.empty(); }
+
   /// \brief Returns the SelectionDatabase owned by the ProxyShape
   /// \return A SelectableDB owned by the ProxyShape
   AL::usdmaya::SelectabilityDB& selectabilityDB()
@@ -786,10 +954,55 @@ public:
   const AL::usdmaya::SelectabilityDB& selectabilityDB() const
     { return const_cast<ProxyShape*>(this)->selectabilityDB(); }
 
-  /// \brief  used to reload the stage after file open
+  /// \brief  the states a stage load can be in (as reported by the loadState attribute)
+  enum StageLoadState
+  {
+    kStageUnloaded,   ///< no stage has been loaded (e.g. the file path is empty)
+    kStageLoading,    ///< the stage is being opened asynchronously on a worker thread
+    kStageLoaded,     ///< the stage has been opened, and the post load process has completed
+    kStageLoadFailed  ///< the file path was not valid, or the stage could not be opened
+  };
+
+  /// \brief  used to reload the stage after file open. If the asyncLoad attribute is set (and maya is running
+  ///         interactively), the stage will be opened on a worker thread, and the post load process will be run on the
+  ///         main thread when the next idle event is processed.
   AL_USDMAYA_PUBLIC
   void loadStage();
 
+  /// \brief  loads the stages of a set of proxy shapes (e.g. after a maya file has been read). The inputs of every proxy
+  ///         are gathered on the main thread, the root layers and stages are then opened concurrently, before the maya
+  ///         side of each load is completed one proxy at a time.
+  /// \param  proxies the proxy shapes to load
+  AL_USDMAYA_PUBLIC
+  static void loadStages(const std::vector<ProxyShape*>& proxies);
+
+  /// \brief  returns the current state of the stage load
+  /// \return the load state
+  StageLoadState stageLoadState() const
+    { return m_currentLoadState; }
+
+  /// \brief  returns true if the stage is currently being loaded asynchronously
+  /// \return true if the stage is being opened on a worker thread
+  bool isStageLoading() const
+    { return m_currentLoadState == kStageLoading; }
+
+  /// \brief  returns the progress of the current stage load
+  /// \return a value between 0 (not started) and 1 (stage loaded and post load process complete)
+  float stageLoadProgress() const
+    { return m_asyncStageLoad ? m_asyncStageLoad->progress.load() : (m_currentLoadState == kStageUnloaded ? 0.0f : 1.0f); }
+
+  /// \brief  if the stage is being loaded asynchronously, this will block until the worker thread has opened the stage,
+  ///         and then complete the post load process immediately. Intended for scripts that need a valid stage.
+  /// \return true if a valid stage is available after the wait
+  AL_USDMAYA_PUBLIC
+  bool waitForStage();
+
+  /// \brief  called after a maya file has been read (and the stage has been loaded) to restore the translator context
+  ///         and transform references serialised in the file. If the stage is still loading asynchronously, this will
+  ///         be deferred until the load completes.
+  AL_USDMAYA_PUBLIC
+  void deserialiseAfterFileRead();
+
   /// \brief  adds the attribute changed callback to the proxy shape
   AL_USDMAYA_PUBLIC
   void addAttributeChangedCallback();
@@ -831,6 +1044,38 @@ public:
 
 private:
 
+  /// the inputs required to open a stage, gathered on the main thread prior to the stage being opened
+  struct StageLoadRequest
+  {
+    std::string fileString;
+    SdfLayerRefPtr sessionLayer;
+    std::string resolverConfig;
+    UsdStagePopulationMask mask;
+    UsdStage::InitialLoadSet loadOperation = UsdStage::LoadAll;
+  };
+
+  /// gathers the inputs needed to open the stage from the node. Returns false if the file path is not valid.
+  bool prepareStageLoad(MDataBlock& dataBlock, StageLoadRequest& request, MString& file);
+
+  /// returns the asset the resolver is configured for when opening the stage described by the request
+  static const std::string& resolverAsset(const StageLoadRequest& request);
+
+  /// configures the (global) asset resolver prior to opening the stage described by the request
+  static void configureResolver(const StageLoadRequest& request);
+
+  /// opens the root layer and stage described by the request. Does not touch any maya state, and so can be called
+  /// from a worker thread (in which case useStageCache must be false, since UsdStageCacheContext is not thread safe).
+  static UsdStageRefPtr openStage(const StageLoadRequest& request, bool useStageCache, std::atomic<float>* progress);
+  static bool asyncLoadAvailable();
+  void beginAsyncLoad(const StageLoadRequest& request, const MString& file);
+  void completeAsyncLoad();
+  void cancelAsyncLoad();
+  void onStageOpened(MDataBlock& dataBlock, const MString& file);
+  void postLoadStage(MDataBlock& dataBlock, bool runPostLoadProcess);
+  void setStageLoadState(StageLoadState state);
+  void setStageLoadProgress(float progress);
+  static void onAsyncLoadIdle(void* ptr);
+
   static void onSelectionChanged(void* ptr);
   bool removeAllSelectedNodes(SelectionUndoHelper& helper);
   void removeTransformRefs(const std::vector<std::pair<SdfPath, MObject>>& removedRefs, TransformReason reason);
@@ -849,6 +1094,14 @@ private:
       uint32_t* createCount = 0,
       MString* newPath = 0);
 
+  MObjectArray makeUsdTransformChains_internal(
+      const std::vector<UsdPrim>& usdPrims,
+      MDagModifier& modifier,
+      TransformReason reason,
+      MDGModifier* modifier2 = 0,
+      uint32_t* createCount = 0,
+      MStringArray* newPaths = 0);
+
   void removeUsdTransformChain_internal(
       const UsdPrim& usdPrim,
       MDagModifier& modifier,
@@ -865,17 +1118,44 @@ private:
       uint32_t* createCount,
       MString* newPath = 0);
 
-  void makeUsdTransformsInternal(
+  MObject makeUsdTransform(
       const UsdPrim& usdPrim,
-      const MObject& parentXForm,
+      const MPlug& outStage,
+      const MPlug& outTime,
+      const MObject& parentNode,
+      const MDagPath& proxyTransformPath,
       MDagModifier& modifier,
       TransformReason reason,
-      MDGModifier* modifier2);
+      MDGModifier* modifier2,
+      MString* newPath);
+
+  /// removes a transform created for the selection, either by returning it to the transform pool, or deleting it
+  void releaseUsdTransform(const MObject& node, MDagModifier& modifier);
+  static void setTransformPlugsLocked(const MObject& node, bool locked);
+
+  /// returns true if the transform created for the prim should not be connected to outTime (i.e. if static transforms
+  /// are being disconnected, and the transform of the prim does not vary over time)
+  bool isStaticTransform(const UsdPrim& prim);
+
+  /// returns true if the time of the transform node is connected to outTime
+  bool isTimeDriven(const MObject& node) const;
+
+  /// returns true if the transform node offsets or scales the time it receives, (or has those values driven by a
+  /// connection), in which case it does not evaluate at the time of this proxy
+  static bool hasTimeRemapping(const MObject& node);
+
+  /// connects (or disconnects) outTime to each of the transforms, based on the disconnectStaticTransforms attribute
+  void updateStaticTransformConnections();
+
+  /// connects outTime to the queued transforms whose prims have gained time samples since they were disconnected
+  void reconnectRearmedTransforms();
 
-  void removeUsdTransformsInternal(
+  void makeUsdTransformsInternal(
       const UsdPrim& usdPrim,
+      const MObject& parentXForm,
       MDagModifier& modifier,
-      TransformReason reason);
+      TransformReason reason,
+      MDGModifier* modifier2);
 
   struct TransformReference
   {
@@ -918,7 +1198,138 @@ private:
   /// If we then later create a USD transform node (because we're bringing in all of them, or just a selection of them),
   /// then we must make sure that we don't end up duplicating paths. This map is use to store a LUT of the paths that
   /// must always exist, and never get deleted.
-  typedef std::map<SdfPath, TransformReference>  TransformReferenceMap;
+  ///
+  /// The references are stored contiguously, and are found via an open addressing hash table of indices into that
+  /// array. Entries are never moved once inserted (erased entries are recycled), so iterators remain valid when other
+  /// entries are inserted or erased. Iteration is in insertion order rather than path order; when path order is needed
+  /// (e.g. to walk a sub tree), findSubtree can be used.
+  ///
+  /// Alongside the map, a reverse index from the UUID of each maya node to its prim path is maintained, so that a maya
+  /// node can be mapped back to its prim without searching the entire map (e.g. when syncing the maya selection).
+  class TransformReferenceMap
+  {
+  public:
+    typedef std::pair<SdfPath, TransformReference> value_type;
+
+  private:
+    struct Entry
+    {
+      Entry(const SdfPath& path, const TransformReference& reference, uint64_t hash)
+        : value(path, reference), hash(hash), alive(true), indexed(false) {}
+      value_type value;
+      uint64_t hash;
+      AL::maya::utils::guid uuid;   ///< the UUID the node was indexed by (valid if indexed is true)
+      bool alive;
+      bool indexed;
+    };
+    typedef std::vector<Entry> EntryArray;
+    enum : uint32_t
+    {
+      kEmpty = 0,
+      kTombstone = ~0u,
+      kEnd = ~0u
+    };
+
+  public:
+
+    /// a forward iterator over the live entries in the map
+    template<typename MapType, typename ValueType>
+    class Iterator
+    {
+      friend class TransformReferenceMap;
+      template<typename, typename> friend class Iterator;
+      Iterator(MapType* map, uint32_t index)
+        : m_map(map), m_index(index) { skipDead(); }
+      void skipDead()
+      {
+        const auto& entries = m_map->m_entries;
+        while(m_index < entries.size() && !entries[m_index].alive)
+          ++m_index;
+        if(m_index >= entries.size())
+          m_index = kEnd;
+      }
+    public:
+      Iterator()
+        : m_map(nullptr), m_index(kEnd) {}
+      template<typename OtherMap, typename OtherValue>
+      Iterator(const Iterator<OtherMap, OtherValue>& other)
+        : m_map(other.m_map), m_index(other.m_index) {}
+      ValueType& operator * () const
+        { return m_map->m_entries[m_index].value; }
+      ValueType* operator -> () const
+        { return &m_map->m_entries[m_index].value; }
+      Iterator& operator ++ ()
+        { ++m_index; skipDead(); return *this; }
+      Iterator operator ++ (int)
+        { Iterator temp = *this; ++*this; return temp; }
+      bool operator == (const Iterator& other) const
+        { return m_index == other.m_index; }
+      bool operator != (const Iterator& other) const
+        { return m_index != other.m_index; }
+    private:
+      MapType* m_map;
+      uint32_t m_index;
+    };
+    typedef Iterator<TransformReferenceMap, value_type> iterator;
+    typedef Iterator<const TransformReferenceMap, const value_type> const_iterator;
+
+    iterator begin()
+      { return iterator(this, 0); }
+    iterator end()
+      { return iterator(this, kEnd); }
+    const_iterator begin() const
+      { return const_iterator(this, 0); }
+    const_iterator end() const
+      { return const_iterator(this, kEnd); }
+    iterator find(const SdfPath& path)
+      { return iterator(this, findEntry(path)); }
+    const_iterator find(const SdfPath& path) const
+      { return const_iterator(this, findEntry(path)); }
+    size_t size() const
+      { return m_size; }
+    bool empty() const
+      { return !m_size; }
+
+    /// returns a counter that is incremented whenever an entry is inserted or erased
+    uint32_t version() const
+      { return m_version; }
+
+    /// inserts a reference for the path, if the path is not already in the map
+    std::pair<iterator, bool> emplace(const SdfPath& path, const TransformReference& reference);
+
+    /// removes the entry, and returns the iterator to the next entry. All other iterators remain valid.
+    iterator erase(iterator it);
+
+    /// removes all entries
+    void clear();
+
+    /// returns the path of the prim the maya node has been created for, or null if the node is not in the map
+    const SdfPath* findPath(const MObject& node) const;
+
+    /// returns the entries for the root path and all of its descendants, sorted by path (so parents appear before
+    /// their children). The cost is proportional to the size of the sub tree, rather than the size of the map.
+    void findSubtree(const SdfPath& root, std::vector<iterator>& references);
+
+  private:
+    uint32_t findEntry(const SdfPath& path) const;
+    uint32_t findBucket(const SdfPath& path, uint64_t hash) const;
+    void rehash(size_t minBuckets);
+    void updateSortedIndex();
+    static uint64_t hashPath(const SdfPath& path);
+
+  private:
+    EntryArray m_entries;
+    std::vector<uint32_t> m_freeEntries;
+    std::vector<uint32_t> m_buckets;  ///< kEmpty, kTombstone, or the index of the entry + 1
+    size_t m_size = 0;
+    size_t m_tombstones = 0;
+    /// the entries sorted by path, followed by any entries inserted since the last sort. Erased entries are not
+    /// removed until the next sort, so each record is checked against the entry before it is used.
+    std::vector<std::pair<SdfPath, uint32_t>> m_sortedIndex;
+    size_t m_numSorted = 0;
+    uint32_t m_version = 0;
+    AL::maya::utils::MObjectValueMap<SdfPath> m_nodeIndex;
+  };
   TransformReferenceMap m_requiredPaths;
 
 
@@ -941,6 +1352,8 @@ private:
   void postConstructor() override;
   MStatus compute(const MPlug& plug, MDataBlock& dataBlock) override;
   MStatus setDependentsDirty(const MPlug& plugBeingDirtied, MPlugArray& plugs) override;
+  MStatus connectionMade(const MPlug& plug, const MPlug& otherPlug, bool asSrc) override;
+  MStatus connectionBroken(const MPlug& plug, const MPlug& otherPlug, bool asSrc) override;
   bool isBounded() const override;
   #if MAYA_API_VERSION < 201700
   MPxNode::SchedulingType schedulingType() const override { return kSerialize; }
@@ -973,11 +1386,16 @@ private:
 
   void layerIdChanged(SdfNotice::LayerIdentifierDidChange const& notice, UsdStageWeakPtr const& sender);
   void onObjectsChanged(UsdNotice::ObjectsChanged const&, UsdStageWeakPtr const& sender);
+  void removeChangedObjectsCallbacks();
+  static void onChangedObjectsIdle(void* ptr);
+  static void onChangedObjectsTimeChange(MTime& time, void* ptr);
   void variantSelectionListener(SdfNotice::LayersDidChange const& notice);
   void onEditTargetChanged(UsdNotice::StageEditTargetChanged const& notice, UsdStageWeakPtr const& sender);
   void trackEditTargetLayer(LayerManager* layerManager=nullptr);
   static void onAttributeChanged(MNodeMessage::AttributeMessage, MPlug&, MPlug&, void*);
+  static void onAboutToDelete(MObject&, MDGModifier&, void*);
   void validateTransforms();
+  bool findTaggedPrimsFromIndex();
 
 
   TfToken getTypeForPath(const SdfPath& path) override
@@ -1000,7 +1418,15 @@ private:
 
   AL::usdmaya::SelectabilityDB m_selectabilityDB;
   HierarchyIterationLogics m_hierarchyIterationLogics;
-  HierarchyIterationLogic m_findExcludedPrims;
+  size_t m_primsVisited = 0;
+  MetadataIndex m_metadataIndex;
+  proxy::PrimPicker m_primPicker;
+  proxy::TransformPool m_transformPool;
+  /// the samples of the transforms whose time is connected to outTime, which are shared with those transforms. The
+  /// set of transforms is rebuilt whenever m_requiredPaths changes (or the samples have been invalidated)
+  std::shared_ptr<proxy::AnimatedSamples> m_animatedSamples = std::make_shared<proxy::AnimatedSamples>();
+  uint32_t m_animatedTransformsVersion = ~0u;
+  FindExcludedPrimsLogic m_findExcludedPrims;
   SelectionList m_selectionList;
   FindUnselectablePrimsLogic m_findUnselectablePrims;
   SdfPathHashSet m_selectedPaths;
@@ -1011,9 +1437,14 @@ private:
   TfNotice::Key m_variantChangedNoticeKey;
   TfNotice::Key m_editTargetChanged;
 
-  mutable std::map<UsdTimeCode, MBoundingBox> m_boundingBoxCache;
+  /// boundingBox() is const, but fills in the cache. Maya may query the bounds from the threads of the evaluation
+  /// manager (or the viewport) while the stage notices invalidate it on the main thread, so all access is serialised
+  /// with m_boundsCacheMutex.
+  mutable proxy::BoundsCache m_boundsCache;
+  mutable std::mutex m_boundsCacheMutex;
   AL::event::CallbackId m_beforeSaveSceneId = -1;
   MCallbackId m_attributeChanged = 0;
+  MCallbackId m_aboutToDelete = 0;
   MCallbackId m_onSelectionChanged = 0;
   SdfPathVector m_excludedGeometry;
   SdfPathVector m_excludedTaggedGeometry;
@@ -1029,9 +1460,32 @@ private:
   fileio::translators::TranslatorManufacture m_translatorManufacture;
   SdfPath m_changedPath;
   SdfPathVector m_variantSwitchedPrims;
+  SdfPathVector m_drivenResyncedPaths;  ///< the paths resynced since the driven transforms were last updated
+  SdfPathSet m_changedSelectabilityPaths; ///< the prims whose selectability or lock state may have changed
+  SdfPathHashSet m_staticTransformPaths;  ///< the prims whose transforms disconnectStaticTransforms removed from outTime
+  SdfPathVector m_rearmedTransformPaths;  ///< the static transforms to reconnect to outTime, as they have gained samples
   SdfLayerHandle m_prevEditTarget;
   UsdImagingGLHdEngine* m_engine = 0;
 
+  /// a stage being opened on a worker thread. The thread is joined when the load is destroyed.
+  struct AsyncStageLoad
+  {
+    ~AsyncStageLoad()
+      { if(thread.joinable()) thread.join(); }
+    std::thread thread;
+    UsdStageRefPtr stage;
+    std::atomic<float> progress { 0.0f };
+    std::atomic<bool> done { false };
+  };
+  std::unique_ptr<AsyncStageLoad> m_asyncStageLoad;
+  MString m_asyncLoadFile;
+  MCallbackId m_asyncLoadIdle = 0;
+  MCallbackId m_changedObjectsIdle = 0;
+  MCallbackId m_changedObjectsTimeChange = 0;
+  StageLoadState m_currentLoadState = kStageUnloaded;
+  bool m_asyncLoadFromFileRead = false;
+  bool m_deserialiseOnAsyncLoad = false;
+
   uint32_t m_engineRefCount = 0;
   bool m_compositionHasChanged = false;
   bool m_drivenTransformsDirty = false;
@@ -13,6 +13,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
+#include "AL/usdmaya/cmds/ProxyShapeCommands.h"
 #include "AL/usdmaya/nodes/ProxyShape.h"
 #include "AL/usdmaya/nodes/Transform.h"
 #include "AL/usdmaya/nodes/TransformationMatrix.h"
@@ -21,6 +22,7 @@
 #include "AL/usdmaya/DebugCodes.h"
 
 #include "maya/MFnDagNode.h"
+#include "maya/MPlugArray.h"
 #include "maya/MPxCommand.h"
 
 #include <set>
@@ -33,17 +35,17 @@ namespace usdmaya {
 namespace nodes {
 namespace {
 typedef void (*proxy_function_prototype)(void* userData, AL::usdmaya::nodes::ProxyShape* proxyInstance);
-inline void addObjToSelectionList(MSelectionList& list, const MObject& object)
+inline void addObjToSelectionList(MSelectionList& list, const MObject& object, bool mergeWithExisting = true)
 {
   if(object.hasFn(MFn::kDagNode))
   {
     MFnDagNode dgNode(object);
     MDagPath dg; dgNode.getPath(dg);
-    list.add(dg, MObject::kNullObj, true);
+    list.add(dg, MObject::kNullObj, mergeWithExisting);
   }
   else
   {
-    list.add(object, true);
+    list.add(object, mergeWithExisting);
   }
 };
 }
@@ -63,86 +65,9 @@ void ProxyShape::onSelectionChanged(void* ptr)
   const int selectionMode = MGlobal::optionVarIntValue("AL_usdmaya_selectMode");
   if(selectionMode)
   {
-    ProxyShape* proxy = (ProxyShape*)ptr;
-    if(!proxy)
-      return;
-
-    if(proxy->m_pleaseIgnoreSelection)
-      return;
-
-    if(proxy->selectedPaths().empty())
-      return;
-
-    auto stage = proxy->getUsdStage();
-
-    MSelectionList sl;
-    MGlobal::getActiveSelectionList(sl);
-
-    std::vector<SdfPath> unselectedSet;
-    MFnDagNode fnDag;
-
-    // now attempt to find any items that have been selected via maya (e.g. by clicking on the parent node in the outliner)
-    bool hasNewItems = false;
-    MString precommand = "AL_usdmaya_ProxyShapeSelect -i -a";
-    for(uint32_t i = 0; i < sl.length(); ++i)
-    {
-      MObject obj;
-      sl.getDependNode(i, obj);
-      SdfPath path;
-      if(!proxy->isSelectedMObject(obj, path))
-      {
-        if(path.IsAbsolutePath())
-        {
-          precommand += " -pp \"";
-          precommand += path.GetText();
-          precommand += "\"";
-          hasNewItems = true;
-        }
-      }
-    }
-
-    struct compare_length {
-      bool operator() (const SdfPath& a, const SdfPath& b) const {
-         return a.GetString().size() > b.GetString().size();
-      }
-    };
-    std::sort(unselectedSet.begin(), unselectedSet.end(), compare_length());
-
-    // construct command to unselect the nodes (specifying the internal flag to ensure the selection list is not modified)
-    MString command = "AL_usdmaya_ProxyShapeSelect -i -d";
-    for(auto removed : unselectedSet)
-    {
-      command += " -pp \"";
-      command += removed.GetText();
-      command += "\"";
-    }
-
-    fnDag.setObject(proxy->thisMObject());
-
-    command += " \"";
-    command += fnDag.name().asChar();
-    command += "\"";
-
-    if(hasNewItems)
-    {
-      precommand += " \"";
-      precommand += fnDag.name().asChar();
-      precommand += "\";";
-      if(!unselectedSet.empty())
-      {
-        command = precommand + command;
-      }
-      else
-      {
-        command = precommand;
-      }
-    }
-
-    if(unselectedSet.empty() && !hasNewItems)
-    {
-      proxy->m_pleaseIgnoreSelection = true;
-      MGlobal::executeCommand(command, false, true);
-    }
+    // In the prim selection mode, the selection of prims is driven by the proxy shape alone, so there is nothing to
+    // reconcile here.
+    return;
   }
   else
   {
@@ -162,10 +87,8 @@ void ProxyShape::onSelectionChanged(void* ptr)
     MSelectionList sl;
     MGlobal::getActiveSelectionList(sl, false);
 
-    bool hasItems = false;
-    bool hasNewItems = false;
-    MString precommand = "AL_usdmaya_ProxyShapeSelect -i -a";
-    MString command = "AL_usdmaya_ProxyShapeSelect -i -d";
+    SdfPathVector newItems;
+    SdfPathVector removedItems;
 
     // maya bug work around.
     auto hasObject = [] (MSelectionList sl, MObject node)
@@ -183,13 +106,9 @@ void ProxyShape::onSelectionChanged(void* ptr)
     for(auto selected : proxy->selectedPaths())
     {
       MObject obj = proxy->findRequiredPath(selected);
-      MFnDependencyNode fn(obj);
       if(!hasObject(sl, obj))
       {
-        hasItems = true;
-        command += " -pp \"";
-        command += selected.GetText();
-        command += "\"";
+        removedItems.push_back(selected);
       }
     }
 
@@ -198,47 +117,262 @@ void ProxyShape::onSelectionChanged(void* ptr)
     {
       MObject obj;
       sl.getDependNode(i, obj);
-      MFnDependencyNode fn(obj);
       SdfPath path;
       if(!proxy->isSelectedMObject(obj, path))
       {
         if(path.IsAbsolutePath())
         {
-          precommand += " -pp \"";
-          precommand += path.GetText();
-          precommand += "\"";
-          hasNewItems = true;
+          newItems.push_back(path);
         }
       }
     }
 
-    if(hasItems)
+    if(!removedItems.empty() || !newItems.empty())
     {
-      MFnDagNode fnDag(proxy->thisMObject());
-      command += " \"";
-      command += fnDag.name().asChar();
-      command += "\"";
-      if(hasNewItems)
-      {
-        precommand += " \"";
-        precommand += fnDag.name().asChar();
-        precommand += "\";";
-        command = precommand + command;
-      }
+      // a single command, so that the change in selection is a single entry in the undo queue
       proxy->m_pleaseIgnoreSelection = true;
-      MGlobal::executeCommand(command, false, true);
+      cmds::ProxyShapeSelect::modifySelection(proxy, newItems, removedItems, true);
       proxy->m_pleaseIgnoreSelection = false;
     }
-    else
-    if(hasNewItems)
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+uint64_t ProxyShape::TransformReferenceMap::hashPath(const SdfPath& path)
+{
+  // the path hash is derived from the address of its node, so the low bits are poorly distributed. Mix them.
+  uint64_t hash = SdfPath::Hash()(path);
+  hash ^= hash >> 30;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+uint32_t ProxyShape::TransformReferenceMap::findBucket(const SdfPath& path, uint64_t hash) const
+{
+  const size_t mask = m_buckets.size() - 1;
+  for(size_t bucket = hash & mask; ; bucket = (bucket + 1) & mask)
+  {
+    const uint32_t value = m_buckets[bucket];
+    if(value == kEmpty)
     {
-      MFnDagNode fnDag(proxy->thisMObject());
-      precommand += " \"";
-      precommand += fnDag.name().asChar();
-      precommand += "\";";
-      proxy->m_pleaseIgnoreSelection = true;
-      MGlobal::executeCommand(precommand, false, true);
-      proxy->m_pleaseIgnoreSelection = false;
+      return kEnd;
+    }
+    if(value != kTombstone)
+    {
+      const Entry& entry = m_entries[value - 1];
+      if(entry.hash == hash && entry.value.first == path)
+      {
+        return bucket;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+uint32_t ProxyShape::TransformReferenceMap::findEntry(const SdfPath& path) const
+{
+  if(!m_size)
+  {
+    return kEnd;
+  }
+  const uint32_t bucket = findBucket(path, hashPath(path));
+  return bucket == kEnd ? kEnd : m_buckets[bucket] - 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::TransformReferenceMap::rehash(size_t minBuckets)
+{
+  size_t numBuckets = 16;
+  while(numBuckets < minBuckets)
+  {
+    numBuckets <<= 1;
+  }
+
+  m_buckets.assign(numBuckets, kEmpty);
+  m_tombstones = 0;
+  const size_t mask = numBuckets - 1;
+  for(uint32_t i = 0, n = m_entries.size(); i < n; ++i)
+  {
+    if(m_entries[i].alive)
+    {
+      size_t bucket = m_entries[i].hash & mask;
+      while(m_buckets[bucket] != kEmpty)
+      {
+        bucket = (bucket + 1) & mask;
+      }
+      m_buckets[bucket] = i + 1;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::pair<ProxyShape::TransformReferenceMap::iterator, bool> ProxyShape::TransformReferenceMap::emplace(
+    const SdfPath& path,
+    const TransformReference& reference)
+{
+  const uint64_t hash = hashPath(path);
+  if(m_size)
+  {
+    const uint32_t bucket = findBucket(path, hash);
+    if(bucket != kEnd)
+    {
+      return std::make_pair(iterator(this, m_buckets[bucket] - 1), false);
+    }
+  }
+
+  // keep the load factor (including the deleted slots) below 3/4
+  if((m_size + m_tombstones + 1) * 4 > m_buckets.size() * 3)
+  {
+    rehash((m_size + 1) * 2);
+  }
+
+  uint32_t index;
+  if(!m_freeEntries.empty())
+  {
+    index = m_freeEntries.back();
+    m_freeEntries.pop_back();
+    m_entries[index] = Entry(path, reference, hash);
+  }
+  else
+  {
+    index = m_entries.size();
+    m_entries.emplace_back(path, reference, hash);
+  }
+
+  const size_t mask = m_buckets.size() - 1;
+  size_t bucket = hash & mask;
+  while(m_buckets[bucket] != kEmpty && m_buckets[bucket] != kTombstone)
+  {
+    bucket = (bucket + 1) & mask;
+  }
+  if(m_buckets[bucket] == kTombstone)
+  {
+    --m_tombstones;
+  }
+  m_buckets[bucket] = index + 1;
+  ++m_size;
+  ++m_version;
+
+  // the new path is sorted into the index the next time a sub tree is requested
+  m_sortedIndex.emplace_back(path, index);
+
+  // the UUID is kept with the entry, so that the index can still be updated once the node has been deleted
+  MStatus status;
+  MFnDependencyNode fn(reference.node(), &status);
+  if(status)
+  {
+    Entry& entry = m_entries[index];
+    fn.uuid().get(entry.uuid.uuid);
+    entry.indexed = true;
+    m_nodeIndex.insert(entry.uuid, path);
+  }
+  return std::make_pair(iterator(this, index), true);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+ProxyShape::TransformReferenceMap::iterator ProxyShape::TransformReferenceMap::erase(iterator it)
+{
+  Entry& entry = m_entries[it.m_index];
+
+  if(entry.indexed)
+  {
+    const SdfPath* indexed = m_nodeIndex.find(entry.uuid);
+    if(indexed && *indexed == entry.value.first)
+    {
+      m_nodeIndex.erase(entry.uuid);
+    }
+  }
+
+  m_buckets[findBucket(entry.value.first, entry.hash)] = kTombstone;
+  ++m_tombstones;
+  --m_size;
+  ++m_version;
+
+  // the entry stays where it is (so the other iterators remain valid), and is recycled by the next insertion
+  entry.alive = false;
+  entry.indexed = false;
+  entry.value.first = SdfPath();
+  entry.value.second = TransformReference(MObject::kNullObj, nullptr, 0, 0, 0);
+  m_freeEntries.push_back(it.m_index);
+  return ++it;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::TransformReferenceMap::clear()
+{
+  m_entries.clear();
+  m_freeEntries.clear();
+  m_buckets.clear();
+  m_size = 0;
+  m_tombstones = 0;
+  m_sortedIndex.clear();
+  m_numSorted = 0;
+  m_nodeIndex.clear();
+  ++m_version;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const SdfPath* ProxyShape::TransformReferenceMap::findPath(const MObject& node) const
+{
+  MStatus status;
+  MFnDependencyNode fn(node, &status);
+  if(!status)
+    return nullptr;
+
+  // the index is keyed on the UUID, so check the reference is still using the same node
+  const SdfPath* path = m_nodeIndex.find(fn);
+  if(path)
+  {
+    auto it = find(*path);
+    if(it != end() && it->second.node() == node)
+    {
+      return path;
+    }
+  }
+  return nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::TransformReferenceMap::updateSortedIndex()
+{
+  const size_t count = m_sortedIndex.size();
+  if(m_numSorted == count && count <= m_size * 2)
+  {
+    return;
+  }
+
+  // only the paths inserted since the last update need sorting, they can then be merged with the sorted records
+  std::sort(m_sortedIndex.begin() + m_numSorted, m_sortedIndex.end());
+  std::inplace_merge(m_sortedIndex.begin(), m_sortedIndex.begin() + m_numSorted, m_sortedIndex.end());
+
+  // drop the records of erased entries. A path that was erased and re-inserted into the same entry will appear twice.
+  auto last = std::unique(m_sortedIndex.begin(), m_sortedIndex.end());
+  last = std::remove_if(m_sortedIndex.begin(), last, [this](const std::pair<SdfPath, uint32_t>& record) {
+    const Entry& entry = m_entries[record.second];
+    return !entry.alive || entry.value.first != record.first;
+  });
+  m_sortedIndex.erase(last, m_sortedIndex.end());
+  m_numSorted = m_sortedIndex.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::TransformReferenceMap::findSubtree(const SdfPath& root, std::vector<iterator>& references)
+{
+  references.clear();
+  updateSortedIndex();
+
+  // the descendants of a path are sorted immediately after it
+  auto it = std::lower_bound(m_sortedIndex.begin(), m_sortedIndex.end(), std::make_pair(root, uint32_t(0)));
+  for(auto end = m_sortedIndex.end(); it != end && it->first.HasPrefix(root); ++it)
+  {
+    const Entry& entry = m_entries[it->second];
+    if(entry.alive && entry.value.first == it->first)
+    {
+      references.push_back(iterator(this, it->second));
     }
   }
 }
@@ -338,11 +472,13 @@ void ProxyShape::makeTransformReference(const SdfPath& path, const MObject& node
   MObjectHandle handle(node);
   if(handle.isAlive() && handle.isValid())
   {
-    MFnDagNode fn(node, &status);
-    status = fn.getPath(dagPath);
+    // The dag path is only needed for the parts of the chain that have no reference (e.g. when re-doing a selection),
+    // so it is only retrieved on demand, and popped to the depth of the current path.
+    uint32_t depth = 0;
+    uint32_t dagPathDepth = 0;
+    bool hasDagPath = false;
     while(tempPath != SdfPath("/"))
     {
-      MObject tempNode = dagPath.node(&status);
       auto existing = m_requiredPaths.find(tempPath);
       if(existing != m_requiredPaths.end())
       {
@@ -350,11 +486,22 @@ void ProxyShape::makeTransformReference(const SdfPath& path, const MObject& node
       }
       else
       {
-        TransformReference ref(tempNode, reason);
+        if(!hasDagPath)
+        {
+          MFnDagNode fn(node, &status);
+          status = fn.getPath(dagPath);
+          hasDagPath = true;
+        }
+        if(depth > dagPathDepth)
+        {
+          status = dagPath.pop(depth - dagPathDepth);
+          dagPathDepth = depth;
+        }
+        TransformReference ref(dagPath.node(&status), reason);
         ref.incRef(reason);
         m_requiredPaths.emplace(tempPath, ref);
       }
-      status = dagPath.pop();
+      ++depth;
       tempPath = tempPath.GetParentPath();
     }
   }
@@ -436,6 +583,191 @@ MObject ProxyShape::makeUsdTransformChain(
   return newNode;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+MObjectArray ProxyShape::makeUsdTransformChains(
+    const std::vector<UsdPrim>& usdPrims,
+    MDagModifier& modifier,
+    TransformReason reason,
+    MDGModifier* modifier2,
+    uint32_t* createCount)
+{
+  TF_DEBUG(ALUSDMAYA_TRANSLATORS).Msg("ProxyShape::makeUsdTransformChains on %lu prims\n", usdPrims.size());
+
+  // special case for selection. Do not allow duplicate paths to be selected.
+  std::vector<UsdPrim> newPrims;
+  newPrims.reserve(usdPrims.size());
+  for(const UsdPrim& usdPrim : usdPrims)
+  {
+    if(usdPrim && (reason != kSelection || m_selectedPaths.insert(usdPrim.GetPath()).second))
+    {
+      newPrims.push_back(usdPrim);
+    }
+  }
+
+  const MObjectArray newNodes = makeUsdTransformChains_internal(newPrims, modifier, reason, modifier2, createCount);
+
+  std::vector<std::pair<SdfPath, MObject>> refs;
+  refs.reserve(newPrims.size());
+  for(uint32_t i = 0; i < newNodes.length(); ++i)
+  {
+    refs.emplace_back(newPrims[i].GetPath(), newNodes[i]);
+  }
+  insertTransformRefs(refs, reason);
+
+  // return the nodes in the order the prims were specified (including those that were previously selected)
+  MObjectArray nodes;
+  nodes.setLength(usdPrims.size());
+  for(uint32_t i = 0, n = usdPrims.size(); i < n; ++i)
+  {
+    if(usdPrims[i])
+    {
+      auto iter = m_requiredPaths.find(usdPrims[i].GetPath());
+      if(iter != m_requiredPaths.end())
+      {
+        nodes[i] = iter->second.node();
+      }
+    }
+  }
+  return nodes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MObjectArray ProxyShape::makeUsdTransformChains_internal(
+    const std::vector<UsdPrim>& usdPrims,
+    MDagModifier& modifier,
+    TransformReason reason,
+    MDGModifier* modifier2,
+    uint32_t* createCount,
+    MStringArray* resultingPaths)
+{
+  TF_DEBUG(ALUSDMAYA_SELECTION).Msg("ProxyShapeSelection::makeUsdTransformChains_internal %lu\n", usdPrims.size());
+
+  MObjectArray nodes;
+  if(usdPrims.empty() || !m_stage)
+  {
+    return nodes;
+  }
+
+  const MPlug outTimeAttr = outTimePlug();
+  const MPlug outStageAttr = outStageDataPlug();
+
+  // makes the assumption that instancing isn't supported.
+  MFnDagNode fn(thisMObject());
+  const MObject parentXForm = fn.parent(0);
+  MDagPath mayaPath;
+  MDagPath::getAPathTo(parentXForm, mayaPath);
+
+  // Gather the missing paths in each chain, along with the index of the first chain that would have created them had
+  // each chain been made separately. The rest of that chain already exists, so the walk stops at the first known path.
+  TfHashMap<SdfPath, size_t, SdfPath::Hash> missingPaths;
+  for(size_t i = 0, n = usdPrims.size(); i < n; ++i)
+  {
+    if(!usdPrims[i])
+      continue;
+    for(SdfPath path = usdPrims[i].GetPath(); path != SdfPath::AbsoluteRootPath(); path = path.GetParentPath())
+    {
+      if(m_requiredPaths.find(path) != m_requiredPaths.end() || !missingPaths.emplace(path, i).second)
+      {
+        break;
+      }
+    }
+  }
+
+  // parents sort before their children, so the transforms are created from the top of the hierarchy down
+  SdfPathVector sortedPaths;
+  sortedPaths.reserve(missingPaths.size());
+  for(const auto& missingPath : missingPaths)
+  {
+    sortedPaths.push_back(missingPath.first);
+  }
+  std::sort(sortedPaths.begin(), sortedPaths.end());
+
+  TfHashMap<SdfPath, MString, SdfPath::Hash> createdPaths;
+  for(const SdfPath& path : sortedPaths)
+  {
+    MObject parentNode = parentXForm;
+    if(path.GetPathElementCount() > 1)
+    {
+      auto parentIter = m_requiredPaths.find(path.GetParentPath());
+      if(parentIter != m_requiredPaths.end())
+      {
+        parentNode = parentIter->second.node();
+      }
+    }
+
+    MString newPath;
+    makeUsdTransform(m_stage->GetPrimAtPath(path), outStageAttr, outTimeAttr, parentNode, mayaPath, modifier, reason,
+                     modifier2, resultingPaths ? &newPath : 0);
+    if(createCount) (*createCount)++;
+    if(resultingPaths)
+    {
+      createdPaths.emplace(path, newPath);
+    }
+  }
+
+  // The new transforms have been counted once already, by the chain that created them. Each chain then references the
+  // transforms that existed before it in the same way as makeUsdTransformChain: every ancestor for a selection, and
+  // the ancestors up to the first that is already required for a required path.
+  if(reason != kRequested)
+  {
+    for(size_t i = 0, n = usdPrims.size(); i < n; ++i)
+    {
+      if(!usdPrims[i])
+        continue;
+
+      SdfPath path = usdPrims[i].GetPath();
+      for(; path != SdfPath::AbsoluteRootPath(); path = path.GetParentPath())
+      {
+        auto missing = missingPaths.find(path);
+        if(missing == missingPaths.end() || missing->second < i)
+        {
+          break;
+        }
+      }
+
+      for(; path != SdfPath::AbsoluteRootPath(); path = path.GetParentPath())
+      {
+        auto iter = m_requiredPaths.find(path);
+        if(iter == m_requiredPaths.end() || (reason == kRequired && iter->second.required()))
+        {
+          break;
+        }
+        iter->second.checkIncRef(reason);
+      }
+    }
+  }
+
+  nodes.setLength(usdPrims.size());
+  for(uint32_t i = 0, n = usdPrims.size(); i < n; ++i)
+  {
+    if(!usdPrims[i])
+    {
+      if(resultingPaths)
+        resultingPaths->append(MString());
+      continue;
+    }
+
+    const SdfPath path = usdPrims[i].GetPath();
+    nodes[i] = m_requiredPaths.find(path)->second.node();
+    if(resultingPaths)
+    {
+      auto created = createdPaths.find(path);
+      if(created != createdPaths.end())
+      {
+        resultingPaths->append(created->second);
+      }
+      else
+      {
+        MFnDagNode fnNode(nodes[i]);
+        MDagPath dagPath;
+        fnNode.getPath(dagPath);
+        resultingPaths->append(dagPath.fullPathName());
+      }
+    }
+  }
+  return nodes;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 MObject ProxyShape::makeUsdTransformChain(
     UsdPrim usdPrim,
@@ -538,11 +870,32 @@ MObject ProxyShape::makeUsdTransformChain(
 
   if(createCount) (*createCount)++;
 
+  //Retrieve the proxy shapes transform path which will be used in the UsdPrim->MayaNode mapping in the case where there is delayed node creation.
+  MFnDagNode shapeFn(thisMObject());
+  const MObject shapeParent = shapeFn.parent(0);
+  MDagPath mayaPath;
+  MDagPath::getAPathTo(shapeParent, mayaPath);
+  return makeUsdTransform(usdPrim, outStage, outTime, parentPath, mayaPath, modifier, reason, modifier2, resultingPath);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MObject ProxyShape::makeUsdTransform(
+    const UsdPrim& usdPrim,
+    const MPlug& outStage,
+    const MPlug& outTime,
+    const MObject& parentNode,
+    const MDagPath& proxyTransformPath,
+    MDagModifier& modifier,
+    TransformReason reason,
+    MDGModifier* modifier2,
+    MString* resultingPath)
+{
   MFnDagNode fn;
-  MObject parentNode = parentPath;
+  const SdfPath path = usdPrim.GetPath();
 
   bool isTransform = usdPrim.IsA<UsdGeomXformable>();
   bool isUsdTransform = true;
+  bool isPooled = false;
   MObject node;
   std::string transformType;
   bool hasMetadata = usdPrim.GetMetadata(Metadata::transformType, &transformType);
@@ -555,22 +908,43 @@ MObject ProxyShape::makeUsdTransformChain(
   }
   else
   {
-    node = modifier.createNode(Transform::kTypeId, parentNode);
-    TF_DEBUG(ALUSDMAYA_SELECTION).Msg("ProxyShape::makeUsdTransformChain created transformType = AL_usdmaya_Transform name=%s\n", usdPrim.GetName().GetText());
+    // transforms for the selection can be re-targeted from those released by a previous selection
+    if(reason == kSelection)
+    {
+      node = m_transformPool.acquire();
+    }
+
+    if(node.isNull())
+    {
+      node = modifier.createNode(Transform::kTypeId, parentNode);
+      TF_DEBUG(ALUSDMAYA_SELECTION).Msg("ProxyShape::makeUsdTransformChain created transformType = AL_usdmaya_Transform name=%s\n", usdPrim.GetName().GetText());
+    }
+    else
+    {
+      // The pooled node is moved through the modifier, so that it is returned to the pool if the selection is undone.
+      // Its plugs may have been locked for a prim of another type, which is harmless to leave behind in the pool.
+      setTransformPlugsLocked(node, !isTransform);
+      modifier.reparentNode(node, parentNode);
+      modifier.renameNode(node, AL::maya::utils::convert(usdPrim.GetName().GetString()));
+      modifier.newPlugValueBool(MPlug(node, MPxTransform::visibility), true);
+      isPooled = true;
+      TF_DEBUG(ALUSDMAYA_SELECTION).Msg("ProxyShape::makeUsdTransformChain reused pooled AL_usdmaya_Transform name=%s\n", usdPrim.GetName().GetText());
+    }
   }
 
   fn.setObject(node);
-  fn.setName(AL::maya::utils::convert(usdPrim.GetName().GetString()));
+  if(!isPooled)
+  {
+    fn.setName(AL::maya::utils::convert(usdPrim.GetName().GetString()));
+  }
 
-  //Retrieve the proxy shapes transform path which will be used in the UsdPrim->MayaNode mapping in the case where there is delayed node creation.
-  MFnDagNode shapeFn(thisMObject());
-  const MObject shapeParent = shapeFn.parent(0);
-  MDagPath mayaPath;
-  MDagPath::getAPathTo(shapeParent, mayaPath);
+  // the proxy shapes transform path is used in the UsdPrim->MayaNode mapping in the case where there is delayed node creation.
+  // A pooled node is still parented under the pool until the modifier is run, so it is mapped in the same way.
+  const MObject mappedNode = isPooled ? MObject::kNullObj : node;
   if(resultingPath)
-    *resultingPath = AL::usdmaya::utils::mapUsdPrimToMayaNode(usdPrim, node, &mayaPath);
+    *resultingPath = AL::usdmaya::utils::mapUsdPrimToMayaNode(usdPrim, mappedNode, &proxyTransformPath);
   else
-    AL::usdmaya::utils::mapUsdPrimToMayaNode(usdPrim, node, &mayaPath);
+    AL::usdmaya::utils::mapUsdPrimToMayaNode(usdPrim, mappedNode, &proxyTransformPath);
 
   if(isUsdTransform)
   {
@@ -578,28 +952,29 @@ MObject ProxyShape::makeUsdTransformChain(
     MPlug inStageData = ptrNode->inStageDataPlug();
     MPlug inTime = ptrNode->timePlug();
 
+    const bool connectTime = !isStaticTransform(usdPrim);
+    if(connectTime)
+    {
+      m_staticTransformPaths.erase(usdPrim.GetPath());
+    }
+    else
+    {
+      m_staticTransformPaths.insert(usdPrim.GetPath());
+    }
     modifier.connect(outStage, inStageData);
-    modifier.connect(outTime, inTime);
+    if(connectTime)
+    {
+      modifier.connect(outTime, inTime);
+    }
 
     if(modifier2)
     {
       modifier2->newPlugValueBool(ptrNode->pushToPrimPlug(), true);
     }
 
-    if(!isTransform)
+    if(!isTransform && !isPooled)
     {
-      MPlug(node, MPxTransform::translate).setLocked(true);
-      MPlug(node, MPxTransform::rotate).setLocked(true);
-      MPlug(node, MPxTransform::scale).setLocked(true);
-      MPlug(node, MPxTransform::transMinusRotatePivot).setLocked(true);
-      MPlug(node, MPxTransform::rotateAxis).setLocked(true);
-      MPlug(node, MPxTransform::scalePivotTranslate).setLocked(true);
-      MPlug(node, MPxTransform::scalePivot).setLocked(true);
-      MPlug(node, MPxTransform::rotatePivotTranslate).setLocked(true);
-      MPlug(node, MPxTransform::rotatePivot).setLocked(true);
-      MPlug(node, MPxTransform::shearXY).setLocked(true);
-      MPlug(node, MPxTransform::shearXZ).setLocked(true);
-      MPlug(node, MPxTransform::shearYZ).setLocked(true);
+      setTransformPlugsLocked(node, true);
     }
 
     // set the primitive path
@@ -652,7 +1027,15 @@ void ProxyShape::makeUsdTransformsInternal(const UsdPrim& usdPrim, const MObject
       MPlug inStageData = ptrNode->inStageDataPlug();
       MPlug inTime = ptrNode->timePlug();
       modifier.connect(outStageAttr, inStageData);
-      modifier.connect(outTimeAttr, inTime);
+      if(!isStaticTransform(prim))
+      {
+        modifier.connect(outTimeAttr, inTime);
+        m_staticTransformPaths.erase(prim.GetPath());
+      }
+      else
+      {
+        m_staticTransformPaths.insert(prim.GetPath());
+      }
 
       if(modifier2)
       {
@@ -675,6 +1058,155 @@ void ProxyShape::makeUsdTransformsInternal(const UsdPrim& usdPrim, const MObject
 }
 
 
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::setTransformPlugsLocked(const MObject& node, bool locked)
+{
+  static const MObject* const attributes[] = {
+    &MPxTransform::translate,
+    &MPxTransform::rotate,
+    &MPxTransform::scale,
+    &MPxTransform::transMinusRotatePivot,
+    &MPxTransform::rotateAxis,
+    &MPxTransform::scalePivotTranslate,
+    &MPxTransform::scalePivot,
+    &MPxTransform::rotatePivotTranslate,
+    &MPxTransform::rotatePivot,
+    &MPxTransform::shearXY,
+    &MPxTransform::shearXZ,
+    &MPxTransform::shearYZ
+  };
+
+  for(const MObject* attribute : attributes)
+  {
+    MPlug(node, *attribute).setLocked(locked);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::releaseUsdTransform(const MObject& node, MDagModifier& modifier)
+{
+  if(m_transformPool.release(node))
+  {
+    // detach the node from the proxy shape and its prim, and hide it in the pool until it is reused
+    Transform* ptrNode = (Transform*)MFnDependencyNode(node).userNode();
+    MPlug inStageData = ptrNode->inStageDataPlug();
+    if(inStageData.isConnected())
+    {
+      modifier.disconnect(outStageDataPlug(), inStageData);
+    }
+    if(isTimeDriven(node))
+    {
+      modifier.disconnect(outTimePlug(), ptrNode->timePlug());
+    }
+    modifier.reparentNode(node, m_transformPool.container());
+    modifier.newPlugValueString(ptrNode->primPathPlug(), "");
+    modifier.newPlugValueBool(MPlug(node, MPxTransform::visibility), false);
+  }
+  else
+  {
+    // reparent the custom transform under world prior to deleting (without accidentally nuking all parent transforms
+    // in the chain)
+    modifier.reparentNode(node);
+    modifier.deleteNode(node);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::isStaticTransform(const UsdPrim& prim)
+{
+  if(!disconnectStaticTransformsPlug().asBool())
+  {
+    return false;
+  }
+  UsdGeomXformable xformable(prim);
+  return !xformable || !xformable.TransformMightBeTimeVarying();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::isTimeDriven(const MObject& node) const
+{
+  MPlugArray sources;
+  MPlug time(node, Transform::time());
+  return time.connectedTo(sources, true, false) && sources.length() && sources[0] == outTimePlug();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool ProxyShape::hasTimeRemapping(const MObject& node)
+{
+  MPlug timeOffset(node, Transform::timeOffset());
+  MPlug timeScalar(node, Transform::timeScalar());
+  if(timeOffset.isConnected() || timeScalar.isConnected())
+  {
+    return true;
+  }
+  return timeOffset.asMTime().value() != 0.0 || timeScalar.asDouble() != 1.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::updateStaticTransformConnections()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::updateStaticTransformConnections\n");
+  if(!m_stage)
+  {
+    return;
+  }
+
+  MDGModifier modifier;
+  const MPlug outTime = outTimePlug();
+  for(const auto& it : m_requiredPaths)
+  {
+    Transform* transform = it.second.m_transform;
+    UsdPrim prim = m_stage->GetPrimAtPath(it.first);
+    if(!transform || !prim)
+    {
+      continue;
+    }
+
+    // only the connections this option removed are restored, so a time connection the user has removed is left alone
+    MPlug time = transform->timePlug();
+    if(isStaticTransform(prim))
+    {
+      if(isTimeDriven(it.second.node()))
+      {
+        modifier.disconnect(outTime, time);
+        m_staticTransformPaths.insert(it.first);
+      }
+    }
+    else
+    if(m_staticTransformPaths.erase(it.first) && !time.isConnected())
+    {
+      modifier.connect(outTime, time);
+    }
+  }
+  modifier.doIt();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void ProxyShape::reconnectRearmedTransforms()
+{
+  SdfPathVector paths;
+  paths.swap(m_rearmedTransformPaths);
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::reconnectRearmedTransforms %zu transforms\n", paths.size());
+
+  MDGModifier modifier;
+  const MPlug outTime = outTimePlug();
+  for(const SdfPath& path : paths)
+  {
+    auto it = m_requiredPaths.find(path);
+    if(it == m_requiredPaths.end() || !it->second.m_transform)
+    {
+      continue;
+    }
+
+    MPlug time = it->second.m_transform->timePlug();
+    if(m_staticTransformPaths.erase(path) && !time.isConnected())
+    {
+      modifier.connect(outTime, time);
+    }
+  }
+  modifier.doIt();
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void ProxyShape::removeUsdTransformChain_internal(
     const UsdPrim& usdPrim,
@@ -699,8 +1231,7 @@ void ProxyShape::removeUsdTransformChain_internal(
       MObject object = it->second.node();
       if(object != MObject::kNullObj)
       {
-        modifier.reparentNode(object);
-        modifier.deleteNode(object);
+        releaseUsdTransform(object, modifier);
       }
       m_currentLockedPrims.erase(primPath);
     }
@@ -804,35 +1335,6 @@ void ProxyShape::removeUsdTransformChain(
   }
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-void ProxyShape::removeUsdTransformsInternal(
-    const UsdPrim& usdPrim,
-    MDagModifier& modifier,
-    TransformReason reason)
-{
-  TF_DEBUG(ALUSDMAYA_SELECTION).Msg("ProxyShapeSelection::removeUsdTransformsInternal %s\n", usdPrim.GetPath().GetText());
-  // can we find the prim in the current set?
-  auto it = m_requiredPaths.find(usdPrim.GetPath());
-  if(it == m_requiredPaths.end())
-  {
-    return;
-  }
-
-  // first go remove the children
-  for(auto iter = usdPrim.GetChildren().begin(), end = usdPrim.GetChildren().end(); iter != end; ++iter)
-  {
-    removeUsdTransformsInternal(*iter, modifier, ProxyShape::kRequested);
-  }
-
-  if(it->second.decRef(reason))
-  {
-    // work around for Maya's love of deleting the parent transforms of custom transform nodes :(
-    modifier.reparentNode(it->second.node());
-    modifier.deleteNode(it->second.node());
-    m_requiredPaths.erase(it);
-  }
-}
-
 //----------------------------------------------------------------------------------------------------------------------
 void ProxyShape::removeUsdTransforms(
     const UsdPrim& usdPrim,
@@ -851,10 +1353,39 @@ void ProxyShape::removeUsdTransforms(
   // no need to iterate through children if we are requesting a shape
   if(reason == kRequested)
   {
-    // first go remove the children
-    for(auto it = usdPrim.GetChildren().begin(), end = usdPrim.GetChildren().end(); it != end; ++it)
+    // The references are sorted by path, so the parents come before their children. Only the references reached by
+    // walking the children of the prim are released (so those beneath an inactive prim, or one that is no longer
+    // referenced, are left alone). The first entry is the prim itself, which is handled by removeUsdTransformChain.
+    std::vector<TransformReferenceMap::iterator> subtree;
+    m_requiredPaths.findSubtree(usdPrim.GetPath(), subtree);
+    const UsdStageWeakPtr stage = usdPrim.GetStage();
+    SdfPathHashSet reached;
+    reached.insert(usdPrim.GetPath());
+    size_t numReached = std::min<size_t>(subtree.size(), 1);
+    for(size_t i = 1; i < subtree.size(); ++i)
+    {
+      const SdfPath& path = subtree[i]->first;
+      const UsdPrim prim = stage->GetPrimAtPath(path);
+      if(reached.count(path.GetParentPath()) && prim && UsdPrimDefaultPredicate(prim))
+      {
+        reached.insert(path);
+        subtree[numReached++] = subtree[i];
+      }
+    }
+    subtree.resize(numReached);
+
+    // walking them in reverse removes the children before their parents
+    for(size_t i = subtree.size(); i > 1; --i)
     {
-      removeUsdTransformsInternal(*it, modifier, ProxyShape::kRequested);
+      auto child = subtree[i - 1];
+      TF_DEBUG(ALUSDMAYA_SELECTION).Msg("ProxyShapeSelection::removeUsdTransforms %s\n", child->first.GetText());
+      if(child->second.refCount() && child->second.decRef(kRequested))
+      {
+        // work around for Maya's love of deleting the parent transforms of custom transform nodes :(
+        modifier.reparentNode(child->second.node());
+        modifier.deleteNode(child->second.node());
+        m_requiredPaths.erase(child);
+      }
     }
   }
 
@@ -884,6 +1415,7 @@ void SelectionUndoHelper::doIt()
   m_proxy->m_pleaseIgnoreSelection = true;
   m_modifier1.doIt();
   m_modifier2.doIt();
+  m_proxy->m_transformPool.commit(m_acquiredNodes, m_releasedNodes);
   m_proxy->insertTransformRefs(m_insertedRefs, nodes::ProxyShape::kSelection);
   m_proxy->removeTransformRefs(m_removedRefs, nodes::ProxyShape::kSelection);
   m_proxy->selectedPaths() = m_paths;
@@ -902,6 +1434,7 @@ void SelectionUndoHelper::undoIt()
   m_proxy->m_pleaseIgnoreSelection = true;
   m_modifier2.undoIt();
   m_modifier1.undoIt();
+  m_proxy->m_transformPool.revert(m_acquiredNodes, m_releasedNodes);
   m_proxy->insertTransformRefs(m_removedRefs, nodes::ProxyShape::kSelection);
   m_proxy->removeTransformRefs(m_insertedRefs, nodes::ProxyShape::kSelection);
   m_proxy->selectedPaths() = m_previousPaths;
@@ -978,12 +1511,8 @@ bool ProxyShape::removeAllSelectedNodes(SelectionUndoHelper& helper)
     // now go and delete all of the nodes in order
     for(auto value = toRemove.begin(), e = toRemove.end(); value != e; ++value)
     {
-      // reparent the custom transform under world prior to deleting
       MObject temp = (*value)->second.node();
-      helper.m_modifier1.reparentNode(temp);
-
-      // now we can delete (without accidentally nuking all parent transforms in the chain)
-      helper.m_modifier1.deleteNode(temp);
+      releaseUsdTransform(temp, helper.m_modifier1);
 
       auto& paths = selectedPaths();
       for(auto iter = paths.begin(), end = paths.end(); iter != end; ++iter)
@@ -1014,6 +1543,10 @@ bool ProxyShape::doSelect(SelectionUndoHelper& helper, const SdfPathVector& orde
   m_pleaseIgnoreSelection = true;
   prepSelect();
 
+  // the transforms released by this selection can be reused by the next one
+  m_transformPool.setCapacity(std::max(0, transformPoolSizePlug().asInt()));
+  proxy::TransformPool::Batch poolBatch(m_transformPool, helper.m_acquiredNodes, helper.m_releasedNodes);
+
   MGlobal::getActiveSelectionList(helper.m_previousSelection);
 
   helper.m_previousPaths = selectedPaths();
@@ -1061,15 +1594,15 @@ bool ProxyShape::doSelect(SelectionUndoHelper& helper, const SdfPathVector& orde
 
       m_selectedPaths.clear();
 
+      // the new selection list starts out empty, and the inserted prims are unique, so there is no need to merge
       uint32_t hasNodesToCreate = 0;
-      for(auto prim : insertPrims)
+      const MObjectArray objects = makeUsdTransformChains_internal(insertPrims, helper.m_modifier1, ProxyShape::kSelection, &helper.m_modifier2, &hasNodesToCreate, &newlySelectedPaths);
+      helper.m_insertedRefs.reserve(insertPrims.size());
+      for(uint32_t i = 0, n = insertPrims.size(); i < n; ++i)
       {
-        m_selectedPaths.insert(prim.GetPath());
-        MString pathName;
-        MObject object = makeUsdTransformChain_internal(prim, helper.m_modifier1, ProxyShape::kSelection, &helper.m_modifier2, &hasNodesToCreate, &pathName);
-        newlySelectedPaths.append(pathName);
-        addObjToSelectionList(helper.m_newSelection, object);
-        helper.m_insertedRefs.emplace_back(prim.GetPath(), object);
+        m_selectedPaths.insert(insertPrims[i].GetPath());
+        addObjToSelectionList(helper.m_newSelection, objects[i], false);
+        helper.m_insertedRefs.emplace_back(insertPrims[i].GetPath(), objects[i]);
       }
 
       for(auto iter : helper.m_previousPaths)
@@ -1114,14 +1647,13 @@ bool ProxyShape::doSelect(SelectionUndoHelper& helper, const SdfPathVector& orde
       helper.m_paths.insert(helper.m_previousPaths.begin(), helper.m_previousPaths.end());
 
       uint32_t hasNodesToCreate = 0;
-      for(auto prim : prims)
+      const MObjectArray objects = makeUsdTransformChains_internal(prims, helper.m_modifier1, ProxyShape::kSelection, &helper.m_modifier2, &hasNodesToCreate, &newlySelectedPaths);
+      helper.m_insertedRefs.reserve(prims.size());
+      for(uint32_t i = 0, n = prims.size(); i < n; ++i)
       {
-        m_selectedPaths.insert(prim.GetPath());
-        MString pathName;
-        MObject object = makeUsdTransformChain_internal(prim, helper.m_modifier1, ProxyShape::kSelection, &helper.m_modifier2, &hasNodesToCreate, &pathName);
-        newlySelectedPaths.append(pathName);
-        addObjToSelectionList(helper.m_newSelection, object);
-        helper.m_insertedRefs.emplace_back(prim.GetPath(), object);
+        m_selectedPaths.insert(prims[i].GetPath());
+        addObjToSelectionList(helper.m_newSelection, objects[i]);
+        helper.m_insertedRefs.emplace_back(prims[i].GetPath(), objects[i]);
       }
     }
     break;
@@ -1238,14 +1770,13 @@ bool ProxyShape::doSelect(SelectionUndoHelper& helper, const SdfPathVector& orde
       }
 
       uint32_t hasNodesToCreate = 0;
-      for(auto prim : insertPrims)
+      const MObjectArray objects = makeUsdTransformChains_internal(insertPrims, helper.m_modifier1, ProxyShape::kSelection, &helper.m_modifier2, &hasNodesToCreate, &newlySelectedPaths);
+      helper.m_insertedRefs.reserve(helper.m_insertedRefs.size() + insertPrims.size());
+      for(uint32_t i = 0, n = insertPrims.size(); i < n; ++i)
       {
-        m_selectedPaths.insert(prim.GetPath());
-        MString pathName;
-        MObject object = makeUsdTransformChain_internal(prim, helper.m_modifier1, ProxyShape::kSelection, &helper.m_modifier2, &hasNodesToCreate, &pathName);
-        newlySelectedPaths.append(pathName);
-        addObjToSelectionList(helper.m_newSelection, object);
-        helper.m_insertedRefs.emplace_back(prim.GetPath(), object);
+        m_selectedPaths.insert(insertPrims[i].GetPath());
+        addObjToSelectionList(helper.m_newSelection, objects[i]);
+        helper.m_insertedRefs.emplace_back(insertPrims[i].GetPath(), objects[i]);
       }
       helper.m_paths = m_selectedPaths;
     }
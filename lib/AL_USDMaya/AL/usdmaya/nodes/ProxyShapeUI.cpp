@@ -16,6 +16,7 @@
 #include "maya/MTypes.h"
 
 #include "AL/usdmaya/DebugCodes.h"
+#include "AL/usdmaya/cmds/ProxyShapeCommands.h"
 #include "AL/usdmaya/nodes/ProxyShape.h"
 #include "AL/usdmaya/nodes/ProxyShapeUI.h"
 #include "AL/usdmaya/nodes/ProxyDrawOverride.h"
@@ -31,6 +32,7 @@
 #include "maya/MPoint.h"
 #include "maya/MObjectArray.h"
 #include "maya/MPointArray.h"
+#include "maya/MVector.h"
 
 
 namespace AL {
@@ -259,6 +261,42 @@ public:
 };
 SdfPathVector ProxyShapeSelectionHelper::m_paths;
 
+namespace {
+//----------------------------------------------------------------------------------------------------------------------
+// fills the hit batch using the CPU prim picker, rather than rendering the stage into a selection buffer
+bool pickPrims(MSelectInfo& selectInfo, proxy::PrimPicker& picker, const MMatrix& localToWorld, const MMatrix& localToClip,
+               UsdImagingGLEngine::HitBatch& hitBatch)
+{
+  proxy::PrimPicker::HitVector hits;
+  if(selectInfo.singleSelection())
+  {
+    MPoint origin;
+    MVector direction;
+    selectInfo.getLocalRay(origin, direction);
+    picker.pickRay(GfRay(GfVec3d(origin.x, origin.y, origin.z), GfVec3d(direction.x, direction.y, direction.z)), hits);
+
+    // only the closest prim can be selected with a single click
+    if(hits.size() > 1)
+    {
+      hits.resize(1);
+    }
+  }
+  else
+  {
+    picker.pickFrustum(GfMatrix4d(localToClip.matrix), hits);
+  }
+
+  for(const proxy::PrimPicker::Hit& hit : hits)
+  {
+    const MPoint worldPoint = MPoint(hit.point[0], hit.point[1], hit.point[2]) * localToWorld;
+    UsdImagingGLEngine::HitInfo& info = hitBatch[hit.path];
+    info.worldSpaceHitPoint = GfVec3d(worldPoint.x, worldPoint.y, worldPoint.z);
+    info.hitInstanceIndex = -1;
+  }
+  return !hits.empty();
+}
+} // anon
+
 
 //----------------------------------------------------------------------------------------------------------------------
 bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList, MPointArray& worldSpaceSelectPoints) const
@@ -299,20 +337,33 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
   SdfPathVector rootPath;
   rootPath.push_back(root.GetPath());
 
-  int resolution = 10;
-  MGlobal::getOptionVarValue("AL_usdmaya_selectResolution", resolution);
-  if (resolution < 10) { resolution = 10; }
-  if (resolution > 1024) { resolution = 1024; }
-
-  bool hitSelected = engine->TestIntersectionBatch(
-          GfMatrix4d(viewMatrix.matrix),
-          GfMatrix4d(projectionMatrix.matrix),
-          worldToLocalSpace,
-          rootPath,
-          params,
-          resolution,
-          ProxyShapeSelectionHelper::path_ting,
-          &hitBatch);
+  // When the pick mode is 1, the prims are picked on the CPU (which avoids the cost of rendering the stage at the
+  // selection resolution). The paths returned by the picker are the paths of the prims (or instance proxies) that were
+  // hit, so they do not need to be resolved through the imaging engine.
+  const bool cpuPicking = (1 == MGlobal::optionVarIntValue("AL_usdmaya_pickMode"));
+  bool hitSelected = false;
+  if(cpuPicking)
+  {
+    const MMatrix localToWorld = selectPath.inclusiveMatrix();
+    hitSelected = pickPrims(selectInfo, proxyShape->primPicker(), localToWorld, localToWorld * viewMatrix * projectionMatrix, hitBatch);
+  }
+  else
+  {
+    int resolution = 10;
+    MGlobal::getOptionVarValue("AL_usdmaya_selectResolution", resolution);
+    if (resolution < 10) { resolution = 10; }
+    if (resolution > 1024) { resolution = 1024; }
+
+    hitSelected = engine->TestIntersectionBatch(
+            GfMatrix4d(viewMatrix.matrix),
+            GfMatrix4d(projectionMatrix.matrix),
+            worldToLocalSpace,
+            rootPath,
+            params,
+            resolution,
+            ProxyShapeSelectionHelper::path_ting,
+            &hitBatch);
+  }
 
   auto selected = false;
 
@@ -329,7 +380,11 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
       return SdfPath(pathStr);
   };
 
-  auto getHitPath = [&engine, &removeVariantFromPath] (UsdImagingGLEngine::HitBatch::const_reference& it) -> SdfPath {
+  auto getHitPath = [&engine, &removeVariantFromPath, cpuPicking] (UsdImagingGLEngine::HitBatch::const_reference& it) -> SdfPath {
+      if (cpuPicking)
+      {
+        return it.first;
+      }
       const UsdImagingGLEngine::HitInfo& hit = it.second;
       auto path = engine->GetPrimPathFromInstanceIndex(it.first, hit.hitInstanceIndex);
       if (!path.IsEmpty())
@@ -342,10 +397,9 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
 
   auto addSelection = [&hitBatch, &selectInfo, &selectionList,
       &worldSpaceSelectPoints, &objectsMask, &selected, proxyShape,
-      &removeVariantFromPath] (const MString& command) {
+      &removeVariantFromPath] (const SdfPathVector& paths, MGlobal::ListAdjustment mode) {
       selected = true;
-      MStringArray nodes;
-      MGlobal::executeCommand(command, nodes, false, true);
+      cmds::ProxyShapeSelect::select(proxyShape, paths, mode, true);
 
       // If the selection is in a single selection mode, we don't know if your mesh
       // will be the actual final selection, because we can't make sure this is going to
@@ -393,38 +447,17 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
       if(shiftHeld)
         mode = MGlobal::kXORWithList;
 
-      MString command = "AL_usdmaya_ProxyShapeSelect";
-      switch(mode)
-      {
-      case MGlobal::kReplaceList: command += " -r"; break;
-      case MGlobal::kRemoveFromList: command += " -d"; break;
-      case MGlobal::kXORWithList: command += " -tgl"; break;
-      case MGlobal::kAddToList: command += " -a"; break;
-      case MGlobal::kAddToHeadOfList: /* should never get here */ break;
-      }
-
+      SdfPathVector paths;
+      paths.reserve(hitBatch.size());
       for(auto it = hitBatch.begin(), e = hitBatch.end(); it != e; ++it)
       {
-        auto path = getHitPath(*it);
-        command += " -pp \"";
-        command += path.GetText();
-        command += "\"";
+        paths.push_back(getHitPath(*it));
       }
-
-      MFnDependencyNode fn(proxyShape->thisMObject());
-      command += " \"";
-      command += fn.name();
-      command += "\"";
-      MGlobal::executeCommandOnIdle(command, false);
+      cmds::ProxyShapeSelect::select(proxyShape, paths, mode, false, cmds::ProxyShapeSelect::kExecuteOnIdle);
     }
     else
     {
-      MString command = "AL_usdmaya_ProxyShapeSelect -cl ";
-      MFnDependencyNode fn(proxyShape->thisMObject());
-      command += " \"";
-      command += fn.name();
-      command += "\"";
-      MGlobal::executeCommandOnIdle(command, false);
+      cmds::ProxyShapeSelect::select(proxyShape, SdfPathVector(), MGlobal::kReplaceList, false, cmds::ProxyShapeSelect::kExecuteOnIdle);
     }
   }
   else
@@ -491,34 +524,14 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
     {
     case MGlobal::kReplaceList:
       {
-        MString command;
         if(!proxyShape->selectedPaths().empty())
         {
-          command = "AL_usdmaya_ProxyShapeSelect -i -cl ";
-          MFnDependencyNode fn(proxyShape->thisMObject());
-          command += " \"";
-          command += fn.name();
-          command += "\";";
+          cmds::ProxyShapeSelect::select(proxyShape, SdfPathVector(), MGlobal::kReplaceList, true);
         }
 
         if(!paths.empty())
         {
-          command += "AL_usdmaya_ProxyShapeSelect -i -a ";
-          for(const auto& it : paths)
-          {
-            command += " -pp \"";
-            command += it.GetText();
-            command += "\"";
-          }
-          MFnDependencyNode fn(proxyShape->thisMObject());
-          command += " \"";
-          command += fn.name();
-          command += "\"";
-
-        }
-
-        if(command.length() > 0) {
-          addSelection(command);
+          addSelection(paths, MGlobal::kAddToList);
         }
       }
       break;
@@ -526,25 +539,9 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
     case MGlobal::kAddToHeadOfList:
     case MGlobal::kAddToList:
       {
-        MString command;
         if(paths.size())
         {
-          command = "AL_usdmaya_ProxyShapeSelect -i -a ";
-          for(auto it : paths)
-          {
-            command += " -pp \"";
-            command += it.GetText();
-            command += "\"";
-          }
-          MFnDependencyNode fn(proxyShape->thisMObject());
-          command += " \"";
-          command += fn.name();
-          command += "\"";
-        }
-
-        if(command.length() > 0) {
-          selected = true;
-          addSelection(command);
+          addSelection(paths, MGlobal::kAddToList);
         }
       }
       break;
@@ -553,18 +550,7 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
       {
         if(!proxyShape->selectedPaths().empty() && paths.size())
         {
-          MString command = "AL_usdmaya_ProxyShapeSelect -d ";
-          for(auto it : paths)
-          {
-            command += " -pp \"";
-            command += it.GetText();
-            command += "\"";
-          }
-          MFnDependencyNode fn(proxyShape->thisMObject());
-          command += " \"";
-          command += fn.name();
-          command += "\"";
-          MGlobal::executeCommandOnIdle(command, false);
+          cmds::ProxyShapeSelect::select(proxyShape, paths, MGlobal::kRemoveFromList, false, cmds::ProxyShapeSelect::kExecuteOnIdle);
         }
       }
       break;
@@ -572,51 +558,26 @@ bool ProxyShapeUI::select(MSelectInfo& selectInfo, MSelectionList& selectionList
     case MGlobal::kXORWithList:
       {
         auto& slpaths = proxyShape->selectedPaths();
-        bool hasSelectedItems = false;
-        bool hasDeletedItems = false;
-
-        MString selectcommand = "AL_usdmaya_ProxyShapeSelect -i -a ";
-        MString deselectcommand = "AL_usdmaya_ProxyShapeSelect -d ";
+        SdfPathVector selectPaths;
+        SdfPathVector deselectPaths;
         for(auto it : paths)
         {
-          bool flag = false;
-          for(auto sit : slpaths)
+          if(slpaths.count(it))
           {
-            if(sit == it)
-            {
-              flag = true;
-              break;
-            }
-          }
-          if(flag)
-          {
-            deselectcommand += " -pp \"";
-            deselectcommand += it.GetText();
-            deselectcommand += "\"";
-            hasDeletedItems = true;
+            deselectPaths.push_back(it);
           }
           else
           {
-            selectcommand += " -pp \"";
-            selectcommand += it.GetText();
-            selectcommand += "\"";
-            hasSelectedItems = true;
+            selectPaths.push_back(it);
           }
         }
-        MFnDependencyNode fn(proxyShape->thisMObject());
-        selectcommand += " \"";
-        selectcommand += fn.name();
-        selectcommand += "\"";
-        deselectcommand += " \"";
-        deselectcommand += fn.name();
-        deselectcommand += "\"";
-
-        if(hasSelectedItems) {
-          addSelection(selectcommand);
+
+        if(!selectPaths.empty()) {
+          addSelection(selectPaths, MGlobal::kAddToList);
         }
 
-        if(hasDeletedItems) {
-          MGlobal::executeCommandOnIdle(deselectcommand, false);
+        if(!deselectPaths.empty()) {
+          cmds::ProxyShapeSelect::select(proxyShape, deselectPaths, MGlobal::kRemoveFromList, false, cmds::ProxyShapeSelect::kExecuteOnIdle);
         }
       }
       break;
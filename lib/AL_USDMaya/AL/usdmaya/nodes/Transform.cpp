@@ -18,6 +18,7 @@
 #include "AL/usdmaya/DebugCodes.h"
 #include "AL/usdmaya/nodes/Transform.h"
 #include "AL/usdmaya/nodes/TransformationMatrix.h"
+#include "AL/usdmaya/nodes/proxy/AnimatedSamples.h"
 
 #include "maya/MBoundingBox.h"
 #include "maya/MDataBlock.h"
@@ -70,6 +71,18 @@ Transform::Transform()
 //----------------------------------------------------------------------------------------------------------------------
 Transform::~Transform()
 {
+  // the proxy shape must not read the samples of this transform once it has gone
+  invalidateAnimatedSamples();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void Transform::invalidateAnimatedSamples()
+{
+  std::shared_ptr<proxy::AnimatedSamples> samples = m_animatedSamples.lock();
+  if(samples)
+  {
+    samples->invalidate();
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -171,6 +184,27 @@ MStatus Transform::compute(const MPlug& plug, MDataBlock& dataBlock)
   return MPxTransform::compute(plug, dataBlock);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+MStatus Transform::connectionMade(const MPlug& plug, const MPlug& otherPlug, bool asSrc)
+{
+  // a transform that remaps the time is not sampled by the proxy shape
+  if(!asSrc && (plug == m_timeOffset || plug == m_timeScalar))
+  {
+    invalidateAnimatedSamples();
+  }
+  return MPxTransform::connectionMade(plug, otherPlug, asSrc);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MStatus Transform::connectionBroken(const MPlug& plug, const MPlug& otherPlug, bool asSrc)
+{
+  if(!asSrc && (plug == m_timeOffset || plug == m_timeScalar))
+  {
+    invalidateAnimatedSamples();
+  }
+  return MPxTransform::connectionBroken(plug, otherPlug, asSrc);
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void Transform::updateTransform(MDataBlock& dataBlock)
 {
@@ -182,9 +216,19 @@ void Transform::updateTransform(MDataBlock& dataBlock)
 
   UsdTimeCode usdTime(theTime.as(MTime::uiUnit()));
 
-  // update the transformation matrix to the values at the specified time
+  // update the transformation matrix to the values at the specified time, using the values read by the proxy shape
+  // (if they were read at the same time)
   TransformationMatrix* m = transform();
-  m->updateToTime(usdTime);
+  std::shared_ptr<proxy::AnimatedSamples> samples = m_animatedSamples.lock();
+  const proxy::AnimatedSamples::Sample* sample = samples ? samples->find(m, usdTime) : nullptr;
+  if(sample)
+  {
+    m->updateToSample(usdTime, *sample);
+  }
+  else
+  {
+    m->updateToTime(usdTime);
+  }
 
   // if translation animation is present, update the translate attribute (or just flag it as clean if no animation exists)
   if(m->hasAnimatedTranslation())
@@ -290,11 +334,13 @@ MStatus Transform::validateAndSetValue(const MPlug& plug, const MDataHandle& han
     if(plug == m_timeOffset)
     {
       outputTimeValue(dataBlock, m_timeOffset, handle.asTime());
+      invalidateAnimatedSamples();
     }
     else
     if(plug == m_timeScalar)
     {
       outputDoubleValue(dataBlock, m_timeScalar, handle.asDouble());
+      invalidateAnimatedSamples();
     }
 
     updateTransform(dataBlock);
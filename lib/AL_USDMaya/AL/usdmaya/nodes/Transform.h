@@ -21,10 +21,12 @@
 #include "AL/maya/utils/MayaHelperMacros.h"
 #include "maya/MPxTransform.h"
 
+#include <memory>
 
 namespace AL {
 namespace usdmaya {
 namespace nodes {
+namespace proxy { class AnimatedSamples; }
 
 //----------------------------------------------------------------------------------------------------------------------
 /// \brief  The AL::usdmaya::nodes::Transform node is a custom transform node that allows you to manipulate a USD
@@ -124,6 +126,12 @@ public:
   MPxNode::SchedulingType schedulingType() const override
     { return kParallel; }
 
+  /// \brief  sets the samples read by the proxy shape whose outTime drives this transform. When computed at the time
+  ///         they were read at, the transform takes its animated values from them (rather than reading them itself).
+  /// \param  samples the samples of the proxy shape, or null once the transform is no longer driven by it
+  inline void setAnimatedSamples(const std::shared_ptr<proxy::AnimatedSamples>& samples)
+    { m_animatedSamples = samples; }
+
 private:
 
   //--------------------------------------------------------------------------------------------------------------------
@@ -133,6 +141,8 @@ private:
   MStatus validateAndSetValue(const MPlug& plug, const MDataHandle& handle, const MDGContext& context) override;
   MPxTransformationMatrix* createTransformationMatrix() override;
   MStatus compute(const MPlug &plug, MDataBlock &datablock) override;
+  MStatus connectionMade(const MPlug& plug, const MPlug& otherPlug, bool asSrc) override;
+  MStatus connectionBroken(const MPlug& plug, const MPlug& otherPlug, bool asSrc) override;
   void postConstructor() override;
   MBoundingBox boundingBox() const override;
   bool isBounded() const override
@@ -145,6 +155,9 @@ private:
   //--------------------------------------------------------------------------------------------------------------------
 
   void updateTransform(MDataBlock& dataBlock);
+  void invalidateAnimatedSamples();
+
+  std::weak_ptr<proxy::AnimatedSamples> m_animatedSamples;
 
   //--------------------------------------------------------------------------------------------------------------------
   /// \name Input Attributes
@@ -19,10 +19,17 @@
 #include "AL/usdmaya/nodes/Transform.h"
 #include "AL/usdmaya/nodes/TransformationMatrix.h"
 
+#include "maya/MEventMessage.h"
 #include "maya/MFileIO.h"
+#include "maya/MGlobal.h"
+#include "maya/MThreadUtils.h"
 #include "AL/usdmaya/utils/AttributeType.h"
 #include "AL/usdmaya/utils/Utils.h"
 
+#include "pxr/usd/sdf/changeBlock.h"
+
+#include <algorithm>
+
 PXR_NAMESPACE_USING_DIRECTIVE
 
 namespace AL {
@@ -31,6 +38,111 @@ namespace nodes {
 
 using AL::usdmaya::utils::UsdDataType;
 
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  the matrices waiting to push their values onto their prims. Only pushes made from the main thread are ever
+///         queued, so the queue is never accessed from the parallel evaluation threads.
+//----------------------------------------------------------------------------------------------------------------------
+class TransformationMatrix::PushQueue
+{
+public:
+  ~PushQueue()
+  {
+    // the callback must not outlive the plugin, so write anything still queued now
+    flush();
+  }
+
+  /// returns true if a push made now should be queued
+  bool shouldQueue() const
+  {
+    return (m_batchDepth || (MGlobal::mayaState() == MGlobal::kInteractive &&
+                             MGlobal::optionVarIntValue("AL_usdmaya_deferPushToPrim"))) && MThreadUtils::isMainThread();
+  }
+
+  void add(TransformationMatrix* matrix)
+  {
+    m_pending.push_back({matrix, matrix->m_time});
+
+    // outside of a batch, the pushes are written once maya has finished processing the current event
+    if(!m_batchDepth && !m_flushOnIdle)
+    {
+      m_flushOnIdle = MEventMessage::addEventCallback("idle", onIdle, this);
+    }
+  }
+
+  void remove(const TransformationMatrix* matrix)
+  {
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                   [matrix](const PendingPush& push) { return push.matrix == matrix; }),
+                    m_pending.end());
+  }
+
+  void beginBatch()
+    { ++m_batchDepth; }
+
+  void endBatch()
+  {
+    if(m_batchDepth && !--m_batchDepth)
+    {
+      flush();
+    }
+  }
+
+  size_t size() const
+    { return m_pending.size(); }
+
+  void flush()
+  {
+    if(m_flushOnIdle)
+    {
+      MEventMessage::removeCallback(m_flushOnIdle);
+      m_flushOnIdle = 0;
+    }
+    if(m_pending.empty())
+    {
+      return;
+    }
+    TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::flushPendingPushes %zu\n", m_pending.size());
+
+    std::vector<PendingPush> pending;
+    pending.swap(m_pending);
+
+    // a single change notice is sent for all of the prims once the block closes
+    SdfChangeBlock changeBlock;
+    for(const PendingPush& push : pending)
+    {
+      TransformationMatrix* matrix = push.matrix;
+      if(matrix->pushToPrimPending())
+      {
+        matrix->m_flags &= ~kPushToPrimPending;
+        if(matrix->pushToPrimAvailable())
+        {
+          // write the values at the time they were set, rather than the time the queue happens to be flushed at
+          const UsdTimeCode currentTime = matrix->m_time;
+          matrix->m_time = push.time;
+          matrix->internal_pushToPrim();
+          matrix->m_time = currentTime;
+        }
+      }
+    }
+  }
+
+private:
+  static void onIdle(void* queue)
+    { ((PushQueue*)queue)->flush(); }
+
+  // a matrix waiting to push its values onto its prim, and the time code the values were set at
+  struct PendingPush
+  {
+    TransformationMatrix* matrix;
+    UsdTimeCode time;
+  };
+  std::vector<PendingPush> m_pending;
+  uint32_t m_batchDepth = 0;
+  MCallbackId m_flushOnIdle = 0;
+};
+
+std::unique_ptr<TransformationMatrix::PushQueue> TransformationMatrix::m_pushQueue;
+
 //----------------------------------------------------------------------------------------------------------------------
 const MTypeId TransformationMatrix::kTypeId(AL_USDMAYA_TRANSFORMATION_MATRIX);
 
@@ -102,6 +214,16 @@ TransformationMatrix::TransformationMatrix(const UsdPrim& prim)
   initialiseToPrim();
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+TransformationMatrix::~TransformationMatrix()
+{
+  // a matrix that has been re-initialised may still be in the queue (without the pending flag), so always check
+  if(m_pushQueue)
+  {
+    m_pushQueue->remove(this);
+  }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void TransformationMatrix::setPrim(const UsdPrim& prim)
 {
@@ -163,17 +285,53 @@ void TransformationMatrix::setPrim(const UsdPrim& prim)
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-bool TransformationMatrix::readVector(MVector& result, const UsdGeomXformOp& op, UsdTimeCode timeCode)
+namespace {
+/// reads the values of an xform op directly
+struct XformOpReader
+{
+  XformOpReader(const UsdGeomXformOp& op)
+    : m_op(op) {}
+  template<typename T>
+  bool get(T* value, UsdTimeCode timeCode) const
+    { return m_op.GetAs<T>(value, timeCode); }
+  UsdGeomXformOp::Type opType() const
+    { return m_op.GetOpType(); }
+  UsdDataType dataType() const
+    { return AL::usdmaya::utils::getAttributeType(m_op.GetTypeName()); }
+  TfToken name() const
+    { return m_op.GetOpName(); }
+  const UsdGeomXformOp& m_op;
+};
+
+/// reads the values of an xform op through its cached attribute query, which avoids resolving the value through the
+/// layer stack on each read
+struct XformOpQueryReader
+{
+  XformOpQueryReader(const TransformationMatrix::XformOpQuery& op)
+    : m_op(op) {}
+  template<typename T>
+  bool get(T* value, UsdTimeCode timeCode) const
+    { return m_op.query.Get<T>(value, timeCode); }
+  UsdGeomXformOp::Type opType() const
+    { return m_op.opType; }
+  UsdDataType dataType() const
+    { return m_op.dataType; }
+  TfToken name() const
+    { return m_op.query.GetAttribute().GetName(); }
+  const TransformationMatrix::XformOpQuery& m_op;
+};
+
+template<typename Reader>
+bool readVectorValue(MVector& result, const Reader& op, UsdTimeCode timeCode)
 {
   TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readVector\n");
-  const SdfValueTypeName vtn = op.GetTypeName();
-  UsdDataType attr_type = AL::usdmaya::utils::getAttributeType(vtn);
+  const UsdDataType attr_type = op.dataType();
   switch(attr_type)
   {
   case UsdDataType::kVec3d:
     {
       GfVec3d value;
-      const bool retValue = op.GetAs<GfVec3d>(&value, timeCode);
+      const bool retValue = op.template get<GfVec3d>(&value, timeCode);
       if (!retValue)
       {
         return false;
@@ -187,7 +345,7 @@ bool TransformationMatrix::readVector(MVector& result, const UsdGeomXformOp& op,
   case UsdDataType::kVec3f:
     {
       GfVec3f value;
-      const bool retValue = op.GetAs<GfVec3f>(&value, timeCode);
+      const bool retValue = op.template get<GfVec3f>(&value, timeCode);
       if (!retValue)
       {
         return false;
@@ -201,7 +359,7 @@ bool TransformationMatrix::readVector(MVector& result, const UsdGeomXformOp& op,
   case UsdDataType::kVec3h:
     {
       GfVec3h value;
-      const bool retValue = op.GetAs<GfVec3h>(&value, timeCode);
+      const bool retValue = op.template get<GfVec3h>(&value, timeCode);
       if (!retValue)
       {
         return false;
@@ -215,7 +373,7 @@ bool TransformationMatrix::readVector(MVector& result, const UsdGeomXformOp& op,
   case UsdDataType::kVec3i:
     {
       GfVec3i value;
-      const bool retValue = op.GetAs<GfVec3i>(&value, timeCode);
+      const bool retValue = op.template get<GfVec3i>(&value, timeCode);
       if (!retValue)
       {
         return false;
@@ -230,9 +388,236 @@ bool TransformationMatrix::readVector(MVector& result, const UsdGeomXformOp& op,
     return false;
   }
 
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readVector %f %f %f\n%s\n", result.x, result.y, result.z, op.GetOpName().GetText());
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readVector %f %f %f\n%s\n", result.x, result.y, result.z, op.name().GetText());
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+template<typename Reader>
+bool readShearValue(MVector& result, const Reader& op, UsdTimeCode timeCode)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readShear\n");
+  const UsdDataType attr_type = op.dataType();
+  switch(attr_type)
+  {
+  case UsdDataType::kMatrix4d:
+    {
+      GfMatrix4d value;
+      const bool retValue = op.template get<GfMatrix4d>(&value, timeCode);
+      if (!retValue)
+      {
+        return false;
+      }
+      result.x = value[1][0];
+      result.y = value[2][0];
+      result.z = value[2][1];
+    }
+    break;
+
+  default:
+    return false;
+  }
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readShear %f %f %f\n%s\n", result.x, result.y, result.z, op.name().GetText());
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+template<typename Reader>
+double readDoubleValue(const Reader& op, UsdTimeCode timeCode)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readDouble\n");
+  double result = 0;
+  const UsdDataType attr_type = op.dataType();
+  switch(attr_type)
+  {
+  case UsdDataType::kHalf:
+    {
+      GfHalf value;
+      const bool retValue = op.template get<GfHalf>(&value, timeCode);
+      if (retValue)
+      {
+        result = float(value);
+      }
+    }
+    break;
+
+  case UsdDataType::kFloat:
+    {
+      float value;
+      const bool retValue = op.template get<float>(&value, timeCode);
+      if (retValue)
+      {
+        result = double(value);
+      }
+    }
+    break;
+
+  case UsdDataType::kDouble:
+    {
+      double value;
+      const bool retValue = op.template get<double>(&value, timeCode);
+      if (retValue)
+      {
+        result = value;
+      }
+    }
+    break;
+
+  case UsdDataType::kInt:
+    {
+      int32_t value;
+      const bool retValue = op.template get<int32_t>(&value, timeCode);
+      if (retValue)
+      {
+        result = double(value);
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readDouble %f\n%s\n", result, op.name().GetText());
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+template<typename Reader>
+bool readRotationValue(MEulerRotation& result, const Reader& op, UsdTimeCode timeCode)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readRotation %f %f %f\n%s\n", result.x, result.y, result.z, op.name().GetText());
+  const double degToRad = 3.141592654 / 180.0;
+  switch(op.opType())
+  {
+  case UsdGeomXformOp::TypeRotateX:
+    {
+      result.x = readDoubleValue(op, timeCode) * degToRad;
+      result.y = 0.0;
+      result.z = 0.0;
+      result.order = MEulerRotation::kXYZ;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateY:
+    {
+      result.x = 0.0;
+      result.y = readDoubleValue(op, timeCode) * degToRad;
+      result.z = 0.0;
+      result.order = MEulerRotation::kXYZ;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateZ:
+    {
+      result.x = 0.0;
+      result.y = 0.0;
+      result.z = readDoubleValue(op, timeCode) * degToRad;
+      result.order = MEulerRotation::kXYZ;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateXYZ:
+    {
+      MVector v;
+      if(readVectorValue(v, op, timeCode))
+      {
+        result.x = v.x * degToRad;
+        result.y = v.y * degToRad;
+        result.z = v.z * degToRad;
+        result.order = MEulerRotation::kXYZ;
+      }
+      else
+        return false;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateXZY:
+    {
+      MVector v;
+      if(readVectorValue(v, op, timeCode))
+      {
+        result.x = v.x * degToRad;
+        result.y = v.y * degToRad;
+        result.z = v.z * degToRad;
+        result.order = MEulerRotation::kXZY;
+      }
+      else
+        return false;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateYXZ:
+    {
+      MVector v;
+      if(readVectorValue(v, op, timeCode))
+      {
+        result.x = v.x * degToRad;
+        result.y = v.y * degToRad;
+        result.z = v.z * degToRad;
+        result.order = MEulerRotation::kYXZ;
+      }
+      else
+        return false;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateYZX:
+    {
+      MVector v;
+      if(readVectorValue(v, op, timeCode))
+      {
+        result.x = v.x * degToRad;
+        result.y = v.y * degToRad;
+        result.z = v.z * degToRad;
+        result.order = MEulerRotation::kYZX;
+      }
+      else
+        return false;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateZXY:
+    {
+      MVector v;
+      if(readVectorValue(v, op, timeCode))
+      {
+        result.x = v.x * degToRad;
+        result.y = v.y * degToRad;
+        result.z = v.z * degToRad;
+        result.order = MEulerRotation::kZXY;
+      }
+      else
+        return false;
+    }
+    break;
+
+  case UsdGeomXformOp::TypeRotateZYX:
+    {
+      MVector v;
+      if(readVectorValue(v, op, timeCode))
+      {
+        result.x = v.x * degToRad;
+        result.y = v.y * degToRad;
+        result.z = v.z * degToRad;
+        result.order = MEulerRotation::kZYX;
+      }
+      else
+        return false;
+    }
+    break;
+
+  default:
+    return false;
+  }
   return true;
 }
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+bool TransformationMatrix::readVector(MVector& result, const UsdGeomXformOp& op, UsdTimeCode timeCode)
+{
+  return readVectorValue(result, XformOpReader(op), timeCode);
+}
 
 //----------------------------------------------------------------------------------------------------------------------
 bool TransformationMatrix::pushVector(const MVector& result, UsdGeomXformOp& op, UsdTimeCode timeCode)
@@ -306,30 +691,7 @@ bool TransformationMatrix::pushShear(const MVector& result, UsdGeomXformOp& op,
 //----------------------------------------------------------------------------------------------------------------------
 bool TransformationMatrix::readShear(MVector& result, const UsdGeomXformOp& op, UsdTimeCode timeCode)
 {
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readShear\n");
-  const SdfValueTypeName vtn = op.GetTypeName();
-  UsdDataType attr_type = AL::usdmaya::utils::getAttributeType(vtn);
-  switch(attr_type)
-  {
-  case UsdDataType::kMatrix4d:
-    {
-      GfMatrix4d value;
-      const bool retValue = op.GetAs<GfMatrix4d>(&value, timeCode);
-      if (!retValue)
-      {
-        return false;
-      }
-      result.x = value[1][0];
-      result.y = value[2][0];
-      result.z = value[2][1];
-    }
-    break;
-
-  default:
-    return false;
-  }
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readShear %f %f %f\n%s\n", result.x, result.y, result.z, op.GetOpName().GetText());
-  return true;
+  return readShearValue(result, XformOpReader(op), timeCode);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -497,66 +859,13 @@ bool TransformationMatrix::pushPoint(const MPoint& result, UsdGeomXformOp& op, U
     return false;
   }
 
-  return true;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-double TransformationMatrix::readDouble(const UsdGeomXformOp& op, UsdTimeCode timeCode)
-{
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readDouble\n");
-  double result = 0;
-  UsdDataType attr_type = AL::usdmaya::utils::getAttributeType(op.GetTypeName());
-  switch(attr_type)
-  {
-  case UsdDataType::kHalf:
-    {
-      GfHalf value;
-      const bool retValue = op.Get<GfHalf>(&value, timeCode);
-      if (retValue)
-      {
-        result = float(value);
-      }
-    }
-    break;
-
-  case UsdDataType::kFloat:
-    {
-      float value;
-      const bool retValue = op.Get<float>(&value, timeCode);
-      if (retValue)
-      {
-        result = double(value);
-      }
-    }
-    break;
-
-  case UsdDataType::kDouble:
-    {
-      double value;
-      const bool retValue = op.Get<double>(&value, timeCode);
-      if (retValue)
-      {
-        result = value;
-      }
-    }
-    break;
-
-  case UsdDataType::kInt:
-    {
-      int32_t value;
-      const bool retValue = op.Get<int32_t>(&value, timeCode);
-      if (retValue)
-      {
-        result = double(value);
-      }
-    }
-    break;
-
-  default:
-    break;
-  }
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readDouble %f\n%s\n", result, op.GetOpName().GetText());
-  return result;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+double TransformationMatrix::readDouble(const UsdGeomXformOp& op, UsdTimeCode timeCode)
+{
+  return readDoubleValue(XformOpReader(op), timeCode);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -598,131 +907,7 @@ void TransformationMatrix::pushDouble(const double value, UsdGeomXformOp& op, Us
 //----------------------------------------------------------------------------------------------------------------------
 bool TransformationMatrix::readRotation(MEulerRotation& result, const UsdGeomXformOp& op, UsdTimeCode timeCode)
 {
-  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readRotation %f %f %f\n%s\n", result.x, result.y, result.z, op.GetOpName().GetText());
-  const double degToRad = 3.141592654 / 180.0;
-  switch(op.GetOpType())
-  {
-  case UsdGeomXformOp::TypeRotateX:
-    {
-      result.x = readDouble(op, timeCode) * degToRad;
-      result.y = 0.0;
-      result.z = 0.0;
-      result.order = MEulerRotation::kXYZ;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateY:
-    {
-      result.x = 0.0;
-      result.y = readDouble(op, timeCode) * degToRad;
-      result.z = 0.0;
-      result.order = MEulerRotation::kXYZ;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateZ:
-    {
-      result.x = 0.0;
-      result.y = 0.0;
-      result.z = readDouble(op, timeCode) * degToRad;
-      result.order = MEulerRotation::kXYZ;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateXYZ:
-    {
-      MVector v;
-      if(readVector(v, op, timeCode))
-      {
-        result.x = v.x * degToRad;
-        result.y = v.y * degToRad;
-        result.z = v.z * degToRad;
-        result.order = MEulerRotation::kXYZ;
-      }
-      else
-        return false;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateXZY:
-    {
-      MVector v;
-      if(readVector(v, op, timeCode))
-      {
-        result.x = v.x * degToRad;
-        result.y = v.y * degToRad;
-        result.z = v.z * degToRad;
-        result.order = MEulerRotation::kXZY;
-      }
-      else
-        return false;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateYXZ:
-    {
-      MVector v;
-      if(readVector(v, op, timeCode))
-      {
-        result.x = v.x * degToRad;
-        result.y = v.y * degToRad;
-        result.z = v.z * degToRad;
-        result.order = MEulerRotation::kYXZ;
-      }
-      else
-        return false;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateYZX:
-    {
-      MVector v;
-      if(readVector(v, op, timeCode))
-      {
-        result.x = v.x * degToRad;
-        result.y = v.y * degToRad;
-        result.z = v.z * degToRad;
-        result.order = MEulerRotation::kYZX;
-      }
-      else
-        return false;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateZXY:
-    {
-      MVector v;
-      if(readVector(v, op, timeCode))
-      {
-        result.x = v.x * degToRad;
-        result.y = v.y * degToRad;
-        result.z = v.z * degToRad;
-        result.order = MEulerRotation::kZXY;
-      }
-      else
-        return false;
-    }
-    break;
-
-  case UsdGeomXformOp::TypeRotateZYX:
-    {
-      MVector v;
-      if(readVector(v, op, timeCode))
-      {
-        result.x = v.x * degToRad;
-        result.y = v.y * degToRad;
-        result.z = v.z * degToRad;
-        result.order = MEulerRotation::kZYX;
-      }
-      else
-        return false;
-    }
-    break;
-
-  default:
-    return false;
-  }
-  return true;
+  return readRotationValue(result, XformOpReader(op), timeCode);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -769,6 +954,20 @@ bool TransformationMatrix::pushRotation(const MEulerRotation& value, UsdGeomXfor
   return true;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::buildXformOpQueries()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::buildXformOpQueries\n");
+  m_xformOpQueries.clear();
+  m_xformOpQueries.reserve(m_xformops.size());
+  for(const UsdGeomXformOp& op : m_xformops)
+  {
+    UsdAttributeQuery query(op.GetAttr());
+    const bool timeVarying = query.ValueMightBeTimeVarying();
+    m_xformOpQueries.push_back({ std::move(query), op.GetOpType(), AL::usdmaya::utils::getAttributeType(op.GetTypeName()), timeVarying });
+  }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transformNode)
 {
@@ -781,6 +980,7 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
   bool resetsXformStack = false;
   m_xformops = m_xform.GetOrderedXformOps(&resetsXformStack);
   m_orderedOps.resize(m_xformops.size());
+  buildXformOpQueries();
 
   if(!resetsXformStack)
     m_flags |= kInheritsTransform;
@@ -794,7 +994,8 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
   }
 
   auto opIt = m_orderedOps.begin();
-  for(std::vector<UsdGeomXformOp>::const_iterator it = m_xformops.begin(), e = m_xformops.end(); it != e; ++it, ++opIt)
+  auto queryIt = m_xformOpQueries.begin();
+  for(std::vector<UsdGeomXformOp>::const_iterator it = m_xformops.begin(), e = m_xformops.end(); it != e; ++it, ++opIt, ++queryIt)
   {
     const UsdGeomXformOp& op = *it;
     switch(*opIt)
@@ -802,7 +1003,7 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
     case kTranslate:
       {
         m_flags |= kPrimHasTranslation;
-        if(op.GetNumTimeSamples() > 1)
+        if(queryIt->timeVarying)
         {
           m_flags |= kAnimatedTranslation;
         }
@@ -872,7 +1073,7 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
     case kRotate:
       {
         m_flags |= kPrimHasRotation;
-        if(op.GetNumTimeSamples() > 1)
+        if(queryIt->timeVarying)
         {
           m_flags |= kAnimatedRotation;
         }
@@ -945,7 +1146,7 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
     case kShear:
       {
         m_flags |= kPrimHasShear;
-        if(op.GetNumTimeSamples() > 1)
+        if(queryIt->timeVarying)
         {
           m_flags |= kAnimatedShear;
         }
@@ -964,7 +1165,7 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
     case kScale:
       {
         m_flags |= kPrimHasScale;
-        if(op.GetNumTimeSamples() > 1)
+        if(queryIt->timeVarying)
         {
           m_flags |= kAnimatedScale;
         }
@@ -995,7 +1196,7 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
         m_flags |= kPrimHasTransform;
         m_flags |= kFromMatrix;
         m_flags |= kPushPrimToMatrix;
-        if(op.GetNumTimeSamples() > 1)
+        if(queryIt->timeVarying)
         {
           m_flags |= kAnimatedMatrix;
         }
@@ -1032,6 +1233,14 @@ void TransformationMatrix::initialiseToPrim(bool readFromPrim, Transform* transf
   }
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::updateAnimationFlags()
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::updateAnimationFlags\n");
+  m_flags &= ~kAnimationMask;
+  initialiseToPrim(false);
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void TransformationMatrix::updateToTime(const UsdTimeCode& time)
 {
@@ -1044,87 +1253,141 @@ void TransformationMatrix::updateToTime(const UsdTimeCode& time)
 
   if(m_time != time)
   {
-    m_time = time;
-    if(hasAnimation())
+    if(hasAnimation() && m_xformOpQueries.size() != m_xformops.size())
+    {
+      buildXformOpQueries();
+    }
+
+    AnimatedSample sample;
+    readAnimatedSample(time, sample);
+    updateToSample(time, sample);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool TransformationMatrix::readAnimatedSample(const UsdTimeCode& time, AnimatedSample& sample) const
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::readAnimatedSample %f\n", time.GetValue());
+  sample.components = 0;
+  if(!m_prim || !hasAnimation() || m_xformOpQueries.size() != m_xformops.size())
+  {
+    return false;
+  }
+
+  const UsdTimeCode timeCode = readAnimatedValues() ? time : UsdTimeCode::Default();
+  auto opIt = m_orderedOps.begin();
+  for(auto it = m_xformOpQueries.cbegin(), e = m_xformOpQueries.cend(); it != e; ++it, ++opIt)
+  {
+    // ops with a single value cannot have changed since they were last read
+    if(!it->timeVarying)
+    {
+      continue;
+    }
+
+    const XformOpQueryReader op(*it);
+    switch(*opIt)
     {
-      auto opIt = m_orderedOps.begin();
-      for(std::vector<UsdGeomXformOp>::const_iterator it = m_xformops.begin(), e = m_xformops.end(); it != e; ++it, ++opIt)
+    case kTranslate:
       {
-        const UsdGeomXformOp& op = *it;
-        switch(*opIt)
+        if(hasAnimatedTranslation() && readVectorValue(sample.translation, op, timeCode))
         {
-        case kTranslate:
-          {
-            if(hasAnimatedTranslation())
-            {
-              internal_readVector(m_translationFromUsd, op);
-              MPxTransformationMatrix::translationValue = m_translationFromUsd + m_translationTweak;
-            }
-          }
-          break;
-
-        case kRotate:
-          {
-            if(hasAnimatedRotation())
-            {
-              internal_readRotation(m_rotationFromUsd, op);
-              MPxTransformationMatrix::rotationValue = m_rotationFromUsd;
-              MPxTransformationMatrix::rotationValue.x += m_rotationTweak.x;
-              MPxTransformationMatrix::rotationValue.y += m_rotationTweak.y;
-              MPxTransformationMatrix::rotationValue.z += m_rotationTweak.z;
-            }
-          }
-          break;
+          sample.components |= AnimatedSample::kTranslation;
+        }
+      }
+      break;
 
-        case kScale:
-          {
-            if(hasAnimatedScale())
-            {
-              internal_readVector(m_scaleFromUsd, op);
-              MPxTransformationMatrix::scaleValue = m_scaleFromUsd + m_scaleTweak;
-            }
-          }
-          break;
+    case kRotate:
+      {
+        if(hasAnimatedRotation() && readRotationValue(sample.rotation, op, timeCode))
+        {
+          sample.components |= AnimatedSample::kRotation;
+        }
+      }
+      break;
 
-        case kShear:
-          {
-            if(hasAnimatedShear())
-            {
-              internal_readShear(m_shearFromUsd, op);
-              MPxTransformationMatrix::shearValue = m_shearFromUsd + m_shearTweak;
-            }
-          }
-          break;
+    case kScale:
+      {
+        if(hasAnimatedScale() && readVectorValue(sample.scale, op, timeCode))
+        {
+          sample.components |= AnimatedSample::kScale;
+        }
+      }
+      break;
 
-        case kTransform:
-          {
-            if(hasAnimatedMatrix())
-            {
-              GfMatrix4d matrix;
-              op.Get<GfMatrix4d>(&matrix, getTimeCode());
-              double T[3], S[3];
-              AL::usdmaya::utils::matrixToSRT(matrix, S, m_rotationFromUsd, T);
-              m_scaleFromUsd.x = S[0];
-              m_scaleFromUsd.y = S[1];
-              m_scaleFromUsd.z = S[2];
-              m_translationFromUsd.x = T[0];
-              m_translationFromUsd.y = T[1];
-              m_translationFromUsd.z = T[2];
-              MPxTransformationMatrix::rotationValue.x = m_rotationFromUsd.x + m_rotationTweak.x;
-              MPxTransformationMatrix::rotationValue.y = m_rotationFromUsd.y + m_rotationTweak.y;
-              MPxTransformationMatrix::rotationValue.z = m_rotationFromUsd.z + m_rotationTweak.z;
-              MPxTransformationMatrix::translationValue = m_translationFromUsd + m_translationTweak;
-              MPxTransformationMatrix::scaleValue = m_scaleFromUsd + m_scaleTweak;
-            }
-          }
-          break;
+    case kShear:
+      {
+        if(hasAnimatedShear() && readShearValue(sample.shear, op, timeCode))
+        {
+          sample.components |= AnimatedSample::kShear;
+        }
+      }
+      break;
 
-        default:
-          break;
+    case kTransform:
+      {
+        GfMatrix4d matrix;
+        if(hasAnimatedMatrix() && it->query.Get<GfMatrix4d>(&matrix, timeCode))
+        {
+          double T[3], S[3];
+          AL::usdmaya::utils::matrixToSRT(matrix, S, sample.rotation, T);
+          sample.scale = MVector(S[0], S[1], S[2]);
+          sample.translation = MVector(T[0], T[1], T[2]);
+          sample.components |= AnimatedSample::kTranslation | AnimatedSample::kRotation | AnimatedSample::kScale;
         }
       }
+      break;
+
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::updateToSample(const UsdTimeCode& time, const AnimatedSample& sample)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::updateToSample %f\n", time.GetValue());
+  if(!m_prim || m_time == time)
+  {
+    return;
+  }
+
+  // the values queued for the previous time would otherwise be replaced by the values read at the new time
+  if(pushToPrimPending())
+  {
+    m_flags &= ~kPushToPrimPending;
+    if(pushToPrimAvailable())
+    {
+      SdfChangeBlock changeBlock;
+      internal_pushToPrim();
     }
   }
+  m_time = time;
+
+  if(sample.components & AnimatedSample::kTranslation)
+  {
+    m_translationFromUsd = sample.translation;
+    MPxTransformationMatrix::translationValue = m_translationFromUsd + m_translationTweak;
+  }
+  if(sample.components & AnimatedSample::kRotation)
+  {
+    m_rotationFromUsd = sample.rotation;
+    MPxTransformationMatrix::rotationValue = m_rotationFromUsd;
+    MPxTransformationMatrix::rotationValue.x += m_rotationTweak.x;
+    MPxTransformationMatrix::rotationValue.y += m_rotationTweak.y;
+    MPxTransformationMatrix::rotationValue.z += m_rotationTweak.z;
+  }
+  if(sample.components & AnimatedSample::kScale)
+  {
+    m_scaleFromUsd = sample.scale;
+    MPxTransformationMatrix::scaleValue = m_scaleFromUsd + m_scaleTweak;
+  }
+  if(sample.components & AnimatedSample::kShear)
+  {
+    m_shearFromUsd = sample.shear;
+    MPxTransformationMatrix::shearValue = m_shearFromUsd + m_shearTweak;
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -1766,6 +2029,69 @@ void TransformationMatrix::pushToPrim()
   // if not yet intiaialised, do not execute this code! (It will crash!).
   if(!m_prim)
     return;
+
+  // pushes made whilst the graph is evaluated in parallel are written immediately, since the queue is not thread safe
+  PushQueue& queue = pushQueue();
+  if(queue.shouldQueue())
+  {
+    TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::pushToPrim deferred\n");
+    if(!pushToPrimPending())
+    {
+      m_flags |= kPushToPrimPending;
+      queue.add(this);
+    }
+    return;
+  }
+
+  internal_pushToPrim();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+TransformationMatrix::PushQueue& TransformationMatrix::pushQueue()
+{
+  if(!m_pushQueue)
+  {
+    m_pushQueue.reset(new PushQueue);
+  }
+  return *m_pushQueue;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::freePushQueue()
+{
+  m_pushQueue.reset();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::beginPushBatch()
+{
+  pushQueue().beginBatch();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::endPushBatch()
+{
+  pushQueue().endBatch();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t TransformationMatrix::numPendingPushes()
+{
+  return m_pushQueue ? m_pushQueue->size() : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::flushPendingPushes()
+{
+  if(m_pushQueue)
+  {
+    m_pushQueue->flush();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformationMatrix::internal_pushToPrim()
+{
   TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("TransformationMatrix::pushToPrim\n");
 
   auto opIt = m_orderedOps.begin();
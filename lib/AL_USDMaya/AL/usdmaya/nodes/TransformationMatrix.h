@@ -18,14 +18,18 @@
 #include "../Api.h"
 
 #include "AL/usdmaya/TransformOperation.h"
+#include "AL/usdmaya/utils/AttributeType.h"
 
 #include "maya/MPxTransformationMatrix.h"
 #include "maya/MPxTransform.h"
 
 #include "pxr/pxr.h"
+#include "pxr/usd/usd/attributeQuery.h"
 #include "pxr/usd/usdGeom/xform.h"
 #include "pxr/usd/usdGeom/xformCommonAPI.h"
 
+#include <memory>
+
 PXR_NAMESPACE_USING_DIRECTIVE
 
 namespace AL {
@@ -41,11 +45,40 @@ namespace nodes {
 class TransformationMatrix
   : public MPxTransformationMatrix
 {
+public:
+  /// \brief  the cached value resolution for one of the xform ops of the prim
+  struct XformOpQuery
+  {
+    UsdAttributeQuery query;                ///< the query on the attribute of the op
+    UsdGeomXformOp::Type opType;            ///< the type of the op
+    usdmaya::utils::UsdDataType dataType;   ///< the data type of the attribute
+    bool timeVarying;                       ///< false if the value of the op is the same at all times
+  };
+
+  /// \brief  the values of the animated xform ops of the prim at a given time, as read by readAnimatedSample
+  struct AnimatedSample
+  {
+    enum Components
+    {
+      kTranslation = 1 << 0,
+      kRotation = 1 << 1,
+      kScale = 1 << 2,
+      kShear = 1 << 3
+    };
+    MVector translation;
+    MEulerRotation rotation;
+    MVector scale;
+    MVector shear;
+    uint32_t components = 0;  ///< which of the values above were read from the prim
+  };
+
+private:
   UsdPrim m_prim;
   UsdGeomXform m_xform;
   UsdTimeCode m_time;
   std::vector<UsdGeomXformOp> m_xformops;
   std::vector<TransformOperation> m_orderedOps;
+  std::vector<XformOpQuery> m_xformOpQueries;   ///< a query for each of the m_xformops, built on demand
   MObject m_transformNode;
 
   // tweak values. These are applied on top of the USD transform values to produce the final result.
@@ -110,6 +143,7 @@ class TransformationMatrix
     kPrimHasPivot = 1 << 25,
     kPrimHasTransform = 1 << 26,
 
+    kPushToPrimPending = 1 << 27,
     kPushToPrimEnabled = 1 << 28,
     kInheritsTransform = 1 << 29,
 
@@ -125,6 +159,8 @@ class TransformationMatrix
   };
   uint32_t m_flags = 0;
 
+  void buildXformOpQueries();
+
   bool internal_readVector(MVector& result, const UsdGeomXformOp& op) { return readVector(result, op, getTimeCode()); }
   bool internal_readShear(MVector& result, const UsdGeomXformOp& op) { return readShear(result, op, getTimeCode()); }
   bool internal_readPoint(MPoint& result, const UsdGeomXformOp& op) { return readPoint(result, op, getTimeCode()); }
@@ -139,6 +175,9 @@ class TransformationMatrix
   bool internal_pushShear(const MVector& result, UsdGeomXformOp& op) { return pushShear(result, op, getTimeCode()); }
   bool internal_pushMatrix(const MMatrix& result, UsdGeomXformOp& op) { return pushMatrix(result, op, getTimeCode()); }
 
+  // writes the current values of the matrix onto the prim immediately
+  void internal_pushToPrim();
+
 public:
 
   /// \brief  sets the MObject for the transform
@@ -278,6 +317,9 @@ public:
   /// \param  prim the USD prim that this matrix should represent
   TransformationMatrix(const UsdPrim& prim);
 
+  /// \brief  dtor
+  ~TransformationMatrix();
+
   /// \brief  set the prim that this transformation matrix will read/write to.
   /// \param  prim the prim
   void setPrim(const UsdPrim& prim);
@@ -298,7 +340,7 @@ public:
   ///         If readFromTimeline is false, then the timecode will be the magic 'modify default values' timecode,
   ///         and animation data will not be affected (only the default values found in the USD prim)
   /// \return the timecode to use when pushing transform values to the USD prim
-  inline UsdTimeCode getTimeCode()
+  inline UsdTimeCode getTimeCode() const
     { return readAnimatedValues() ? m_time : UsdTimeCode::Default(); }
 
   /// \brief  Applies a local space translation offset to the computed matrix. Useful for positioning objects on a
@@ -417,9 +459,82 @@ public:
   /// \param  time the new timecode
   void updateToTime(const UsdTimeCode& time);
 
-  /// \brief  pushes any modifications on the matrix back onto the UsdPrim
+  /// \brief  reads the values of the animated xform ops at the given time, without modifying this matrix, so that the
+  ///         values can be read ahead of time (and in parallel with other matrices) and applied by updateToSample.
+  /// \param  time the timecode to read the values at
+  /// \param  sample receives the values read
+  /// \return false if there are no animated values to read, or the xform op queries need to be rebuilt first
+  bool readAnimatedSample(const UsdTimeCode& time, AnimatedSample& sample) const;
+
+  /// \brief  the same as updateToTime, except the animated values are taken from a sample read by readAnimatedSample
+  ///         at the same time, rather than being read from the prim. Only the Transform node should need to call this
+  /// \param  time the new timecode
+  /// \param  sample the values of the animated xform ops at that time
+  void updateToSample(const UsdTimeCode& time, const AnimatedSample& sample);
+
+  /// \brief  discards the cached queries on the xform ops, so that they are rebuilt the next time the ops are read. This
+  ///         should be called whenever the prim has been changed on the stage, since a query will not pick up opinions
+  ///         (or time samples) authored after it was built.
+  inline void invalidateXformOpQueries()
+    { m_xformOpQueries.clear(); }
+
+  /// \brief  re-reads which of the xform ops of the prim are animated (e.g. once time samples have been authored on a
+  ///         prim that previously had none). Unlike setPrim, the tweaks and the values read from the prim are kept.
+  void updateAnimationFlags();
+
+  /// \brief  pushes any modifications on the matrix back onto the UsdPrim. If pushes are currently being batched, the
+  ///         matrix is queued instead, and the values are written when the batch is flushed.
   void pushToPrim();
 
+  /// \brief  returns true if this matrix is queued to push its values onto the UsdPrim when the batch is flushed
+  inline bool pushToPrimPending() const
+    { return (kPushToPrimPending & m_flags) != 0; }
+
+  //--------------------------------------------------------------------------------------------------------------------
+  /// \name  Batched pushes
+  /// \brief  Each write to the prim raises its own change notice, which is costly when many transforms are modified at
+  ///         once (e.g. when dragging a manipulator over many objects). Whilst a batch is open, pushToPrim only queues
+  ///         the matrix, and the queued matrices are written within a single SdfChangeBlock when the batch is closed.
+  ///         In interactive sessions, pushes made outside of a batch are also queued (unless the optionVar
+  ///         AL_usdmaya_deferPushToPrim is set to 0), and are flushed the next time maya is idle, or before the scene is
+  ///         saved or exported. Only pushes made from the main thread are queued, pushes made during parallel
+  ///         evaluation are always written immediately.
+  //--------------------------------------------------------------------------------------------------------------------
+
+  /// \brief  opens a batch of pushes for the lifetime of this object
+  struct ScopedPushBatch
+  {
+    ScopedPushBatch()
+      { beginPushBatch(); }
+    ~ScopedPushBatch()
+      { endPushBatch(); }
+  };
+
+  /// \brief  opens a batch of pushes. Batches can be nested, and the pushes are flushed when the outermost closes.
+  AL_USDMAYA_PUBLIC
+  static void beginPushBatch();
+
+  /// \brief  closes a batch of pushes, flushing the queued pushes if this was the outermost batch
+  AL_USDMAYA_PUBLIC
+  static void endPushBatch();
+
+  /// \brief  writes the values of all of the queued matrices onto their prims, within a single SdfChangeBlock
+  AL_USDMAYA_PUBLIC
+  static void flushPendingPushes();
+
+  /// \brief  returns the number of matrices waiting to push their values onto their prims
+  AL_USDMAYA_PUBLIC
+  static size_t numPendingPushes();
+
+  /// \brief  flushes and destroys the queue of pushes, when the plugin is unloaded
+  AL_USDMAYA_PUBLIC
+  static void freePushQueue();
+
+private:
+  class PushQueue;
+  static PushQueue& pushQueue();
+  static std::unique_ptr<PushQueue> m_pushQueue;
+
 private:
   //  Translation methods:
   MStatus translateTo(const MVector &vector, MSpace::Space = MSpace::kTransform) override;
@@ -0,0 +1,82 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "AL/usdmaya/nodes/proxy/AnimatedSamples.h"
+#include "AL/usdmaya/DebugCodes.h"
+
+#include "pxr/base/work/loops.h"
+
+#include <algorithm>
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+//----------------------------------------------------------------------------------------------------------------------
+void AnimatedSamples::reset(const std::vector<const TransformationMatrix*>& matrices)
+{
+  m_matrices = matrices;
+  m_samples.assign(m_matrices.size(), Sample());
+  m_hasSample.assign(m_matrices.size(), 0);
+  m_indices.clear();
+  for(size_t i = 0, n = m_matrices.size(); i < n; ++i)
+  {
+    m_indices.emplace(m_matrices[i], i);
+  }
+  m_time = UsdTimeCode::Default();
+  m_valid = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t AnimatedSamples::update(const UsdTimeCode& time)
+{
+  if(m_time == time)
+  {
+    return 0;
+  }
+  m_time = time;
+
+  // only the samples are written here, the matrices are left untouched until their transforms are computed
+  WorkParallelForN(m_matrices.size(), [this, time](size_t begin, size_t end)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      m_hasSample[i] = m_matrices[i]->readAnimatedSample(time, m_samples[i]);
+    }
+  });
+
+  const size_t count = std::count(m_hasSample.begin(), m_hasSample.end(), 1);
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("AnimatedSamples::update read %zu of %zu transforms\n", count, m_matrices.size());
+  return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const AnimatedSamples::Sample* AnimatedSamples::find(const TransformationMatrix* matrix, const UsdTimeCode& time) const
+{
+  if(m_time != time)
+  {
+    return nullptr;
+  }
+  auto it = m_indices.find(matrix);
+  return it != m_indices.end() && m_hasSample[it->second] ? &m_samples[it->second] : nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#pragma once
+
+#include "../../Api.h"
+#include "AL/usdmaya/nodes/TransformationMatrix.h"
+
+#include <unordered_map>
+#include <vector>
+#include "pxr/usd/usd/timeCode.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  The values of the animated xform ops of the transforms driven by a proxy shape, read (in parallel) when the
+///         output time of the proxy changes. Each AL_usdmaya_Transform looks up its own sample when it is computed,
+///         rather than reading its xform ops from the prim in turn.
+///
+///         The samples are only written whilst the outTime of the proxy is computed, and only read by the transforms
+///         connected to it, which are computed afterwards. The set of transforms that are sampled is rebuilt by the
+///         proxy shape whenever it has been invalidated.
+//----------------------------------------------------------------------------------------------------------------------
+class AnimatedSamples
+{
+public:
+  typedef TransformationMatrix::AnimatedSample Sample;
+
+  /// \brief  sets the matrices to read samples for, and marks the set as valid
+  /// \param  matrices the matrices of the transforms driven by the proxy shape
+  AL_USDMAYA_PUBLIC
+  void reset(const std::vector<const TransformationMatrix*>& matrices);
+
+  /// \brief  flags the set of matrices as out of date, e.g. once the time of one of the transforms is remapped
+  inline void invalidate()
+    { m_valid = false; }
+
+  /// \brief  returns false if the set of matrices needs to be rebuilt
+  inline bool valid() const
+    { return m_valid; }
+
+  /// \brief  reads the samples of all of the matrices at the given time (unless they have been read already)
+  /// \param  time the output time of the proxy shape
+  /// \return the number of matrices that had animated values to read
+  AL_USDMAYA_PUBLIC
+  size_t update(const UsdTimeCode& time);
+
+  /// \brief  returns the sample of the matrix, if one was read at the given time
+  /// \param  matrix the matrix of the transform
+  /// \param  time the time the transform is being computed at
+  /// \return the sample, or null if there is none at that time (in which case the matrix should read its own values)
+  AL_USDMAYA_PUBLIC
+  const Sample* find(const TransformationMatrix* matrix, const UsdTimeCode& time) const;
+
+private:
+  std::vector<const TransformationMatrix*> m_matrices;
+  std::vector<Sample> m_samples;
+  std::vector<char> m_hasSample;
+  std::unordered_map<const TransformationMatrix*, size_t> m_indices;
+  UsdTimeCode m_time = UsdTimeCode::Default();
+  bool m_valid = false;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,656 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "AL/usdmaya/nodes/proxy/BoundsCache.h"
+#include "AL/usdmaya/DebugCodes.h"
+
+#include "pxr/base/gf/bbox3d.h"
+#include "pxr/base/work/loops.h"
+#include "pxr/usd/sdf/layer.h"
+#include "pxr/usd/usdGeom/boundable.h"
+#include "pxr/usd/usdGeom/modelAPI.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformable.h"
+
+#include <algorithm>
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+namespace {
+
+// the depth beneath the root prim at which the bounds are no longer cached per child, which limits the number of nodes
+const uint32_t kMaxNodeDepth = 8;
+
+//----------------------------------------------------------------------------------------------------------------------
+TfTokenVector includedPurposes(const uint32_t purposes)
+{
+  TfTokenVector included = { UsdGeomTokens->default_, UsdGeomTokens->proxy };
+  if(purposes & BoundsCache::kGuidePurpose)
+  {
+    included.push_back(UsdGeomTokens->guide);
+  }
+  if(purposes & BoundsCache::kRenderPurpose)
+  {
+    included.push_back(UsdGeomTokens->render);
+  }
+  return included;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// primvars and normals are the most commonly animated attributes that have no effect on the extents of a prim
+bool mayAffectExtents(const SdfPath& propertyPath)
+{
+  static const std::string primvarsPrefix("primvars:");
+  const std::string& name = propertyPath.GetName();
+  return name.compare(0, primvarsPrefix.size(), primvarsPrefix) != 0 && name != UsdGeomTokens->normals.GetString();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// transforms the untransformed bounds of a prim into the space of its parent
+GfRange3d transformToParent(const UsdPrim& prim, const GfRange3d& bounds, const UsdTimeCode time)
+{
+  UsdGeomXformable xformable(prim);
+  GfMatrix4d localTransform;
+  bool resetsXformStack;
+  if(!bounds.IsEmpty() && xformable && xformable.GetLocalTransformation(&localTransform, &resetsXformStack, time))
+  {
+    return GfBBox3d(bounds, localTransform).ComputeAlignedRange();
+  }
+  return bounds;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// The layers of any value clips are not used by the stage until their values are first read, so they cannot be
+// scanned for time samples. Instead the prims that source their values from clips are assumed to be time varying.
+bool hasValueClips(const SdfLayerHandle& layer, const SdfPath& primPath)
+{
+  static const TfToken clips("clips");
+  static const TfToken clipAssetPaths("clipAssetPaths");
+  return layer->HasField(primPath, clips) || layer->HasField(primPath, clipAssetPaths);
+}
+
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+bool BoundsCache::hasTimeVaryingExtents(const UsdStageRefPtr& stage)
+{
+  for(const SdfLayerHandle& layer : stage->GetUsedLayers())
+  {
+    if(!layer)
+    {
+      continue;
+    }
+
+    // most layers will either have no time samples at all (so only the prims need to be checked for value clips), or
+    // will have time samples on the transforms or points
+    const bool hasTimeSamples = !layer->ListAllTimeSamples().empty();
+    bool timeVarying = false;
+    layer->Traverse(SdfPath::AbsoluteRootPath(), [&layer, hasTimeSamples, &timeVarying](const SdfPath& path)
+    {
+      if(timeVarying)
+      {
+        return;
+      }
+      if(path.IsPrimOrPrimVariantSelectionPath())
+      {
+        timeVarying = hasValueClips(layer, path);
+      }
+      else
+      if(hasTimeSamples && path.IsPropertyPath() && layer->GetNumTimeSamplesForPath(path) && mayAffectExtents(path))
+      {
+        timeVarying = true;
+      }
+    });
+    if(timeVarying)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+GfRange3d BoundsCache::bounds(const UsdPrim& prim, UsdTimeCode time, uint32_t purposes)
+{
+  if(prim != m_prim)
+  {
+    clear();
+    m_prim = prim;
+  }
+  if(!prim)
+  {
+    return GfRange3d();
+  }
+
+  if(m_stageState == kUnknown)
+  {
+    m_stageState = hasTimeVaryingExtents(prim.GetStage()) ? kAnimated : kStatic;
+    TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("BoundsCache::bounds stage is %s\n", m_stageState == kStatic ? "static" : "animated");
+  }
+
+  // the bounds of a static stage are the same at all times
+  if(m_stageState == kStatic)
+  {
+    time = UsdTimeCode::Default();
+  }
+
+  purposes &= kAllPurposes;
+  const Key key(purposes, time);
+  auto it = m_entries.find(key);
+  if(it != m_entries.end())
+  {
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->bounds;
+  }
+
+  std::unique_ptr<UsdGeomBBoxCache>& bboxCache = m_bboxCaches[purposes];
+  if(!bboxCache)
+  {
+    bboxCache.reset(new UsdGeomBBoxCache(time, includedPurposes(purposes), m_useExtentsHint));
+  }
+  else
+  {
+    // only the bounds of the time varying prims are discarded when the time changes
+    bboxCache->SetTime(time);
+  }
+
+  // the bounds cached for the children of the nodes are only valid for a single time
+  if(m_nodeTime != time)
+  {
+    for(auto& node : m_nodes)
+    {
+      for(Child& child : node.second.children)
+      {
+        child.valid = 0;
+      }
+    }
+    m_nodeTime = time;
+  }
+
+  m_numLeavesComputed = 0;
+  Entry entry = { key, GfRange3d() };
+  if(isSplittable(prim, 0))
+  {
+    Node& root = m_nodes[prim.GetPath()];
+    root.prim = prim;
+    entry.bounds = computeNode(root, purposes, *bboxCache, m_parallel);
+  }
+  else
+  {
+    if(!extentsHintBounds(prim, purposes, entry.bounds))
+    {
+      entry.bounds = bboxCache->ComputeUntransformedBound(prim).ComputeAlignedRange();
+    }
+    ++m_numLeavesComputed;
+  }
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("BoundsCache::bounds computed the bounds of %zu leaves\n", size_t(m_numLeavesComputed));
+
+  m_lru.push_front(entry);
+  m_entries.insert(std::make_pair(key, m_lru.begin()));
+  evict();
+  return entry.bounds;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool BoundsCache::isSplittable(const UsdPrim& prim, const uint32_t depth) const
+{
+  // The gprims (and any prims that are not imageable, or whose transforms are not relative to their parent) are left
+  // to the UsdGeomBBoxCache, as are instances (so that the bounds of their masters are shared). Models with an
+  // extentsHint are leaves, so that their descendants are never visited.
+  if(prim.IsPseudoRoot())
+  {
+    return true;
+  }
+  if(depth >= kMaxNodeDepth || prim.IsInstance() || !prim.IsA<UsdGeomImageable>() || prim.IsA<UsdGeomBoundable>())
+  {
+    return false;
+  }
+  if(m_useExtentsHint && prim.IsModel() && UsdGeomModelAPI(prim).GetExtentsHintAttr().HasAuthoredValueOpinion())
+  {
+    return false;
+  }
+  UsdGeomXformable xformable(prim);
+  return !xformable || !xformable.GetResetXformStack();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool BoundsCache::extentsHintBounds(const UsdPrim& prim, const uint32_t purposes, GfRange3d& bounds) const
+{
+  // As with the UsdGeomBBoxCache, only the hints of models are trusted. The hint on any other prim is not maintained by
+  // the pipeline (and goes stale as soon as one of its descendants is edited within Maya), so it is ignored.
+  VtVec3fArray extents;
+  if(!m_useExtentsHint || !prim.IsModel() || !UsdGeomModelAPI(prim).GetExtentsHint(&extents, m_nodeTime) || extents.size() < 2)
+  {
+    return false;
+  }
+
+  // the hint holds a min/max pair for each of the ordered purposes, although the trailing empty pairs may be omitted
+  const TfTokenVector& orderedPurposes = UsdGeomImageable::GetOrderedPurposeTokens();
+  const TfTokenVector included = includedPurposes(purposes);
+  bounds = GfRange3d();
+  for(size_t i = 0, n = std::min(orderedPurposes.size(), extents.size() / 2); i < n; ++i)
+  {
+    if(std::find(included.begin(), included.end(), orderedPurposes[i]) != included.end())
+    {
+      bounds.UnionWith(GfRange3d(GfVec3d(extents[2 * i]), GfVec3d(extents[2 * i + 1])));
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::eraseNodes(const SdfPath& path, const bool includeRoot)
+{
+  std::lock_guard<std::mutex> lock(m_nodesMutex);
+  auto it = m_nodes.find(path);
+  if(it != m_nodes.end() && !includeRoot)
+  {
+    ++it;
+  }
+  while(it != m_nodes.end() && it->first.HasPrefix(path))
+  {
+    it = m_nodes.erase(it);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::findChildren(Node& node)
+{
+  // any children that already exist keep their bounds (and nodes)
+  std::map<SdfPath, Child> previous;
+  for(const Child& child : node.children)
+  {
+    previous.insert(std::make_pair(child.prim.GetPath(), child));
+  }
+  node.children.clear();
+
+  for(const UsdPrim& prim : node.prim.GetChildren())
+  {
+    const SdfPath path = prim.GetPath();
+    Child child;
+    auto it = previous.find(path);
+    if(it != previous.end())
+    {
+      child = it->second;
+      previous.erase(it);
+    }
+    else
+    {
+      child.node = nullptr;
+      child.valid = 0;
+    }
+    child.prim = prim;
+
+    const bool splittable = isSplittable(prim, node.depth + 1);
+    if(splittable && !child.node)
+    {
+      std::lock_guard<std::mutex> lock(m_nodesMutex);
+      child.node = &m_nodes[path];
+      child.node->prim = prim;
+      child.node->depth = node.depth + 1;
+      child.node->parent = &node;
+      child.valid = 0;
+    }
+    else
+    if(!splittable && child.node)
+    {
+      eraseNodes(path, true);
+      child.node = nullptr;
+      child.valid = 0;
+    }
+    if(child.node)
+    {
+      child.node->indexInParent = uint32_t(node.children.size());
+    }
+    node.children.push_back(child);
+  }
+
+  // discard the nodes of the children that have been removed
+  for(const auto& removed : previous)
+  {
+    if(removed.second.node)
+    {
+      eraseNodes(removed.first, true);
+    }
+  }
+  node.hasChildren = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool BoundsCache::isCulled(const UsdPrim& prim, const uint32_t purposes) const
+{
+  // invisible subtrees, and those with a purpose that is not included, are skipped (as they are by UsdGeomBBoxCache)
+  UsdGeomImageable imageable(prim);
+  if(!imageable)
+  {
+    return false;
+  }
+  TfToken visibility;
+  imageable.GetVisibilityAttr().Get(&visibility, m_nodeTime);
+  if(visibility == UsdGeomTokens->invisible)
+  {
+    return true;
+  }
+  const TfToken purpose = imageable.ComputePurpose();
+  return purpose != UsdGeomTokens->default_ && purpose != UsdGeomTokens->proxy &&
+         !(purpose == UsdGeomTokens->guide && (purposes & kGuidePurpose)) &&
+         !(purpose == UsdGeomTokens->render && (purposes & kRenderPurpose));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::findLeaves(Node& node, const uint32_t purposes, const bool parallel, std::vector<Leaf>& leaves)
+{
+  if(!node.hasChildren)
+  {
+    findChildren(node);
+  }
+  if(isCulled(node.prim, purposes))
+  {
+    return;
+  }
+
+  const uint8_t bit = uint8_t(1 << purposes);
+  std::vector<uint32_t> modifiedNodes;
+  for(uint32_t i = 0, n = uint32_t(node.children.size()); i < n; ++i)
+  {
+    const Child& child = node.children[i];
+    if(!(child.valid & bit))
+    {
+      if(child.node)
+      {
+        modifiedNodes.push_back(i);
+      }
+      else
+      {
+        leaves.push_back(Leaf{ &node, i });
+      }
+    }
+  }
+
+  // recurse into the child nodes that have been modified
+  if(parallel && modifiedNodes.size() > 1)
+  {
+    std::mutex leavesMutex;
+    WorkParallelForN(modifiedNodes.size(), [this, &node, &modifiedNodes, &leaves, &leavesMutex, purposes](size_t begin, size_t end)
+    {
+      std::vector<Leaf> taskLeaves;
+      for(size_t i = begin; i < end; ++i)
+      {
+        findLeaves(*node.children[modifiedNodes[i]].node, purposes, false, taskLeaves);
+      }
+      std::lock_guard<std::mutex> lock(leavesMutex);
+      leaves.insert(leaves.end(), taskLeaves.begin(), taskLeaves.end());
+    });
+  }
+  else
+  {
+    for(const uint32_t i : modifiedNodes)
+    {
+      findLeaves(*node.children[i].node, purposes, parallel, leaves);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+GfRange3d BoundsCache::combineNode(Node& node, const uint32_t purposes)
+{
+  if(isCulled(node.prim, purposes))
+  {
+    return GfRange3d();
+  }
+
+  const uint8_t bit = uint8_t(1 << purposes);
+  GfRange3d bounds;
+  for(Child& child : node.children)
+  {
+    if(!(child.valid & bit))
+    {
+      child.bounds[purposes] = transformToParent(child.prim, combineNode(*child.node, purposes), m_nodeTime);
+      child.valid |= bit;
+    }
+    bounds.UnionWith(child.bounds[purposes]);
+  }
+  return bounds;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+GfRange3d BoundsCache::computeNode(Node& node, const uint32_t purposes, UsdGeomBBoxCache& bboxCache, const bool parallel)
+{
+  // The modified nodes are traversed first (in parallel if enabled) to find the leaves that need to be computed. The
+  // UsdGeomBBoxCache cannot be queried from more than one thread at a time, but it computes each query in parallel
+  // itself, so the leaves are all computed with the same cache (which means that the bounds of the masters of any
+  // instances are shared between them). Finally the bounds are combined from the leaves up to the node.
+  std::vector<Leaf> leaves;
+  findLeaves(node, purposes, parallel, leaves);
+
+  const uint8_t bit = uint8_t(1 << purposes);
+  for(const Leaf& leaf : leaves)
+  {
+    Child& child = leaf.node->children[leaf.index];
+    GfRange3d hint;
+    if(extentsHintBounds(child.prim, purposes, hint))
+    {
+      child.bounds[purposes] = transformToParent(child.prim, hint, m_nodeTime);
+    }
+    else
+    {
+      child.bounds[purposes] = bboxCache.ComputeRelativeBound(child.prim, leaf.node->prim).ComputeAlignedRange();
+    }
+    child.valid |= bit;
+  }
+  m_numLeavesComputed += leaves.size();
+
+  return combineNode(node, purposes);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::clearEntries()
+{
+  // the bounds at all of the time codes are affected. The UsdGeomBBoxCache has no way to discard the bounds of a single
+  // prim, so it has to start again (although it will only be queried for the modified children).
+  m_lru.clear();
+  m_entries.clear();
+  for(auto& bboxCache : m_bboxCaches)
+  {
+    if(bboxCache)
+    {
+      bboxCache->Clear();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::invalidate(const SdfPath& path, const bool resynced)
+{
+  clearEntries();
+  invalidateNodes(path, resynced);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::invalidate(const SdfPathVector& resyncedPaths, const SdfPathVector& changedPaths)
+{
+  if(resyncedPaths.empty() && changedPaths.empty())
+  {
+    return;
+  }
+  clearEntries();
+  for(const SdfPath& path : resyncedPaths)
+  {
+    invalidateNodes(path, true);
+  }
+  for(const SdfPath& path : changedPaths)
+  {
+    invalidateNodes(path, false);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::invalidateNodes(const SdfPath& path, const bool resynced)
+{
+  if(!m_prim || m_nodes.empty())
+  {
+    return;
+  }
+
+  // a change to an ancestor of the root (or to the master of an instance) could affect any of the bounds
+  const SdfPath primPath = path.GetPrimPath();
+  const SdfPath& rootPath = m_prim.GetPath();
+  const UsdPrim prim = m_prim.GetStage()->GetPrimAtPath(primPath);
+  if((prim && prim.IsInMaster()) || (primPath != rootPath && rootPath.HasPrefix(primPath)))
+  {
+    clearNodes();
+    return;
+  }
+  if(!primPath.HasPrefix(rootPath))
+  {
+    return;
+  }
+
+  // find the node that contains the prim
+  SdfPath nodePath = primPath;
+  auto it = m_nodes.find(nodePath);
+  while(it == m_nodes.end() && nodePath != rootPath)
+  {
+    nodePath = nodePath.GetParentPath();
+    it = m_nodes.find(nodePath);
+  }
+  if(it == m_nodes.end())
+  {
+    return;
+  }
+  Node& node = it->second;
+
+  // authoring (or removing) a hint, or changing the kind of a prim (so that it is, or is no longer, a model),
+  // determines whether a prim is a node
+  const bool hintChanged = path.IsPropertyPath() ? path.GetNameToken() == UsdGeomTokens->extentsHint : !resynced;
+  if(primPath == nodePath)
+  {
+    if(resynced)
+    {
+      // everything beneath the node may have changed, and the prim itself may have been removed (or changed type)
+      eraseNodes(nodePath, false);
+      node.children.clear();
+      node.hasChildren = false;
+      if(node.parent)
+      {
+        node.parent->hasChildren = false;
+      }
+    }
+    else
+    if(!path.IsPropertyPath() || path.GetNameToken() == UsdGeomTokens->purpose)
+    {
+      // the purpose is inherited by all of the prims beneath the node
+      for(auto sub = it; sub != m_nodes.end() && sub->first.HasPrefix(nodePath); ++sub)
+      {
+        for(Child& child : sub->second.children)
+        {
+          child.valid = 0;
+        }
+      }
+    }
+    if(hintChanged && node.parent)
+    {
+      node.parent->hasChildren = false;
+    }
+    // otherwise only the transform or visibility of the node have changed, which only affect its ancestors
+  }
+  else
+  {
+    // only the child that contains the prim needs to be recomputed (and the children found again if it has been added
+    // or removed)
+    SdfPath childPath = primPath;
+    while(childPath.GetParentPath() != nodePath)
+    {
+      childPath = childPath.GetParentPath();
+    }
+    for(Child& child : node.children)
+    {
+      if(child.prim.GetPath() == childPath)
+      {
+        child.valid = 0;
+        break;
+      }
+    }
+    if((resynced || hintChanged) && childPath == primPath)
+    {
+      node.hasChildren = false;
+    }
+  }
+
+  for(Node* n = &node; n->parent; n = n->parent)
+  {
+    n->parent->children[n->indexInParent].valid = 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::clearNodes()
+{
+  m_nodes.clear();
+  m_nodeTime = UsdTimeCode::Default();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::clear()
+{
+  m_lru.clear();
+  m_entries.clear();
+  for(auto& bboxCache : m_bboxCaches)
+  {
+    bboxCache.reset();
+  }
+  clearNodes();
+  m_prim = UsdPrim();
+  m_stageState = kUnknown;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::setUseExtentsHint(const bool useExtentsHint)
+{
+  if(useExtentsHint != m_useExtentsHint)
+  {
+    const UsdPrim prim = m_prim;
+    clear();
+    m_prim = prim;
+    m_useExtentsHint = useExtentsHint;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::setMaxEntries(const size_t maxEntries)
+{
+  m_maxEntries = maxEntries;
+  evict();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void BoundsCache::evict()
+{
+  while(m_entries.size() > m_maxEntries && !m_lru.empty())
+  {
+    m_entries.erase(m_lru.back().key);
+    m_lru.pop_back();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
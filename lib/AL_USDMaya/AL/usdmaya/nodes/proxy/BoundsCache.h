@@ -0,0 +1,245 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#pragma once
+
+#include "../../Api.h"
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "pxr/base/gf/range3d.h"
+#include "pxr/usd/usd/prim.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usd/timeCode.h"
+#include "pxr/usd/usdGeom/bboxCache.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  Caches the untransformed bounds of a prim (typically the root prim of a proxy shape) over time.
+///
+///         The bounds are computed with a UsdGeomBBoxCache that persists for each set of purposes, so that the bounds
+///         of any prims that are not time varying are only computed once, no matter how many frames are visited.
+///         If none of the layers used by the stage contain time samples that can affect the extents of the prims, the
+///         stage is treated as static, and a single entry is cached for all time codes. Otherwise an entry is stored
+///         for each time code visited, up to a maximum number of entries, after which the least recently used entries
+///         are discarded.
+///
+///         Beneath the prim, the bounds of each transform (or scope) are cached separately for each of its children,
+///         in the space of the transform. When a prim is modified, invalidate only needs to discard the bounds along
+///         the path from the prim up to the root, so only the modified subtree (and the transforms above it) are
+///         recomputed. The bounds of the gprims, instances, and any other prims that are not split up in this way,
+///         are computed with the UsdGeomBBoxCache.
+///
+///         If enabled, the extentsHint authored on a model (e.g. by the exporter) is used in place of the bounds of its
+///         descendants, so that the bounds of a large asset can be found without traversing any of its geometry.
+///
+///         The methods of the cache are not thread safe (even bounds, which fills in the cache), so the owner must
+///         make sure that they are not called concurrently.
+//----------------------------------------------------------------------------------------------------------------------
+class BoundsCache
+{
+public:
+
+  /// \brief  the optional purposes (in addition to default and proxy) of the prims included in the bounds
+  enum Purposes
+  {
+    kGuidePurpose = 1 << 0,
+    kRenderPurpose = 1 << 1,
+    kAllPurposes = kGuidePurpose | kRenderPurpose
+  };
+
+  /// the default maximum number of entries (each of which costs roughly 100 bytes)
+  static const size_t kDefaultMaxEntries = 4096;
+
+  /// \brief  ctor
+  /// \param  maxEntries the maximum number of bounds to cache
+  BoundsCache(size_t maxEntries = kDefaultMaxEntries)
+    : m_maxEntries(maxEntries), m_numLeavesComputed(0) {}
+
+  /// \brief  returns the untransformed bounds of a prim, computing them if they have not been cached
+  /// \param  prim the prim to compute the bounds of. If this differs from the prim the cached bounds were computed
+  ///         for, the cache is cleared.
+  /// \param  time the time at which to compute the bounds
+  /// \param  purposes a combination of the Purposes flags
+  /// \return the bounds of the prim, which may be empty
+  AL_USDMAYA_PUBLIC
+  GfRange3d bounds(const UsdPrim& prim, UsdTimeCode time, uint32_t purposes);
+
+  /// \brief  discards all of the cached bounds, and the static stage detection
+  AL_USDMAYA_PUBLIC
+  void clear();
+
+  /// \brief  discards the cached bounds of a prim (or the prim of a property), and those of its ancestors
+  /// \param  path the path of the prim or property that has been modified
+  /// \param  resynced true if the prim has been resynced (so the children of the prim may have changed)
+  AL_USDMAYA_PUBLIC
+  void invalidate(const SdfPath& path, bool resynced);
+
+  /// \brief  discards the cached bounds of a batch of modified prims (or properties), and those of their ancestors.
+  ///         This is cheaper than invalidating each path in turn, since the bounds cached for each time code, and the
+  ///         UsdGeomBBoxCache, are only discarded once.
+  /// \param  resyncedPaths the paths that have been resynced
+  /// \param  changedPaths the paths whose values (or metadata) have changed
+  AL_USDMAYA_PUBLIC
+  void invalidate(const SdfPathVector& resyncedPaths, const SdfPathVector& changedPaths);
+
+  /// \brief  flags that time samples may have been added to the stage, so that a static stage is checked again
+  inline void invalidateTimeVarying()
+    { if(m_stageState == kStatic) m_stageState = kUnknown; }
+
+  /// \brief  if enabled, the modified subtrees of a transform are traversed in parallel (the leaves are then computed
+  ///         with a single UsdGeomBBoxCache, which parallelises each query itself)
+  /// \param  parallel true to traverse the modified subtrees in parallel
+  inline void setParallel(const bool parallel)
+    { m_parallel = parallel; }
+
+  /// \brief  returns true if the modified subtrees of a transform are traversed in parallel
+  inline bool parallel() const
+    { return m_parallel; }
+
+  /// \brief  enables (or disables) the use of the extentsHint of the prims, discarding any cached bounds
+  /// \param  useExtentsHint true to use the extentsHint authored on a model rather than the bounds of its descendants
+  AL_USDMAYA_PUBLIC
+  void setUseExtentsHint(bool useExtentsHint);
+
+  /// \brief  returns true if the extentsHint authored on a model is used rather than the bounds of its descendants
+  inline bool useExtentsHint() const
+    { return m_useExtentsHint; }
+
+  /// \brief  returns the number of transforms whose bounds are cached per child
+  inline size_t numNodes() const
+    { return m_nodes.size(); }
+
+  /// \brief  returns the number of bounds computed with the UsdGeomBBoxCache by the last call to bounds (which is
+  ///         intended for profiling)
+  inline size_t numLeavesComputed() const
+    { return m_numLeavesComputed; }
+
+  /// \brief  sets the maximum number of bounds that are cached, discarding the least recently used entries if needed
+  /// \param  maxEntries the maximum number of entries
+  AL_USDMAYA_PUBLIC
+  void setMaxEntries(size_t maxEntries);
+
+  /// \brief  returns the maximum number of bounds that are cached
+  inline size_t maxEntries() const
+    { return m_maxEntries; }
+
+  /// \brief  returns the number of bounds currently cached
+  inline size_t size() const
+    { return m_entries.size(); }
+
+  /// \brief  returns true if the stage has been found to have no time varying extents (this is only known once bounds
+  ///         have been computed)
+  inline bool isStatic() const
+    { return m_stageState == kStatic; }
+
+  /// \brief  returns true if any of the layers used by the stage contain time samples that may affect the extents of
+  ///         the prims (i.e. any time samples other than those authored on primvars), or any prims that source their
+  ///         values from value clips
+  /// \param  stage the stage to test
+  /// \return true if the stage may have time varying extents
+  AL_USDMAYA_PUBLIC
+  static bool hasTimeVaryingExtents(const UsdStageRefPtr& stage);
+
+private:
+  typedef std::pair<uint32_t, UsdTimeCode> Key;
+  struct Entry
+  {
+    Key key;
+    GfRange3d bounds;
+  };
+  typedef std::list<Entry> EntryList;
+
+  enum StageState
+  {
+    kUnknown,
+    kStatic,
+    kAnimated
+  };
+
+  struct Node;
+
+  /// a child of a node, along with its bounds in the space of the node
+  struct Child
+  {
+    UsdPrim prim;
+    Node* node;                             ///< the node of the child, or null if the UsdGeomBBoxCache is used
+    GfRange3d bounds[kAllPurposes + 1];     ///< the bounds of the child for each set of purposes
+    uint8_t valid;                          ///< a bit for each set of purposes, set if the bounds are up to date
+  };
+
+  /// a transform (or scope) whose bounds are cached for each of its children
+  struct Node
+  {
+    UsdPrim prim;
+    Node* parent = nullptr;
+    uint32_t indexInParent = 0;
+    uint32_t depth = 0;
+    std::vector<Child> children;
+    bool hasChildren = false;               ///< false until the children have been found
+  };
+
+  /// a child of a node whose bounds are computed with the UsdGeomBBoxCache
+  struct Leaf
+  {
+    Node* node;
+    uint32_t index;
+  };
+
+  void evict();
+  void clearEntries();
+  void clearNodes();
+  void eraseNodes(const SdfPath& path, bool includeRoot);
+  void invalidateNodes(const SdfPath& path, bool resynced);
+  bool isSplittable(const UsdPrim& prim, uint32_t depth) const;
+  bool isCulled(const UsdPrim& prim, uint32_t purposes) const;
+  bool extentsHintBounds(const UsdPrim& prim, uint32_t purposes, GfRange3d& bounds) const;
+  void findChildren(Node& node);
+  void findLeaves(Node& node, uint32_t purposes, bool parallel, std::vector<Leaf>& leaves);
+  GfRange3d combineNode(Node& node, uint32_t purposes);
+  GfRange3d computeNode(Node& node, uint32_t purposes, UsdGeomBBoxCache& bboxCache, bool parallel);
+
+private:
+  EntryList m_lru;                                        ///< the cached bounds, most recently used first
+  std::map<Key, EntryList::iterator> m_entries;           ///< the cached bounds, sorted by purposes and time code
+  std::unique_ptr<UsdGeomBBoxCache> m_bboxCaches[kAllPurposes + 1];
+  std::map<SdfPath, Node> m_nodes;                        ///< the nodes, sorted so that each subtree is contiguous
+  std::mutex m_nodesMutex;
+  UsdPrim m_prim;
+  UsdTimeCode m_nodeTime = UsdTimeCode::Default();        ///< the time the bounds of the nodes were computed at
+  size_t m_maxEntries;
+  std::atomic<size_t> m_numLeavesComputed;
+  StageState m_stageState = kUnknown;
+  bool m_parallel = false;
+  bool m_useExtentsHint = true;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
@@ -3,129 +3,475 @@
 #include "AL/usdmaya/nodes/proxy/DrivenTransforms.h"
 #include "AL/usdmaya/DebugCodes.h"
 
+#include "pxr/base/work/loops.h"
+#include "pxr/usd/sdf/attributeSpec.h"
+#include "pxr/usd/sdf/changeBlock.h"
+#include "pxr/usd/sdf/layer.h"
+#include "pxr/usd/sdf/primSpec.h"
+
+#include <algorithm>
+
 namespace AL {
 namespace usdmaya {
 namespace nodes {
 namespace proxy {
 
+namespace {
+
+// an attribute spec that needs to be created in the edit target layer before its samples can be written
+struct NewSpec
+{
+  SdfPath* specPath;
+  SdfValueTypeName typeName;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// maps the attribute into the edit target, and records whether its spec needs to be created. Only the Usd API is used
+// here, so that the stage is not queried after any of the specs have been modified.
+bool resolveSpec(const UsdEditTarget& editTarget, const UsdAttribute& attr, SdfPath& specPath, std::vector<NewSpec>& newSpecs)
+{
+  if(specPath.IsEmpty())
+  {
+    specPath = editTarget.MapToSpecPath(attr.GetPath());
+    if(specPath.IsEmpty())
+    {
+      return false;
+    }
+    if(!editTarget.GetLayer()->GetAttributeAtPath(specPath))
+    {
+      NewSpec spec = { &specPath, attr.GetTypeName() };
+      newSpecs.push_back(spec);
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// resizes a bitset to hold newCount bits, setting any new bits to the specified value, and clearing the unused bits in
+// the last word (so that they are not set if the bitset grows again)
+void resizeBits(std::vector<uint64_t>& bits, const size_t oldCount, const size_t newCount, const bool value)
+{
+  bits.resize((newCount + 63) >> 6, 0);
+  if(value)
+  {
+    for(size_t i = oldCount; i < newCount; ++i)
+    {
+      bits[i >> 6] |= (uint64_t(1) << (i & 63));
+    }
+  }
+  if(newCount & 63)
+  {
+    bits.back() &= (uint64_t(1) << (newCount & 63)) - 1;
+  }
+}
+
+} // anon
+
 //----------------------------------------------------------------------------------------------------------------------
 void DrivenTransforms::resizeDrivenTransforms(const size_t primPathCount)
 {
+  const size_t oldCount = storageCount();
   m_drivenPrimPaths.resize(primPathCount);
-  m_drivenMatrix.resize(primPathCount, MMatrix::identity);
-  m_drivenVisibility.resize(primPathCount, true);
+  m_drivenMatrices.resize(primPathCount * 16);
+  for(size_t i = oldCount; i < primPathCount; ++i)
+  {
+    std::memcpy(m_drivenMatrices.data() + i * 16, MMatrix::identity.matrix, sizeof(double) * 16);
+  }
+  resizeBits(m_drivenVisibilityBits, oldCount, primPathCount, true);
+  resizeBits(m_dirtyMatrixBits, oldCount, primPathCount, false);
+  resizeBits(m_dirtyVisibilityBits, oldCount, primPathCount, false);
+
+  // discard any dirty indices that are no longer valid
+  auto outOfRange = [primPathCount](const int32_t index) { return uint32_t(index) >= primPathCount; };
+  m_dirtyMatrices.erase(std::remove_if(m_dirtyMatrices.begin(), m_dirtyMatrices.end(), outOfRange), m_dirtyMatrices.end());
+  m_dirtyVisibilities.erase(std::remove_if(m_dirtyVisibilities.begin(), m_dirtyVisibilities.end(), outOfRange), m_dirtyVisibilities.end());
+  invalidateCache();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void DrivenTransforms::updateDrivenTransforms(std::vector<UsdPrim>& drivenPrims, const MTime& currentTime)
+void DrivenTransforms::clearDirty(std::vector<uint64_t>& bits, std::vector<int32_t>& indices)
 {
-  for (uint32_t i = 0, cnt = m_dirtyMatrices.size(); i < cnt; ++i)
+  for(const int32_t index : indices)
   {
-    uint32_t idx = uint32_t(m_dirtyMatrices[i]);
-    // [RB] This seems redundant? Why not just prevent invalid data from entering the structure?
-    if (idx >= drivenPrims.size())
+    bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+  }
+  indices.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void DrivenTransforms::invalidateCache(const SdfPathVector& resyncedPaths)
+{
+  if(m_drivenPrims.empty())
+  {
+    return;
+  }
+
+  for(const SdfPath& path : resyncedPaths)
+  {
+    const SdfPath primPath = path.GetPrimPath();
+    if(primPath == SdfPath::AbsoluteRootPath())
     {
-      continue;
+      invalidateCache();
+      return;
     }
-    UsdPrim& usdPrim = drivenPrims[idx];
-    if (!usdPrim.IsValid())
+
+    // a resynced prim affects all of its descendants, whereas a resynced property only affects its own prim
+    const bool subtree = !path.IsPropertyPath();
+    for(size_t i = 0, n = m_drivenPrims.size(); i < n; ++i)
     {
-      continue;
+      if(subtree ? m_drivenPrimPaths[i].HasPrefix(primPath) : m_drivenPrimPaths[i] == primPath)
+      {
+        m_drivenPrims[i] = UsdPrim();
+        m_drivenOps[i] = UsdGeomXformOp();
+        if(i < m_drivenMatrixSpecs.size())
+        {
+          m_drivenMatrixSpecs[i] = SdfPath();
+          m_drivenVisibilitySpecs[i] = SdfPath();
+          m_writtenMatrices[i] = WrittenSample<GfMatrix4d>();
+          m_writtenVisibilities[i] = WrittenSample<TfToken>();
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const UsdPrim& DrivenTransforms::resolvePrim(const UsdStageRefPtr& stage, const uint32_t primIndex)
+{
+  UsdPrim& prim = m_drivenPrims[primIndex];
+  if(!prim.IsValid())
+  {
+    prim = stage->GetPrimAtPath(m_drivenPrimPaths[primIndex]);
+    m_drivenOps[primIndex] = UsdGeomXformOp();
+    if(!prim.IsValid())
+    {
+      MString warningMsg;
+      warningMsg.format("Driven Prim [^1s] is not valid.", MString("") + primIndex);
+      MGlobal::displayWarning(warningMsg);
     }
+  }
+  return prim;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+UsdGeomXformOp& DrivenTransforms::resolveTransformOp(const UsdStageRefPtr& stage, const uint32_t primIndex)
+{
+  const UsdPrim& usdPrim = resolvePrim(stage, primIndex);
+  UsdGeomXformOp& xformop = m_drivenOps[primIndex];
+  if (!xformop && usdPrim.IsValid())
+  {
+    // find (or create) the transform op the first time the prim is driven
     UsdGeomXform xform(usdPrim);
     bool resetsXformStack = false;
     std::vector<UsdGeomXformOp> xformops = xform.GetOrderedXformOps(&resetsXformStack);
-    bool pushed = false;
     for (auto& it : xformops)
     {
       if (it.GetOpType() == UsdGeomXformOp::TypeTransform)
       {
-        nodes::TransformationMatrix::pushMatrix(m_drivenMatrix[idx], it, currentTime.as(MTime::uiUnit()));
-        pushed = true;
+        xformop = it;
         break;
       }
     }
-    if (!pushed)
+    if (!xformop)
     {
-      UsdGeomXformOp xformop = xform.AddTransformOp();
-      nodes::TransformationMatrix::pushMatrix(m_drivenMatrix[idx], xformop, currentTime.as(MTime::uiUnit()));
+      xformop = xform.AddTransformOp();
+    }
+  }
+  return xformop;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+UsdAttribute DrivenTransforms::resolveVisibilityAttr(const UsdStageRefPtr& stage, const uint32_t primIndex)
+{
+  const UsdPrim& usdPrim = resolvePrim(stage, primIndex);
+  if (!usdPrim)
+  {
+    return UsdAttribute();
+  }
+  UsdGeomXform xform(usdPrim);
+  UsdAttribute attr = xform.GetVisibilityAttr();
+  if(!attr)
+  {
+    attr = xform.CreateVisibilityAttr();
+  }
+  return attr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool DrivenTransforms::updateDrivenTransforms(const UsdStageRefPtr& stage, const MTime& currentTime)
+{
+  bool result = true;
+  for (uint32_t i = 0, cnt = m_dirtyMatrices.size(); i < cnt; ++i)
+  {
+    uint32_t idx = uint32_t(m_dirtyMatrices[i]);
+    // [RB] This seems redundant? Why not just prevent invalid data from entering the structure?
+    if (idx >= m_drivenPrims.size())
+    {
+      continue;
+    }
+    UsdGeomXformOp& xformop = resolveTransformOp(stage, idx);
+    if (!xformop)
+    {
+      result = false;
+      continue;
     }
+    const MMatrix& matrix = drivenMatrix(idx);
+    nodes::TransformationMatrix::pushMatrix(matrix, xformop, currentTime.as(MTime::uiUnit()));
 
     TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("ProxyShape::updateDrivenTransforms %lf %lf %lf %lf  %lf %lf %lf %lf  %lf %lf %lf %lf  %lf %lf %lf %lf\n",
-        m_drivenMatrix[idx][0][0],
-        m_drivenMatrix[idx][0][1],
-        m_drivenMatrix[idx][0][2],
-        m_drivenMatrix[idx][0][3],
-        m_drivenMatrix[idx][1][0],
-        m_drivenMatrix[idx][1][1],
-        m_drivenMatrix[idx][1][2],
-        m_drivenMatrix[idx][1][3],
-        m_drivenMatrix[idx][2][0],
-        m_drivenMatrix[idx][2][1],
-        m_drivenMatrix[idx][2][2],
-        m_drivenMatrix[idx][2][3],
-        m_drivenMatrix[idx][3][0],
-        m_drivenMatrix[idx][3][1],
-        m_drivenMatrix[idx][3][2],
-        m_drivenMatrix[idx][3][3]);
-  }
-  m_dirtyMatrices.clear();
+        matrix[0][0],
+        matrix[0][1],
+        matrix[0][2],
+        matrix[0][3],
+        matrix[1][0],
+        matrix[1][1],
+        matrix[1][2],
+        matrix[1][3],
+        matrix[2][0],
+        matrix[2][1],
+        matrix[2][2],
+        matrix[2][3],
+        matrix[3][0],
+        matrix[3][1],
+        matrix[3][2],
+        matrix[3][3]);
+  }
+  clearDirty(m_dirtyMatrixBits, m_dirtyMatrices);
+  return result;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void DrivenTransforms::updateDrivenVisibility(std::vector<UsdPrim>& drivenPrims, const MTime& currentTime)
+bool DrivenTransforms::updateDrivenVisibility(const UsdStageRefPtr& stage, const MTime& currentTime)
 {
+  bool result = true;
   for (uint32_t i = 0, cnt = m_dirtyVisibilities.size(); i < cnt; ++i)
   {
     uint32_t idx = uint32_t(m_dirtyVisibilities[i]);
     // [RB] This seems redundant? Why not just prevent invalid data from entering the structure?
-    if (idx >= drivenPrims.size())
+    if (idx >= m_drivenPrims.size())
     {
       continue;
     }
-    UsdPrim& usdPrim = drivenPrims[idx];
-    if (!usdPrim)
+    UsdAttribute attr = resolveVisibilityAttr(stage, idx);
+    if (!attr)
     {
+      result = false;
       continue;
     }
-    UsdGeomXform xform(usdPrim);
-    UsdAttribute attr = xform.GetVisibilityAttr();
-    if(!attr)
-    {
-      attr = xform.CreateVisibilityAttr();
-    }
-    attr.Set(m_drivenVisibility[idx] ? UsdGeomTokens->inherited : UsdGeomTokens->invisible, currentTime.as(MTime::uiUnit()));
+    attr.Set(drivenVisibility(idx) ? UsdGeomTokens->inherited : UsdGeomTokens->invisible, currentTime.as(MTime::uiUnit()));
   }
-  m_dirtyVisibilities.clear();
+  clearDirty(m_dirtyVisibilityBits, m_dirtyVisibilities);
+  return result;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-bool DrivenTransforms::update(UsdStageRefPtr stage, const MTime& currentTime)
+template<typename T>
+uint32_t DrivenTransforms::WrittenSample<T>::fill(const T& newValue, const double newTime, const bool skipUnchanged, std::pair<double, T>* samples)
+{
+  // While the value is unchanged, only the first sample of the run is written. Once it changes, the held value is
+  // written at the last time it was driven, so that the values within the run are not interpolated towards the new one.
+  if(skipUnchanged && valid && newTime > time && newValue == value)
+  {
+    time = newTime;
+    held = true;
+    return 0;
+  }
+
+  uint32_t count = 0;
+  if(held)
+  {
+    samples[count++] = std::make_pair(time, value);
+  }
+  samples[count++] = std::make_pair(newTime, newValue);
+  value = newValue;
+  time = newTime;
+  valid = true;
+  held = false;
+  return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool DrivenTransforms::bulkUpdate(const UsdStageRefPtr& stage, const MTime& currentTime)
 {
-  std::vector<UsdPrim> drivenPrims;
-  drivenPrims.resize(transformCount());
+  const UsdEditTarget& editTarget = stage->GetEditTarget();
+  const SdfLayerHandle layer = editTarget.GetLayer();
+  if(!layer)
+  {
+    return false;
+  }
+
+  // the cached specs (and the samples written to them) are only valid for the edit target they were resolved for
+  if(m_drivenEditTarget != editTarget)
+  {
+    m_drivenEditTarget = editTarget;
+    m_drivenMatrixSpecs.clear();
+    m_drivenVisibilitySpecs.clear();
+    m_writtenMatrices.clear();
+    m_writtenVisibilities.clear();
+  }
+  const size_t count = m_drivenPrimPaths.size();
+  m_drivenMatrixSpecs.resize(count);
+  m_drivenVisibilitySpecs.resize(count);
+  m_writtenMatrices.resize(count);
+  m_writtenVisibilities.resize(count);
+
+  const double layerTime = editTarget.GetMapFunction().GetTimeOffset().GetInverse() * currentTime.as(MTime::uiUnit());
+
+  // resolve all of the prims, attributes and specs with the Usd API, before any of the specs are modified
   bool result = true;
-  uint32_t cnt = m_drivenPrimPaths.size();
-  for (uint32_t idx = 0; idx < cnt; ++idx)
+  std::vector<NewSpec> newSpecs;
+  std::vector<uint32_t> matrixIndices;
+  std::vector<uint32_t> visibilityIndices;
+  matrixIndices.reserve(m_dirtyMatrices.size());
+  visibilityIndices.reserve(m_dirtyVisibilities.size());
+  for(const int32_t dirty : m_dirtyMatrices)
   {
-    auto path = m_drivenPrimPaths[idx];
-    drivenPrims[idx] = stage->GetPrimAtPath(path);
-    if (!drivenPrims[idx].IsValid())
+    const uint32_t idx = uint32_t(dirty);
+    if(idx >= count)
+    {
+      continue;
+    }
+    const UsdGeomXformOp& xformop = resolveTransformOp(stage, idx);
+    if(!xformop || !resolveSpec(editTarget, xformop.GetAttr(), m_drivenMatrixSpecs[idx], newSpecs))
+    {
+      result = false;
+      continue;
+    }
+    matrixIndices.push_back(idx);
+  }
+  for(const int32_t dirty : m_dirtyVisibilities)
+  {
+    const uint32_t idx = uint32_t(dirty);
+    if(idx >= count)
+    {
+      continue;
+    }
+    UsdAttribute attr = resolveVisibilityAttr(stage, idx);
+    if(!attr || !resolveSpec(editTarget, attr, m_drivenVisibilitySpecs[idx], newSpecs))
     {
-      MString warningMsg;
-      warningMsg.format("Driven Prim [^1s] is not valid.", MString("") + idx);
-      MGlobal::displayWarning(warningMsg);
       result = false;
+      continue;
     }
+    visibilityIndices.push_back(idx);
   }
+  clearDirty(m_dirtyMatrixBits, m_dirtyMatrices);
+  clearDirty(m_dirtyVisibilityBits, m_dirtyVisibilities);
+
+  SdfChangeBlock changeBlock;
 
+  for(const NewSpec& spec : newSpecs)
+  {
+    SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(layer, spec.specPath->GetPrimPath());
+    if(!primSpec || !SdfAttributeSpec::New(primSpec, spec.specPath->GetName(), spec.typeName))
+    {
+      MGlobal::displayWarning(MString("Unable to create the driven attribute ") + spec.specPath->GetText());
+      *spec.specPath = SdfPath();
+      result = false;
+    }
+  }
+
+  // work out which samples need to be written. Each index is only processed once (and only reads from the layer), so
+  // this can safely be done in parallel.
+  const bool skipUnchanged = (m_updateFlags & kSkipUnchangedSamples) != 0;
+  std::vector<std::pair<double, GfMatrix4d> > matrixSamples(matrixIndices.size() * 2);
+  std::vector<std::pair<double, TfToken> > visibilitySamples(visibilityIndices.size() * 2);
+  std::vector<uint8_t> matrixSampleCounts(matrixIndices.size(), 0);
+  std::vector<uint8_t> visibilitySampleCounts(visibilityIndices.size(), 0);
+
+  auto fillMatrices = [&](size_t begin, size_t end)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      const uint32_t idx = matrixIndices[i];
+      const SdfPath& specPath = m_drivenMatrixSpecs[idx];
+      if(!specPath.IsEmpty())
+      {
+        // a sample from a previous recording must always be overwritten
+        const bool skip = skipUnchanged && !layer->QueryTimeSample(specPath, layerTime);
+        const GfMatrix4d& value = *(const GfMatrix4d*)(m_drivenMatrices.data() + idx * 16);
+        matrixSampleCounts[i] = m_writtenMatrices[idx].fill(value, layerTime, skip, &matrixSamples[i * 2]);
+      }
+    }
+  };
+  auto fillVisibilities = [&](size_t begin, size_t end)
+  {
+    for(size_t i = begin; i < end; ++i)
+    {
+      const uint32_t idx = visibilityIndices[i];
+      const SdfPath& specPath = m_drivenVisibilitySpecs[idx];
+      if(!specPath.IsEmpty())
+      {
+        const bool skip = skipUnchanged && !layer->QueryTimeSample(specPath, layerTime);
+        const TfToken& value = drivenVisibility(idx) ? UsdGeomTokens->inherited : UsdGeomTokens->invisible;
+        visibilitySampleCounts[i] = m_writtenVisibilities[idx].fill(value, layerTime, skip, &visibilitySamples[i * 2]);
+      }
+    }
+  };
+
+  if(m_updateFlags & kParallelFill)
+  {
+    WorkParallelForN(matrixIndices.size(), fillMatrices);
+    WorkParallelForN(visibilityIndices.size(), fillVisibilities);
+  }
+  else
+  {
+    fillMatrices(0, matrixIndices.size());
+    fillVisibilities(0, visibilityIndices.size());
+  }
+
+  // Sdf is not thread safe, so the samples themselves are written serially
+  size_t numWritten = 0;
+  for(size_t i = 0, n = matrixIndices.size(); i < n; ++i)
+  {
+    const SdfPath& specPath = m_drivenMatrixSpecs[matrixIndices[i]];
+    for(uint8_t j = 0; j < matrixSampleCounts[i]; ++j, ++numWritten)
+    {
+      const std::pair<double, GfMatrix4d>& sample = matrixSamples[i * 2 + j];
+      layer->SetTimeSample(specPath, sample.first, sample.second);
+    }
+  }
+  for(size_t i = 0, n = visibilityIndices.size(); i < n; ++i)
+  {
+    const SdfPath& specPath = m_drivenVisibilitySpecs[visibilityIndices[i]];
+    for(uint8_t j = 0; j < visibilitySampleCounts[i]; ++j, ++numWritten)
+    {
+      const std::pair<double, TfToken>& sample = visibilitySamples[i * 2 + j];
+      layer->SetTimeSample(specPath, sample.first, sample.second);
+    }
+  }
+
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("DrivenTransforms::bulkUpdate wrote %zu samples for %zu matrices and %zu visibilities\n",
+      numWritten, matrixIndices.size(), visibilityIndices.size());
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool DrivenTransforms::update(UsdStageRefPtr stage, const MTime& currentTime)
+{
+  // the cached prims are only valid for the stage they were resolved from
+  if(get_pointer(m_drivenStage) != get_pointer(stage))
+  {
+    invalidateCache();
+    m_drivenStage = stage;
+  }
+
+  // only the prims that have been dirtied are resolved (or validated)
+  m_drivenPrims.resize(m_drivenPrimPaths.size());
+  m_drivenOps.resize(m_drivenPrimPaths.size());
+
+  if(m_updateFlags & kBulkWrite)
+  {
+    return bulkUpdate(stage, currentTime);
+  }
+
+  bool result = true;
   if (!dirtyMatrices().empty())
   {
-    updateDrivenTransforms(drivenPrims, currentTime);
+    result = updateDrivenTransforms(stage, currentTime) && result;
   }
   if (!dirtyVisibilities().empty())
   {
-    updateDrivenVisibility(drivenPrims, currentTime);
+    result = updateDrivenVisibility(stage, currentTime) && result;
   }
   return result;
 }
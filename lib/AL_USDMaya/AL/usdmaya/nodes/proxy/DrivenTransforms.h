@@ -17,15 +17,21 @@
 
 #include "../../Api.h"
 
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/tf/token.h"
 #include "pxr/usd/sdf/path.h"
+#include "pxr/usd/usd/editTarget.h"
 #include "pxr/usd/usd/prim.h"
+#include "pxr/usd/usdGeom/xformOp.h"
 
 #include "maya/MPxData.h"
 #include "maya/MVector.h"
 #include "maya/MMatrix.h"
 
+#include <cstring>
 #include <vector>
 #include <string>
+#include <utility>
 #include "AL/maya/utils/ForwardDeclares.h"
 #include "AL/usd/utils/ForwardDeclares.h"
 
@@ -43,17 +49,33 @@ namespace proxy {
 ///         memory storage. setDrivenPrimPaths should be called to specify the prim paths. Whenever you need to specify
 ///         a change to the matrix or visibility values, call either dirtyVisibility or dirtyMatrix, and specify the
 ///         index of the prim to modify.
-///         Within the compute method of the node, constructDrivenPrimsArray should be called to construct the array
-///         of prims to update, which can then be passed to the update method to set the dirty values on the prim
-///         attributes.
+///         Within the compute method of the node, the update method should be called to set the dirty values on the
+///         prim attributes. The prims (and the transform ops the matrices are written to) are resolved the first time
+///         they are dirtied, and cached until invalidateCache is called (which the proxy shape does whenever the prims
+///         are resynced).
+///         By default the values are set with the Usd API, one attribute at a time. When kBulkWrite is enabled in the
+///         update flags, the samples are instead written directly to the attribute specs in the layer of the stage's
+///         edit target, within a single SdfChangeBlock, so that the stage only processes one change notification for
+///         the whole batch. The proxy shape also enables kBulkWrite (and kParallelFill) for all of its driven transforms
+///         when its bulkWriteDrivenTransforms attribute is set.
 //----------------------------------------------------------------------------------------------------------------------
 class DrivenTransforms
 {
 public:
 
+  /// \brief  flags that control how the dirty values are written by update
+  enum UpdateFlags
+  {
+    kBulkWrite = 1 << 0,            ///< write the time samples directly to the specs in the edit target's layer
+    kParallelFill = 1 << 1,         ///< prepare the samples to write in parallel (only used with kBulkWrite)
+    kSkipUnchangedSamples = 1 << 2  ///< do not write samples that are identical to the previous frame (only used with kBulkWrite)
+  };
+
   /// \brief  ctor
   inline DrivenTransforms()
-    : m_drivenPrimPaths(), m_drivenMatrix(), m_drivenVisibility(), m_dirtyMatrices(), m_dirtyVisibilities() {}
+    : m_drivenPrimPaths(), m_drivenPrims(), m_drivenOps(), m_drivenStage(), m_drivenEditTarget(), m_drivenMatrixSpecs(),
+      m_drivenVisibilitySpecs(), m_writtenMatrices(), m_writtenVisibilities(), m_drivenMatrices(),
+      m_drivenVisibilityBits(), m_dirtyMatrixBits(), m_dirtyVisibilityBits(), m_dirtyMatrices(), m_dirtyVisibilities(), m_updateFlags(0) {}
 
   /// \brief  returns the number of transforms
   inline size_t transformCount() const
@@ -67,7 +89,23 @@ public:
   /// \brief  set the driven prim paths on the host driven transforms
   /// \param  primPaths the prim paths to set on the proxy
   inline void setDrivenPrimPaths(const SdfPathVector& primPaths)
-    { m_drivenPrimPaths = primPaths; }
+    { m_drivenPrimPaths = primPaths; invalidateCache(); }
+
+  /// \brief  discards all of the cached prims and transform ops, so that they are resolved again when next updated
+  inline void invalidateCache()
+    {
+      m_drivenPrims.clear();
+      m_drivenOps.clear();
+      m_drivenMatrixSpecs.clear();
+      m_drivenVisibilitySpecs.clear();
+      m_writtenMatrices.clear();
+      m_writtenVisibilities.clear();
+    }
+
+  /// \brief  discards the cached prims and transform ops affected by the resynced paths
+  /// \param  resyncedPaths the paths of the prims (or properties) that have been resynced on the stage
+  AL_USDMAYA_PUBLIC
+  void invalidateCache(const SdfPathVector& resyncedPaths);
 
   /// \brief  update the driven transforms
   /// \param  stage the stage to extract the prims from
@@ -76,13 +114,29 @@ public:
   AL_USDMAYA_PUBLIC
   bool update(UsdStageRefPtr stage, const MTime& currentTime);
 
+  /// \brief  sets the flags that control how the dirty values are written to the stage
+  /// \param  flags a combination of the UpdateFlags
+  inline void setUpdateFlags(const uint32_t flags)
+    { m_updateFlags = flags; }
+
+  /// \brief  returns the flags that control how the dirty values are written to the stage
+  /// \return the UpdateFlags
+  inline uint32_t updateFlags() const
+    { return m_updateFlags; }
+
   /// \brief  dirties the visibility for the specified prim index
   /// \param  primIndex the index of the prim
   /// \param  newValue the new visibility value
   inline void dirtyVisibility(const int32_t primIndex, bool newValue)
     {
-      m_drivenVisibility[primIndex] = newValue;
-      m_dirtyVisibilities.push_back(primIndex);
+      if(uint32_t(primIndex) < storageCount())
+      {
+        assignBit(m_drivenVisibilityBits, primIndex, newValue);
+        if(!setBit(m_dirtyVisibilityBits, primIndex))
+        {
+          m_dirtyVisibilities.push_back(primIndex);
+        }
+      }
     }
 
   /// \brief  dirties the matrix for the specified prim index
@@ -90,44 +144,155 @@ public:
   /// \param  newValue the new matrix value
   inline void dirtyMatrix(const int32_t primIndex, const MMatrix& newValue)
     {
-      m_drivenMatrix[primIndex] = newValue;
-      m_dirtyMatrices.push_back(primIndex);
+      if(uint32_t(primIndex) < storageCount())
+      {
+        std::memcpy(m_drivenMatrices.data() + primIndex * 16, newValue.matrix, sizeof(double) * 16);
+        dirtyMatrix(primIndex);
+      }
+    }
+
+  /// \brief  dirties the matrix for the specified prim index, once its value has been written directly into the
+  ///         drivenMatrixBuffer
+  /// \param  primIndex the index of the prim
+  inline void dirtyMatrix(const int32_t primIndex)
+    {
+      if(uint32_t(primIndex) < storageCount() && !setBit(m_dirtyMatrixBits, primIndex))
+      {
+        m_dirtyMatrices.push_back(primIndex);
+      }
+    }
+
+  /// \brief  dirties the matrices of a contiguous range of prims, once their values have been written directly into
+  ///         the drivenMatrixBuffer
+  /// \param  firstIndex the index of the first prim
+  /// \param  count the number of prims
+  inline void dirtyMatrices(const int32_t firstIndex, const int32_t count)
+    {
+      for(int32_t i = firstIndex, end = firstIndex + count; i < end; ++i)
+      {
+        dirtyMatrix(i);
+      }
     }
 
+  /// \brief  returns the buffer that holds the matrices of the driven transforms, as 16 doubles per prim (in the same
+  ///         row major layout as an MMatrix or GfMatrix4d). Upstream nodes can write the matrices into this buffer
+  ///         directly (e.g. as they compose them), and then call dirtyMatrix(primIndex) or
+  ///         dirtyMatrices(firstIndex, count) to mark them as dirty, which avoids copying each MMatrix.
+  /// \return the matrix buffer
+  inline double* drivenMatrixBuffer()
+    { return m_drivenMatrices.data(); }
+
+  /// \brief  returns the buffer that holds the matrices of the driven transforms, as 16 doubles per prim
+  /// \return the matrix buffer
+  inline const double* drivenMatrixBuffer() const
+    { return m_drivenMatrices.data(); }
+
   /// \brief  returns the paths of the driven transforms
   /// \return the driven transforms
   inline const SdfPathVector& drivenPrimPaths() const
     { return m_drivenPrimPaths; }
 
   /// \brief  returns the matrices that have been dirtied
-  /// \return returns the indices of the prims that have dirtied matrix params
+  /// \return returns the (unique) indices of the prims that have dirtied matrix params, in the order they were dirtied
   inline const std::vector<int32_t>& dirtyMatrices() const
     { return m_dirtyMatrices; }
 
   /// \brief  returns the visibilities that have been dirtied
-  /// \return returns the indices of the prims that have dirtied visibility params
+  /// \return returns the (unique) indices of the prims that have dirtied visibility params, in the order they were dirtied
   inline const std::vector<int32_t>& dirtyVisibilities() const
     { return m_dirtyVisibilities; }
 
-  /// \brief  returns the visibilities that have been dirtied
-  /// \return returns the current matrix values of the driven transforms
-  inline const std::vector<MMatrix>& drivenMatrices() const
-    { return m_drivenMatrix; }
+  /// \brief  returns the current matrix value of a driven transform
+  /// \param  primIndex the index of the prim
+  /// \return the matrix
+  inline const MMatrix& drivenMatrix(const uint32_t primIndex) const
+    { return *(const MMatrix*)(m_drivenMatrices.data() + primIndex * 16); }
 
-  /// \brief  returns the visibilities that have been dirtied
-  /// \return returns the current visibility statuses of the driven transforms
-  inline const std::vector<bool>& drivenVisibilities() const
-    { return m_drivenVisibility; }
+  /// \brief  returns the current visibility status of a driven transform
+  /// \param  primIndex the index of the prim
+  /// \return true if the prim is visible
+  inline bool drivenVisibility(const uint32_t primIndex) const
+    { return testBit(m_drivenVisibilityBits, primIndex); }
+
+  /// \brief  returns a copy of the current matrix values of the driven transforms
+  /// \return the matrices, one per prim
+  /// \deprecated the matrices are no longer stored as MMatrix, so this copies them. Use drivenMatrix(primIndex) or
+  ///         drivenMatrixBuffer() instead.
+  inline std::vector<MMatrix> drivenMatrices() const
+    {
+      std::vector<MMatrix> matrices(storageCount());
+      for(size_t i = 0, n = matrices.size(); i < n; ++i)
+      {
+        matrices[i] = drivenMatrix(i);
+      }
+      return matrices;
+    }
+
+  /// \brief  returns a copy of the current visibility statuses of the driven transforms
+  /// \return the visibilities, one per prim
+  /// \deprecated the visibilities are no longer stored as a std::vector<bool>, so this copies them. Use
+  ///         drivenVisibility(primIndex) instead.
+  inline std::vector<bool> drivenVisibilities() const
+    {
+      std::vector<bool> visibilities(storageCount());
+      for(size_t i = 0, n = visibilities.size(); i < n; ++i)
+      {
+        visibilities[i] = drivenVisibility(i);
+      }
+      return visibilities;
+    }
 
 private:
-  void updateDrivenVisibility(std::vector<UsdPrim>& drivenPrims, const MTime& currentTime);
-  void updateDrivenTransforms(std::vector<UsdPrim>& drivenPrims, const MTime& currentTime);
+  /// the value last written to the spec of a driven attribute, used to skip the samples that have not changed
+  template<typename T>
+  struct WrittenSample
+  {
+    T value;
+    double time = 0;      ///< the last time the value was driven
+    bool valid = false;   ///< true once a value has been written
+    bool held = false;    ///< true if the sample at 'time' was skipped (so it must be written when the value changes)
+
+    /// returns the number of samples (0, 1, or 2) that need to be written for the new value
+    uint32_t fill(const T& newValue, double newTime, bool skipUnchanged, std::pair<double, T>* samples);
+  };
+
+  /// the number of prims the matrices and visibilities have been allocated for (by resizeDrivenTransforms)
+  inline size_t storageCount() const
+    { return m_drivenMatrices.size() >> 4; }
+  static inline bool testBit(const std::vector<uint64_t>& bits, const uint32_t i)
+    { return (bits[i >> 6] & (uint64_t(1) << (i & 63))) != 0; }
+  static inline bool setBit(std::vector<uint64_t>& bits, const uint32_t i)
+    { const bool wasSet = testBit(bits, i); bits[i >> 6] |= (uint64_t(1) << (i & 63)); return wasSet; }
+  static inline void assignBit(std::vector<uint64_t>& bits, const uint32_t i, const bool value)
+    { bits[i >> 6] = (bits[i >> 6] & ~(uint64_t(1) << (i & 63))) | (uint64_t(value) << (i & 63)); }
+  static void clearDirty(std::vector<uint64_t>& bits, std::vector<int32_t>& indices);
+
+  const UsdPrim& resolvePrim(const UsdStageRefPtr& stage, uint32_t primIndex);
+  UsdGeomXformOp& resolveTransformOp(const UsdStageRefPtr& stage, uint32_t primIndex);
+  UsdAttribute resolveVisibilityAttr(const UsdStageRefPtr& stage, uint32_t primIndex);
+  bool updateDrivenVisibility(const UsdStageRefPtr& stage, const MTime& currentTime);
+  bool updateDrivenTransforms(const UsdStageRefPtr& stage, const MTime& currentTime);
+  bool bulkUpdate(const UsdStageRefPtr& stage, const MTime& currentTime);
 private:
   SdfPathVector m_drivenPrimPaths;
-  std::vector<MMatrix> m_drivenMatrix;
-  std::vector<bool> m_drivenVisibility;
+  std::vector<UsdPrim> m_drivenPrims;         ///< the cached prims for the driven prim paths (invalid until resolved)
+  std::vector<UsdGeomXformOp> m_drivenOps;    ///< the cached transform op of each prim (invalid until resolved)
+  UsdStageWeakPtr m_drivenStage;              ///< the stage the cached prims were resolved from
+  UsdEditTarget m_drivenEditTarget;           ///< the edit target the cached specs were resolved for
+  SdfPathVector m_drivenMatrixSpecs;          ///< the cached spec paths of the transform ops in the edit target layer
+  SdfPathVector m_drivenVisibilitySpecs;      ///< the cached spec paths of the visibility attributes in the edit target layer
+  std::vector<WrittenSample<GfMatrix4d> > m_writtenMatrices;
+  std::vector<WrittenSample<TfToken> > m_writtenVisibilities;
+  // The matrices, visibilities and dirty states are each held in their own array. Each matrix is kept whole (rather
+  // than splitting its 16 elements into separate arrays), since the matrices are written (by upstream nodes),
+  // read (as an MMatrix) and authored (as a GfMatrix4d) a whole matrix at a time.
+  std::vector<double> m_drivenMatrices;         ///< the matrices of the driven transforms, 16 doubles per prim
+  std::vector<uint64_t> m_drivenVisibilityBits; ///< a bit per prim, set if the prim is visible
+  std::vector<uint64_t> m_dirtyMatrixBits;      ///< a bit per prim, set if the index is in m_dirtyMatrices
+  std::vector<uint64_t> m_dirtyVisibilityBits;  ///< a bit per prim, set if the index is in m_dirtyVisibilities
   std::vector<int32_t> m_dirtyMatrices;
   std::vector<int32_t> m_dirtyVisibilities;
+  uint32_t m_updateFlags;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,487 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "AL/usdmaya/nodes/proxy/PrimPicker.h"
+#include "AL/usdmaya/DebugCodes.h"
+
+#include "pxr/base/gf/vec4d.h"
+#include "pxr/usd/usd/primRange.h"
+#include "pxr/usd/usdGeom/bboxCache.h"
+#include "pxr/usd/usdGeom/gprim.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/xformCache.h"
+
+#include <algorithm>
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+namespace {
+
+// the maximum number of prims stored within a leaf node of the hierarchy
+const uint32_t kMaxLeavesPerNode = 4;
+
+enum Containment
+{
+  kOutside,
+  kIntersects,
+  kInside
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// extracts the six clipping planes (with normals pointing inwards) from a row-major model view projection matrix
+void extractPlanes(const GfMatrix4d& m, GfVec4d planes[6])
+{
+  const GfVec4d x = m.GetColumn(0);
+  const GfVec4d y = m.GetColumn(1);
+  const GfVec4d z = m.GetColumn(2);
+  const GfVec4d w = m.GetColumn(3);
+  planes[0] = w + x;
+  planes[1] = w - x;
+  planes[2] = w + y;
+  planes[3] = w - y;
+  planes[4] = w + z;
+  planes[5] = w - z;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline double planeDistance(const GfVec4d& plane, const GfVec3d& p)
+{
+  return plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3];
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+Containment classifyBox(const GfRange3d& box, const GfVec4d planes[6])
+{
+  if(box.IsEmpty())
+    return kOutside;
+
+  const GfVec3d& bmin = box.GetMin();
+  const GfVec3d& bmax = box.GetMax();
+  Containment result = kInside;
+  for(int i = 0; i < 6; ++i)
+  {
+    const GfVec4d& plane = planes[i];
+    // the corners of the box furthest along, and furthest against, the plane normal
+    const GfVec3d furthest(plane[0] >= 0 ? bmax[0] : bmin[0], plane[1] >= 0 ? bmax[1] : bmin[1], plane[2] >= 0 ? bmax[2] : bmin[2]);
+    const GfVec3d nearest(plane[0] >= 0 ? bmin[0] : bmax[0], plane[1] >= 0 ? bmin[1] : bmax[1], plane[2] >= 0 ? bmin[2] : bmax[2]);
+    if(planeDistance(plane, furthest) < 0)
+      return kOutside;
+    if(planeDistance(plane, nearest) < 0)
+      result = kIntersects;
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// clips the triangle against the planes (Sutherland-Hodgman), and returns a point within the frustum if any part of the
+// triangle remains.
+bool clipTriangle(const GfVec3d& a, const GfVec3d& b, const GfVec3d& c, const GfVec4d planes[6], GfVec3d& inside)
+{
+  // each plane can add at most one vertex to the polygon
+  GfVec3d buffers[2][9];
+  buffers[0][0] = a;
+  buffers[0][1] = b;
+  buffers[0][2] = c;
+  int count = 3;
+  int src = 0;
+  for(int i = 0; i < 6; ++i)
+  {
+    const GfVec3d* in = buffers[src];
+    GfVec3d* out = buffers[src ^ 1];
+    int outCount = 0;
+    for(int j = 0; j < count; ++j)
+    {
+      const GfVec3d& p = in[j];
+      const GfVec3d& q = in[(j + 1) % count];
+      const double dp = planeDistance(planes[i], p);
+      const double dq = planeDistance(planes[i], q);
+      if(dp >= 0)
+      {
+        out[outCount++] = p;
+      }
+      if((dp >= 0) != (dq >= 0))
+      {
+        out[outCount++] = p + (q - p) * (dp / (dp - dq));
+      }
+    }
+    count = outCount;
+    src ^= 1;
+    if(!count)
+      return false;
+  }
+  inside = buffers[src][0];
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+inline double clipDepth(const GfMatrix4d& stageToClip, const GfVec3d& p)
+{
+  const GfVec4d c = GfVec4d(p[0], p[1], p[2], 1.0) * stageToClip;
+  return c[3] != 0 ? c[2] / c[3] : c[2];
+}
+
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimPicker::build(const UsdPrim& root, UsdTimeCode time, const TfTokenVector& purposes)
+{
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("PrimPicker::build\n");
+  clear();
+  if(!root)
+    return;
+
+  m_time = time;
+  m_purposes = purposes;
+
+  for(const UsdPrim& prim : UsdPrimRange(root, UsdTraverseInstanceProxies()))
+  {
+    // invisible prims, or those with a purpose that is not displayed, are retained with empty bounds so that a refit
+    // can pick up animated visibility
+    if(prim.IsA<UsdGeomGprim>())
+    {
+      Leaf leaf;
+      leaf.prim = prim;
+      leaf.isMesh = prim.IsA<UsdGeomMesh>();
+      leaf.hasTriangles = false;
+      m_leaves.push_back(std::move(leaf));
+    }
+  }
+
+  if(m_leaves.empty())
+    return;
+
+  computeLeafBounds();
+
+  std::vector<GfVec3d> centroids(m_leaves.size());
+  std::vector<uint32_t> order(m_leaves.size());
+  for(uint32_t i = 0, n = m_leaves.size(); i < n; ++i)
+  {
+    const GfRange3d& bounds = m_leaves[i].bounds;
+    centroids[i] = bounds.IsEmpty() ? GfVec3d(0.0) : bounds.GetMidpoint();
+    order[i] = i;
+  }
+
+  m_nodes.reserve(2 * m_leaves.size() / kMaxLeavesPerNode + 1);
+  buildNode(0, m_leaves.size(), order, centroids);
+
+  // store the leaves in the order they are referenced by the nodes
+  std::vector<Leaf> leaves;
+  leaves.reserve(m_leaves.size());
+  for(uint32_t index : order)
+  {
+    leaves.push_back(std::move(m_leaves[index]));
+  }
+  m_leaves.swap(leaves);
+
+  refitNodes();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimPicker::clear()
+{
+  m_nodes.clear();
+  m_leaves.clear();
+  m_purposes.clear();
+  m_time = UsdTimeCode::Default();
+  m_boundsDirty = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+uint32_t PrimPicker::buildNode(uint32_t first, uint32_t count, std::vector<uint32_t>& order, const std::vector<GfVec3d>& centroids)
+{
+  const uint32_t index = m_nodes.size();
+  m_nodes.push_back(Node{GfRange3d(), first, count});
+  if(count <= kMaxLeavesPerNode)
+  {
+    return index;
+  }
+
+  // split at the median of the centroids, along the axis in which they are most spread out
+  GfRange3d centroidRange;
+  for(uint32_t i = first; i < first + count; ++i)
+  {
+    centroidRange.UnionWith(centroids[order[i]]);
+  }
+  const GfVec3d size = centroidRange.GetSize();
+  const int axis = size[0] > size[1] ? (size[0] > size[2] ? 0 : 2) : (size[1] > size[2] ? 1 : 2);
+
+  const uint32_t half = count / 2;
+  std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                   [&centroids, axis](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+
+  buildNode(first, half, order, centroids);
+  const uint32_t right = buildNode(first + half, count - half, order, centroids);
+  m_nodes[index].first = right;
+  m_nodes[index].count = 0;
+  return index;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimPicker::computeLeafBounds()
+{
+  UsdGeomBBoxCache bboxCache(m_time, m_purposes, true);
+  UsdGeomXformCache xformCache(m_time);
+  for(Leaf& leaf : m_leaves)
+  {
+    leaf.bounds = bboxCache.ComputeWorldBound(leaf.prim).ComputeAlignedRange();
+    leaf.localToStage = xformCache.GetLocalToWorldTransform(leaf.prim);
+    leaf.hasTriangles = false;
+    leaf.triangles.clear();
+  }
+  m_boundsDirty = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimPicker::refitNodes()
+{
+  // children are always stored after their parents, so a reverse pass updates the children first
+  for(size_t i = m_nodes.size(); i-- > 0; )
+  {
+    Node& node = m_nodes[i];
+    node.bounds = GfRange3d();
+    if(node.count)
+    {
+      for(uint32_t j = node.first; j < node.first + node.count; ++j)
+      {
+        node.bounds.UnionWith(m_leaves[j].bounds);
+      }
+    }
+    else
+    {
+      node.bounds.UnionWith(m_nodes[i + 1].bounds);
+      node.bounds.UnionWith(m_nodes[node.first].bounds);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void PrimPicker::setTime(UsdTimeCode time)
+{
+  if(!isValid() || (time == m_time && !m_boundsDirty))
+    return;
+
+  TF_DEBUG(ALUSDMAYA_EVALUATION).Msg("PrimPicker::setTime %f\n", time.GetValue());
+  m_time = time;
+  computeLeafBounds();
+  refitNodes();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const std::vector<GfVec3f>& PrimPicker::triangles(const Leaf& leaf) const
+{
+  if(leaf.hasTriangles)
+    return leaf.triangles;
+
+  leaf.hasTriangles = true;
+  leaf.triangles.clear();
+
+  UsdGeomMesh mesh(leaf.prim);
+  VtArray<GfVec3f> points;
+  VtIntArray faceVertexCounts;
+  VtIntArray faceVertexIndices;
+  mesh.GetPointsAttr().Get(&points, m_time);
+  mesh.GetFaceVertexCountsAttr().Get(&faceVertexCounts, m_time);
+  mesh.GetFaceVertexIndicesAttr().Get(&faceVertexIndices, m_time);
+
+  // fan triangulate the faces, skipping any that reference invalid points
+  const int numPoints = points.size();
+  const int numIndices = faceVertexIndices.size();
+  int offset = 0;
+  for(const int count : faceVertexCounts)
+  {
+    if(count < 0 || offset + count > numIndices)
+      break;
+
+    for(int i = 2; i < count; ++i)
+    {
+      const int i0 = faceVertexIndices[offset];
+      const int i1 = faceVertexIndices[offset + i - 1];
+      const int i2 = faceVertexIndices[offset + i];
+      if(i0 >= 0 && i0 < numPoints && i1 >= 0 && i1 < numPoints && i2 >= 0 && i2 < numPoints)
+      {
+        leaf.triangles.push_back(points[i0]);
+        leaf.triangles.push_back(points[i1]);
+        leaf.triangles.push_back(points[i2]);
+      }
+    }
+    offset += count;
+  }
+  return leaf.triangles;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimPicker::intersectLeaf(const Leaf& leaf, const GfRay& ray, double& distance) const
+{
+  double enter, exit;
+  if(leaf.bounds.IsEmpty() || !ray.Intersect(leaf.bounds, &enter, &exit))
+    return false;
+
+  if(!leaf.isMesh)
+  {
+    distance = std::max(enter, 0.0);
+    return true;
+  }
+
+  const std::vector<GfVec3f>& points = triangles(leaf);
+  if(points.empty())
+    return false;
+
+  // the ray direction is not normalised by the transform, so the distances remain in stage space
+  GfRay localRay(ray);
+  localRay.Transform(leaf.localToStage.GetInverse());
+
+  bool hit = false;
+  for(size_t i = 0, n = points.size(); i < n; i += 3)
+  {
+    double d;
+    if(localRay.Intersect(GfVec3d(points[i]), GfVec3d(points[i + 1]), GfVec3d(points[i + 2]), &d) && (!hit || d < distance))
+    {
+      distance = d;
+      hit = true;
+    }
+  }
+  return hit;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimPicker::intersectLeaf(const Leaf& leaf, const GfMatrix4d& stageToClip, GfVec3d& point, double& depth) const
+{
+  GfVec4d planes[6];
+  extractPlanes(stageToClip, planes);
+  const Containment containment = classifyBox(leaf.bounds, planes);
+  if(containment == kOutside)
+    return false;
+
+  if(containment == kInside || !leaf.isMesh)
+  {
+    point = leaf.bounds.GetMidpoint();
+    depth = clipDepth(stageToClip, point);
+    return true;
+  }
+
+  const std::vector<GfVec3f>& points = triangles(leaf);
+  if(points.empty())
+    return false;
+
+  // clip the triangles in the local space of the mesh
+  GfVec4d localPlanes[6];
+  extractPlanes(leaf.localToStage * stageToClip, localPlanes);
+  for(size_t i = 0, n = points.size(); i < n; i += 3)
+  {
+    GfVec3d inside;
+    if(clipTriangle(GfVec3d(points[i]), GfVec3d(points[i + 1]), GfVec3d(points[i + 2]), localPlanes, inside))
+    {
+      point = leaf.localToStage.Transform(inside);
+      depth = clipDepth(stageToClip, point);
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimPicker::pickRay(const GfRay& ray, HitVector& hits) const
+{
+  hits.clear();
+  if(m_nodes.empty())
+    return false;
+
+  const GfRay unitRay(ray.GetStartPoint(), ray.GetDirection().GetNormalized());
+
+  std::vector<uint32_t> stack(1, 0);
+  while(!stack.empty())
+  {
+    const uint32_t index = stack.back();
+    stack.pop_back();
+
+    const Node& node = m_nodes[index];
+    double enter, exit;
+    if(node.bounds.IsEmpty() || !unitRay.Intersect(node.bounds, &enter, &exit))
+      continue;
+
+    if(node.count)
+    {
+      for(uint32_t i = node.first; i < node.first + node.count; ++i)
+      {
+        double distance;
+        if(intersectLeaf(m_leaves[i], unitRay, distance))
+        {
+          hits.push_back(Hit{m_leaves[i].prim.GetPath(), unitRay.GetPoint(distance), distance});
+        }
+      }
+    }
+    else
+    {
+      stack.push_back(node.first);
+      stack.push_back(index + 1);
+    }
+  }
+
+  std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.distance < b.distance; });
+  return !hits.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool PrimPicker::pickFrustum(const GfMatrix4d& stageToClip, HitVector& hits) const
+{
+  hits.clear();
+  if(m_nodes.empty())
+    return false;
+
+  GfVec4d planes[6];
+  extractPlanes(stageToClip, planes);
+
+  std::vector<uint32_t> stack(1, 0);
+  while(!stack.empty())
+  {
+    const uint32_t index = stack.back();
+    stack.pop_back();
+
+    const Node& node = m_nodes[index];
+    if(classifyBox(node.bounds, planes) == kOutside)
+      continue;
+
+    if(node.count)
+    {
+      for(uint32_t i = node.first; i < node.first + node.count; ++i)
+      {
+        GfVec3d point;
+        double depth;
+        if(intersectLeaf(m_leaves[i], stageToClip, point, depth))
+        {
+          hits.push_back(Hit{m_leaves[i].prim.GetPath(), point, depth});
+        }
+      }
+    }
+    else
+    {
+      stack.push_back(node.first);
+      stack.push_back(index + 1);
+    }
+  }
+
+  std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.distance < b.distance; });
+  return !hits.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,152 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#pragma once
+
+#include "../../Api.h"
+
+#include <vector>
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/range3d.h"
+#include "pxr/base/gf/ray.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/usd/usd/prim.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usd/timeCode.h"
+#include "pxr/usd/sdf/path.h"
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  A CPU implementation of prim picking, which does not require an OpenGL context (so it can be used in batch
+///         mode, or from the unit tests). A bounding volume hierarchy is built from the bounds of the gprims on the
+///         stage (as computed by a UsdGeomBBoxCache), which is used to find the candidate prims for a pick. Meshes are
+///         then tested against their triangles, and all other gprims against their bounds.
+///
+///         All of the rays, matrices and returned hit points are in the space of the stage (i.e. the local space of
+///         the proxy shape).
+//----------------------------------------------------------------------------------------------------------------------
+class PrimPicker
+{
+public:
+
+  /// \brief  a prim found by a pick
+  struct Hit
+  {
+    SdfPath path;       ///< the path of the prim that was hit (which may be an instance proxy)
+    GfVec3d point;      ///< the hit point, in stage space
+    double distance;    ///< the distance along the ray for ray picks, or the normalised depth for frustum picks
+  };
+  typedef std::vector<Hit> HitVector;
+
+  /// \brief  builds the hierarchy for all of the gprims found beneath the root prim
+  /// \param  root the prim to start searching for gprims from (typically the pseudo root)
+  /// \param  time the time at which to compute the bounds
+  /// \param  purposes the purposes of the prims that can be picked
+  AL_USDMAYA_PUBLIC
+  void build(const UsdPrim& root, UsdTimeCode time, const TfTokenVector& purposes);
+
+  /// \brief  discards the hierarchy
+  AL_USDMAYA_PUBLIC
+  void clear();
+
+  /// \brief  returns true if the hierarchy has been built
+  inline bool isValid() const
+    { return !m_nodes.empty(); }
+
+  /// \brief  returns the time at which the bounds were last computed
+  inline UsdTimeCode time() const
+    { return m_time; }
+
+  /// \brief  returns the purposes the hierarchy was built with
+  inline const TfTokenVector& purposes() const
+    { return m_purposes; }
+
+  /// \brief  returns the number of gprims in the hierarchy
+  inline size_t numPrims() const
+    { return m_leaves.size(); }
+
+  /// \brief  refits the hierarchy to the bounds of the prims at the specified time. The structure of the hierarchy is
+  ///         retained, so this is much cheaper than a rebuild, however it is only valid for as long as the set of prims
+  ///         on the stage does not change.
+  /// \param  time the new time
+  AL_USDMAYA_PUBLIC
+  void setTime(UsdTimeCode time);
+
+  /// \brief  flags that the bounds or points of the prims may have been modified, so that the next call to setTime
+  ///         will refit the hierarchy, even if the time has not changed.
+  inline void invalidateBounds()
+    { m_boundsDirty = true; }
+
+  /// \brief  finds all of the prims hit by a ray
+  /// \param  ray the ray to test, in stage space
+  /// \param  hits the returned hits, sorted by distance from the start of the ray
+  /// \return true if any prims were hit
+  AL_USDMAYA_PUBLIC
+  bool pickRay(const GfRay& ray, HitVector& hits) const;
+
+  /// \brief  finds all of the prims that are within (or partially within) a frustum
+  /// \param  stageToClip the matrix that transforms from stage space into the clip space of the frustum (i.e. the
+  ///         model view projection matrix of the selection region)
+  /// \param  hits the returned hits, sorted by depth
+  /// \return true if any prims were found within the frustum
+  AL_USDMAYA_PUBLIC
+  bool pickFrustum(const GfMatrix4d& stageToClip, HitVector& hits) const;
+
+private:
+  struct Leaf
+  {
+    UsdPrim prim;
+    GfRange3d bounds;
+    GfMatrix4d localToStage;
+    bool isMesh;
+    mutable bool hasTriangles;
+    mutable std::vector<GfVec3f> triangles;
+  };
+
+  // nodes are stored depth first, so the left child of an interior node immediately follows it
+  struct Node
+  {
+    GfRange3d bounds;
+    uint32_t first;   ///< the index of the first leaf for a leaf node, or the index of the right child
+    uint32_t count;   ///< the number of leaves for a leaf node, zero for interior nodes
+  };
+
+  uint32_t buildNode(uint32_t first, uint32_t count, std::vector<uint32_t>& order, const std::vector<GfVec3d>& centroids);
+  void computeLeafBounds();
+  void refitNodes();
+  const std::vector<GfVec3f>& triangles(const Leaf& leaf) const;
+  bool intersectLeaf(const Leaf& leaf, const GfRay& ray, double& distance) const;
+  bool intersectLeaf(const Leaf& leaf, const GfMatrix4d& stageToClip, GfVec3d& point, double& depth) const;
+
+private:
+  std::vector<Node> m_nodes;
+  std::vector<Leaf> m_leaves;
+  TfTokenVector m_purposes;
+  UsdTimeCode m_time = UsdTimeCode::Default();
+  bool m_boundsDirty = false;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,221 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "AL/usdmaya/nodes/proxy/TransformPool.h"
+#include "AL/usdmaya/nodes/Transform.h"
+#include "AL/usdmaya/DebugCodes.h"
+
+#include "maya/MDagModifier.h"
+#include "maya/MFnDagNode.h"
+#include "maya/MPlug.h"
+
+#include <algorithm>
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+//----------------------------------------------------------------------------------------------------------------------
+MObject TransformPool::acquire()
+{
+  if(!m_acquired)
+  {
+    return MObject::kNullObj;
+  }
+
+  // the nodes are only removed from the pool once the batch is committed, so skip those acquired by this batch already
+  for(size_t i = m_nodes.size(); i--; )
+  {
+    const MObjectHandle& node = m_nodes[i];
+
+    // the node may have been deleted by the user since it was pooled
+    if(!node.isValid() || !node.isAlive())
+    {
+      m_nodes.erase(m_nodes.begin() + i);
+      continue;
+    }
+
+    if(std::find(m_acquired->begin(), m_acquired->end(), node) == m_acquired->end())
+    {
+      m_acquired->push_back(node);
+      TF_DEBUG(ALUSDMAYA_SELECTION).Msg("TransformPool::acquire %lu remaining\n", m_nodes.size() - m_acquired->size());
+      return node.object();
+    }
+  }
+  return MObject::kNullObj;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool TransformPool::release(const MObject& node)
+{
+  if(!m_released || node.isNull())
+  {
+    return false;
+  }
+
+  // the removed nodes are recorded even if they are not pooled, so that their parents can be pooled
+  m_removed.push_back(node);
+
+  const size_t available = m_nodes.size() - (m_acquired ? m_acquired->size() : 0);
+  if(available + m_released->size() >= m_capacity)
+  {
+    return false;
+  }
+
+  MFnDagNode fn(node);
+  if(fn.typeId() != Transform::kTypeId)
+  {
+    return false;
+  }
+
+  // a node that still has children (e.g. a node the user has parented beneath it) cannot be re-targeted
+  for(uint32_t i = 0, n = fn.childCount(); i < n; ++i)
+  {
+    if(std::find(m_removed.begin(), m_removed.end(), fn.child(i)) == m_removed.end())
+    {
+      return false;
+    }
+  }
+
+  m_released->push_back(MObjectHandle(node));
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MObject TransformPool::container()
+{
+  if(m_container.isValid() && m_container.isAlive())
+  {
+    return m_container.object();
+  }
+
+  // the container is created immediately (rather than via the modifiers of the selection), so that it is available
+  // for the nodes released by the selection. It is left in place if the selection is undone.
+  MDagModifier modifier;
+  MObject node = modifier.createNode("transform");
+  modifier.renameNode(node, "AL_usdmaya_TransformPool");
+  if(!modifier.doIt())
+  {
+    return MObject::kNullObj;
+  }
+
+  MFnDagNode fn(node);
+  fn.setDoNotWrite(true);
+  fn.findPlug("visibility").setBool(false);
+  MStatus status;
+  MPlug hiddenInOutliner = fn.findPlug("hiddenInOutliner", &status);
+  if(status)
+  {
+    hiddenInOutliner.setBool(true);
+  }
+  m_container = MObjectHandle(node);
+  return node;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformPool::add(const MObjectHandle& node)
+{
+  if(node.isValid() && node.isAlive())
+  {
+    if(std::find(m_nodes.begin(), m_nodes.end(), node) == m_nodes.end())
+    {
+      m_nodes.push_back(node);
+    }
+    MFnDependencyNode(node.object()).setDoNotWrite(true);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformPool::remove(const MObjectHandle& node)
+{
+  auto it = std::find(m_nodes.begin(), m_nodes.end(), node);
+  if(it != m_nodes.end())
+  {
+    m_nodes.erase(it);
+  }
+  if(node.isValid() && node.isAlive())
+  {
+    MFnDependencyNode(node.object()).setDoNotWrite(false);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformPool::commit(const NodeArray& acquired, const NodeArray& released)
+{
+  for(const MObjectHandle& node : acquired)
+  {
+    remove(node);
+  }
+  for(const MObjectHandle& node : released)
+  {
+    add(node);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformPool::revert(const NodeArray& acquired, const NodeArray& released)
+{
+  for(const MObjectHandle& node : released)
+  {
+    remove(node);
+  }
+  for(const MObjectHandle& node : acquired)
+  {
+    add(node);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformPool::clear(MDGModifier* modifier)
+{
+  if(modifier)
+  {
+    for(const MObjectHandle& node : m_nodes)
+    {
+      if(node.isValid() && node.isAlive())
+      {
+        modifier->deleteNode(node.object());
+      }
+    }
+    if(m_container.isValid() && m_container.isAlive())
+    {
+      modifier->deleteNode(m_container.object());
+    }
+  }
+  m_nodes.clear();
+  m_container = MObjectHandle();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void TransformPool::trim(MDGModifier& modifier)
+{
+  while(m_nodes.size() > m_capacity)
+  {
+    const MObjectHandle node = m_nodes.back();
+    m_nodes.pop_back();
+    if(node.isValid() && node.isAlive())
+    {
+      modifier.deleteNode(node.object());
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
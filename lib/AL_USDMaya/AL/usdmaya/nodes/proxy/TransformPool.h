@@ -0,0 +1,136 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#pragma once
+
+#include "../../Api.h"
+
+#include <vector>
+#include "maya/MDGModifier.h"
+#include "maya/MObject.h"
+#include "maya/MObjectHandle.h"
+
+namespace AL {
+namespace usdmaya {
+namespace nodes {
+namespace proxy {
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  A pool of AL_usdmaya_Transform nodes that have been released by the selection, and which can be re-targeted
+///         to another prim when the next selection is made (rather than deleting and re-creating the nodes).
+///
+///         Nodes are only acquired or released while a Batch is active (i.e. while a selection is being constructed).
+///         The modifications to the nodes are made via the modifiers of the selection, so the pool itself only records
+///         which nodes were acquired and released. Those records are held by the undo helper of the selection, which
+///         commits them to the pool when the selection is performed, and reverts them when it is undone.
+///
+///         The pooled nodes are disconnected from the proxy shape, have an empty prim path, and are parented under a
+///         hidden container transform (which is hidden in the outliner). The container and the pooled nodes are
+///         flagged so that they are not written to file.
+//----------------------------------------------------------------------------------------------------------------------
+class TransformPool
+{
+public:
+  typedef std::vector<MObjectHandle> NodeArray;
+
+  /// \brief  While in scope, the nodes acquired from and released to the pool are recorded in the arrays provided.
+  struct Batch
+  {
+    Batch(TransformPool& pool, NodeArray& acquired, NodeArray& released)
+      : m_pool(pool)
+    {
+      m_pool.m_acquired = &acquired;
+      m_pool.m_released = &released;
+      m_pool.m_removed.clear();
+    }
+    ~Batch()
+    {
+      m_pool.m_acquired = nullptr;
+      m_pool.m_released = nullptr;
+      m_pool.m_removed.clear();
+    }
+  private:
+    TransformPool& m_pool;
+  };
+
+  /// \brief  sets the maximum number of nodes the pool will retain. A capacity of zero disables the pool.
+  inline void setCapacity(uint32_t capacity)
+    { m_capacity = capacity; }
+
+  /// \brief  returns the maximum number of nodes the pool will retain
+  inline uint32_t capacity() const
+    { return m_capacity; }
+
+  /// \brief  returns the number of nodes currently in the pool
+  inline size_t size() const
+    { return m_nodes.size(); }
+
+  /// \brief  takes a node from the pool. The caller is responsible for parenting, renaming, and showing the node, and
+  ///         setting its prim path. The node stays in the pool until the batch is committed, so it is not lost if the
+  ///         selection is never performed.
+  /// \return the node, or a null object if the pool is empty or no batch is active
+  AL_USDMAYA_PUBLIC
+  MObject acquire();
+
+  /// \brief  offers a node that is no longer needed to the pool. This must be called for all of the nodes removed in
+  ///         a batch (including those that are subsequently deleted), so that a parent is only pooled once all of its
+  ///         children have been removed.
+  /// \param  node the node being removed (children must be removed before their parents)
+  /// \return true if the node will be pooled, in which case the caller should detach and hide it. If false, the
+  ///         caller should delete the node.
+  AL_USDMAYA_PUBLIC
+  bool release(const MObject& node);
+
+  /// \brief  returns the transform that the pooled nodes are parented under, creating it if it does not exist
+  AL_USDMAYA_PUBLIC
+  MObject container();
+
+  /// \brief  applies the nodes acquired and released by a batch, once the modifications to the nodes have been made
+  AL_USDMAYA_PUBLIC
+  void commit(const NodeArray& acquired, const NodeArray& released);
+
+  /// \brief  reverses the nodes acquired and released by a batch, once the modifications to the nodes have been undone
+  AL_USDMAYA_PUBLIC
+  void revert(const NodeArray& acquired, const NodeArray& released);
+
+  /// \brief  empties the pool
+  /// \param  modifier if specified, the pooled nodes (and their container) will be deleted via this modifier
+  AL_USDMAYA_PUBLIC
+  void clear(MDGModifier* modifier = 0);
+
+  /// \brief  removes the nodes in excess of the capacity of the pool (e.g. after the capacity has been reduced)
+  /// \param  modifier the excess nodes will be deleted via this modifier
+  AL_USDMAYA_PUBLIC
+  void trim(MDGModifier& modifier);
+
+private:
+  void add(const MObjectHandle& node);
+  void remove(const MObjectHandle& node);
+
+private:
+  NodeArray m_nodes;
+  NodeArray* m_acquired = nullptr;
+  NodeArray* m_released = nullptr;
+  std::vector<MObject> m_removed;
+  MObjectHandle m_container;
+  uint32_t m_capacity = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+} // proxy
+} // nodes
+} // usdmaya
+} // AL
+//----------------------------------------------------------------------------------------------------------------------
@@ -385,11 +385,25 @@ void wrapProxyShape()
       .value("kRequired", ProxyShape::kRequired)
   ;
 
+  boost::python::enum_<ProxyShape::StageLoadState>("StageLoadState")
+      .value("kStageUnloaded", ProxyShape::kStageUnloaded)
+      .value("kStageLoading", ProxyShape::kStageLoading)
+      .value("kStageLoaded", ProxyShape::kStageLoaded)
+      .value("kStageLoadFailed", ProxyShape::kStageLoadFailed)
+  ;
+
   proxyShapeCls
     .def("getByName", PyProxyShape::getProxyShapeByName,
         boost::python::return_value_policy<reference_existing_object>())
         .staticmethod("getByName")
     .def("getUsdStage", &ProxyShape::getUsdStage)
+    .def("stageLoadState", &ProxyShape::stageLoadState)
+    .def("isStageLoading", &ProxyShape::isStageLoading)
+    .def("stageLoadProgress", &ProxyShape::stageLoadProgress)
+    .def("waitForStage", &ProxyShape::waitForStage)
+    .def("primsVisited", &ProxyShape::primsVisited)
+    .def("processChangedObjects", &ProxyShape::processChangedObjects)
+    .def("hasChangedObjects", &ProxyShape::hasChangedObjects)
     .def("resync", &ProxyShape::resync,
          (boost::python::arg("path")))
     .def("boundingBox", PyProxyShape::boundingBox)
@@ -16,6 +16,7 @@
 
 //#include "AL/maya/utils/Utils.h"
 #include "AL/maya/utils/MObjectMap.h"
+#include "maya/MGlobal.h"
 #include <gtest/gtest.h>
 
 using namespace AL;
@@ -77,3 +78,48 @@ TEST(extraMaya_Utils, guid_compare)
 #endif
 }
 
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  Test the lookup of values from dependency nodes
+//----------------------------------------------------------------------------------------------------------------------
+TEST(extraMaya_Utils, MObjectValueMap)
+{
+  MFnDependencyNode fnA, fnB;
+  fnA.create("transform");
+  fnB.create("transform");
+
+  MObjectValueMap<int> nodeMap;
+  EXPECT_EQ(nullptr, nodeMap.find(fnA));
+
+  nodeMap.insert(fnA, 1);
+  nodeMap.insert(fnB, 2);
+  EXPECT_EQ(2u, nodeMap.size());
+  ASSERT_NE(nullptr, nodeMap.find(fnA));
+  EXPECT_EQ(1, *nodeMap.find(fnA));
+  ASSERT_NE(nullptr, nodeMap.find(fnB));
+  EXPECT_EQ(2, *nodeMap.find(fnB));
+
+  // inserting an existing node replaces the value
+  nodeMap.insert(fnA, 3);
+  EXPECT_EQ(2u, nodeMap.size());
+  EXPECT_EQ(3, *nodeMap.find(fnA));
+
+  EXPECT_TRUE(nodeMap.erase(fnA));
+  EXPECT_FALSE(nodeMap.erase(fnA));
+  EXPECT_EQ(nullptr, nodeMap.find(fnA));
+  EXPECT_EQ(1u, nodeMap.size());
+
+  // a node can also be found (and removed) by its uuid, which remains usable once the node has been deleted
+  guid uuidB;
+  fnB.uuid().get(uuidB.uuid);
+  ASSERT_NE(nullptr, nodeMap.find(uuidB));
+  EXPECT_EQ(2, *nodeMap.find(uuidB));
+  MGlobal::deleteNode(fnB.object());
+  EXPECT_TRUE(nodeMap.erase(uuidB));
+  EXPECT_EQ(0u, nodeMap.size());
+
+  nodeMap.insert(uuidB, 4);
+  EXPECT_EQ(4, *nodeMap.find(uuidB));
+  nodeMap.clear();
+  EXPECT_EQ(0u, nodeMap.size());
+}
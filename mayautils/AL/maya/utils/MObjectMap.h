@@ -143,6 +143,111 @@ private:
   std::map<guid, MObject, guid_compare> m_nodeMap;
   #endif
 };
+
+//----------------------------------------------------------------------------------------------------------------------
+/// \brief  A class that acts as a lookup table from dependency nodes to some value associated with them. In the same way
+///         as the MObjectMap, the entries are sorted based on the uuid of each node.
+/// \ingroup usdmaya
+//----------------------------------------------------------------------------------------------------------------------
+template<typename T>
+struct MObjectValueMap
+{
+  /// \brief  insert a node into the map, replacing any value previously associated with the node.
+  /// \param  fn the function set attached to the node to insert
+  /// \param  value the value to associate with the node
+  inline void insert(const MFnDependencyNode& fn, const T& value)
+  {
+    m_nodeMap[key(fn)] = value;
+  }
+
+  /// \brief  returns the value associated with the dependency node
+  /// \param  fn the function set attached to the node to find in the map
+  /// \return a pointer to the value, or null if the node is not in the map
+  inline const T* find(const MFnDependencyNode& fn) const
+  {
+    auto it = m_nodeMap.find(key(fn));
+    return it != m_nodeMap.end() ? &it->second : nullptr;
+  }
+
+  /// \brief  removes the dependency node from the map
+  /// \param  fn the function set attached to the node to remove
+  /// \return true if the node was found and removed
+  inline bool erase(const MFnDependencyNode& fn)
+  {
+    return m_nodeMap.erase(key(fn)) != 0;
+  }
+
+  /// \brief  insert a node into the map by its uuid, replacing any value previously associated with the node.
+  /// \param  uuid the uuid of the node to insert
+  /// \param  value the value to associate with the node
+  inline void insert(const guid& uuid, const T& value)
+  {
+    m_nodeMap[key(uuid)] = value;
+  }
+
+  /// \brief  returns the value associated with the uuid of a dependency node
+  /// \param  uuid the uuid of the node to find in the map
+  /// \return a pointer to the value, or null if the node is not in the map
+  inline const T* find(const guid& uuid) const
+  {
+    auto it = m_nodeMap.find(key(uuid));
+    return it != m_nodeMap.end() ? &it->second : nullptr;
+  }
+
+  /// \brief  removes a node from the map by its uuid. Unlike erase(fn), this works once the node has been deleted (when
+  ///         a function set can no longer be attached to it), as long as its uuid was stored when it was inserted.
+  /// \param  uuid the uuid of the node to remove
+  /// \return true if the node was found and removed
+  inline bool erase(const guid& uuid)
+  {
+    return m_nodeMap.erase(key(uuid)) != 0;
+  }
+
+  /// \brief  removes all nodes from the map
+  inline void clear()
+    { m_nodeMap.clear(); }
+
+  /// \brief  returns the number of nodes in the map
+  inline size_t size() const
+    { return m_nodeMap.size(); }
+
+private:
+  #if AL_UTILS_ENABLE_SIMD
+  static inline i128 key(const MFnDependencyNode& fn)
+  {
+    union
+    {
+      __m128i sse;
+      guid uuid;
+    };
+    fn.uuid().get(uuid.uuid);
+    return sse;
+  }
+  static inline i128 key(const guid& value)
+  {
+    union
+    {
+      __m128i sse;
+      guid uuid;
+    };
+    uuid = value;
+    return sse;
+  }
+  std::map<i128, T, guid_compare> m_nodeMap;
+  #else
+  static inline guid key(const MFnDependencyNode& fn)
+  {
+    guid uuid;
+    fn.uuid().get(uuid.uuid);
+    return uuid;
+  }
+  static inline const guid& key(const guid& uuid)
+  {
+    return uuid;
+  }
+  std::map<guid, T, guid_compare> m_nodeMap;
+  #endif
+};
 //----------------------------------------------------------------------------------------------------------------------
 } // utils
 } // maya
@@ -15,11 +15,17 @@
 //
 
 #include "AL/maya/utils/Utils.h"
+#include "AL/usdmaya/nodes/ProxyShape.h"
 #include "test_usdmaya.h"
 #include "maya/MGlobal.h"
 #include "maya/MFileIO.h"
 #include "maya/MFnDagNode.h"
 
+#include "pxr/usd/kind/registry.h"
+#include "pxr/usd/usd/modelAPI.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/modelAPI.h"
+
 TEST(ExportCommands, exportUV)
 {
   MFileIO::newFile(true);
@@ -109,3 +115,69 @@ TEST(ExportCommands, extensiveAnimationCheck)
   MGlobal::executeCommand(exportCmd, true);
   expectAnimation(false);
 }
+
+TEST(ExportCommands, extentsHints)
+{
+  MFileIO::newFile(true);
+  MGlobal::executeCommand(MString("createNode transform -n geo;polyCube -n cube;parent cube geo;select geo;"), false, true);
+
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_extentsHints.usda");
+  MString exportCmd;
+
+  // the hints are only authored when requested
+  exportCmd.format(MString("AL_usdmaya_ExportCommand -f \"^1s\" -sl 1"), AL::maya::utils::convert(temp_path));
+  MGlobal::executeCommand(exportCmd, true);
+  {
+    UsdStageRefPtr stage = UsdStage::Open(temp_path);
+    ASSERT_TRUE(stage);
+    UsdPrim prim = stage->GetPrimAtPath(SdfPath("/geo"));
+    ASSERT_TRUE(prim.IsValid());
+    EXPECT_FALSE(UsdGeomModelAPI(prim).GetExtentsHintAttr().HasAuthoredValueOpinion());
+  }
+
+  // as there are no models in the scene, the root prim is exported as a component so that its hint is used
+  exportCmd.format(MString("AL_usdmaya_ExportCommand -f \"^1s\" -sl 1 -eh 1"), AL::maya::utils::convert(temp_path));
+  MGlobal::executeCommand(exportCmd, true);
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  UsdStageRefPtr stage = proxy->getUsdStage();
+  ASSERT_TRUE(stage);
+
+  UsdPrim prim = stage->GetPrimAtPath(SdfPath("/geo"));
+  ASSERT_TRUE(prim.IsValid());
+  TfToken kind;
+  EXPECT_TRUE(UsdModelAPI(prim).GetKind(&kind));
+  EXPECT_EQ(KindTokens->component, kind);
+
+  MBoundingBox bounds = proxy->boundingBox();
+  EXPECT_NEAR(-0.5, bounds.min().x, 1e-5);
+  EXPECT_NEAR(0.5, bounds.max().x, 1e-5);
+
+  // once the cube is scaled, the proxy continues to use the exported hint rather than the bounds of the cube
+  UsdGeomMesh mesh(stage->GetPrimAtPath(SdfPath("/geo/cube")));
+  ASSERT_TRUE(mesh);
+  VtVec3fArray points;
+  mesh.GetPointsAttr().Get(&points);
+  for(GfVec3f& point : points)
+  {
+    point *= 10.0f;
+  }
+  mesh.GetPointsAttr().Set(points);
+  VtVec3fArray extent(2);
+  extent[0] = GfVec3f(-5.0f);
+  extent[1] = GfVec3f(5.0f);
+  mesh.CreateExtentAttr().Set(extent);
+
+  bounds = proxy->boundingBox();
+  EXPECT_NEAR(-0.5, bounds.min().x, 1e-5);
+  EXPECT_NEAR(0.5, bounds.max().x, 1e-5);
+
+  proxy->useExtentsHintPlug().setBool(false);
+  bounds = proxy->boundingBox();
+  EXPECT_NEAR(-5.0, bounds.min().x, 1e-5);
+  EXPECT_NEAR(5.0, bounds.max().x, 1e-5);
+}
@@ -15,6 +15,7 @@
 //
 #include "test_usdmaya.h"
 
+#include "AL/usdmaya/cmds/ProxyShapeCommands.h"
 #include "AL/usdmaya/nodes/ProxyShape.h"
 #include "AL/usdmaya/nodes/Transform.h"
 #include "maya/MFnTransform.h"
@@ -900,3 +901,190 @@ TEST(ProxyShapeSelect, repeatedSelection)
   MGlobal::executeCommand("undo", false, true);
   { SCOPED_TRACE(""); assertNothingSelected(proxy); }
 }
+
+// MStatus ProxyShapeSelect::select(nodes::ProxyShape* proxy, const SdfPathVector& paths, MGlobal::ListAdjustment mode, bool internal, Execution execution)
+TEST(ProxyShapeSelect, selectFromCpp)
+{
+  MFileIO::newFile(true);
+  MGlobal::executeCommand("undoInfo -state 1;");
+
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_selectFromCpp.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+
+  MGlobal::executeCommand("select -cl;");
+  const SdfPathVector paths = { SdfPath("/root/hip1"), SdfPath("/root/hip2") };
+  EXPECT_TRUE(AL::usdmaya::cmds::ProxyShapeSelect::select(proxy, paths, MGlobal::kReplaceList));
+  EXPECT_EQ(2u, proxy->selectedPaths().size());
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip2")));
+
+  MSelectionList sl;
+  MGlobal::getActiveSelectionList(sl);
+  EXPECT_EQ(2u, sl.length());
+
+  // the selection should be undoable in the same way as the command
+  MGlobal::executeCommand("undo", false, true);
+  EXPECT_EQ(0u, proxy->selectedPaths().size());
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+
+  MGlobal::executeCommand("redo", false, true);
+  EXPECT_EQ(2u, proxy->selectedPaths().size());
+
+  EXPECT_TRUE(AL::usdmaya::cmds::ProxyShapeSelect::select(proxy, { SdfPath("/root/hip1") }, MGlobal::kRemoveFromList));
+  EXPECT_EQ(1u, proxy->selectedPaths().size());
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip2")));
+
+  // passing no paths with kReplaceList clears the selection
+  EXPECT_TRUE(AL::usdmaya::cmds::ProxyShapeSelect::select(proxy, SdfPathVector(), MGlobal::kReplaceList));
+  EXPECT_EQ(0u, proxy->selectedPaths().size());
+}
+
+// MStatus ProxyShapeSelect::modifySelection(nodes::ProxyShape* proxy, const SdfPathVector& selectPaths, const SdfPathVector& deselectPaths, bool internal, Execution execution)
+TEST(ProxyShapeSelect, modifySelectionFromCpp)
+{
+  MFileIO::newFile(true);
+  MGlobal::executeCommand("undoInfo -state 1;");
+
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_modifySelectionFromCpp.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+
+  MGlobal::executeCommand("select -cl;");
+  EXPECT_TRUE(AL::usdmaya::cmds::ProxyShapeSelect::select(proxy, { SdfPath("/root/hip1") }, MGlobal::kReplaceList));
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip1")));
+
+  // selecting hip2 and deselecting hip1 should be a single entry in the undo queue
+  EXPECT_TRUE(AL::usdmaya::cmds::ProxyShapeSelect::modifySelection(proxy, { SdfPath("/root/hip2") }, { SdfPath("/root/hip1") }));
+  EXPECT_EQ(1u, proxy->selectedPaths().size());
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip2")));
+
+  MGlobal::executeCommand("undo", false, true);
+  EXPECT_EQ(1u, proxy->selectedPaths().size());
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip1")));
+
+  MGlobal::executeCommand("redo", false, true);
+  EXPECT_EQ(1u, proxy->selectedPaths().size());
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip2")));
+
+  // the same selection can still be made from MEL, by passing the paths as arguments of the command
+  MGlobal::executeCommand("AL_usdmaya_ProxyShapeSelect -a -pp \"/root/hip1\" -dp \"/root/hip2\" \"AL_usdmaya_ProxyShape1\"", false, true);
+  EXPECT_EQ(1u, proxy->selectedPaths().size());
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip1")));
+
+  // the paths handed over from C++ are consumed by the command, so repeating the command (which only refers to them)
+  // should fail, rather than make the selection again.
+  EXPECT_FALSE(MGlobal::executeCommand("AL_usdmaya_ProxyShapeSelect -pnd 0 \"AL_usdmaya_ProxyShape1\"", false, false));
+  EXPECT_EQ(1u, proxy->selectedPaths().size());
+  EXPECT_EQ(1u, proxy->selectedPaths().count(SdfPath("/root/hip1")));
+}
+
+// Make sure the transforms released by one selection are reused by the next when the transform pool is enabled
+TEST(ProxyShapeSelect, transformPool)
+{
+  MFileIO::newFile(true);
+  // unsure undo is enabled for this test
+  MGlobal::executeCommand("undoInfo -state 1;");
+
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_transformPool.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  auto countTransforms = [] ()
+  {
+    uint32_t count = 0;
+    for(MItDependencyNodes it(MFn::kPluginTransformNode); !it.isDone(); it.next())
+    {
+      ++count;
+    }
+    return count;
+  };
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  proxy->transformPoolSizePlug().setInt(4);
+
+  MGlobal::executeCommand("select -cl;");
+  MGlobal::executeCommand("AL_usdmaya_ProxyShapeSelect -r -pp \"/root/hip1\" \"AL_usdmaya_ProxyShape1\"", false, true);
+  const MObject hip1 = proxy->findRequiredPath(SdfPath("/root/hip1"));
+  EXPECT_FALSE(hip1.isNull());
+  EXPECT_EQ(2u, countTransforms());
+
+  // the transform for hip1 is released to the pool, rather than deleted
+  MGlobal::executeCommand("AL_usdmaya_ProxyShapeSelect -r -pp \"/root/hip2\" \"AL_usdmaya_ProxyShape1\"", false, true);
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip2")));
+  EXPECT_EQ(3u, countTransforms());
+  EXPECT_EQ(MString(""), MFnDependencyNode(hip1).findPlug("primPath").asString());
+
+  // the pooled node is kept out of sight, and no longer evaluated by the proxy shape
+  {
+    MFnDagNode fnHip(hip1);
+    MFnDagNode fnContainer(fnHip.parent(0));
+    EXPECT_TRUE(fnContainer.name() == "AL_usdmaya_TransformPool");
+    EXPECT_TRUE(fnContainer.findPlug("hiddenInOutliner").asBool());
+    EXPECT_FALSE(fnHip.findPlug("inStageData").isConnected());
+    EXPECT_FALSE(fnHip.findPlug("time").isConnected());
+    EXPECT_FALSE(fnHip.findPlug("translate").isLocked());
+  }
+
+  // and is re-targeted when hip1 is selected again
+  MGlobal::executeCommand("AL_usdmaya_ProxyShapeSelect -r -pp \"/root/hip1\" \"AL_usdmaya_ProxyShape1\"", false, true);
+  EXPECT_TRUE(proxy->findRequiredPath(SdfPath("/root/hip1")) == hip1);
+  EXPECT_EQ(MString("/root/hip1"), MFnDependencyNode(hip1).findPlug("primPath").asString());
+  EXPECT_EQ(3u, countTransforms());
+  {
+    MFnDagNode fnHip(hip1);
+    EXPECT_EQ(MString("hip1"), fnHip.name());
+    EXPECT_TRUE(fnHip.parent(0) == proxy->findRequiredPath(SdfPath("/root")));
+    EXPECT_TRUE(fnHip.findPlug("inStageData").isConnected());
+    EXPECT_TRUE(fnHip.findPlug("time").isConnected());
+  }
+
+  // undo should return the node to the pool
+  MGlobal::executeCommand("undo", false, true);
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip2")));
+  EXPECT_EQ(MString(""), MFnDependencyNode(hip1).findPlug("primPath").asString());
+  MGlobal::executeCommand("redo", false, true);
+  EXPECT_TRUE(proxy->findRequiredPath(SdfPath("/root/hip1")) == hip1);
+
+  // shrinking the pool deletes the pooled node for hip2
+  proxy->transformPoolSizePlug().setInt(0);
+  EXPECT_EQ(2u, countTransforms());
+
+  // and with the pool disabled, the nodes are deleted
+  MGlobal::executeCommand("AL_usdmaya_ProxyShapeSelect -cl \"AL_usdmaya_ProxyShape1\"", false, true);
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root")));
+  EXPECT_EQ(0u, countTransforms());
+}
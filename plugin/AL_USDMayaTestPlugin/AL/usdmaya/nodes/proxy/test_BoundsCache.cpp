@@ -0,0 +1,297 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "test_usdmaya.h"
+#include "AL/usdmaya/nodes/proxy/BoundsCache.h"
+
+#include "pxr/usd/kind/registry.h"
+#include "pxr/usd/sdf/attributeSpec.h"
+#include "pxr/usd/sdf/primSpec.h"
+#include "pxr/usd/usd/clipsAPI.h"
+#include "pxr/usd/usd/modelAPI.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/cube.h"
+#include "pxr/usd/usdGeom/modelAPI.h"
+#include "pxr/usd/usdGeom/primvarsAPI.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xform.h"
+#include "pxr/usd/usdGeom/xformCommonAPI.h"
+#include "pxr/base/tf/stringUtils.h"
+
+using AL::usdmaya::nodes::proxy::BoundsCache;
+
+namespace {
+UsdGeomCube defineCube(UsdStageRefPtr stage, const SdfPath& path, const GfVec3d& position)
+{
+  UsdGeomCube cube = UsdGeomCube::Define(stage, path);
+  VtArray<GfVec3f> extent(2);
+  extent[0] = GfVec3f(-1.0f);
+  extent[1] = GfVec3f(1.0f);
+  cube.CreateExtentAttr().Set(extent);
+  UsdGeomXformCommonAPI(cube).SetTranslate(position);
+  return cube;
+}
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that a single entry is cached for a stage without any time varying extents
+//----------------------------------------------------------------------------------------------------------------------
+TEST(BoundsCache, staticStage)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomCube cube = defineCube(stage, SdfPath("/A"), GfVec3d(5.0, 0.0, 0.0));
+  EXPECT_FALSE(BoundsCache::hasTimeVaryingExtents(stage));
+
+  // animated primvars do not affect the bounds
+  UsdGeomPrimvar primvar = UsdGeomPrimvarsAPI(cube).CreatePrimvar(TfToken("weight"), SdfValueTypeNames->Float);
+  primvar.Set(1.0f, UsdTimeCode(1.0));
+  primvar.Set(2.0f, UsdTimeCode(2.0));
+  EXPECT_FALSE(BoundsCache::hasTimeVaryingExtents(stage));
+
+  BoundsCache cache;
+  for(double time = 1.0; time <= 10.0; time += 1.0)
+  {
+    const GfRange3d bounds = cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(time), 0);
+    EXPECT_EQ(GfRange3d(GfVec3d(4.0, -1.0, -1.0), GfVec3d(6.0, 1.0, 1.0)), bounds);
+  }
+  EXPECT_TRUE(cache.isStatic());
+  EXPECT_EQ(1u, cache.size());
+
+  // the cache is only rebuilt when cleared
+  UsdGeomXformCommonAPI(cube).SetTranslate(GfVec3d(0.0));
+  EXPECT_EQ(GfRange3d(GfVec3d(4.0, -1.0, -1.0), GfVec3d(6.0, 1.0, 1.0)), cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(1.0), 0));
+  cache.clear();
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(GfRange3d(GfVec3d(-1.0), GfVec3d(1.0)), cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(1.0), 0));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that the bounds of an animated stage are cached per time code, up to the maximum number of entries
+//----------------------------------------------------------------------------------------------------------------------
+TEST(BoundsCache, animatedStage)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomCube cube = defineCube(stage, SdfPath("/A"), GfVec3d(0.0));
+  UsdGeomXformCommonAPI(cube).SetTranslate(GfVec3d(0.0), UsdTimeCode(0.0));
+  UsdGeomXformCommonAPI(cube).SetTranslate(GfVec3d(10.0, 0.0, 0.0), UsdTimeCode(10.0));
+  EXPECT_TRUE(BoundsCache::hasTimeVaryingExtents(stage));
+
+  BoundsCache cache(4);
+  EXPECT_EQ(4u, cache.maxEntries());
+  for(int time = 0; time <= 10; ++time)
+  {
+    const GfRange3d bounds = cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(time), 0);
+    EXPECT_NEAR(time - 1.0, bounds.GetMin()[0], 1e-5);
+    EXPECT_NEAR(time + 1.0, bounds.GetMax()[0], 1e-5);
+    EXPECT_LE(cache.size(), 4u);
+  }
+  EXPECT_FALSE(cache.isStatic());
+  EXPECT_EQ(4u, cache.size());
+
+  // revisiting a cached frame does not add an entry
+  cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(9.0), 0);
+  EXPECT_EQ(4u, cache.size());
+
+  cache.setMaxEntries(2);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_NEAR(4.0, cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(5.0), 0).GetMin()[0], 1e-5);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that prims whose values come from value clips are treated as time varying
+//----------------------------------------------------------------------------------------------------------------------
+TEST(BoundsCache, valueClips)
+{
+  // the extent of the cube grows over the frames of the clip
+  SdfLayerRefPtr clipLayer = SdfLayer::CreateAnonymous(".usda");
+  SdfPrimSpecHandle primSpec = SdfCreatePrimInLayer(clipLayer, SdfPath("/A"));
+  SdfAttributeSpecHandle extentSpec = SdfAttributeSpec::New(primSpec, UsdGeomTokens->extent.GetString(), SdfValueTypeNames->Float3Array);
+  for(int time = 0; time <= 10; time += 10)
+  {
+    VtArray<GfVec3f> extent(2);
+    extent[0] = GfVec3f(-1.0f - time);
+    extent[1] = GfVec3f(1.0f + time);
+    clipLayer->SetTimeSample(extentSpec->GetPath(), time, extent);
+  }
+
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomCube cube = UsdGeomCube::Define(stage, SdfPath("/A"));
+  UsdClipsAPI clips(cube.GetPrim());
+  VtArray<SdfAssetPath> assetPaths(1, SdfAssetPath(clipLayer->GetIdentifier()));
+  clips.SetClipAssetPaths(assetPaths);
+  clips.SetClipPrimPath("/A");
+  clips.SetClipActive(VtVec2dArray(1, GfVec2d(0.0, 0.0)));
+  VtVec2dArray clipTimes(2);
+  clipTimes[0] = GfVec2d(0.0, 0.0);
+  clipTimes[1] = GfVec2d(10.0, 10.0);
+  clips.SetClipTimes(clipTimes);
+
+  // none of the layers used by the stage have time samples until the values of the clip have been read
+  EXPECT_TRUE(BoundsCache::hasTimeVaryingExtents(stage));
+
+  BoundsCache cache;
+  EXPECT_NEAR(-1.0, cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(0.0), 0).GetMin()[0], 1e-5);
+  EXPECT_NEAR(-11.0, cache.bounds(stage->GetPseudoRoot(), UsdTimeCode(10.0), 0).GetMin()[0], 1e-5);
+  EXPECT_FALSE(cache.isStatic());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that the guide and render purposes are only included in the bounds when requested
+//----------------------------------------------------------------------------------------------------------------------
+TEST(BoundsCache, purposes)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  defineCube(stage, SdfPath("/A"), GfVec3d(0.0));
+  UsdGeomCube guide = defineCube(stage, SdfPath("/B"), GfVec3d(10.0, 0.0, 0.0));
+  guide.CreatePurposeAttr().Set(UsdGeomTokens->guide);
+  UsdGeomCube render = defineCube(stage, SdfPath("/C"), GfVec3d(-10.0, 0.0, 0.0));
+  render.CreatePurposeAttr().Set(UsdGeomTokens->render);
+
+  BoundsCache cache;
+  const UsdPrim root = stage->GetPseudoRoot();
+  EXPECT_EQ(GfRange3d(GfVec3d(-1.0), GfVec3d(1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+  EXPECT_EQ(GfRange3d(GfVec3d(-1.0), GfVec3d(11.0, 1.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), BoundsCache::kGuidePurpose));
+  EXPECT_EQ(GfRange3d(GfVec3d(-11.0, -1.0, -1.0), GfVec3d(1.0)), cache.bounds(root, UsdTimeCode(1.0), BoundsCache::kRenderPurpose));
+  EXPECT_EQ(GfRange3d(GfVec3d(-11.0, -1.0, -1.0), GfVec3d(11.0, 1.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), BoundsCache::kAllPurposes));
+  EXPECT_EQ(4u, cache.size());
+
+  // the cache is cleared when the bounds of another prim are requested
+  EXPECT_EQ(GfRange3d(GfVec3d(9.0, -1.0, -1.0), GfVec3d(11.0, 1.0, 1.0)), cache.bounds(guide.GetPrim(), UsdTimeCode(1.0), BoundsCache::kGuidePurpose));
+  EXPECT_EQ(1u, cache.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that only the modified subtrees are recomputed after a prim has been invalidated
+//----------------------------------------------------------------------------------------------------------------------
+TEST(BoundsCache, incremental)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform::Define(stage, SdfPath("/root"));
+  for(int i = 0; i < 4; ++i)
+  {
+    const SdfPath groupPath = SdfPath("/root").AppendChild(TfToken(TfStringPrintf("group%d", i)));
+    UsdGeomXform::Define(stage, groupPath);
+    for(int j = 0; j < 4; ++j)
+    {
+      defineCube(stage, groupPath.AppendChild(TfToken(TfStringPrintf("cube%d", j))), GfVec3d(i * 10.0, j * 10.0, 0.0));
+    }
+  }
+
+  for(const bool parallel : { false, true })
+  {
+    BoundsCache cache;
+    cache.setParallel(parallel);
+    EXPECT_EQ(parallel, cache.parallel());
+    const UsdPrim root = stage->GetPseudoRoot();
+    EXPECT_EQ(GfRange3d(GfVec3d(-1.0, -1.0, -1.0), GfVec3d(31.0, 31.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+    EXPECT_EQ(16u, cache.numLeavesComputed());
+    EXPECT_EQ(6u, cache.numNodes());
+
+    // moving a single cube only recomputes that cube
+    const SdfPath cubePath("/root/group3/cube3");
+    UsdGeomXformCommonAPI(stage->GetPrimAtPath(cubePath)).SetTranslate(GfVec3d(50.0, 30.0, 0.0));
+    cache.invalidate(cubePath.AppendProperty(TfToken("xformOp:translate")), false);
+    EXPECT_EQ(GfRange3d(GfVec3d(-1.0, -1.0, -1.0), GfVec3d(51.0, 31.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+    EXPECT_EQ(1u, cache.numLeavesComputed());
+
+    // moving a group does not recompute any of the cubes
+    const SdfPath groupPath("/root/group0");
+    UsdGeomXformCommonAPI(stage->GetPrimAtPath(groupPath)).SetTranslate(GfVec3d(-10.0, 0.0, 0.0));
+    cache.invalidate(groupPath.AppendProperty(TfToken("xformOp:translate")), false);
+    EXPECT_EQ(GfRange3d(GfVec3d(-11.0, -1.0, -1.0), GfVec3d(51.0, 31.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+    EXPECT_EQ(0u, cache.numLeavesComputed());
+
+    // a batch of changes only recomputes the modified cubes
+    const SdfPath batchPaths[] = { SdfPath("/root/group1/cube0"), SdfPath("/root/group2/cube0") };
+    for(const double z : { 5.0, 0.0 })
+    {
+      SdfPathVector changedPaths;
+      for(const SdfPath& path : batchPaths)
+      {
+        UsdGeomXformCommonAPI(stage->GetPrimAtPath(path)).SetTranslate(GfVec3d(path == batchPaths[0] ? 10.0 : 20.0, 0.0, z));
+        changedPaths.push_back(path.AppendProperty(TfToken("xformOp:translate")));
+      }
+      cache.invalidate(SdfPathVector(), changedPaths);
+      EXPECT_EQ(GfRange3d(GfVec3d(-11.0, -1.0, -1.0), GfVec3d(51.0, 31.0, z + 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+      EXPECT_EQ(2u, cache.numLeavesComputed());
+    }
+
+    // adding a prim finds the children of the group again
+    const SdfPath addedPath("/root/group1/added");
+    defineCube(stage, addedPath, GfVec3d(10.0, 0.0, 100.0));
+    cache.invalidate(addedPath, true);
+    EXPECT_EQ(GfRange3d(GfVec3d(-11.0, -1.0, -1.0), GfVec3d(51.0, 31.0, 101.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+    EXPECT_EQ(1u, cache.numLeavesComputed());
+
+    // as does removing one
+    stage->RemovePrim(addedPath);
+    cache.invalidate(addedPath, true);
+    EXPECT_EQ(GfRange3d(GfVec3d(-11.0, -1.0, -1.0), GfVec3d(51.0, 31.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+    EXPECT_EQ(0u, cache.numLeavesComputed());
+
+    // removing a group discards its node
+    stage->RemovePrim(groupPath);
+    cache.invalidate(groupPath, true);
+    EXPECT_EQ(GfRange3d(GfVec3d(9.0, -1.0, -1.0), GfVec3d(51.0, 31.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+    EXPECT_EQ(5u, cache.numNodes());
+
+    // restore the stage for the next pass
+    UsdGeomXform::Define(stage, groupPath);
+    for(int j = 0; j < 4; ++j)
+    {
+      defineCube(stage, groupPath.AppendChild(TfToken(TfStringPrintf("cube%d", j))), GfVec3d(0.0, j * 10.0, 0.0));
+    }
+    UsdGeomXformCommonAPI(stage->GetPrimAtPath(cubePath)).SetTranslate(GfVec3d(30.0, 30.0, 0.0));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that the extentsHint of a model is used in place of the bounds of its descendants
+//----------------------------------------------------------------------------------------------------------------------
+TEST(BoundsCache, extentsHint)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform model = UsdGeomXform::Define(stage, SdfPath("/model"));
+  UsdGeomXformCommonAPI(model).SetTranslate(GfVec3d(10.0, 0.0, 0.0));
+  defineCube(stage, SdfPath("/model/cube"), GfVec3d(0.0));
+
+  BoundsCache cache;
+  const UsdPrim root = stage->GetPseudoRoot();
+  EXPECT_TRUE(cache.useExtentsHint());
+  EXPECT_EQ(GfRange3d(GfVec3d(9.0, -1.0, -1.0), GfVec3d(11.0, 1.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+  EXPECT_EQ(2u, cache.numNodes());
+
+  // the hint (which only needs to contain the default purpose) replaces the bounds of the cube
+  VtVec3fArray hint(2);
+  hint[0] = GfVec3f(-5.0f);
+  hint[1] = GfVec3f(5.0f);
+  UsdGeomModelAPI(model).SetExtentsHint(hint);
+  cache.invalidate(model.GetPath().AppendProperty(UsdGeomTokens->extentsHint), false);
+
+  // the hint is ignored until the prim is a model
+  EXPECT_EQ(GfRange3d(GfVec3d(9.0, -1.0, -1.0), GfVec3d(11.0, 1.0, 1.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+  EXPECT_EQ(2u, cache.numNodes());
+
+  UsdModelAPI(model.GetPrim()).SetKind(KindTokens->component);
+  cache.invalidate(model.GetPath(), false);
+  EXPECT_EQ(GfRange3d(GfVec3d(5.0, -5.0, -5.0), GfVec3d(15.0, 5.0, 5.0)), cache.bounds(root, UsdTimeCode(1.0), 0));
+  EXPECT_EQ(1u, cache.numNodes());
+  EXPECT_EQ(GfRange3d(GfVec3d(-5.0), GfVec3d(5.0)), cache.bounds(model.GetPrim(), UsdTimeCode(1.0), 0));
+
+  cache.setUseExtentsHint(false);
+  EXPECT_FALSE(cache.useExtentsHint());
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(GfRange3d(GfVec3d(-1.0), GfVec3d(1.0)), cache.bounds(model.GetPrim(), UsdTimeCode(1.0), 0));
+}
@@ -26,13 +26,16 @@
 #include "maya/MDagModifier.h"
 #include "maya/MFileIO.h"
 #include "maya/MStringArray.h"
+#include "maya/MFnPluginData.h"
 
 #include "pxr/usd/usd/stage.h"
 #include "pxr/usd/sdf/types.h"
 #include "pxr/usd/usd/attribute.h"
+#include "pxr/usd/usd/notice.h"
 #include "pxr/usd/usdGeom/xform.h"
 #include "pxr/usd/usdGeom/xformCommonAPI.h"
 
+#include <cstring>
 #include <fstream>
 
 
@@ -226,3 +229,357 @@ TEST(ProxyShape, DrivenTransforms)
 
   }
 }
+
+TEST(ProxyShape, DrivenTransformsCache)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform::Define(stage, SdfPath("/root"));
+  UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+
+  const SdfPathVector drivenPaths =
+  {
+    SdfPath("/root"),
+    SdfPath("/root/hip1"),
+    SdfPath("/missing")
+  };
+
+  AL::usdmaya::nodes::proxy::DrivenTransforms dt;
+  dt.resizeDrivenTransforms(drivenPaths.size());
+  dt.setDrivenPrimPaths(drivenPaths);
+
+  // only the dirty prims are resolved, so the missing prim does not matter until it is driven
+  const MTime time(1.0, MTime::uiUnit());
+  MMatrix matrixValue = MMatrix::identity;
+  matrixValue[3][0] = 2.0;
+  dt.dirtyMatrix(1, matrixValue);
+  EXPECT_TRUE(dt.update(stage, time));
+
+  UsdGeomXform hip(stage->GetPrimAtPath(SdfPath("/root/hip1")));
+  bool resetsXformStack;
+  std::vector<UsdGeomXformOp> ops = hip.GetOrderedXformOps(&resetsXformStack);
+  ASSERT_EQ(1u, ops.size());
+  MMatrix returnedMatrix;
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, time.as(MTime::uiUnit()));
+  EXPECT_EQ(matrixValue, returnedMatrix);
+
+  // the cached op continues to be used on subsequent updates
+  matrixValue[3][1] = 3.0;
+  dt.dirtyMatrix(1, matrixValue);
+  EXPECT_TRUE(dt.update(stage, time));
+  EXPECT_EQ(1u, hip.GetOrderedXformOps(&resetsXformStack).size());
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, time.as(MTime::uiUnit()));
+  EXPECT_EQ(matrixValue, returnedMatrix);
+
+  // once the prim has been resynced, the op is resolved (and created) again
+  hip.ClearXformOpOrder();
+  hip.GetPrim().RemoveProperty(ops[0].GetAttr().GetName());
+  dt.invalidateCache(SdfPathVector(1, SdfPath("/root/hip1")));
+  dt.dirtyMatrix(1, matrixValue);
+  EXPECT_TRUE(dt.update(stage, time));
+  ops = hip.GetOrderedXformOps(&resetsXformStack);
+  ASSERT_EQ(1u, ops.size());
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, time.as(MTime::uiUnit()));
+  EXPECT_EQ(matrixValue, returnedMatrix);
+
+  // driving the missing prim fails
+  dt.dirtyMatrix(2, matrixValue);
+  EXPECT_FALSE(dt.update(stage, time));
+  EXPECT_TRUE(dt.dirtyMatrices().empty());
+
+  // as does driving a prim that has been removed from the stage
+  stage->RemovePrim(SdfPath("/root/hip1"));
+  dt.invalidateCache(SdfPathVector(1, SdfPath("/root")));
+  dt.dirtyVisibility(1, false);
+  EXPECT_FALSE(dt.update(stage, time));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that samples can be written directly to the edit target layer, skipping those that have not changed
+//----------------------------------------------------------------------------------------------------------------------
+TEST(ProxyShape, DrivenTransformsBulkWrite)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform::Define(stage, SdfPath("/root"));
+  UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+
+  AL::usdmaya::nodes::proxy::DrivenTransforms dt;
+  dt.resizeDrivenTransforms(1);
+  dt.setDrivenPrimPaths(SdfPathVector(1, SdfPath("/root/hip1")));
+  dt.setUpdateFlags(AL::usdmaya::nodes::proxy::DrivenTransforms::kBulkWrite |
+                    AL::usdmaya::nodes::proxy::DrivenTransforms::kParallelFill |
+                    AL::usdmaya::nodes::proxy::DrivenTransforms::kSkipUnchangedSamples);
+
+  // the same values over frames 1 to 3, then new values at frame 4
+  MMatrix heldValue = MMatrix::identity;
+  heldValue[3][0] = 2.0;
+  MMatrix newValue = MMatrix::identity;
+  newValue[3][0] = 6.0;
+  for(int frame = 1; frame <= 4; ++frame)
+  {
+    dt.dirtyMatrix(0, frame < 4 ? heldValue : newValue);
+    dt.dirtyVisibility(0, frame == 4);
+    EXPECT_TRUE(dt.update(stage, MTime(frame, MTime::uiUnit())));
+    EXPECT_TRUE(dt.dirtyMatrices().empty());
+    EXPECT_TRUE(dt.dirtyVisibilities().empty());
+  }
+
+  UsdGeomXform hip(stage->GetPrimAtPath(SdfPath("/root/hip1")));
+  bool resetsXformStack;
+  std::vector<UsdGeomXformOp> ops = hip.GetOrderedXformOps(&resetsXformStack);
+  ASSERT_EQ(1u, ops.size());
+
+  // frame 2 is skipped, but the held value is written at frame 3 so that nothing is interpolated before frame 4
+  const std::vector<double> expectedTimes = { 1.0, 3.0, 4.0 };
+  std::vector<double> times;
+  ops[0].GetAttr().GetTimeSamples(&times);
+  EXPECT_EQ(expectedTimes, times);
+  hip.GetVisibilityAttr().GetTimeSamples(&times);
+  EXPECT_EQ(expectedTimes, times);
+
+  MMatrix returnedMatrix;
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, 2.0);
+  EXPECT_EQ(heldValue, returnedMatrix);
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, 3.0);
+  EXPECT_EQ(heldValue, returnedMatrix);
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, 4.0);
+  EXPECT_EQ(newValue, returnedMatrix);
+
+  TfToken visibility;
+  hip.GetVisibilityAttr().Get(&visibility, 2.0);
+  EXPECT_EQ(UsdGeomTokens->invisible, visibility);
+  hip.GetVisibilityAttr().Get(&visibility, 4.0);
+  EXPECT_EQ(UsdGeomTokens->inherited, visibility);
+
+  // an existing sample is overwritten, even if the value has not changed since the previous frame
+  dt.dirtyMatrix(0, newValue);
+  EXPECT_TRUE(dt.update(stage, MTime(5.0, MTime::uiUnit())));
+  dt.dirtyMatrix(0, newValue);
+  EXPECT_TRUE(dt.update(stage, MTime(1.0, MTime::uiUnit())));
+  ops[0].Get((GfMatrix4d*)&returnedMatrix, 1.0);
+  EXPECT_EQ(newValue, returnedMatrix);
+}
+
+namespace {
+// counts the change notices sent by a stage
+struct ObjectsChangedCounter : public TfWeakBase
+{
+  ObjectsChangedCounter(const UsdStageRefPtr& stage)
+    { m_key = TfNotice::Register(TfCreateWeakPtr(this), &ObjectsChangedCounter::objectsChanged, stage); }
+  ~ObjectsChangedCounter()
+    { TfNotice::Revoke(m_key); }
+  void objectsChanged(const UsdNotice::ObjectsChanged&)
+    { ++m_count; }
+  TfNotice::Key m_key;
+  uint32_t m_count = 0;
+};
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that the proxy shape writes the driven transforms connected to it in bulk when bulkWriteDrivenTransforms is set
+//----------------------------------------------------------------------------------------------------------------------
+TEST(ProxyShape, DrivenTransformsBulkWriteAttribute)
+{
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_proxy_DrivenTransformsBulkWrite.usda");
+  {
+    std::ofstream os(temp_path);
+    os << g_drivenData;
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  auto stage = proxy->getUsdStage();
+
+  // bulk writes are disabled by default
+  EXPECT_FALSE(proxy->bulkWriteDrivenTransformsPlug().asBool());
+
+  const SdfPathVector drivenPaths =
+  {
+    SdfPath("/root"),
+    SdfPath("/root/hip1"),
+    SdfPath("/root/hip1/knee1"),
+    SdfPath("/root/hip1/knee1/ankle1"),
+    SdfPath("/root/hip1/knee1/ankle1/ltoe1")
+  };
+
+  // passes new values for all of the driven prims into the proxy, and evaluates it at the given frame
+  auto drive = [&](const double frame, const MMatrix& value, const bool visible)
+  {
+    MFnPluginData fnData;
+    MObject data = fnData.create(AL::usdmaya::DrivenTransformsData::kTypeId);
+    AL::usdmaya::nodes::proxy::DrivenTransforms& dt = ((AL::usdmaya::DrivenTransformsData*)fnData.data())->m_drivenTransforms;
+    dt.resizeDrivenTransforms(drivenPaths.size());
+    dt.setDrivenPrimPaths(drivenPaths);
+    for(int32_t i = 0; i < int32_t(drivenPaths.size()); ++i)
+    {
+      dt.dirtyMatrix(i, value);
+      dt.dirtyVisibility(i, visible);
+    }
+    proxy->timePlug().setMTime(MTime(frame, MTime::uiUnit()));
+    proxy->inDrivenTransformsDataPlug().elementByLogicalIndex(0).setValue(data);
+    proxy->outStageDataPlug().asMObject();
+  };
+
+  MMatrix firstValue = MMatrix::identity;
+  firstValue[3][0] = 2.0;
+  MMatrix secondValue = MMatrix::identity;
+  secondValue[3][0] = 4.0;
+  MMatrix thirdValue = MMatrix::identity;
+  thirdValue[3][0] = 6.0;
+
+  // the first update creates the transform ops, and writes each attribute with the Usd API
+  drive(1.0, firstValue, true);
+
+  // once enabled, all of the samples are written within a single change block
+  {
+    ObjectsChangedCounter counter(stage);
+    proxy->bulkWriteDrivenTransformsPlug().setBool(true);
+    drive(2.0, secondValue, false);
+    EXPECT_EQ(1u, counter.m_count);
+  }
+
+  // and once disabled, each attribute is written separately again
+  {
+    ObjectsChangedCounter counter(stage);
+    proxy->bulkWriteDrivenTransformsPlug().setBool(false);
+    drive(3.0, thirdValue, true);
+    EXPECT_LT(1u, counter.m_count);
+  }
+
+  // the update flags on the connected data are left unchanged
+  MFnPluginData fnData(proxy->inDrivenTransformsDataPlug().elementByLogicalIndex(0).asMObject());
+  EXPECT_EQ(0u, ((AL::usdmaya::DrivenTransformsData*)fnData.data())->m_drivenTransforms.updateFlags());
+
+  const std::vector<double> expectedTimes = { 1.0, 2.0, 3.0 };
+  for(const SdfPath& path : drivenPaths)
+  {
+    UsdGeomXform xform(stage->GetPrimAtPath(path));
+    bool resetsXformStack;
+    std::vector<UsdGeomXformOp> ops = xform.GetOrderedXformOps(&resetsXformStack);
+    ASSERT_EQ(1u, ops.size());
+
+    std::vector<double> times;
+    ops[0].GetAttr().GetTimeSamples(&times);
+    EXPECT_EQ(expectedTimes, times);
+    xform.GetVisibilityAttr().GetTimeSamples(&times);
+    EXPECT_EQ(expectedTimes, times);
+
+    MMatrix returnedMatrix;
+    ops[0].Get((GfMatrix4d*)&returnedMatrix, 1.0);
+    EXPECT_EQ(firstValue, returnedMatrix);
+    ops[0].Get((GfMatrix4d*)&returnedMatrix, 2.0);
+    EXPECT_EQ(secondValue, returnedMatrix);
+    ops[0].Get((GfMatrix4d*)&returnedMatrix, 3.0);
+    EXPECT_EQ(thirdValue, returnedMatrix);
+
+    TfToken visibility;
+    xform.GetVisibilityAttr().Get(&visibility, 2.0);
+    EXPECT_EQ(UsdGeomTokens->invisible, visibility);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test that the dirty indices are unique, and that the matrices can be written directly into the buffer
+//----------------------------------------------------------------------------------------------------------------------
+TEST(ProxyShape, DrivenTransformsBuffer)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  SdfPathVector drivenPaths;
+  for(int i = 0; i < 70; ++i)
+  {
+    drivenPaths.push_back(SdfPath("/xform" + std::to_string(i)));
+    UsdGeomXform::Define(stage, drivenPaths.back());
+  }
+
+  AL::usdmaya::nodes::proxy::DrivenTransforms dt;
+  dt.resizeDrivenTransforms(drivenPaths.size());
+  dt.setDrivenPrimPaths(drivenPaths);
+  EXPECT_EQ(70u, dt.transformCount());
+  EXPECT_EQ(MMatrix::identity, dt.drivenMatrix(69));
+  EXPECT_TRUE(dt.drivenVisibility(69));
+
+  // dirtying the same prim more than once only records it once, and the latest value is used
+  MMatrix matrixValue = MMatrix::identity;
+  matrixValue[3][0] = 1.0;
+  dt.dirtyMatrix(65, matrixValue);
+  dt.dirtyMatrix(3, matrixValue);
+  matrixValue[3][0] = 2.0;
+  dt.dirtyMatrix(65, matrixValue);
+  dt.dirtyVisibility(65, false);
+  dt.dirtyVisibility(65, true);
+  dt.dirtyVisibility(65, false);
+  ASSERT_EQ(2u, dt.dirtyMatrices().size());
+  EXPECT_EQ(65, dt.dirtyMatrices()[0]);
+  EXPECT_EQ(3, dt.dirtyMatrices()[1]);
+  ASSERT_EQ(1u, dt.dirtyVisibilities().size());
+  EXPECT_EQ(matrixValue, dt.drivenMatrix(65));
+  EXPECT_FALSE(dt.drivenVisibility(65));
+  EXPECT_TRUE(dt.drivenVisibility(64));
+  EXPECT_TRUE(dt.drivenVisibility(66));
+
+  // the deprecated accessors return copies of the same values
+  {
+    const std::vector<MMatrix> matrices = dt.drivenMatrices();
+    const std::vector<bool> visibilities = dt.drivenVisibilities();
+    ASSERT_EQ(70u, matrices.size());
+    ASSERT_EQ(70u, visibilities.size());
+    EXPECT_EQ(matrixValue, matrices[65]);
+    EXPECT_FALSE(visibilities[65]);
+    EXPECT_TRUE(visibilities[66]);
+  }
+
+  // out of range indices are ignored
+  dt.dirtyMatrix(70, matrixValue);
+  dt.dirtyVisibility(-1, false);
+  EXPECT_EQ(2u, dt.dirtyMatrices().size());
+  EXPECT_EQ(1u, dt.dirtyVisibilities().size());
+
+  const MTime time(1.0, MTime::uiUnit());
+  EXPECT_TRUE(dt.update(stage, time));
+  EXPECT_TRUE(dt.dirtyMatrices().empty());
+  EXPECT_TRUE(dt.dirtyVisibilities().empty());
+
+  // once updated, the same prims can be dirtied again
+  dt.dirtyMatrix(65);
+  EXPECT_EQ(1u, dt.dirtyMatrices().size());
+
+  // write a block of matrices directly into the buffer
+  double* const buffer = dt.drivenMatrixBuffer();
+  for(int i = 10; i < 20; ++i)
+  {
+    MMatrix value = MMatrix::identity;
+    value[3][1] = i;
+    std::memcpy(buffer + i * 16, value.matrix, sizeof(double) * 16);
+  }
+  dt.dirtyMatrices(10, 10);
+  EXPECT_EQ(11u, dt.dirtyMatrices().size());
+  EXPECT_TRUE(dt.update(stage, time));
+
+  for(int i = 10; i < 20; ++i)
+  {
+    UsdGeomXform xform(stage->GetPrimAtPath(drivenPaths[i]));
+    bool resetsXformStack;
+    std::vector<UsdGeomXformOp> ops = xform.GetOrderedXformOps(&resetsXformStack);
+    ASSERT_EQ(1u, ops.size());
+    MMatrix returnedMatrix;
+    ops[0].Get((GfMatrix4d*)&returnedMatrix, time.as(MTime::uiUnit()));
+    EXPECT_EQ(dt.drivenMatrix(i), returnedMatrix);
+    EXPECT_EQ(double(i), returnedMatrix[3][1]);
+  }
+
+  // shrinking the transforms discards the dirty indices that are out of range
+  dt.dirtyMatrix(65, matrixValue);
+  dt.dirtyMatrix(2, matrixValue);
+  dt.resizeDrivenTransforms(64);
+  ASSERT_EQ(1u, dt.dirtyMatrices().size());
+  EXPECT_EQ(2, dt.dirtyMatrices()[0]);
+
+  // and growing them again resets the new values
+  dt.resizeDrivenTransforms(70);
+  EXPECT_EQ(MMatrix::identity, dt.drivenMatrix(65));
+  EXPECT_TRUE(dt.drivenVisibility(65));
+  dt.dirtyMatrix(65, matrixValue);
+  EXPECT_EQ(2u, dt.dirtyMatrices().size());
+}
@@ -0,0 +1,221 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include "test_usdmaya.h"
+#include "AL/usdmaya/nodes/proxy/PrimPicker.h"
+
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/cube.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformCommonAPI.h"
+
+using AL::usdmaya::nodes::proxy::PrimPicker;
+
+namespace {
+const TfTokenVector defaultPurposes = { UsdGeomTokens->default_, UsdGeomTokens->proxy };
+
+// a single triangle in the XY plane, covering the half of the square [-1, 1] where x + y <= 0
+UsdGeomMesh defineTriangle(UsdStageRefPtr stage, const SdfPath& path)
+{
+  UsdGeomMesh mesh = UsdGeomMesh::Define(stage, path);
+  VtArray<GfVec3f> points(3);
+  points[0] = GfVec3f(-1.0f, -1.0f, 0.0f);
+  points[1] = GfVec3f(1.0f, -1.0f, 0.0f);
+  points[2] = GfVec3f(-1.0f, 1.0f, 0.0f);
+  VtIntArray counts(1, 3);
+  VtIntArray indices(3);
+  indices[0] = 0;
+  indices[1] = 1;
+  indices[2] = 2;
+  VtArray<GfVec3f> extent(2);
+  extent[0] = GfVec3f(-1.0f, -1.0f, 0.0f);
+  extent[1] = GfVec3f(1.0f, 1.0f, 0.0f);
+  mesh.CreatePointsAttr().Set(points);
+  mesh.CreateFaceVertexCountsAttr().Set(counts);
+  mesh.CreateFaceVertexIndicesAttr().Set(indices);
+  mesh.CreateExtentAttr().Set(extent);
+  return mesh;
+}
+
+UsdGeomCube defineCube(UsdStageRefPtr stage, const SdfPath& path, const GfVec3d& position)
+{
+  UsdGeomCube cube = UsdGeomCube::Define(stage, path);
+  VtArray<GfVec3f> extent(2);
+  extent[0] = GfVec3f(-1.0f);
+  extent[1] = GfVec3f(1.0f);
+  cube.CreateExtentAttr().Set(extent);
+  UsdGeomXformCommonAPI(cube).SetTranslate(position);
+  return cube;
+}
+
+// an orthographic projection of the box centred at (x, y), with a half size of 'size' and a depth range of [-100, 100]
+GfMatrix4d orthoFrustum(double x, double y, double size)
+{
+  return GfMatrix4d().SetTranslate(GfVec3d(-x, -y, 0.0)) * GfMatrix4d().SetScale(GfVec3d(1.0 / size, 1.0 / size, 0.01));
+}
+} // anon
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test picking with a ray against meshes (triangles) and other gprims (bounds)
+//----------------------------------------------------------------------------------------------------------------------
+TEST(PrimPicker, pickRay)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  defineTriangle(stage, SdfPath("/A"));
+  defineCube(stage, SdfPath("/B"), GfVec3d(5.0, 0.0, 0.0));
+
+  PrimPicker picker;
+  EXPECT_FALSE(picker.isValid());
+  picker.build(stage->GetPseudoRoot(), UsdTimeCode::Default(), defaultPurposes);
+  EXPECT_TRUE(picker.isValid());
+  EXPECT_EQ(2u, picker.numPrims());
+
+  PrimPicker::HitVector hits;
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(-0.5, -0.5, 10.0), GfVec3d(0.0, 0.0, -1.0)), hits));
+  ASSERT_EQ(1u, hits.size());
+  EXPECT_EQ(SdfPath("/A"), hits[0].path);
+  EXPECT_NEAR(10.0, hits[0].distance, 1e-5);
+  EXPECT_NEAR(0.0, hits[0].point[2], 1e-5);
+
+  // within the bounds of the mesh, but outside of the triangle
+  EXPECT_FALSE(picker.pickRay(GfRay(GfVec3d(0.5, 0.5, 10.0), GfVec3d(0.0, 0.0, -1.0)), hits));
+  EXPECT_TRUE(hits.empty());
+
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(5.0, 0.0, 10.0), GfVec3d(0.0, 0.0, -2.0)), hits));
+  ASSERT_EQ(1u, hits.size());
+  EXPECT_EQ(SdfPath("/B"), hits[0].path);
+  EXPECT_NEAR(9.0, hits[0].distance, 1e-5);
+
+  // with a cube above the triangle, both are hit (closest first)
+  defineCube(stage, SdfPath("/C"), GfVec3d(0.0, 0.0, 5.0));
+  picker.build(stage->GetPseudoRoot(), UsdTimeCode::Default(), defaultPurposes);
+  EXPECT_EQ(3u, picker.numPrims());
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(-0.5, -0.5, 10.0), GfVec3d(0.0, 0.0, -1.0)), hits));
+  ASSERT_EQ(2u, hits.size());
+  EXPECT_EQ(SdfPath("/C"), hits[0].path);
+  EXPECT_NEAR(4.0, hits[0].distance, 1e-5);
+  EXPECT_EQ(SdfPath("/A"), hits[1].path);
+
+  picker.clear();
+  EXPECT_FALSE(picker.isValid());
+  EXPECT_FALSE(picker.pickRay(GfRay(GfVec3d(-0.5, -0.5, 10.0), GfVec3d(0.0, 0.0, -1.0)), hits));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test marquee picking with a frustum
+//----------------------------------------------------------------------------------------------------------------------
+TEST(PrimPicker, pickFrustum)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  defineTriangle(stage, SdfPath("/A"));
+  defineCube(stage, SdfPath("/B"), GfVec3d(5.0, 0.0, 0.0));
+
+  PrimPicker picker;
+  picker.build(stage->GetPseudoRoot(), UsdTimeCode::Default(), defaultPurposes);
+
+  PrimPicker::HitVector hits;
+  EXPECT_TRUE(picker.pickFrustum(orthoFrustum(0.0, 0.0, 2.0), hits));
+  ASSERT_EQ(1u, hits.size());
+  EXPECT_EQ(SdfPath("/A"), hits[0].path);
+
+  EXPECT_TRUE(picker.pickFrustum(orthoFrustum(5.5, 0.5, 1.0), hits));
+  ASSERT_EQ(1u, hits.size());
+  EXPECT_EQ(SdfPath("/B"), hits[0].path);
+
+  EXPECT_TRUE(picker.pickFrustum(orthoFrustum(2.5, 0.0, 10.0), hits));
+  EXPECT_EQ(2u, hits.size());
+
+  // overlaps the bounds of the mesh, but not the triangle
+  EXPECT_FALSE(picker.pickFrustum(orthoFrustum(0.5, 0.5, 0.25), hits));
+
+  // partially overlaps the triangle
+  EXPECT_TRUE(picker.pickFrustum(orthoFrustum(0.25, -0.75, 0.5), hits));
+  ASSERT_EQ(1u, hits.size());
+  EXPECT_EQ(SdfPath("/A"), hits[0].path);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test the hierarchy is refitted when the time changes, or when the bounds are invalidated
+//----------------------------------------------------------------------------------------------------------------------
+TEST(PrimPicker, refit)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomCube cube = defineCube(stage, SdfPath("/B"), GfVec3d(0.0));
+  UsdGeomXformCommonAPI(cube).SetTranslate(GfVec3d(5.0, 0.0, 0.0), UsdTimeCode(1.0));
+  UsdGeomXformCommonAPI(cube).SetTranslate(GfVec3d(20.0, 0.0, 0.0), UsdTimeCode(2.0));
+  defineTriangle(stage, SdfPath("/A"));
+
+  PrimPicker picker;
+  picker.build(stage->GetPseudoRoot(), UsdTimeCode(1.0), defaultPurposes);
+
+  const GfVec3d down(0.0, 0.0, -1.0);
+  PrimPicker::HitVector hits;
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(5.0, 0.0, 10.0), down), hits));
+  EXPECT_FALSE(picker.pickRay(GfRay(GfVec3d(20.0, 0.0, 10.0), down), hits));
+
+  picker.setTime(UsdTimeCode(2.0));
+  EXPECT_EQ(UsdTimeCode(2.0), picker.time());
+  EXPECT_FALSE(picker.pickRay(GfRay(GfVec3d(5.0, 0.0, 10.0), down), hits));
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(20.0, 0.0, 10.0), down), hits));
+
+  // invisible prims cannot be picked
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(-0.5, -0.5, 10.0), down), hits));
+  UsdGeomMesh(stage->GetPrimAtPath(SdfPath("/A"))).CreateVisibilityAttr().Set(UsdGeomTokens->invisible);
+  picker.setTime(UsdTimeCode(2.0));
+  EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(-0.5, -0.5, 10.0), down), hits));
+  picker.invalidateBounds();
+  picker.setTime(UsdTimeCode(2.0));
+  EXPECT_FALSE(picker.pickRay(GfRay(GfVec3d(-0.5, -0.5, 10.0), down), hits));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Test picking within a larger hierarchy
+//----------------------------------------------------------------------------------------------------------------------
+TEST(PrimPicker, manyPrims)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  for(int i = 0; i < 10; ++i)
+  {
+    for(int j = 0; j < 10; ++j)
+    {
+      std::string name = "/cube_" + std::to_string(i) + "_" + std::to_string(j);
+      defineCube(stage, SdfPath(name), GfVec3d(i * 4.0, j * 4.0, 0.0));
+    }
+  }
+
+  PrimPicker picker;
+  picker.build(stage->GetPseudoRoot(), UsdTimeCode::Default(), defaultPurposes);
+  EXPECT_EQ(100u, picker.numPrims());
+
+  PrimPicker::HitVector hits;
+  for(int i = 0; i < 10; ++i)
+  {
+    for(int j = 0; j < 10; ++j)
+    {
+      std::string name = "/cube_" + std::to_string(i) + "_" + std::to_string(j);
+      EXPECT_TRUE(picker.pickRay(GfRay(GfVec3d(i * 4.0, j * 4.0, 10.0), GfVec3d(0.0, 0.0, -1.0)), hits));
+      ASSERT_EQ(1u, hits.size());
+      EXPECT_EQ(SdfPath(name), hits[0].path);
+    }
+  }
+
+  // the gaps between the cubes
+  EXPECT_FALSE(picker.pickRay(GfRay(GfVec3d(2.0, 2.0, 10.0), GfVec3d(0.0, 0.0, -1.0)), hits));
+
+  // a 3x3 block of cubes
+  EXPECT_TRUE(picker.pickFrustum(orthoFrustum(4.0, 4.0, 5.5), hits));
+  EXPECT_EQ(9u, hits.size());
+}
@@ -17,25 +17,38 @@
 #include "AL/usdmaya/nodes/ProxyShape.h"
 #include "AL/usdmaya/nodes/Transform.h"
 #include "AL/usdmaya/nodes/LayerManager.h"
+#include "AL/usdmaya/Metadata.h"
 #include "AL/usdmaya/StageCache.h"
 #include "AL/usdmaya/fileio/translators/TranslatorContext.h"
 
+#include "maya/MAnimControl.h"
+#include "maya/MFnAttribute.h"
 #include "maya/MFnTransform.h"
 #include "maya/MSelectionList.h"
 #include "maya/MGlobal.h"
 #include "maya/MItDependencyNodes.h"
 #include "maya/MDagModifier.h"
 #include "maya/MFileIO.h"
+#include "maya/MFnStringArrayData.h"
 #include "maya/MStringArray.h"
+#include "maya/MUuid.h"
 #include "maya/MCommonSystemUtils.h"
 
+#include "pxr/base/tf/fileUtils.h"
+#include "pxr/base/tf/stringUtils.h"
 #include "pxr/usd/sdf/types.h"
+#include "pxr/usd/kind/registry.h"
 #include "pxr/usd/usd/attribute.h"
+#include "pxr/usd/usd/modelAPI.h"
 #include "pxr/usd/usd/stage.h"
 #include "pxr/usd/usd/usdaFileFormat.h"
+#include "pxr/usd/usdGeom/cube.h"
+#include "pxr/usd/usdGeom/modelAPI.h"
 #include "pxr/usd/usdGeom/xform.h"
 #include "pxr/usd/usdGeom/xformCommonAPI.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
 
@@ -950,6 +963,522 @@ TEST(ProxyShape, basicTransformChainOperations2)
   }
 }
 
+// Make sure that the batched creation of transform chains shares the common ancestors between the chains, and
+// that the reference counts match those of creating each chain separately.
+TEST(ProxyShape, batchTransformChainOperations)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_batchTransformChainOperations.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1/knee1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1/knee2"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  auto stage = proxy->getUsdStage();
+
+  const SdfPath paths[] = {
+    SdfPath("/root/hip1/knee1"),
+    SdfPath("/root/hip1/knee2"),
+    SdfPath("/root/hip2")
+  };
+  std::vector<UsdPrim> prims;
+  for(const SdfPath& path : paths)
+  {
+    prims.push_back(stage->GetPrimAtPath(path));
+  }
+
+  MDagModifier modifier1;
+  MDGModifier modifier2;
+  uint32_t createCount = 0;
+  MObjectArray nodes = proxy->makeUsdTransformChains(prims, modifier1, AL::usdmaya::nodes::ProxyShape::kRequired, &modifier2, &createCount);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier1.doIt());
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier2.doIt());
+
+  // the shared ancestors should only be created once
+  EXPECT_EQ(5U, createCount);
+  ASSERT_EQ(3U, nodes.length());
+  for(uint32_t i = 0; i < 3; ++i)
+  {
+    EXPECT_TRUE(proxy->findRequiredPath(paths[i]) == nodes[i]);
+    MFnDependencyNode fnNode(nodes[i]);
+    EXPECT_EQ(MString(paths[i].GetText()), fnNode.findPlug("primPath").asString());
+  }
+  EXPECT_TRUE(MFnDagNode(nodes[0]).parent(0) == MFnDagNode(nodes[1]).parent(0));
+  EXPECT_TRUE(proxy->findRequiredPath(SdfPath("/root/hip1")) == MFnDagNode(nodes[0]).parent(0));
+  EXPECT_TRUE(proxy->findRequiredPath(SdfPath("/root")) == MFnDagNode(nodes[2]).parent(0));
+
+  // a second request should not create anything new
+  {
+    MDagModifier modifier1b;
+    createCount = 0;
+    MObjectArray nodes2 = proxy->makeUsdTransformChains(prims, modifier1b, AL::usdmaya::nodes::ProxyShape::kRequired, 0, &createCount);
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier1b.doIt());
+    EXPECT_EQ(0U, createCount);
+    ASSERT_EQ(3U, nodes2.length());
+    EXPECT_TRUE(nodes[0] == nodes2[0]);
+
+    MDagModifier modifier3;
+    for(const UsdPrim& prim : prims)
+    {
+      proxy->removeUsdTransformChain(prim, modifier3, AL::usdmaya::nodes::ProxyShape::kRequired);
+    }
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier3.doIt());
+    EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root")));
+  }
+
+  // removing each chain once more should release all of the references
+  MDagModifier modifier4;
+  for(const UsdPrim& prim : prims)
+  {
+    proxy->removeUsdTransformChain(prim, modifier4, AL::usdmaya::nodes::ProxyShape::kRequired);
+  }
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier4.doIt());
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root")));
+  {
+    MItDependencyNodes it(MFn::kPluginTransformNode);
+    EXPECT_TRUE(it.isDone());
+  }
+}
+
+// Make sure that a batch of chains references the existing transforms in the same way as makeUsdTransformChain, so
+// that required transforms survive the selection being removed (and vice versa).
+TEST(ProxyShape, batchTransformChainRequiredThenDeselect)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_batchTransformChainRequiredThenDeselect.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1/knee1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  auto stage = proxy->getUsdStage();
+
+  const SdfPath kneePath("/root/hip1/knee1");
+  const SdfPath hipPath("/root/hip2");
+  const std::vector<UsdPrim> prims = { stage->GetPrimAtPath(kneePath), stage->GetPrimAtPath(hipPath) };
+
+  auto countTransforms = []()
+  {
+    uint32_t count = 0;
+    for(MItDependencyNodes it(MFn::kPluginTransformNode); !it.isDone(); it.next())
+    {
+      ++count;
+    }
+    return count;
+  };
+
+  // select the prims, and then require the same chains
+  {
+    MDagModifier modifier1;
+    proxy->makeUsdTransformChains(prims, modifier1, AL::usdmaya::nodes::ProxyShape::kSelection);
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier1.doIt());
+    EXPECT_EQ(4u, countTransforms());
+
+    MDagModifier modifier2;
+    proxy->makeUsdTransformChains(prims, modifier2, AL::usdmaya::nodes::ProxyShape::kRequired);
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier2.doIt());
+    EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root")));
+    EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+    EXPECT_TRUE(proxy->isRequiredPath(kneePath));
+    EXPECT_EQ(4u, countTransforms());
+  }
+
+  // deselecting the prims should leave the required transforms alone
+  {
+    MDagModifier modifier;
+    for(const UsdPrim& prim : prims)
+    {
+      proxy->removeUsdTransformChain(prim, modifier, AL::usdmaya::nodes::ProxyShape::kSelection);
+    }
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier.doIt());
+    EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+    EXPECT_TRUE(proxy->isRequiredPath(kneePath));
+    EXPECT_EQ(4u, countTransforms());
+  }
+
+  // selecting the required prims again, and then deselecting them, should also leave them alone
+  {
+    MDagModifier modifier1;
+    proxy->makeUsdTransformChains(prims, modifier1, AL::usdmaya::nodes::ProxyShape::kSelection);
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier1.doIt());
+
+    MDagModifier modifier2;
+    for(const UsdPrim& prim : prims)
+    {
+      proxy->removeUsdTransformChain(prim, modifier2, AL::usdmaya::nodes::ProxyShape::kSelection);
+    }
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier2.doIt());
+    EXPECT_TRUE(proxy->isRequiredPath(kneePath));
+    EXPECT_EQ(4u, countTransforms());
+  }
+
+  // releasing the required chains should remove everything
+  {
+    MDagModifier modifier;
+    for(const UsdPrim& prim : prims)
+    {
+      proxy->removeUsdTransformChain(prim, modifier, AL::usdmaya::nodes::ProxyShape::kRequired);
+    }
+    EXPECT_EQ(MStatus(MS::kSuccess), modifier.doIt());
+    EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root")));
+    EXPECT_EQ(0u, countTransforms());
+  }
+}
+
+// Make sure the transform references survive being serialised, and that requested sub trees are removed
+TEST(ProxyShape, serialiseTransformRefs)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_serialiseTransformRefs.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1/knee1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1/knee2"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  auto stage = proxy->getUsdStage();
+
+  const SdfPath paths[] = {
+    SdfPath("/root/hip1/knee1"),
+    SdfPath("/root/hip1/knee2"),
+    SdfPath("/root/hip2")
+  };
+  std::vector<UsdPrim> prims;
+  for(const SdfPath& path : paths)
+  {
+    prims.push_back(stage->GetPrimAtPath(path));
+  }
+
+  MDagModifier modifier1;
+  MObjectArray nodes = proxy->makeUsdTransformChains(prims, modifier1, AL::usdmaya::nodes::ProxyShape::kRequired);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier1.doIt());
+
+  proxy->serialiseTransformRefs();
+  EXPECT_EQ(MString(), proxy->serializedRefCountsPlug().asString());
+  {
+    MObject data;
+    proxy->serializedRefPathsPlug().getValue(data);
+    EXPECT_EQ(10U, MFnStringArrayData(data).array().length());
+  }
+
+  proxy->destroyTransformReferences();
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root")));
+
+  // a node outside of the proxy that shares a UUID with one of the transforms should not be picked up
+  {
+    MFnDagNode fnOther;
+    fnOther.create("transform");
+    fnOther.setUuid(MFnDependencyNode(nodes[0]).uuid());
+  }
+
+  proxy->deserialiseTransformRefs();
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root")));
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip1")));
+  for(uint32_t i = 0; i < 3; ++i)
+  {
+    EXPECT_TRUE(proxy->findRequiredPath(paths[i]) == nodes[i]);
+  }
+
+  // the ref counts should have been restored, so removing each chain once should release all of the references
+  MDagModifier modifier2;
+  for(const UsdPrim& prim : prims)
+  {
+    proxy->removeUsdTransformChain(prim, modifier2, AL::usdmaya::nodes::ProxyShape::kRequired);
+  }
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier2.doIt());
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root")));
+
+  // requesting the whole hierarchy, then removing it, should remove the children before their parents
+  UsdPrim root = stage->GetPrimAtPath(SdfPath("/root"));
+  MDagModifier modifier3;
+  proxy->makeUsdTransforms(root, modifier3, AL::usdmaya::nodes::ProxyShape::kRequested);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier3.doIt());
+  EXPECT_TRUE(proxy->isRequiredPath(SdfPath("/root/hip1/knee2")));
+
+  MDagModifier modifier4;
+  proxy->removeUsdTransforms(root, modifier4, AL::usdmaya::nodes::ProxyShape::kRequested);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier4.doIt());
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root/hip1/knee2")));
+  EXPECT_FALSE(proxy->isRequiredPath(SdfPath("/root")));
+  {
+    MItDependencyNodes it(MFn::kPluginTransformNode);
+    EXPECT_TRUE(it.isDone());
+  }
+}
+
+// Make sure the animated transforms driven by the proxy are all updated when the output time changes
+TEST(ProxyShape, evaluateAnimatedTransforms)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_evaluateAnimatedTransforms.usda");
+  const uint32_t numAnimated = 8;
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    for(uint32_t i = 0; i < numAnimated; ++i)
+    {
+      UsdGeomXform xform = UsdGeomXform::Define(stage, SdfPath("/animated" + std::to_string(i)));
+      UsdGeomXformOp op = xform.AddTranslateOp(UsdGeomXformOp::PrecisionDouble);
+      op.Set(GfVec3d(i, 0.0, 0.0), UsdTimeCode(1.0));
+      op.Set(GfVec3d(i, 10.0, 0.0), UsdTimeCode(11.0));
+    }
+    UsdGeomXformCommonAPI(UsdGeomXform::Define(stage, SdfPath("/static"))).SetTranslate(GfVec3d(1.0, 2.0, 3.0));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  auto stage = proxy->getUsdStage();
+
+  std::vector<UsdPrim> prims;
+  for(uint32_t i = 0; i < numAnimated; ++i)
+  {
+    prims.push_back(stage->GetPrimAtPath(SdfPath("/animated" + std::to_string(i))));
+  }
+  prims.push_back(stage->GetPrimAtPath(SdfPath("/static")));
+
+  MDagModifier modifier1;
+  MObjectArray nodes = proxy->makeUsdTransformChains(prims, modifier1, AL::usdmaya::nodes::ProxyShape::kRequired);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier1.doIt());
+  ASSERT_EQ(numAnimated + 1, nodes.length());
+
+  auto transformAt = [&nodes] (uint32_t i)
+  {
+    return (AL::usdmaya::nodes::Transform*)MFnDependencyNode(nodes[i]).userNode();
+  };
+
+  // only the animated transforms need to be sampled, and the transforms are left untouched until they are computed
+  const MTime time(6.0, MTime::uiUnit());
+  EXPECT_EQ(numAnimated, proxy->evaluateAnimatedTransforms(time));
+  for(uint32_t i = 0; i < numAnimated; ++i)
+  {
+    const AL::usdmaya::nodes::TransformationMatrix* matrix = transformAt(i)->transform();
+    EXPECT_NE(UsdTimeCode(6.0), matrix->getTimeCode());
+    const AL::usdmaya::nodes::TransformationMatrix::AnimatedSample* sample = proxy->animatedSamples().find(matrix, UsdTimeCode(6.0));
+    ASSERT_TRUE(sample != nullptr);
+    EXPECT_NEAR(double(i), sample->translation.x, 1e-5);
+    EXPECT_NEAR(5.0, sample->translation.y, 1e-5);
+  }
+  EXPECT_TRUE(proxy->animatedSamples().find(transformAt(numAnimated)->transform(), UsdTimeCode(6.0)) == nullptr);
+  EXPECT_TRUE(proxy->animatedSamples().find(transformAt(0)->transform(), UsdTimeCode(7.0)) == nullptr);
+
+  // nothing needs to be done until the time changes
+  EXPECT_EQ(0u, proxy->evaluateAnimatedTransforms(time));
+
+  // when the transforms are computed by maya, they take their values from the samples
+  MAnimControl::setCurrentTime(MTime(11.0, MTime::uiUnit()));
+  for(uint32_t i = 0; i < numAnimated; ++i)
+  {
+    MFnDependencyNode fnNode(nodes[i]);
+    EXPECT_NEAR(double(i), fnNode.findPlug("translateX").asDouble(), 1e-5);
+    EXPECT_NEAR(10.0, fnNode.findPlug("translateY").asDouble(), 1e-5);
+    EXPECT_EQ(UsdTimeCode(11.0), transformAt(i)->transform()->getTimeCode());
+  }
+
+  // a transform that is no longer driven by the proxy is not sampled
+  MDGModifier modifier2;
+  modifier2.disconnect(proxy->outTimePlug(), MFnDependencyNode(nodes[0]).findPlug("time"));
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier2.doIt());
+  EXPECT_EQ(numAnimated - 1, proxy->evaluateAnimatedTransforms(MTime(2.0, MTime::uiUnit())));
+  EXPECT_TRUE(proxy->animatedSamples().find(transformAt(0)->transform(), UsdTimeCode(2.0)) == nullptr);
+
+  // nor is a transform that offsets the time, which evaluates at its own time
+  MFnDependencyNode(nodes[1]).findPlug("timeOffset").setMTime(MTime(5.0, MTime::uiUnit()));
+  EXPECT_EQ(numAnimated - 2, proxy->evaluateAnimatedTransforms(MTime(3.0, MTime::uiUnit())));
+  EXPECT_TRUE(proxy->animatedSamples().find(transformAt(1)->transform(), UsdTimeCode(3.0)) == nullptr);
+  MAnimControl::setCurrentTime(MTime(8.0, MTime::uiUnit()));
+  EXPECT_NEAR(2.0, MFnDependencyNode(nodes[1]).findPlug("translateY").asDouble(), 1e-5);
+  EXPECT_EQ(UsdTimeCode(3.0), transformAt(1)->transform()->getTimeCode());
+}
+
+TEST(ProxyShape, disconnectStaticTransforms)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_disconnectStaticTransforms.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXformOp op = UsdGeomXform::Define(stage, SdfPath("/animated")).AddTranslateOp(UsdGeomXformOp::PrecisionDouble);
+    op.Set(GfVec3d(0.0), UsdTimeCode(1.0));
+    op.Set(GfVec3d(10.0), UsdTimeCode(11.0));
+    UsdGeomXform::Define(stage, SdfPath("/static")).AddTranslateOp(UsdGeomXformOp::PrecisionDouble).Set(GfVec3d(1.0, 2.0, 3.0));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  proxy->disconnectStaticTransformsPlug().setBool(true);
+  auto stage = proxy->getUsdStage();
+
+  std::vector<UsdPrim> prims;
+  prims.push_back(stage->GetPrimAtPath(SdfPath("/animated")));
+  prims.push_back(stage->GetPrimAtPath(SdfPath("/static")));
+  MDagModifier modifier;
+  MObjectArray nodes = proxy->makeUsdTransformChains(prims, modifier, AL::usdmaya::nodes::ProxyShape::kRequired);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier.doIt());
+  ASSERT_EQ(2u, nodes.length());
+
+  MPlug animatedTime = MFnDependencyNode(nodes[0]).findPlug("time");
+  MPlug staticTime = MFnDependencyNode(nodes[1]).findPlug("time");
+  EXPECT_TRUE(animatedTime.isConnected());
+  EXPECT_FALSE(staticTime.isConnected());
+
+  // once the static prim has time samples, it is driven by the proxy again. The connection is made once the queued
+  // changes are processed, rather than from within the notice.
+  UsdGeomXformable(prims[1]).GetOrderedXformOps(nullptr)[0].Set(GfVec3d(4.0, 5.0, 6.0), UsdTimeCode(1.0));
+  UsdGeomXformable(prims[1]).GetOrderedXformOps(nullptr)[0].Set(GfVec3d(7.0, 8.0, 9.0), UsdTimeCode(2.0));
+  AL::usdmaya::nodes::Transform* transform = (AL::usdmaya::nodes::Transform*)MFnDependencyNode(nodes[1]).userNode();
+  EXPECT_TRUE(transform->transform()->hasAnimation());
+  EXPECT_FALSE(staticTime.isConnected());
+  EXPECT_TRUE(proxy->hasChangedObjects());
+  proxy->processChangedObjects();
+  EXPECT_TRUE(staticTime.isConnected());
+
+  // a time connection removed by the user is never restored
+  MDGModifier disconnectModifier;
+  disconnectModifier.disconnect(proxy->outTimePlug(), animatedTime);
+  EXPECT_EQ(MStatus(MS::kSuccess), disconnectModifier.doIt());
+  UsdGeomXformable(prims[0]).GetOrderedXformOps(nullptr)[0].Set(GfVec3d(1.0), UsdTimeCode(5.0));
+  EXPECT_FALSE(proxy->hasChangedObjects());
+
+  // turning the option off reconnects everything it disconnected
+  UsdGeomXform::Define(stage, SdfPath("/static2")).AddTranslateOp(UsdGeomXformOp::PrecisionDouble).Set(GfVec3d(1.0));
+  prims.assign(1, stage->GetPrimAtPath(SdfPath("/static2")));
+  MDagModifier modifier2;
+  nodes = proxy->makeUsdTransformChains(prims, modifier2, AL::usdmaya::nodes::ProxyShape::kRequired);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier2.doIt());
+  ASSERT_EQ(1u, nodes.length());
+  MPlug static2Time = MFnDependencyNode(nodes[0]).findPlug("time");
+  EXPECT_FALSE(static2Time.isConnected());
+  proxy->disconnectStaticTransformsPlug().setBool(false);
+  EXPECT_TRUE(static2Time.isConnected());
+  EXPECT_FALSE(animatedTime.isConnected());
+}
+
+// Make sure that when deferObjectsChanged is enabled, the lock and selectability changes from many notices are merged,
+// and applied once the time changes
+TEST(ProxyShape, deferObjectsChanged)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_deferObjectsChanged.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip1"));
+    UsdGeomXform::Define(stage, SdfPath("/root/hip2"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  EXPECT_FALSE(proxy->deferObjectsChangedPlug().asBool());
+  proxy->deferObjectsChangedPlug().setBool(true);
+  auto stage = proxy->getUsdStage();
+
+  std::vector<UsdPrim> prims;
+  prims.push_back(stage->GetPrimAtPath(SdfPath("/root/hip1")));
+  MDagModifier modifier;
+  MObjectArray nodes = proxy->makeUsdTransformChains(prims, modifier, AL::usdmaya::nodes::ProxyShape::kRequired);
+  EXPECT_EQ(MStatus(MS::kSuccess), modifier.doIt());
+  ASSERT_EQ(1u, nodes.length());
+  MPlug translate = MFnDependencyNode(nodes[0]).findPlug("translate");
+  EXPECT_FALSE(translate.isLocked());
+
+  // each edit sends its own notice, but nothing is checked until the queued changes are processed
+  MAnimControl::setCurrentTime(MTime(1.0, MTime::uiUnit()));
+  stage->GetPrimAtPath(SdfPath("/root/hip1")).SetMetadata(AL::usdmaya::Metadata::locked, AL::usdmaya::Metadata::lockTransform);
+  stage->GetPrimAtPath(SdfPath("/root/hip1")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+  stage->GetPrimAtPath(SdfPath("/root/hip2")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+  EXPECT_TRUE(proxy->hasChangedObjects());
+  EXPECT_FALSE(translate.isLocked());
+  EXPECT_FALSE(proxy->selectabilityDB().isPathUnselectable(SdfPath("/root/hip1")));
+  EXPECT_FALSE(proxy->selectabilityDB().isPathUnselectable(SdfPath("/root/hip2")));
+
+  // changing the time processes all of them together
+  MAnimControl::setCurrentTime(MTime(2.0, MTime::uiUnit()));
+  EXPECT_FALSE(proxy->hasChangedObjects());
+  EXPECT_TRUE(translate.isLocked());
+  EXPECT_TRUE(proxy->selectabilityDB().isPathUnselectable(SdfPath("/root/hip1")));
+  EXPECT_TRUE(proxy->selectabilityDB().isPathUnselectable(SdfPath("/root/hip2")));
+
+  // as does an explicit call to processChangedObjects (e.g. from a batch session)
+  stage->GetPrimAtPath(SdfPath("/root/hip1")).SetMetadata(AL::usdmaya::Metadata::locked, AL::usdmaya::Metadata::lockUnlocked);
+  EXPECT_TRUE(translate.isLocked());
+  proxy->processChangedObjects();
+  EXPECT_FALSE(proxy->hasChangedObjects());
+  EXPECT_FALSE(translate.isLocked());
+}
+
+// Make sure the useExtentsHint attribute determines whether the extentsHint of a model is used as its bounds
+TEST(ProxyShape, useExtentsHint)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_useExtentsHint.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform model = UsdGeomXform::Define(stage, SdfPath("/model"));
+    UsdModelAPI(model.GetPrim()).SetKind(KindTokens->component);
+    VtVec3fArray hint(2);
+    hint[0] = GfVec3f(-5.0f);
+    hint[1] = GfVec3f(5.0f);
+    UsdGeomModelAPI(model).SetExtentsHint(hint);
+    UsdGeomCube::Define(stage, SdfPath("/model/cube"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  EXPECT_TRUE(proxy->useExtentsHintPlug().asBool());
+
+  MBoundingBox bounds = proxy->boundingBox();
+  EXPECT_NEAR(-5.0, bounds.min().x, 1e-5);
+  EXPECT_NEAR(5.0, bounds.max().x, 1e-5);
+
+  // the cube itself has a size of 2
+  proxy->useExtentsHintPlug().setBool(false);
+  bounds = proxy->boundingBox();
+  EXPECT_NEAR(-1.0, bounds.min().x, 1e-5);
+  EXPECT_NEAR(1.0, bounds.max().x, 1e-5);
+}
+
 // Make sure that if we make a brand new layer, make it the edit target, then
 // change it away, then save, the layer is saved
 TEST(ProxyShape, editTargetChangeAndSave)
@@ -1032,6 +1561,268 @@ TEST(ProxyShape, editTargetChangeAndSave)
   }
 }
 
+// bool ProxyShape::waitForStage()
+// StageLoadState ProxyShape::stageLoadState() const
+TEST(ProxyShape, asyncLoadStage)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_asyncLoadStage.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/child"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+
+  EXPECT_EQ(AL::usdmaya::nodes::ProxyShape::kStageUnloaded, proxy->stageLoadState());
+  EXPECT_FLOAT_EQ(0.0f, proxy->stageLoadProgress());
+
+  // the tests run in batch mode, where async loads fall back to a synchronous load
+  proxy->asyncLoadPlug().setValue(true);
+  proxy->filePathPlug().setString(temp_path.c_str());
+
+  EXPECT_TRUE(proxy->waitForStage());
+  EXPECT_FALSE(proxy->isStageLoading());
+  EXPECT_EQ(AL::usdmaya::nodes::ProxyShape::kStageLoaded, proxy->stageLoadState());
+  EXPECT_FLOAT_EQ(1.0f, proxy->stageLoadProgress());
+  EXPECT_EQ(int(AL::usdmaya::nodes::ProxyShape::kStageLoaded), proxy->loadStatePlug().asInt());
+
+  auto stage = proxy->getUsdStage();
+  ASSERT_TRUE(stage);
+  EXPECT_TRUE(stage->GetPrimAtPath(SdfPath("/root/child")));
+
+  // an invalid path should not leave the proxy in a loading state
+  proxy->filePathPlug().setString("/this/file/does/not/exist.usda");
+  EXPECT_FALSE(proxy->waitForStage());
+  EXPECT_EQ(AL::usdmaya::nodes::ProxyShape::kStageLoadFailed, proxy->stageLoadState());
+}
+
+// bool ProxyShape::waitForStage() (with the stage opened on a worker thread)
+TEST(ProxyShape, asyncLoadStageOnWorker)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_asyncLoadStageOnWorker.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/child"));
+    stage->Export(temp_path, false);
+  }
+
+  // batch sessions have no idle loop, so they have to opt in to asynchronous loads
+  MGlobal::setOptionVarValue("AL_usdmaya_asyncLoadInBatch", 1);
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+
+  // the load state is reported by the node, and cannot be set by the user
+  EXPECT_FALSE(MFnAttribute(proxy->loadStatePlug().attribute()).isWritable());
+  EXPECT_FALSE(MFnAttribute(proxy->loadProgressPlug().attribute()).isWritable());
+
+  proxy->asyncLoadPlug().setValue(true);
+  proxy->filePathPlug().setString(temp_path.c_str());
+  EXPECT_TRUE(proxy->isStageLoading());
+  EXPECT_EQ(int(AL::usdmaya::nodes::ProxyShape::kStageLoading), proxy->loadStatePlug().asInt());
+  EXPECT_FALSE(proxy->getUsdStage());
+
+  EXPECT_TRUE(proxy->waitForStage());
+  EXPECT_EQ(AL::usdmaya::nodes::ProxyShape::kStageLoaded, proxy->stageLoadState());
+  EXPECT_EQ(int(AL::usdmaya::nodes::ProxyShape::kStageLoaded), proxy->loadStatePlug().asInt());
+  EXPECT_FLOAT_EQ(1.0f, proxy->loadProgressPlug().asFloat());
+  ASSERT_TRUE(proxy->getUsdStage());
+  EXPECT_TRUE(proxy->getUsdStage()->GetPrimAtPath(SdfPath("/root/child")));
+
+  // a load that is superseded whilst the worker is still running waits for it to finish
+  proxy->filePathPlug().setString(temp_path.c_str());
+  EXPECT_TRUE(proxy->isStageLoading());
+  proxy->filePathPlug().setString(temp_path.c_str());
+  EXPECT_TRUE(proxy->isStageLoading());
+  EXPECT_TRUE(proxy->waitForStage());
+  EXPECT_TRUE(proxy->getUsdStage()->GetPrimAtPath(SdfPath("/root/child")));
+
+  MGlobal::removeOptionVar("AL_usdmaya_asyncLoadInBatch");
+}
+
+// static void ProxyShape::loadStages(const std::vector<ProxyShape*>& proxies)
+TEST(ProxyShape, loadStagesResolverContexts)
+{
+  MFileIO::newFile(true);
+
+  // two root layers that reference the same search path asset, which resolves next to each root layer
+  auto writeLayers = [](const char* const dir, const char* const child)
+  {
+    const std::string root_path = buildTempPath((std::string(dir) + "/root.usda").c_str());
+    const std::string sub_path = buildTempPath((std::string(dir) + "/sub.usda").c_str());
+    TfMakeDirs(TfGetPathName(root_path), -1, true);
+    {
+      std::ofstream os(sub_path);
+      os << "#usda 1.0\n\ndef Xform \"content\"\n{\n    def Xform \"" << child << "\"\n    {\n    }\n}\n";
+    }
+    {
+      std::ofstream os(root_path);
+      os << "#usda 1.0\n\ndef Xform \"root\" (\n    references = @sub.usda@</content>\n)\n{\n}\n";
+    }
+    return root_path;
+  };
+  const std::string pathA = writeLayers("AL_USDMayaTests_ProxyShape_loadStagesA", "fromA");
+  const std::string pathB = writeLayers("AL_USDMayaTests_ProxyShape_loadStagesB", "fromB");
+
+  auto createProxy = [](const std::string& path)
+  {
+    MFnDagNode fn;
+    MObject xform = fn.create("transform");
+    fn.create("AL_usdmaya_ProxyShape", xform);
+    AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+    proxy->filePathPlug().setString(path.c_str());
+    return proxy;
+  };
+  AL::usdmaya::nodes::ProxyShape* proxyA = createProxy(pathA);
+  AL::usdmaya::nodes::ProxyShape* proxyB = createProxy(pathB);
+
+  // reload both together, each stage must resolve the references relative to its own file
+  AL::usdmaya::nodes::ProxyShape::loadStages({ proxyA, proxyB });
+
+  UsdStageRefPtr stageA = proxyA->getUsdStage();
+  UsdStageRefPtr stageB = proxyB->getUsdStage();
+  ASSERT_TRUE(stageA);
+  ASSERT_TRUE(stageB);
+  EXPECT_TRUE(stageA->GetPrimAtPath(SdfPath("/root/fromA")));
+  EXPECT_FALSE(stageA->GetPrimAtPath(SdfPath("/root/fromB")));
+  EXPECT_TRUE(stageB->GetPrimAtPath(SdfPath("/root/fromB")));
+  EXPECT_FALSE(stageB->GetPrimAtPath(SdfPath("/root/fromA")));
+}
+
+// size_t ProxyShape::iteratePrimHierarchy(const HierarchyIterationPipeline& logics)
+// void ProxyShape::findTaggedPrims(const HierarchyIterationPipeline& additionalLogics)
+TEST(ProxyShape, fusedHierarchyIteration)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_fusedHierarchyIteration.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/root"));
+    UsdGeomXform::Define(stage, SdfPath("/root/a"));
+    UsdGeomXform::Define(stage, SdfPath("/root/a/b"));
+    UsdGeomXform::Define(stage, SdfPath("/root/c"));
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  ASSERT_TRUE(proxy->getUsdStage());
+
+  // the post load process should have walked the stage a single time, visiting each prim once
+  EXPECT_EQ(4u, proxy->primsVisited());
+
+  std::vector<std::string> order;
+  SdfPathVector visited;
+  AL::usdmaya::nodes::HierarchyIterationLogic first;
+  first.preIteration = [&order]() { order.push_back("pre1"); };
+  first.iteration = [&visited](const AL::usdmaya::fileio::TransformIterator&, const UsdPrim& prim)
+    { visited.push_back(prim.GetPath()); };
+  first.postIteration = [&order]() { order.push_back("post1"); };
+
+  // logics without a visitor are still called before and after the traversal
+  AL::usdmaya::nodes::HierarchyIterationLogic second;
+  second.postIteration = [&order]() { order.push_back("post2"); };
+
+  const AL::usdmaya::nodes::HierarchyIterationPipeline logics{ &first, &second };
+  const size_t count = proxy->iteratePrimHierarchy(logics);
+  EXPECT_EQ(count, visited.size());
+  EXPECT_EQ(count, proxy->primsVisited());
+  EXPECT_TRUE(std::find(visited.begin(), visited.end(), SdfPath("/root/a/b")) != visited.end());
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ("pre1", order[0]);
+  EXPECT_EQ("post1", order[1]);
+  EXPECT_EQ("post2", order[2]);
+
+  // running alongside the tagged prim searches should not require another traversal
+  visited.clear();
+  proxy->findTaggedPrims(AL::usdmaya::nodes::HierarchyIterationPipeline{ &first });
+  EXPECT_EQ(count, visited.size());
+  EXPECT_EQ(count, proxy->primsVisited());
+}
+
+// size_t ProxyShape::iteratePrimHierarchy(const HierarchyIterationPipeline& logics, bool allowParallel)
+TEST(ProxyShape, concurrentHierarchyIteration)
+{
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_concurrentHierarchyIteration.usda");
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    for(int i = 0; i < 8; ++i)
+    {
+      const SdfPath parent(TfStringPrintf("/root%d", i));
+      UsdGeomXform::Define(stage, parent);
+      for(int j = 0; j < 16; ++j)
+      {
+        UsdGeomXform::Define(stage, parent.AppendChild(TfToken(TfStringPrintf("child%d", j))));
+      }
+    }
+    stage->GetPrimAtPath(SdfPath("/root3/child7")).SetMetadata(AL::usdmaya::Metadata::locked, AL::usdmaya::Metadata::lockTransform);
+    stage->Export(temp_path, false);
+  }
+
+  MFnDagNode fn;
+  MObject xform = fn.create("transform");
+  MObject shape = fn.create("AL_usdmaya_ProxyShape", xform);
+  AL::usdmaya::nodes::ProxyShape* proxy = (AL::usdmaya::nodes::ProxyShape*)fn.userNode();
+  proxy->filePathPlug().setString(temp_path.c_str());
+  ASSERT_TRUE(proxy->getUsdStage());
+
+  std::atomic<size_t> concurrentCount(0);
+  tbb::enumerable_thread_specific<SdfPathVector> found;
+  AL::usdmaya::nodes::HierarchyIterationLogic logic;
+  logic.threadSafe = true;
+  logic.concurrentIteration = [&concurrentCount, &found](const UsdPrim& prim)
+  {
+    ++concurrentCount;
+    TfToken lock;
+    if(prim.GetMetadata(AL::usdmaya::Metadata::locked, &lock))
+    {
+      found.local().push_back(prim.GetPath());
+    }
+  };
+
+  const AL::usdmaya::nodes::HierarchyIterationPipeline logics{ &logic };
+  const size_t parallelCount = proxy->iteratePrimHierarchy(logics, true);
+  EXPECT_EQ(8u * 17u, parallelCount);
+  EXPECT_EQ(parallelCount, concurrentCount.load());
+
+  SdfPathVector merged;
+  for(auto& paths : found)
+  {
+    merged.insert(merged.end(), paths.begin(), paths.end());
+  }
+  ASSERT_EQ(1u, merged.size());
+  EXPECT_EQ(SdfPath("/root3/child7"), merged[0]);
+
+  // the serial traversal should visit exactly the same prims
+  concurrentCount = 0;
+  EXPECT_EQ(parallelCount, proxy->iteratePrimHierarchy(logics, false));
+  EXPECT_EQ(parallelCount, concurrentCount.load());
+
+  // mixing thread safe logics with serial ones should still walk the stage once, visiting each prim once per logic
+  size_t serialCount = 0;
+  AL::usdmaya::nodes::HierarchyIterationLogic serial;
+  serial.iteration = [&serialCount](const AL::usdmaya::fileio::TransformIterator&, const UsdPrim&) { ++serialCount; };
+  concurrentCount = 0;
+  EXPECT_EQ(parallelCount, proxy->iteratePrimHierarchy(AL::usdmaya::nodes::HierarchyIterationPipeline{ &logic, &serial }, true));
+  EXPECT_EQ(parallelCount, proxy->primsVisited());
+  EXPECT_EQ(parallelCount, serialCount);
+  EXPECT_EQ(parallelCount, concurrentCount.load());
+}
+
 // Test translating a Mesh Prim via the command
 TEST(ManualTranslate, importMeshPrim)
 {
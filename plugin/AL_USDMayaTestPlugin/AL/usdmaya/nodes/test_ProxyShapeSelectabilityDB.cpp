@@ -28,6 +28,7 @@
 #include "maya/MStringArray.h"
 
 #include "pxr/usd/usd/stage.h"
+#include "pxr/usd/sdf/changeBlock.h"
 #include "pxr/usd/sdf/types.h"
 #include "pxr/usd/usd/attribute.h"
 #include "pxr/usd/usdGeom/xform.h"
@@ -115,3 +116,122 @@ TEST(ProxyShapeSelectabilityDB, selectableIsRemoval)
   //Check that the path has been removed from the selectable list
   EXPECT_FALSE(proxyShape->selectabilityDB().isPathUnselectable(expectedSelectable));
 }
+
+/*
+ * Tests that the changes to the stage are processed as they are made when deferObjectsChanged is disabled (the
+ * default), and that changes made within a change block are all picked up.
+ */
+TEST(ProxyShapeSelectabilityDB, selectablesOnDeferredModification)
+{
+  std::function<UsdStageRefPtr()>  constructTransformChain = [] ()
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    stage->DefinePrim(SdfPath("/A/B/C"));
+    stage->DefinePrim(SdfPath("/A/D"));
+    return stage;
+  };
+
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_selectablesOnDeferredModification.usda");
+  AL::usdmaya::nodes::ProxyShape* proxyShape = CreateMayaProxyShape(constructTransformChain, temp_path);
+  EXPECT_FALSE(proxyShape->deferObjectsChangedPlug().asBool());
+
+  UsdStageRefPtr stage = proxyShape->getUsdStage();
+  stage->GetPrimAtPath(SdfPath("/A/B")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+  EXPECT_FALSE(proxyShape->hasChangedObjects());
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/B")));
+
+  {
+    SdfChangeBlock changeBlock;
+    stage->DefinePrim(SdfPath("/A/B/E"));
+    stage->GetPrimAtPath(SdfPath("/A/B/C")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+    stage->GetPrimAtPath(SdfPath("/A/D")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+  }
+  EXPECT_FALSE(proxyShape->hasChangedObjects());
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/B/C")));
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/D")));
+
+  // there is nothing left to process
+  proxyShape->processChangedObjects();
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/B")));
+}
+
+/*
+ * Tests that when deferObjectsChanged is enabled, the selectability changes are queued until processChangedObjects is
+ * called (which maya does once it is idle), whilst the rest of the proxy is kept in sync with the stage immediately.
+ */
+TEST(ProxyShapeSelectabilityDB, selectablesOnQueuedModification)
+{
+  std::function<UsdStageRefPtr()>  constructTransformChain = [] ()
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    stage->DefinePrim(SdfPath("/A/B/C"));
+    stage->DefinePrim(SdfPath("/A/D"));
+    return stage;
+  };
+
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_selectablesOnQueuedModification.usda");
+  AL::usdmaya::nodes::ProxyShape* proxyShape = CreateMayaProxyShape(constructTransformChain, temp_path);
+  proxyShape->deferObjectsChangedPlug().setValue(true);
+  EXPECT_FALSE(proxyShape->hasChangedObjects());
+
+  UsdStageRefPtr stage = proxyShape->getUsdStage();
+  stage->GetPrimAtPath(SdfPath("/A/B")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+  {
+    SdfChangeBlock changeBlock;
+    stage->DefinePrim(SdfPath("/A/B/E"));
+    stage->GetPrimAtPath(SdfPath("/A/D")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+  }
+
+  // the changes are merged, and nothing has been checked yet
+  EXPECT_TRUE(proxyShape->hasChangedObjects());
+  EXPECT_FALSE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/B")));
+  EXPECT_FALSE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/D")));
+
+  proxyShape->processChangedObjects();
+  EXPECT_FALSE(proxyShape->hasChangedObjects());
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/B")));
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/D")));
+
+  // unrelated edits are not queued
+  stage->GetPrimAtPath(SdfPath("/A/B/C")).SetDocumentation("a prim");
+  EXPECT_FALSE(proxyShape->hasChangedObjects());
+
+  // disabling the deferral processes each change as it is made
+  proxyShape->deferObjectsChangedPlug().setValue(false);
+  stage->GetPrimAtPath(SdfPath("/A/D")).SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::selectable);
+  EXPECT_FALSE(proxyShape->hasChangedObjects());
+  EXPECT_FALSE(proxyShape->selectabilityDB().isPathUnselectable(SdfPath("/A/D")));
+}
+
+/*
+ * Tests that edits that do not touch the selectability (e.g. attribute values and other metadata) leave the
+ * selectability database alone, whilst changes to the selectability metadata are still picked up.
+ */
+TEST(ProxyShapeSelectabilityDB, selectablesOnUnrelatedModification)
+{
+  SdfPath expectedSelectable("/A/B");
+  std::function<UsdStageRefPtr()>  constructTransformChain = [&expectedSelectable] ()
+  {
+    UsdStageRefPtr stage = UsdStage::CreateInMemory();
+    UsdGeomXform::Define(stage, SdfPath("/A/B/C"));
+    UsdPrim b = stage->GetPrimAtPath(expectedSelectable);
+    b.SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::unselectable);
+    return stage;
+  };
+
+  MFileIO::newFile(true);
+  const std::string temp_path = buildTempPath("AL_USDMayaTests_ProxyShape_selectablesOnUnrelatedModification.usda");
+  AL::usdmaya::nodes::ProxyShape* proxyShape = CreateMayaProxyShape(constructTransformChain, temp_path);
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(expectedSelectable));
+
+  UsdStageRefPtr stage = proxyShape->getUsdStage();
+  UsdPrim b = stage->GetPrimAtPath(expectedSelectable);
+  UsdGeomXformCommonAPI(stage->GetPrimAtPath(SdfPath("/A/B/C"))).SetTranslate(GfVec3d(1.0, 2.0, 3.0));
+  b.SetDocumentation("a prim that cannot be selected");
+  EXPECT_TRUE(proxyShape->selectabilityDB().isPathUnselectable(expectedSelectable));
+
+  b.SetMetadata(AL::usdmaya::Metadata::selectability, AL::usdmaya::Metadata::selectable);
+  EXPECT_FALSE(proxyShape->selectabilityDB().isPathUnselectable(expectedSelectable));
+}
@@ -33,9 +33,12 @@
 #include "pxr/usd/usd/stage.h"
 #include "pxr/usd/sdf/types.h"
 #include "pxr/usd/usd/attribute.h"
+#include "pxr/usd/usd/notice.h"
 #include "pxr/usd/usdGeom/xform.h"
 #include "pxr/usd/usdGeom/xformCommonAPI.h"
 
+#include <memory>
+
 //#define TEST(X, Y) void X##Y()
 
 //  inline const UsdPrim& prim() const
@@ -1142,6 +1145,117 @@ TEST(Transform, matrixAnimationChannels)
   AL_USDMAYA_UNTESTED;
 }
 
+// Make sure the cached queries on the xform ops only read the animated ops, and pick up new opinions once invalidated
+TEST(Transform, xformOpQueries)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform xform = UsdGeomXform::Define(stage, SdfPath("/tm"));
+  UsdGeomXformOp translate = xform.AddTranslateOp(UsdGeomXformOp::PrecisionDouble, TfToken("translate"));
+  UsdGeomXformOp scale = xform.AddScaleOp(UsdGeomXformOp::PrecisionFloat, TfToken("scale"));
+  translate.Set(GfVec3d(1.0, 0.0, 0.0), UsdTimeCode(1.0));
+  translate.Set(GfVec3d(3.0, 0.0, 0.0), UsdTimeCode(3.0));
+  scale.Set(GfVec3f(2.0f, 2.0f, 2.0f));
+
+  AL::usdmaya::nodes::TransformationMatrix matrix(xform.GetPrim());
+  EXPECT_TRUE(matrix.hasAnimatedTranslation());
+  EXPECT_FALSE(matrix.hasAnimatedScale());
+
+  matrix.updateToTime(UsdTimeCode(2.0));
+  EXPECT_NEAR(2.0, matrix.translation(MSpace::kTransform).x, 1e-5);
+  EXPECT_NEAR(2.0, matrix.scale(MSpace::kTransform).x, 1e-5);
+
+  // a stronger opinion is picked up once the queries have been rebuilt
+  stage->SetEditTarget(stage->GetSessionLayer());
+  translate.Set(GfVec3d(10.0, 0.0, 0.0), UsdTimeCode(1.0));
+  translate.Set(GfVec3d(30.0, 0.0, 0.0), UsdTimeCode(3.0));
+  matrix.invalidateXformOpQueries();
+  matrix.updateToTime(UsdTimeCode(3.0));
+  EXPECT_NEAR(30.0, matrix.translation(MSpace::kTransform).x, 1e-5);
+  EXPECT_NEAR(2.0, matrix.scale(MSpace::kTransform).x, 1e-5);
+}
+
+namespace {
+// counts the change notices sent by a stage
+struct ObjectsChangedCounter : public TfWeakBase
+{
+  ObjectsChangedCounter(const UsdStageRefPtr& stage)
+    { m_key = TfNotice::Register(TfCreateWeakPtr(this), &ObjectsChangedCounter::objectsChanged, stage); }
+  ~ObjectsChangedCounter()
+    { TfNotice::Revoke(m_key); }
+  void objectsChanged(const UsdNotice::ObjectsChanged&)
+    { ++m_count; }
+  TfNotice::Key m_key;
+  uint32_t m_count = 0;
+};
+} // anon
+
+TEST(Transform, batchedPushToPrim)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  std::vector<UsdGeomXformOp> ops;
+  std::vector<std::unique_ptr<AL::usdmaya::nodes::TransformationMatrix> > matrices;
+  for(int i = 0; i < 3; ++i)
+  {
+    UsdGeomXform xform = UsdGeomXform::Define(stage, SdfPath("/tm" + std::to_string(i)));
+    ops.push_back(xform.AddTranslateOp(UsdGeomXformOp::PrecisionDouble, TfToken("translate")));
+    ops.back().Set(GfVec3d(0.0));
+    matrices.emplace_back(new AL::usdmaya::nodes::TransformationMatrix(xform.GetPrim()));
+    matrices.back()->enablePushToPrim(true);
+  }
+
+  ObjectsChangedCounter counter(stage);
+  {
+    AL::usdmaya::nodes::TransformationMatrix::ScopedPushBatch batch;
+    for(int i = 0; i < 3; ++i)
+    {
+      MPxTransformationMatrix& matrix = *matrices[i];
+      matrix.translateTo(MVector(i + 1.0, 0.0, 0.0));
+      matrix.translateTo(MVector(i + 1.0, 2.0, 0.0));
+      EXPECT_TRUE(matrices[i]->pushToPrimPending());
+    }
+
+    // nothing is written until the batch closes
+    EXPECT_EQ(3u, AL::usdmaya::nodes::TransformationMatrix::numPendingPushes());
+    EXPECT_EQ(0u, counter.m_count);
+    GfVec3d value;
+    ops[0].Get(&value);
+    EXPECT_EQ(GfVec3d(0.0), value);
+  }
+
+  // all of the prims are modified in a single change notice
+  EXPECT_EQ(0u, AL::usdmaya::nodes::TransformationMatrix::numPendingPushes());
+  EXPECT_EQ(1u, counter.m_count);
+  for(int i = 0; i < 3; ++i)
+  {
+    EXPECT_FALSE(matrices[i]->pushToPrimPending());
+    GfVec3d value;
+    ops[i].Get(&value);
+    EXPECT_EQ(GfVec3d(i + 1.0, 2.0, 0.0), value);
+  }
+
+  // a matrix that is destroyed whilst queued is not pushed
+  {
+    AL::usdmaya::nodes::TransformationMatrix::ScopedPushBatch batch;
+    static_cast<MPxTransformationMatrix&>(*matrices[0]).translateTo(MVector(5.0, 0.0, 0.0));
+    EXPECT_EQ(1u, AL::usdmaya::nodes::TransformationMatrix::numPendingPushes());
+    matrices[0].reset();
+    EXPECT_EQ(0u, AL::usdmaya::nodes::TransformationMatrix::numPendingPushes());
+  }
+  EXPECT_EQ(1u, counter.m_count);
+
+  // the queue writes anything still queued when it is freed (e.g. when the plugin is unloaded)
+  AL::usdmaya::nodes::TransformationMatrix::beginPushBatch();
+  static_cast<MPxTransformationMatrix&>(*matrices[1]).translateTo(MVector(7.0, 0.0, 0.0));
+  EXPECT_EQ(1u, AL::usdmaya::nodes::TransformationMatrix::numPendingPushes());
+  AL::usdmaya::nodes::TransformationMatrix::freePushQueue();
+  EXPECT_EQ(0u, AL::usdmaya::nodes::TransformationMatrix::numPendingPushes());
+  EXPECT_FALSE(matrices[1]->pushToPrimPending());
+  EXPECT_EQ(2u, counter.m_count);
+  GfVec3d value;
+  ops[1].Get(&value);
+  EXPECT_EQ(GfVec3d(7.0, 0.0, 0.0), value);
+}
+
 //  TransformationMatrix();
 //  TransformationMatrix(const UsdPrim& prim);
 //  void setPrim(const UsdPrim& prim);
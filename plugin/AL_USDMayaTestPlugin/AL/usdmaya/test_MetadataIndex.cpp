@@ -0,0 +1,192 @@
+//
+// Copyright 2017 Animal Logic
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.//
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <AL/usdmaya/Metadata.h>
+#include <AL/usdmaya/MetadataIndex.h>
+#include <gtest/gtest.h>
+
+#include "pxr/base/tf/notice.h"
+#include "pxr/base/tf/weakBase.h"
+#include "pxr/usd/sdf/payload.h"
+#include "pxr/usd/usd/editContext.h"
+#include "pxr/usd/usd/variantSets.h"
+#include "pxr/usd/usdGeom/xform.h"
+
+using namespace AL::usdmaya;
+
+namespace {
+// forwards the layer change notifications to the index, in the same way as the proxy shape
+struct IndexListener : public TfWeakBase
+{
+  IndexListener(MetadataIndex& index)
+    : m_index(index)
+  {
+    m_key = TfNotice::Register(TfCreateWeakPtr(this), &IndexListener::layersDidChange);
+    m_objectsChangedKey = TfNotice::Register(TfCreateWeakPtr(this), &IndexListener::objectsChanged);
+  }
+  ~IndexListener()
+  {
+    TfNotice::Revoke(m_key);
+    TfNotice::Revoke(m_objectsChangedKey);
+  }
+  void layersDidChange(const SdfNotice::LayersDidChange& notice)
+    { m_index.layersDidChange(notice); }
+  void objectsChanged(const UsdNotice::ObjectsChanged& notice)
+    { m_index.objectsChanged(notice); }
+  MetadataIndex& m_index;
+  TfNotice::Key m_key;
+  TfNotice::Key m_objectsChangedKey;
+};
+} // anon
+
+TEST(MetadataIndex, taggedPaths)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform::Define(stage, SdfPath("/A"));
+  UsdGeomXform::Define(stage, SdfPath("/A/B"));
+  UsdGeomXform::Define(stage, SdfPath("/A/B/C"));
+  UsdGeomXform::Define(stage, SdfPath("/D"));
+  stage->GetPrimAtPath(SdfPath("/A/B")).SetMetadata(Metadata::selectability, Metadata::unselectable);
+  stage->GetPrimAtPath(SdfPath("/D")).SetMetadata(Metadata::locked, Metadata::lockTransform);
+
+  MetadataIndex index;
+  EXPECT_FALSE(index.isValid());
+  index.build(stage);
+  EXPECT_TRUE(index.isValid());
+  EXPECT_TRUE(index.isComplete());
+  EXPECT_EQ(2u, index.numTaggedSpecs());
+
+  SdfPathVector paths;
+  index.taggedPaths(MetadataIndex::kSelectability, paths);
+  ASSERT_EQ(1u, paths.size());
+  EXPECT_EQ(SdfPath("/A/B"), paths[0]);
+
+  index.taggedPaths(MetadataIndex::kAllTags, paths);
+  ASSERT_EQ(2u, paths.size());
+  EXPECT_EQ(SdfPath("/A/B"), paths[0]);
+  EXPECT_EQ(SdfPath("/D"), paths[1]);
+
+  index.clear();
+  EXPECT_FALSE(index.isValid());
+  EXPECT_EQ(0u, index.numTaggedSpecs());
+}
+
+TEST(MetadataIndex, layersDidChange)
+{
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdGeomXform::Define(stage, SdfPath("/A"));
+  UsdGeomXform::Define(stage, SdfPath("/A/B"));
+
+  MetadataIndex index;
+  IndexListener listener(index);
+  index.build(stage);
+  EXPECT_EQ(0u, index.numTaggedSpecs());
+
+  // authoring the metadata should add the spec
+  stage->GetPrimAtPath(SdfPath("/A/B")).SetMetadata(Metadata::excludeFromProxyShape, true);
+  SdfPathVector paths;
+  index.taggedPaths(MetadataIndex::kExcludeFromProxyShape, paths);
+  ASSERT_EQ(1u, paths.size());
+  EXPECT_EQ(SdfPath("/A/B"), paths[0]);
+
+  // as should a new tagged prim
+  UsdGeomXform::Define(stage, SdfPath("/A/C"));
+  stage->GetPrimAtPath(SdfPath("/A/C")).SetMetadata(Metadata::selectability, Metadata::unselectable);
+  EXPECT_EQ(2u, index.numTaggedSpecs());
+
+  // clearing the metadata should remove it
+  stage->GetPrimAtPath(SdfPath("/A/B")).ClearMetadata(Metadata::excludeFromProxyShape);
+  index.taggedPaths(MetadataIndex::kAllTags, paths);
+  ASSERT_EQ(1u, paths.size());
+  EXPECT_EQ(SdfPath("/A/C"), paths[0]);
+
+  // and removing the prims should remove the specs beneath them
+  stage->RemovePrim(SdfPath("/A"));
+  EXPECT_EQ(0u, index.numTaggedSpecs());
+}
+
+TEST(MetadataIndex, referencedLayers)
+{
+  SdfLayerRefPtr referenced = SdfLayer::CreateAnonymous();
+  {
+    UsdStageRefPtr stage = UsdStage::Open(referenced);
+    UsdGeomXform::Define(stage, SdfPath("/Model"));
+    UsdGeomXform::Define(stage, SdfPath("/Model/Child"));
+    stage->GetPrimAtPath(SdfPath("/Model/Child")).SetMetadata(Metadata::selectability, Metadata::unselectable);
+  }
+
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  MetadataIndex index;
+  IndexListener listener(index);
+  index.build(stage);
+  EXPECT_TRUE(index.isComplete());
+
+  // tags brought in through a reference are not at the paths of the composed prims, so the index cannot be used alone
+  UsdPrim prim = UsdGeomXform::Define(stage, SdfPath("/Ref")).GetPrim();
+  prim.GetReferences().AddReference(referenced->GetIdentifier(), SdfPath("/Model"));
+  EXPECT_FALSE(index.isComplete());
+  EXPECT_EQ(1u, index.numTaggedSpecs());
+}
+
+TEST(MetadataIndex, variantsAndPayloads)
+{
+  SdfLayerRefPtr variantLayer = SdfLayer::CreateAnonymous();
+  SdfLayerRefPtr payloadLayer = SdfLayer::CreateAnonymous();
+  for(const SdfLayerRefPtr& layer : { variantLayer, payloadLayer })
+  {
+    UsdStageRefPtr stage = UsdStage::Open(layer);
+    UsdGeomXform::Define(stage, SdfPath("/Model"));
+    UsdGeomXform::Define(stage, SdfPath("/Model/Child"));
+    stage->GetPrimAtPath(SdfPath("/Model/Child")).SetMetadata(Metadata::selectability, Metadata::unselectable);
+  }
+
+  UsdStageRefPtr stage = UsdStage::CreateInMemory();
+  UsdPrim switched = UsdGeomXform::Define(stage, SdfPath("/Switched")).GetPrim();
+  UsdVariantSet variantSet = switched.GetVariantSets().AddVariantSet("model");
+  variantSet.AddVariant("empty");
+  variantSet.AddVariant("tagged");
+  variantSet.SetVariantSelection("tagged");
+  {
+    UsdEditContext context(variantSet.GetVariantEditContext());
+    switched.GetReferences().AddReference(variantLayer->GetIdentifier(), SdfPath("/Model"));
+  }
+  variantSet.SetVariantSelection("empty");
+
+  UsdPrim payload = UsdGeomXform::Define(stage, SdfPath("/Payload")).GetPrim();
+  payload.SetPayload(SdfPayload(payloadLayer->GetIdentifier(), SdfPath("/Model")));
+  stage->Unload(SdfPath("/Payload"));
+
+  MetadataIndex index;
+  IndexListener listener(index);
+  index.build(stage);
+  EXPECT_TRUE(index.isComplete());
+  EXPECT_EQ(0u, index.numTaggedSpecs());
+
+  // selecting the variant brings the tagged layer into the stage
+  variantSet.SetVariantSelection("tagged");
+  EXPECT_FALSE(index.isComplete());
+  EXPECT_EQ(1u, index.numTaggedSpecs());
+  variantSet.SetVariantSelection("empty");
+  EXPECT_TRUE(index.isComplete());
+
+  // as does loading the payload, which does not modify any layer
+  stage->Load(SdfPath("/Payload"));
+  EXPECT_FALSE(index.isComplete());
+  EXPECT_EQ(1u, index.numTaggedSpecs());
+  stage->Unload(SdfPath("/Payload"));
+  EXPECT_TRUE(index.isComplete());
+  EXPECT_EQ(0u, index.numTaggedSpecs());
+}
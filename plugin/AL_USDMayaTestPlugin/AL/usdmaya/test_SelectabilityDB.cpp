@@ -34,9 +34,10 @@ TEST(SelectabilityDB, makingParentPathsSelectable)
     EXPECT_TRUE(selectablePaths[0] == childPath);
 
     selectableDB.addPathAsUnselectable(grandchildPath);
+    const SdfPathVector& updatedPaths = selectableDB.getUnselectablePaths();
 
-    ASSERT_TRUE(selectablePaths.size() == 2);
-    EXPECT_TRUE(selectablePaths[1] == grandchildPath);
+    ASSERT_TRUE(updatedPaths.size() == 2);
+    EXPECT_TRUE(updatedPaths[1] == grandchildPath);
   }
 }
 /*
@@ -80,11 +81,58 @@ TEST(SelectabilityDB, removePaths)
   {
     //
     selectable.addPathAsUnselectable(childPath);
-    const SdfPathVector& unselectablePaths = selectable.getUnselectablePaths();
-    EXPECT_TRUE(unselectablePaths.size() == 1);
+    EXPECT_TRUE(selectable.getUnselectablePaths().size() == 1);
     selectable.addPathAsUnselectable(grandchildPath);
-    EXPECT_TRUE(unselectablePaths.size() == 2);
+    EXPECT_TRUE(selectable.getUnselectablePaths().size() == 2);
     selectable.removePathAsUnselectable(childPath);
-    EXPECT_TRUE(unselectablePaths.size() == 1);
+    EXPECT_TRUE(selectable.getUnselectablePaths().size() == 1);
   }
 }
+
+/*
+ * Test that the batch API keeps the paths sorted, and that the inherited state can be queried
+ */
+// void SelectableDB::addPathsAsUnselectable(const SdfPathVector& paths)
+// void SelectableDB::removePathsAsUnselectable(const SdfPathVector& paths)
+// SdfPath SelectableDB::findUnselectableAncestor(const SdfPath& path) const
+// bool SelectableDB::hasUnselectableDescendants(const SdfPath& path) const
+TEST(SelectabilityDB, inheritedState)
+{
+  SdfPath rootPath        ("/A");
+  SdfPath childPath       ("/A/B");
+  SdfPath grandchildPath  ("/A/B/C");
+  SdfPath secondChildPath ("/A/D");
+  SdfPath otherRootPath   ("/E");
+
+  SelectabilityDB selectable;
+  selectable.addPathsAsUnselectable(SdfPathVector{ otherRootPath, grandchildPath, childPath, grandchildPath });
+
+  const SdfPathVector& unselectablePaths = selectable.getUnselectablePaths();
+  ASSERT_EQ(3u, unselectablePaths.size());
+  EXPECT_TRUE(std::is_sorted(unselectablePaths.begin(), unselectablePaths.end()));
+
+  EXPECT_EQ(childPath, selectable.findUnselectableAncestor(childPath));
+  EXPECT_EQ(grandchildPath, selectable.findUnselectableAncestor(grandchildPath));
+  EXPECT_EQ(childPath, selectable.findUnselectableAncestor(childPath.AppendChild(TfToken("F"))));
+  EXPECT_TRUE(selectable.findUnselectableAncestor(secondChildPath).IsEmpty());
+
+  EXPECT_TRUE(selectable.isPathExplicitlyUnselectable(childPath));
+  EXPECT_FALSE(selectable.isPathExplicitlyUnselectable(rootPath));
+
+  EXPECT_TRUE(selectable.hasUnselectableDescendants(rootPath));
+  EXPECT_TRUE(selectable.hasUnselectableDescendants(childPath));
+  EXPECT_FALSE(selectable.hasUnselectableDescendants(grandchildPath));
+
+  // the list of paths is rebuilt from the tree when next requested
+  selectable.removePathsAsUnselectable(SdfPathVector{ grandchildPath, childPath });
+  const SdfPathVector& remainingPaths = selectable.getUnselectablePaths();
+  ASSERT_EQ(1u, remainingPaths.size());
+  EXPECT_EQ(otherRootPath, remainingPaths[0]);
+  EXPECT_FALSE(selectable.isPathUnselectable(grandchildPath));
+  EXPECT_FALSE(selectable.hasUnselectableDescendants(rootPath));
+  EXPECT_TRUE(selectable.isPathUnselectable(otherRootPath.AppendChild(TfToken("F"))));
+
+  selectable.clear();
+  EXPECT_TRUE(unselectablePaths.empty());
+  EXPECT_FALSE(selectable.isPathUnselectable(otherRootPath));
+}